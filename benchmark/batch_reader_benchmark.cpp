@@ -0,0 +1,67 @@
+// Compares reading the per-process files of a scan through io_uring with
+// the synchronous open/pread/close loop. Live pids are reused round robin
+// to stand in for 1k, 10k and 50k processes.
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "parser_factory/batch_reader.h"
+#include "parser_factory/parser.h"
+
+using parser_factory::BatchReader;
+
+namespace {
+
+typedef struct Result {
+  double milliseconds;
+  unsigned long long syscalls;
+  std::size_t bytes;
+} result_t;
+
+// stat and io of every simulated process
+Result Scan(BatchReader& reader, const std::vector<int>& pids,
+            std::size_t processes) {
+  static const char* const kFiles[] = {"stat", "io"};
+  std::size_t bytes = 0;
+  unsigned long long const syscalls = reader.Syscalls();
+  auto const start = std::chrono::steady_clock::now();
+  reader.Read(
+      processes * 2,
+      [&pids](std::size_t i, char* path, std::size_t size) {
+        std::snprintf(path, size, "/proc/%d/%s", pids[(i / 2) % pids.size()],
+                      kFiles[i % 2]);
+      },
+      [&bytes](std::size_t, std::string_view data, int) {
+        bytes += data.size();
+      });
+  std::chrono::duration<double, std::milli> const elapsed =
+      std::chrono::steady_clock::now() - start;
+  return {elapsed.count(), reader.Syscalls() - syscalls, bytes};
+}
+
+}  // namespace
+
+int main() {
+  parser_factory::ProcessParser parser;
+  std::vector<int> const pids = parser.GetPids();
+  if (pids.empty()) {
+    std::fprintf(stderr, "no processes found under /proc\n");
+    return 1;
+  }
+  BatchReader sync(BatchReader::Backend::kSync);
+  BatchReader uring(BatchReader::Backend::kAuto);
+  if (!uring.Uring()) {
+    std::printf("io_uring unavailable, both columns use pread\n");
+  }
+  std::printf("%10s %14s %12s %14s %12s\n", "processes", "sync syscalls",
+              "sync ms", "uring syscalls", "uring ms");
+  for (std::size_t processes : {1000, 10000, 50000}) {
+    // Warm the dentry cache so the first backend is not penalized
+    Scan(sync, pids, processes);
+    Result const a = Scan(sync, pids, processes);
+    Result const b = Scan(uring, pids, processes);
+    std::printf("%10zu %14llu %12.2f %14llu %12.2f\n", processes, a.syscalls,
+                a.milliseconds, b.syscalls, b.milliseconds);
+  }
+  return 0;
+}
@@ -0,0 +1,78 @@
+#ifndef AGENT_H
+#define AGENT_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "exporter/delta_codec.h"
+#include "snapshot/snapshot_publisher.h"
+
+namespace exporter {
+
+/*
+Streams the published snapshots of this host to an Aggregator on a Unix
+socket ("unix:/run/monitor-agg.sock") or loopback TCP ("127.0.0.1:9200").
+
+The collector wakes the agent thread through an eventfd, the latest
+snapshot is delta encoded against the one sent before it. At most one
+frame is in flight: while the aggregator has not taken it, newer
+snapshots only mark the stream dirty and the latest one is encoded once
+the socket drains, so a slow aggregator sees fewer ticks instead of a
+growing queue. A lost connection is retried with exponential backoff and
+restarts the stream with a keyframe.
+*/
+class Agent {
+ public:
+  Agent(snapshot::SnapshotPublisher& publisher, std::string address,
+        std::string name);
+  Agent(const Agent&) = delete;
+  Agent& operator=(const Agent&) = delete;
+  ~Agent();
+
+  // Throws std::runtime_error when the address is malformed, an absent
+  // aggregator is only retried
+  void Start();
+  void Stop();
+
+  std::uint64_t Frames() const { return frames_.load(); }
+  std::uint64_t Bytes() const { return bytes_.load(); }
+  // Snapshots never sent because the aggregator was behind
+  std::uint64_t Skipped() const { return skipped_.load(); }
+
+ private:
+  void Run();
+  void Connect();
+  void Disconnect();
+  // Encodes the latest snapshot when nothing is in flight
+  void Encode();
+  // Sends what it can of the frame in flight, false once the peer is gone
+  bool Flush();
+
+  snapshot::SnapshotPublisher& publisher_;
+  snapshot::SnapshotPublisher::Reader reader_;
+  std::string address_;
+  std::string name_;
+  int socket_fd_{-1};
+  int wake_fd_{-1};
+  int listener_id_{0};
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+  DeltaEncoder encoder_;
+  std::string_view frame_;
+  std::size_t sent_{0};
+  std::uint64_t sent_sequence_{0};
+  int backoff_ms_{0};
+  // Next connection attempt while disconnected, kept across wakeups
+  std::chrono::steady_clock::time_point reconnect_at_{};
+  std::atomic<std::uint64_t> frames_{0};
+  std::atomic<std::uint64_t> bytes_{0};
+  std::atomic<std::uint64_t> skipped_{0};
+};
+
+}  // namespace exporter
+
+#endif  // AGENT_H
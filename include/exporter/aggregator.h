@@ -0,0 +1,85 @@
+#ifndef AGGREGATOR_H
+#define AGGREGATOR_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "exporter/delta_codec.h"
+#include "snapshot/process_tree.h"
+#include "snapshot/snapshot_publisher.h"
+
+namespace exporter {
+
+/*
+Merges the streams of many Agents into one SnapshotPublisher, so the
+display and the exporters show every host of a machine pool at once.
+
+One epoll thread accepts agents and decodes their frames. Sources are
+kept by name in order of first contact, an agent that reconnects gets
+its old slot and history back. Every interval, when anything arrived or
+an agent left, a merged snapshot is published: the process rows of all
+connected sources, ProcessRow::source telling them apart, the system
+values averaged or summed over them, and one SourceRow per source with
+its recent CPU history.
+*/
+class Aggregator {
+ public:
+  Aggregator(snapshot::SnapshotPublisher& publisher, std::string address,
+             std::chrono::milliseconds interval, std::size_t history = 300);
+  Aggregator(const Aggregator&) = delete;
+  Aggregator& operator=(const Aggregator&) = delete;
+  ~Aggregator();
+
+  // Binds and starts accepting, throws std::runtime_error when binding fails
+  void Start();
+  void Stop();
+
+ private:
+  typedef struct Connection {
+    std::string buffer;  // received bytes not yet decoded
+    DeltaDecoder decoder;
+    int source{-1};  // index into sources_ once the first frame named it
+  } connection_t;
+
+  typedef struct Source {
+    snapshot::source_row_t row;
+    int fd{-1};  // connection streaming it, -1 while disconnected
+    long uptime{0};
+    int running_processes{0};
+    std::string operating_system;
+    std::string kernel;
+    std::vector<snapshot::ProcessRow> processes;
+    snapshot::ProcessTree tree;
+  } source_t;
+
+  void Run();
+  void Accept();
+  void OnReadable(int fd, Connection& connection);
+  // False when the frame is malformed and the connection has to go
+  bool OnFrame(int fd, Connection& connection, std::string_view payload);
+  void Close(int fd);
+  void Publish();
+
+  snapshot::SnapshotPublisher& publisher_;
+  std::string address_;
+  std::chrono::milliseconds interval_;
+  std::size_t history_;
+  int listen_fd_{-1};
+  int epoll_fd_{-1};
+  int wake_fd_{-1};
+  int timer_fd_{-1};
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+  std::unordered_map<int, connection_t> connections_;
+  std::vector<source_t> sources_;
+  bool changed_{false};
+};
+
+}  // namespace exporter
+
+#endif  // AGGREGATOR_H
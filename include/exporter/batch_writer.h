@@ -0,0 +1,23 @@
+#ifndef BATCH_WRITER_H
+#define BATCH_WRITER_H
+
+#include <string_view>
+
+#include "options.h"
+#include "snapshot/snapshot_publisher.h"
+
+namespace exporter {
+
+/*
+Headless mode. Writes every snapshot the collector publishes as one
+record to stdout or options.output until options.count records were
+written or SIGINT/SIGTERM arrives. Returns the process exit status.
+*/
+int RunBatch(snapshot::SnapshotPublisher& publisher, const Options& options);
+
+// Writes all of data to fd, retrying short writes. False on error.
+bool WriteAll(int fd, std::string_view data);
+
+}  // namespace exporter
+
+#endif  // BATCH_WRITER_H
@@ -0,0 +1,74 @@
+#ifndef DELTA_CODEC_H
+#define DELTA_CODEC_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "snapshot/system_snapshot.h"
+
+namespace exporter {
+
+/*
+Wire format between an Agent and an Aggregator. Every frame is a
+little-endian u32 payload length followed by the payload:
+
+  u8      kind, 1 keyframe or 2 delta
+  varint  mask of the system fields that follow, sequence and timestamp
+          as differences to the previous frame
+  varint  number of exited pids, then each as the difference to the one
+          before it
+  varint  number of new or changed rows, by ascending pid, each one the
+          pid difference, a varint mask of the fields that changed and
+          those fields
+
+Integers are zigzag varints, memory sizes as differences to the last
+value sent, rates and utilizations raw little-endian IEEE floats. Every
+fixed-width value is written byte by byte, so hosts of either byte order
+understand each other. A keyframe starts
+from nothing, a pid whose starttime changed is sent as a new process.
+Process uptime and subtrees are derived by the receiver, the cgroup
+table and the per-thread views are not streamed.
+*/
+class DeltaEncoder {
+ public:
+  // The returned view stays valid until the next call
+  std::string_view Encode(const snapshot::SystemSnapshot& snapshot,
+                          const std::string& name);
+  // The next frame is a keyframe, e.g. for a new connection
+  void Reset();
+
+ private:
+  std::string buffer_;
+  bool keyframe_{true};
+  snapshot::SystemSnapshot last_;  // system fields of the last frame
+  std::string name_;
+  std::vector<snapshot::ProcessRow> rows_;  // last frame by pid
+  std::vector<snapshot::ProcessRow> scratch_;
+};
+
+// Payload length of the frame starting at data, which holds 4 bytes
+std::uint32_t FrameLength(const char* data);
+
+// Rebuilds the snapshots of one stream, frame by frame
+class DeltaDecoder {
+ public:
+  // payload is one frame without its length. False when it is malformed
+  // or a delta came without a keyframe before it, the stream is lost then.
+  bool Decode(std::string_view payload);
+  // Processes by ascending pid, without source, cgroup or subtree
+  const snapshot::SystemSnapshot& Snapshot() const { return snapshot_; }
+  const std::string& Name() const { return name_; }
+
+ private:
+  snapshot::SystemSnapshot snapshot_;
+  std::string name_;
+  bool synced_{false};
+  std::vector<int> exited_;
+  std::vector<snapshot::ProcessRow> scratch_;
+};
+
+}  // namespace exporter
+
+#endif  // DELTA_CODEC_H
@@ -0,0 +1,67 @@
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "exporter/prometheus_renderer.h"
+#include "snapshot/snapshot_publisher.h"
+
+namespace exporter {
+
+/*
+Serves GET /metrics on a loopback TCP port ("127.0.0.1:9100") or a Unix
+socket ("unix:/run/monitor.sock") from one epoll thread.
+
+The collector wakes the thread through an eventfd after each publish,
+the response is rendered right then and kept as one shared immutable
+buffer. Every scrape until the next tick just writes that buffer, so
+parallel scrapers never cause /proc reads or re-serialization.
+*/
+class MetricsServer {
+ public:
+  MetricsServer(snapshot::SnapshotPublisher& publisher, std::string address);
+  MetricsServer(const MetricsServer&) = delete;
+  MetricsServer& operator=(const MetricsServer&) = delete;
+  ~MetricsServer();
+
+  // Binds and starts serving, throws std::runtime_error when binding fails
+  void Start();
+  void Stop();
+
+ private:
+  typedef struct Connection {
+    std::string request;
+    std::shared_ptr<const std::string> response;
+    std::size_t sent{0};
+  } connection_t;
+
+  void Run();
+  void Render();
+  void Accept();
+  void OnReadable(int fd, Connection& connection);
+  void OnWritable(int fd, Connection& connection);
+  void Close(int fd);
+
+  snapshot::SnapshotPublisher& publisher_;
+  snapshot::SnapshotPublisher::Reader reader_;
+  std::string address_;
+  int listen_fd_{-1};
+  int epoll_fd_{-1};
+  int wake_fd_{-1};
+  int listener_id_{0};
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+  PrometheusRenderer renderer_;
+  std::uint64_t rendered_sequence_{0};
+  std::shared_ptr<const std::string> response_;
+  std::unordered_map<int, connection_t> connections_;
+};
+
+}  // namespace exporter
+
+#endif  // METRICS_SERVER_H
@@ -0,0 +1,66 @@
+#ifndef PROMETHEUS_RENDERER_H
+#define PROMETHEUS_RENDERER_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "snapshot/system_snapshot.h"
+#include "snapshot/top_n.h"
+
+namespace exporter {
+
+/*
+Renders a snapshot in the Prometheus text exposition format (0.0.4).
+Host wide gauges are always exported, per-process series only for the
+top_processes processes by CPU to keep the series count bounded.
+*/
+class PrometheusRenderer {
+ public:
+  explicit PrometheusRenderer(std::size_t top_processes = 20);
+
+  // Complete HTTP/1.1 200 response, headers included, ready to be sent
+  std::string RenderResponse(const snapshot::SystemSnapshot& snapshot);
+  std::string_view RenderBody(const snapshot::SystemSnapshot& snapshot);
+
+ private:
+  void Family(std::string_view name, std::string_view type,
+              std::string_view help);
+  void Sample(std::string_view name, double value);
+  void CpuSample(std::string_view name, int cpu, double value);
+  // One series with a single label, e.g. window="1m"
+  void LabeledSample(std::string_view name, std::string_view label,
+                     std::string_view text, double value);
+  // quantile is left out of the labels when empty
+  void LatencySample(std::string_view name, std::string_view collector,
+                     std::string_view quantile, double value);
+  void CgroupSample(std::string_view name, const snapshot::CgroupRow& cgroup,
+                    double value);
+  // One monitor_pressure_stall_ratio series, kind "some" or "full"
+  void PressureSample(const snapshot::PressureRow& pressure,
+                      std::string_view kind, std::string_view window,
+                      float percent);
+  // kind is left out of the labels when empty
+  void NodeSample(std::string_view name, int node, std::string_view kind,
+                  double value);
+  // One monitor_interrupt_source_per_second series
+  void InterruptSample(const snapshot::InterruptSource& source);
+  void SourceSample(std::string_view name, const snapshot::SourceRow& source,
+                    double value);
+  // Rows of an aggregator are labelled with the name of their source
+  void ProcessSample(std::string_view name, const snapshot::ProcessRow& row,
+                     double value);
+  void Append(std::string_view text);
+  void AppendValue(double value);
+  void AppendLabelValue(std::string_view text);
+
+  std::size_t top_processes_;
+  snapshot::TopNSelector selector_;
+  std::string body_;
+  const std::vector<snapshot::SourceRow>* sources_{nullptr};
+};
+
+}  // namespace exporter
+
+#endif  // PROMETHEUS_RENDERER_H
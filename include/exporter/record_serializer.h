@@ -0,0 +1,91 @@
+#ifndef RECORD_SERIALIZER_H
+#define RECORD_SERIALIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "options.h"
+#include "snapshot/system_snapshot.h"
+
+namespace exporter {
+
+/*
+Turns snapshots into records without iostreams. Numbers are written with
+std::to_chars straight into one buffer that keeps its capacity between
+calls, so a steady process table serializes without allocating.
+
+jsonl   one JSON object per tick, process table nested under "processes"
+csv     one row per process, prefixed with the tick timestamp and sequence
+binary  per tick a u32 payload length followed by the payload: the fixed
+        SystemHeader, then one ProcessRecord per process. Everything is
+        in host byte order, as in the shared-memory segment using the
+        same records, so the stream is meant for readers on the same host.
+*/
+class RecordSerializer {
+ public:
+#pragma pack(push, 1)
+  typedef struct SystemHeader {
+    std::uint64_t sequence;
+    std::int64_t timestamp_ns;
+    float cpu_utilization;
+    float memory_utilization;
+    std::int64_t uptime;
+    std::int32_t total_processes;
+    std::int32_t running_processes;
+    std::uint32_t process_count;
+  } system_header_t;
+
+  typedef struct ProcessRecord {
+    std::int32_t pid;
+    std::int32_t ppid;
+    char state;
+    char comm[16];
+    float cpu_utilization;
+    std::int64_t rss_kb;
+    std::int64_t num_threads;
+    std::uint64_t starttime;
+    std::int64_t uptime;
+    double io_rate;
+    double energy_joules;
+  } process_record_t;
+#pragma pack(pop)
+
+  explicit RecordSerializer(RecordFormat format);
+
+  // Conversions between snapshots and the fixed binary records, shared
+  // with the shared-memory segment which uses the same layout
+  static system_header_t ToHeader(const snapshot::SystemSnapshot& snapshot);
+  static process_record_t ToRecord(const snapshot::ProcessRow& row);
+  static void FromHeader(const system_header_t& header,
+                         snapshot::SystemSnapshot& snapshot);
+  static snapshot::ProcessRow FromRecord(const process_record_t& record);
+
+  // Header emitted once at the start of a stream (CSV column names)
+  std::string_view Preamble();
+  // The returned view stays valid until the next call
+  std::string_view Serialize(const snapshot::SystemSnapshot& snapshot);
+
+ private:
+  void SerializeJson(const snapshot::SystemSnapshot& snapshot);
+  void SerializeCsv(const snapshot::SystemSnapshot& snapshot);
+  void SerializeBinary(const snapshot::SystemSnapshot& snapshot);
+
+  char* Reserve(std::size_t bytes);
+  void Append(std::string_view text);
+  void Append(char c);
+  template <typename T>
+  void AppendNumber(T value);
+  void AppendFixed(double value, int precision);
+  void AppendJsonString(std::string_view text);
+  void AppendCsvString(std::string_view text);
+
+  RecordFormat format_;
+  std::vector<char> buffer_;
+  std::size_t size_{0};
+};
+
+}  // namespace exporter
+
+#endif  // RECORD_SERIALIZER_H
@@ -0,0 +1,113 @@
+#ifndef SHM_SEGMENT_H
+#define SHM_SEGMENT_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include "exporter/record_serializer.h"
+#include "snapshot/snapshot_publisher.h"
+#include "snapshot/system_snapshot.h"
+
+namespace exporter {
+
+constexpr char kShmDefaultName[] = "/green_sys";
+constexpr std::uint32_t kShmVersion = 1;
+constexpr std::uint32_t kShmDefaultCapacity = 65536;
+
+/*
+Fixed layout of the POSIX shared-memory segment. The header is followed
+by capacity ProcessRecords. sequence is a seqlock: the writer makes it
+odd before touching the payload and even again afterwards, readers copy
+the payload and retry when sequence was odd or changed meanwhile.
+*/
+typedef struct ShmLayout {
+  char magic[8];  // "GRNSYS\0\0"
+  std::uint32_t version;
+  std::uint32_t capacity;
+  std::uint32_t record_size;
+  std::uint32_t truncated;  // processes that did not fit into capacity
+  alignas(64) std::atomic<std::uint64_t> sequence;
+  alignas(64) RecordSerializer::SystemHeader system;
+  char operating_system[64];
+  char kernel[64];
+} shm_layout_t;
+
+// Writes every snapshot the collector publishes into the segment
+class ShmWriter {
+ public:
+  ShmWriter(snapshot::SnapshotPublisher& publisher, std::string name,
+            std::uint32_t capacity = kShmDefaultCapacity);
+  ShmWriter(const ShmWriter&) = delete;
+  ShmWriter& operator=(const ShmWriter&) = delete;
+  ~ShmWriter();
+
+  // Creates and maps the segment, throws std::runtime_error on failure
+  // or when another live writer owns a segment of the same name
+  void Start();
+  void Stop();
+  void Write(const snapshot::SystemSnapshot& snapshot);
+
+ private:
+  snapshot::SnapshotPublisher& publisher_;
+  snapshot::SnapshotPublisher::Reader reader_;
+  std::string name_;
+  std::uint32_t capacity_;
+  std::size_t size_{0};
+  ShmLayout* layout_{nullptr};
+  int fd_{-1};  // kept open to hold the writer's lock
+  int listener_id_{0};
+};
+
+// Maps an existing segment read only, reading it needs no syscalls
+class ShmReader {
+ public:
+  explicit ShmReader(std::string name);
+  ShmReader(const ShmReader&) = delete;
+  ShmReader& operator=(const ShmReader&) = delete;
+  ~ShmReader();
+
+  // Throws std::runtime_error when the segment is missing or incompatible
+  void Open();
+  std::uint64_t Sequence() const;
+  // Copies a consistent snapshot and returns the sequence it was validated
+  // against, 0 when the writer kept it busy
+  std::uint64_t Read(snapshot::SystemSnapshot& snapshot) const;
+
+ private:
+  std::string name_;
+  std::size_t size_{0};
+  const ShmLayout* layout_{nullptr};
+};
+
+/*
+Feeds a local SnapshotPublisher from a segment so the display and the
+exporters work unchanged on top of another monitor's collection.
+*/
+class ShmAttach {
+ public:
+  ShmAttach(ShmReader& reader, snapshot::SnapshotPublisher& publisher,
+            std::chrono::milliseconds poll = std::chrono::milliseconds(100));
+  ShmAttach(const ShmAttach&) = delete;
+  ShmAttach& operator=(const ShmAttach&) = delete;
+  ~ShmAttach();
+
+  void Start();
+  void Stop();
+
+ private:
+  void Run();
+
+  ShmReader& reader_;
+  snapshot::SnapshotPublisher& publisher_;
+  std::chrono::milliseconds poll_;
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+};
+
+}  // namespace exporter
+
+#endif  // SHM_SEGMENT_H
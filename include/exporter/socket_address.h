@@ -0,0 +1,23 @@
+#ifndef SOCKET_ADDRESS_H
+#define SOCKET_ADDRESS_H
+
+#include <string>
+
+namespace exporter {
+
+// Addresses are "unix:/path/to.sock", "host:port" or a bare port, TCP
+// hosts are IPv4 loopback literals (127.0.0.0/8) and default to 127.0.0.1.
+// Other hosts are rejected, nothing served here is authenticated.
+
+// Non-blocking listening socket. A stale unix socket file is replaced.
+// Throws std::runtime_error when the address is malformed or taken.
+int ListenOn(const std::string& address);
+// Non-blocking connected socket, -1 with errno set when the peer is not
+// there. Throws std::runtime_error when the address is malformed.
+int ConnectTo(const std::string& address);
+// The socket file of a unix address, empty for TCP
+std::string UnixPath(const std::string& address);
+
+}  // namespace exporter
+
+#endif  // SOCKET_ADDRESS_H
@@ -1,10 +1,16 @@
 #ifndef FORMAT_H
 #define FORMAT_H
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 namespace Format {
-std::string ElapsedTime(long times);  // TODO: See src/format.cpp
+std::string ElapsedTime(long times);
+// Writes HH:MM:SS into buffer without allocating, returns the length written
+std::size_t ElapsedTime(long times, char* buffer, std::size_t size);
+// Short latency with a unit picked by magnitude: 850ns, 12.3us, 4.56ms
+std::size_t Duration(std::uint64_t nanoseconds, char* buffer, std::size_t size);
 };                                    // namespace Format
 
-#endif
\ No newline at end of file
+#endif
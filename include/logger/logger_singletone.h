@@ -17,6 +17,7 @@ public:
     static Logger& GetInstance();  // Singleton instance
 
     void SetLogLevel(LogLevel level);  // Change log level at runtime
+    void SetConsoleOutput(bool enabled);  // Keep stdout free for data streams
     void Log(LogLevel level, const std::string& message);
     ~Logger();
 
@@ -25,6 +26,7 @@ private:
     std::ofstream log_file;
     std::mutex log_mutex;
     LogLevel current_log_level;
+    bool console_output = true;
 
     std::string GetTimestamp();
     std::string LogLevelToString(LogLevel level);
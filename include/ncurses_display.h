@@ -3,14 +3,110 @@
 
 #include <curses.h>
 
-#include "process.h"
-#include "system.h"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+#include "snapshot/collector.h"
+#include "snapshot/process_details.h"
+#include "snapshot/snapshot_publisher.h"
+#include "snapshot/system_snapshot.h"
+#include "snapshot/top_n.h"
 
 namespace NCursesDisplay {
-void Display(System& system, int n = 10);
-void DisplaySystem(System& system, WINDOW* window);
-void DisplayProcesses(std::vector<Process>& processes, WINDOW* window, int n);
+
+/*
+Keeps the characters written to a window during the previous frame.
+Put() compares a cell against that copy and only hands it to curses
+when its contents changed, so a steady screen costs no terminal output.
+*/
+class FrameCache {
+ public:
+  void Reset(int rows, int cols);
+  void Invalidate();
+  // Writes text into [col, col + width) of row, padding with blanks.
+  // Returns true when the cell was re-emitted.
+  bool Put(WINDOW* window, int row, int col, int width, const char* text,
+           std::size_t len, attr_t attr = A_NORMAL);
+  int Rows() const { return rows_; }
+  int Cols() const { return cols_; }
+
+ private:
+  int rows_{0};
+  int cols_{0};
+  std::vector<char> cells_;
+  std::vector<attr_t> attrs_;
+};
+
+/*
+Scroll state of the process list. Only the rows between Top() and
+Top() + page are ever rendered, whatever the length of the list.
+*/
+class ProcessListView {
+ public:
+  // Returns true when the key moved the selection
+  bool HandleKey(int key, std::size_t count, std::size_t page);
+  // Keeps the selection on the same pid when a new snapshot arrives,
+  // order maps list positions to rows and may cover only the top rows
+  void Follow(const std::vector<snapshot::ProcessRow>& processes,
+              const std::vector<std::uint32_t>& order, std::size_t page);
+  std::size_t Top() const { return top_; }
+  std::size_t Selected() const { return selected_; }
+
+ private:
+  void Clamp(std::size_t count, std::size_t page);
+
+  std::size_t top_{0};
+  std::size_t selected_{0};
+  int selected_pid_{-1};
+};
+
+/*
+Tree mode of the process list, toggled with 't'. Rows are listed depth
+first below their parents with the totals of their subtree, space
+collapses or expands the subtree of the selected process.
+*/
+class ProcessTreeView {
+ public:
+  bool Enabled() const { return enabled_; }
+  // Returns true when the key changed the mode or a collapsed subtree
+  bool HandleKey(int key, int selected_pid);
+  // Depth first order of the snapshot's processes, rebuilt once per
+  // snapshot and after a subtree was collapsed or expanded
+  const std::vector<std::uint32_t>& Order(
+      const snapshot::SystemSnapshot& system);
+  std::uint16_t Depth(std::size_t position) const {
+    return position < depths_.size() ? depths_[position] : 0;
+  }
+  bool Collapsed(int pid) const { return collapsed_.count(pid) != 0; }
+
+ private:
+  bool enabled_{false};
+  bool dirty_{true};
+  std::uint64_t built_sequence_{0};
+  std::unordered_set<int> collapsed_;
+  std::vector<std::uint32_t> order_;
+  std::vector<std::uint16_t> depths_;
+};
+
+// Renders the snapshots published by the collector until 'q'. The
+// process list shows at least n rows and grows with the terminal. When
+// the collector is given, 'x' expands the threads of the selected process
+// and '/' edits the process filter.
+void Display(snapshot::SnapshotPublisher& publisher,
+             snapshot::Collector* collector = nullptr, int n = 10);
+void DisplaySystem(const snapshot::SystemSnapshot& system, WINDOW* window,
+                   FrameCache& cache);
+void DisplayProcesses(const snapshot::SystemSnapshot& system, WINDOW* window,
+                      const std::vector<std::uint32_t>& order,
+                      const ProcessListView& view,
+                      const ProcessTreeView& tree,
+                      snapshot::ProcessDetailCache& details,
+                      FrameCache& cache);
 std::string ProgressBar(float percent);
+// Same bar as above rendered into a caller owned buffer, returns its length
+std::size_t ProgressBar(float percent, char* buffer, std::size_t size);
 };  // namespace NCursesDisplay
 
-#endif
\ No newline at end of file
+#endif
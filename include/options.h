@@ -0,0 +1,37 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Output encodings of the headless batch mode
+enum class RecordFormat { kJsonLines, kCsv, kBinary };
+
+// Command line of the monitor, defaults start the interactive display
+typedef struct Options {
+  bool batch{false};
+  RecordFormat format{RecordFormat::kJsonLines};
+  std::string output;  // empty writes to stdout
+  std::chrono::milliseconds interval{1000};
+  bool adaptive{true};  // let collectors speed up and back off
+  double overhead_budget{0.01};  // share of one core the monitor may use
+  long count{0};  // records to write in batch mode, 0 runs until signalled
+  std::string listen;  // metrics endpoint, "host:port" or "unix:/path"
+  bool shm{false};  // publish snapshots into a shared-memory segment
+  bool attach{false};  // read snapshots from a segment instead of /proc
+  std::string shm_name{"/green_sys"};
+  std::string threads;  // collect threads of processes whose comm contains it
+  bool io_uring{false};  // batch the per-process reads of a scan
+  std::string filter;  // list only processes matching this expression
+  std::string agent;  // stream snapshots to the aggregator at this address
+  std::string aggregate;  // merge the agents streaming to this address
+  std::string source_name;  // name of this agent, empty for the hostname
+  bool help{false};
+} options_t;
+
+// Throws std::invalid_argument on unknown or malformed arguments
+Options ParseOptions(const std::vector<std::string>& args);
+std::string Usage(const std::string& program);
+
+#endif  // OPTIONS_H
@@ -0,0 +1,69 @@
+#ifndef BATCH_READER_H
+#define BATCH_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace parser_factory {
+
+/*
+Reads many small files, e.g. /proc/[pid]/stat of every process, a batch
+at a time. With io_uring each file is an openat, a read and a close
+linked in the submission ring, using direct descriptors and a slab of
+registered buffers, so a batch of up to slots files costs one
+io_uring_enter instead of three syscalls per file. Where io_uring is
+missing or refused the same interface runs an open/pread/close loop.
+*/
+class BatchReader {
+ public:
+  enum class Backend { kAuto, kSync };
+  // Writes the name of file index into path, at most size bytes
+  typedef std::function<void(std::size_t index, char* path, std::size_t size)>
+      PathFn;
+  // data is only valid during the call, error is 0 or an errno value
+  typedef std::function<void(std::size_t index, std::string_view data,
+                             int error)>
+      DoneFn;
+
+  explicit BatchReader(Backend backend = Backend::kAuto,
+                       std::size_t slots = 256, std::size_t slot_size = 4096);
+  BatchReader(const BatchReader&) = delete;
+  BatchReader& operator=(const BatchReader&) = delete;
+  ~BatchReader();
+
+  // Reads files 0 .. count - 1, calling done once for each. Files longer
+  // than slot_size are cut short.
+  void Read(std::size_t count, const PathFn& path, const DoneFn& done);
+  bool Uring() const { return ring_ != nullptr; }
+  // Syscalls issued by Read() so far
+  std::uint64_t Syscalls() const { return syscalls_; }
+
+ private:
+  struct Ring;
+  static constexpr std::size_t kPathSize = 64;
+
+  bool SetupRing();
+  // Opens, reads and closes /proc/self/stat through a direct descriptor
+  bool TrialRead();
+  // One batch of at most slots_ files whose paths are in paths_
+  void ReadUring(std::size_t first, std::size_t count, const DoneFn& done);
+  void ReadSync(std::size_t first, std::size_t count, const DoneFn& done);
+
+  std::size_t slots_;
+  std::size_t slot_size_;
+  std::vector<char> slab_;
+  std::vector<char> sync_buffer_;
+  std::vector<char> paths_;
+  std::vector<int> lengths_;
+  std::vector<int> errors_;
+  std::unique_ptr<Ring> ring_;
+  std::uint64_t syscalls_{0};
+};
+
+}  // namespace parser_factory
+
+#endif  // BATCH_READER_H
@@ -0,0 +1,69 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+namespace parser_factory {
+
+/*
+Fixed schema of the system-wide numbers of one tick. Every metric
+collector owns a group of fields and fills them with one Collect() call,
+reading through descriptors it keeps open into buffers it reuses, so a
+warm collector allocates nothing. Text is made of these only by the
+display and the exporters. Rates and shares are taken between two
+Collect() calls of the same collector and are 0 after the first one.
+*/
+typedef struct MetricSnapshot {
+  // CpuParser, /proc/stat. Jiffies since boot, summed over all CPUs.
+  unsigned long long cpu_user;
+  unsigned long long cpu_nice;
+  unsigned long long cpu_system;
+  unsigned long long cpu_idle;
+  unsigned long long cpu_iowait;
+  unsigned long long cpu_irq;
+  unsigned long long cpu_softirq;
+  unsigned long long cpu_steal;
+  int cpu_count;                        /** online CPUs **/
+  float cpu_utilization;                /** busy share, 0.0 - 1.0 **/
+  unsigned long long context_switches;  /** since boot **/
+  unsigned long long forks;             /** processes created since boot **/
+  int procs_running;
+  int procs_blocked;                    /** waiting for I/O **/
+
+  // MemoryParser, /proc/meminfo
+  unsigned long long mem_total_kb;
+  unsigned long long mem_free_kb;
+  unsigned long long mem_available_kb;
+  unsigned long long buffers_kb;
+  unsigned long long cached_kb;
+  unsigned long long swap_total_kb;
+  unsigned long long swap_free_kb;
+  float memory_utilization;  /** 1 - MemAvailable / MemTotal **/
+
+  // NetworkParser, /proc/net/dev, every interface but loopback
+  unsigned long long rx_bytes;
+  unsigned long long tx_bytes;
+  unsigned long long rx_packets;
+  unsigned long long tx_packets;
+  double rx_rate;  /** bytes per second **/
+  double tx_rate;
+
+  // SystemParser, /proc/uptime and /proc/loadavg
+  double uptime_seconds;
+  double idle_seconds;  /** summed over all CPUs **/
+  float load1;
+  float load5;
+  float load15;
+  int threads;  /** scheduling entities that exist **/
+} metric_snapshot_t;
+
+// A source of one group of MetricSnapshot fields
+class IMetricCollector {
+ public:
+  // False when the source could not be read, its fields are left as they
+  // were
+  virtual bool Collect(metric_snapshot_t& metrics) = 0;
+  virtual ~IMetricCollector() = default;
+};
+
+}  // namespace parser_factory
+
+#endif  // METRICS_H
@@ -6,13 +6,21 @@
 #include <fstream>
 #include <regex>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 #include <memory>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <utility>
 #include <limits.h>
 
 //internal includes liberaries
 #include "logger/logger_singletone.h"
+#include "parser_factory/metrics.h"
 
 
 
@@ -26,9 +34,30 @@ static const std::unordered_map<std::string, std::string> LinuxFilesSet{
     {"kStatFilename", "/proc/stat"},
     {"kUptimeFilename", "/proc/uptime"},
     {"kMeminfoFilename", "/proc/meminfo"},
+    {"kLoadavgFilename", "/proc/loadavg"},
+    {"kNetDevFilename", "/proc/net/dev"},
     {"kVersionFilename", "/proc/version"},
     {"kOSReleaseFilename", "/etc/os-release"},
-    {"kPasswordFilename", "/etc/passwd"}};
+    {"kPasswordFilename", "/etc/passwd"},
+    {"kProcDirectory", "/proc/"},
+    {"kPidCmdlineFilename", "/cmdline"},
+    {"kPidStatFilename", "/stat"},
+    {"kPidStatusFilename", "/status"},
+    {"kSchedstatFilename", "/proc/schedstat"},
+    {"kInterruptsFilename", "/proc/interrupts"},
+    {"kSoftirqsFilename", "/proc/softirqs"},
+    {"kPressureDirectory", "/proc/pressure/"},
+    {"kNodeDirectory", "/sys/devices/system/node"},
+    {"kMountsFilename", "/proc/self/mounts"},
+    {"kPidCgroupFilename", "/cgroup"},
+    {"kPidSchedstatFilename", "/schedstat"},
+    {"kPidStatmFilename", "/statm"},
+    {"kPidIoFilename", "/io"},
+    {"kPidSmapsRollupFilename", "/smaps_rollup"},
+    {"kPidNumaMapsFilename", "/numa_maps"},
+    {"kRaplEnergyFilename", "/sys/class/powercap/intel-rapl:0/energy_uj"},
+    {"kRaplMaxEnergyFilename",
+     "/sys/class/powercap/intel-rapl:0/max_energy_range_uj"}};
 
 // -----------------------------
 // CPU State Enum
@@ -147,6 +176,162 @@ enum class CPUStates {
 //   unsigned long getActiveJiffies() const {return (utime + stime + cutime + cstime);}
 // }pid_state_t;
 
+/*
+Typed subset of /proc/[pid]/stat, decoded in place without tokenising
+the line into strings. Field names follow proc(5).
+*/
+typedef struct PidStat {
+  int pid;
+  char comm[16];                    /** filename of the executable **/
+  char state;                       /** R, S, D, Z, T ... **/
+  int ppid;                         /** process id of the parent process **/
+  unsigned long utime;              /** user mode jiffies **/
+  unsigned long stime;              /** kernel mode jiffies **/
+  long cutime;                      /** user mode jiffies with child's **/
+  long cstime;                      /** kernel mode jiffies with child's **/
+  long num_threads;                 /** number of threads **/
+  unsigned long long starttime;     /** jiffies after boot the process started **/
+  unsigned long vsize;              /** virtual memory size in bytes **/
+  long rss;                         /** resident set size in pages **/
+  int processor;                    /** CPU the task last ran on **/
+  unsigned long getActiveJiffies() const { return utime + stime; }
+} pid_stat_t;
+
+/*
+Scheduler statistics of one CPU from a cpuN line of /proc/schedstat
+(needs CONFIG_SCHEDSTATS). All counters are cumulative since boot.
+*/
+typedef struct CpuSchedStat {
+  int cpu;
+  unsigned long long run_ns;      /** time tasks spent running **/
+  unsigned long long wait_ns;     /** time runnable tasks waited for the CPU **/
+  unsigned long long timeslices;  /** timeslices run on this CPU **/
+} cpu_schedstat_t;
+
+/*
+/proc/[pid]/task/[tid]/schedstat summed over the threads of the process,
+/proc/[pid]/schedstat alone only covers the thread group leader.
+*/
+typedef struct PidSchedStat {
+  unsigned long long run_ns;      /** time spent on the CPU **/
+  unsigned long long wait_ns;     /** time spent waiting on a run queue **/
+  unsigned long long timeslices;  /** timeslices run on a CPU **/
+} pid_schedstat_t;
+
+/*
+Memory of a process in kilobytes. rss_kb and shared_kb come from
+/proc/[pid]/statm, which is cheap; the rest needs /proc/[pid]/smaps_rollup,
+which walks every mapping of the process.
+*/
+typedef struct PidMemory {
+  long rss_kb;     /** resident set **/
+  long shared_kb;  /** resident and backed by a file or shared **/
+  long pss_kb;     /** resident, shared pages divided among their users **/
+  long uss_kb;     /** resident and private to the process **/
+  long swap_kb;    /** swapped out **/
+} pid_memory_t;
+
+/*
+/proc/[pid]/io counters, cumulative over the life of the process.
+*/
+typedef struct PidIo {
+  unsigned long long syscr;                  /** read syscalls **/
+  unsigned long long syscw;                  /** write syscalls **/
+  unsigned long long read_bytes;             /** fetched from storage **/
+  unsigned long long write_bytes;            /** sent to storage **/
+  unsigned long long cancelled_write_bytes;  /** dirty pages truncated **/
+} pid_io_t;
+
+/*
+Open file descriptors of a process by what their /proc/[pid]/fd links
+point at. Files include directories and named FIFOs, other covers
+devices and anonymous inodes such as eventfd, epoll or inotify.
+*/
+typedef struct PidFds {
+  int total;
+  int sockets;
+  int pipes;
+  int files;
+  int other;
+} pid_fds_t;
+
+// Resources the kernel reports Pressure Stall Information for
+enum class PsiResource { kCpu = 0, kMemory, kIo };
+constexpr int kPsiResourceCount = 3;
+const char* PsiResourceName(PsiResource resource);
+
+/*
+One line of a PSI file: share of wall time in which some (or all, for
+"full") non-idle tasks were stalled on the resource, in percent over
+10, 60 and 300 second windows, plus the total stall time.
+*/
+typedef struct PsiAverages {
+  float avg10;
+  float avg60;
+  float avg300;
+  unsigned long long total_us;
+} psi_averages_t;
+
+typedef struct Pressure {
+  psi_averages_t some;
+  psi_averages_t full;  /** all zero for system-wide cpu on older kernels **/
+} pressure_t;
+
+// A PSI trigger that fired
+typedef struct PsiEvent {
+  PsiResource resource;
+  std::string spec;  /** e.g. "some 150000 1000000" **/
+  std::chrono::system_clock::time_point when;
+} psi_event_t;
+
+/*
+Counters of one cgroup v2 group from cpu.stat, memory.current,
+memory.stat and io.stat. The kernel accounts them hierarchically, a
+group includes all of its descendants. Files of controllers that are
+not enabled for the group leave their fields at zero.
+*/
+typedef struct CgroupStat {
+  unsigned long long usage_usec;      /** CPU time used **/
+  unsigned long long throttled_usec;  /** time throttled by cpu.max **/
+  unsigned long long memory_bytes;    /** memory.current **/
+  unsigned long long anon_bytes;      /** anonymous memory **/
+  unsigned long long file_bytes;      /** page cache **/
+  unsigned long long read_bytes;      /** io.stat rbytes, all devices **/
+  unsigned long long write_bytes;     /** io.stat wbytes, all devices **/
+} cgroup_stat_t;
+
+/*
+IRQ x CPU counter matrix of /proc/interrupts or /proc/softirqs. counts
+holds one row of cpus.size() counters per source, row major, so a whole
+table is one contiguous block. The kernel keeps these counters in 32
+bits, differences are taken modulo 2^32. Summary lines with a single
+counter (ERR, MIS) are left out.
+*/
+typedef struct InterruptTable {
+  std::vector<int> cpus;                  /** online CPUs, one per column **/
+  std::vector<std::string> names;         /** "24", "NMI", "NET_RX" **/
+  std::vector<std::string> descriptions;  /** chip and device, hard IRQs only **/
+  std::vector<std::uint32_t> counts;      /** names.size() x cpus.size() **/
+  bool layout_changed;  /** sources or CPUs differ from the previous read **/
+} interrupt_table_t;
+
+/*
+One NUMA node under /sys/devices/system/node. The numastat counters are
+page allocations since boot, counted on the node the page came from.
+*/
+typedef struct NumaNodeStat {
+  std::vector<int> cpus;          /** from cpulist, empty for memory only **/
+  unsigned long long total_kb;    /** MemTotal of the node's meminfo **/
+  unsigned long long free_kb;     /** MemFree **/
+  unsigned long long file_kb;     /** FilePages **/
+  unsigned long long anon_kb;     /** AnonPages **/
+  unsigned long long numa_hit;    /** allocated here, as preferred **/
+  unsigned long long numa_miss;   /** allocated here, another was preferred **/
+  unsigned long long numa_foreign;  /** preferred here, allocated elsewhere **/
+  unsigned long long local_node;  /** allocated here for a task running here **/
+  unsigned long long other_node;  /** allocated here for a task elsewhere **/
+} numa_node_stat_t;
+
 /*
 User – Time in user mode.
 Nice – Time in low-priority user mode.
@@ -158,6 +343,7 @@ SoftIRQ – Time servicing soft interrupts.
 Steal – Time stolen by other virtual machines.
 */
 typedef struct CPUData {
+  int cpu;  /** -1 for the first line, which sums all CPUs **/
   long user;
   long nice;
   long system;
@@ -175,9 +361,9 @@ typedef struct CPUData {
 
 // -----------------------------
 // Interfaces for Each Component
-class ICpuParser {
+// Each fills its fields of metric_snapshot_t through Collect()
+class ICpuParser : public IMetricCollector {
  public:
-  virtual std::string GetCPUUsage() = 0;
   virtual std::string GetCPUInfo() = 0;
   virtual std::vector<cpu_data_t> GetCpuUtilization() = 0;
   virtual std::vector<std::string> GetProcessorUtilization(int pid) = 0;
@@ -185,21 +371,14 @@ class ICpuParser {
   virtual long GetActiveJiffies() = 0;
   virtual long GetActiveJiffies(int pid) = 0;
   virtual long GetIdleJiffies() = 0;
+  virtual double GetPackageEnergy() = 0;
+  virtual bool GetSchedStat(std::vector<cpu_schedstat_t>& cpus) = 0;
   virtual ~ICpuParser() = default;
 };
 
-class IMemoryParser {
- public:
-  virtual std::string GetMemoryUsage() = 0;
-  virtual std::string GetRAMInfo() = 0;
-  virtual ~IMemoryParser() = default;
-};
+class IMemoryParser : public IMetricCollector {};
 
-class INetworkParser {
- public:
-  virtual std::string GetNetworkUsage() = 0;
-  virtual ~INetworkParser() = default;
-};
+class INetworkParser : public IMetricCollector {};
 
 class IProcessParser {
  public:
@@ -208,16 +387,59 @@ class IProcessParser {
   virtual std::string GetUid(int pid) = 0;
   virtual std::string GetUser(int pid) = 0;
   virtual long GetUpTime(int pid) = 0;
+  virtual bool GetStat(int pid, pid_stat_t& stat) = 0;
+  virtual bool GetSchedStat(int pid, pid_schedstat_t& schedstat) = 0;
+  virtual bool GetStatm(int pid, pid_memory_t& memory) = 0;
+  virtual bool GetSmapsRollup(int pid, pid_memory_t& memory) = 0;
+  virtual bool GetIo(int pid, pid_io_t& io) = 0;
+  virtual int CountFds(int pid) = 0;
+  virtual bool GetFds(int pid, pid_fds_t& fds) = 0;
+  virtual long GetFdLimit(int pid) = 0;
+  virtual bool GetTaskStat(int pid, int tid, pid_stat_t& stat) = 0;
+  virtual std::vector<int> GetTids(int pid) = 0;
   virtual std::vector<int> GetPids() = 0;
   virtual int GetTotalProcesses() = 0;
   virtual int GetRunningProcesses() = 0;
   virtual ~IProcessParser() = default;
 };
 
-class ISystemParser {
+class IPressureParser {
+ public:
+  virtual bool GetPressure(PsiResource resource, pressure_t& pressure) = 0;
+  // Any PSI file, e.g. the cpu.pressure of a cgroup v2 directory
+  virtual bool GetPressure(const std::string& path, pressure_t& pressure) = 0;
+  // Mount point of the cgroup v2 hierarchy, empty when there is none
+  virtual std::string GetCgroup2Root() = 0;
+  virtual ~IPressureParser() = default;
+};
+
+class IInterruptParser {
+ public:
+  virtual bool GetInterrupts(interrupt_table_t& table) = 0;
+  virtual bool GetSoftirqs(interrupt_table_t& table) = 0;
+  virtual ~IInterruptParser() = default;
+};
+
+class INumaParser {
+ public:
+  virtual std::vector<int> GetNodes() = 0;
+  virtual bool GetNode(int node, numa_node_stat_t& stat) = 0;
+  virtual bool GetNumaMaps(int pid, std::vector<unsigned long long>& node_kb) = 0;
+  virtual ~INumaParser() = default;
+};
+
+class ICgroupParser {
+ public:
+  // Group paths below the root, "/" is the root itself
+  virtual std::vector<std::string> GetCgroups() = 0;
+  virtual bool GetStat(const std::string& cgroup, cgroup_stat_t& stat) = 0;
+  // Group of a process from /proc/[pid]/cgroup, empty when unknown
+  virtual std::string GetProcessCgroup(int pid) = 0;
+  virtual ~ICgroupParser() = default;
+};
+
+class ISystemParser : public IMetricCollector {
  public:
-  virtual std::string GetSystemInfo() = 0;
-  virtual std::string GetSystemUptime() = 0;
   virtual std::string GetTemperature() = 0;
   virtual std::string GetDiskUsage() = 0;
   virtual std::string GetLogs() = 0;
@@ -225,6 +447,8 @@ class ISystemParser {
   virtual std::string GetResponseTime() = 0;
   virtual std::string GetLatency() = 0;
   virtual std::string GetPlatformSpecificData() = 0;
+  virtual std::string GetPressure() = 0;
+  virtual std::string GetPressureEvents() = 0;
   virtual ~ISystemParser() = default;
 };
 
@@ -233,7 +457,11 @@ class ISystemParser {
 class CpuParser : public ICpuParser {
  public:
  CpuParser() : cpu_data_list_(std::make_shared<std::vector<cpu_data_t>>()) {}
-  std::string GetCPUUsage() override;
+  CpuParser(const CpuParser&) = delete;
+  CpuParser& operator=(const CpuParser&) = delete;
+  ~CpuParser();
+  // CPU fields of metrics from /proc/stat, utilization since the last call
+  bool Collect(metric_snapshot_t& metrics) override;
   std::string GetCPUInfo() override;
   std::vector<cpu_data_t> GetCpuUtilization() override;
   std::vector<std::string> GetProcessorUtilization(int pid) override;
@@ -241,8 +469,17 @@ class CpuParser : public ICpuParser {
   long GetActiveJiffies() override;
   long GetActiveJiffies(int pid) override;
   long GetIdleJiffies() override;
-  ~CpuParser() = default;
+  // Cumulative package energy in joules, negative without RAPL support
+  double GetPackageEnergy() override;
+  // Range after which the energy counter wraps, in joules
+  double GetPackageEnergyRange();
+  // Per-CPU run-queue counters, false without /proc/schedstat
+  bool GetSchedStat(std::vector<cpu_schedstat_t>& cpus) override;
   private:
+  int stat_fd_{-1};
+  std::vector<char> stat_buffer_;
+  unsigned long long last_busy_{0};
+  unsigned long long last_total_{0};
   cpu_data_t cpu_data_;
   Logger& logger_ = Logger::GetInstance();
   // Shared pointer to hold the vector, shared across functions
@@ -251,13 +488,33 @@ class CpuParser : public ICpuParser {
 
 class MemoryParser : public IMemoryParser {
  public:
-  std::string GetMemoryUsage() override;
-  std::string GetRAMInfo() override;
+  MemoryParser() = default;
+  MemoryParser(const MemoryParser&) = delete;
+  MemoryParser& operator=(const MemoryParser&) = delete;
+  ~MemoryParser();
+  // Memory fields of metrics from /proc/meminfo
+  bool Collect(metric_snapshot_t& metrics) override;
+
+ private:
+  int meminfo_fd_{-1};
+  std::vector<char> buffer_;
 };
 
 class NetworkParser : public INetworkParser {
  public:
-  std::string GetNetworkUsage() override;
+  NetworkParser() = default;
+  NetworkParser(const NetworkParser&) = delete;
+  NetworkParser& operator=(const NetworkParser&) = delete;
+  ~NetworkParser();
+  // Network fields of metrics from /proc/net/dev, rates since the last call
+  bool Collect(metric_snapshot_t& metrics) override;
+
+ private:
+  int dev_fd_{-1};
+  std::vector<char> buffer_;
+  unsigned long long last_rx_bytes_{0};
+  unsigned long long last_tx_bytes_{0};
+  std::chrono::steady_clock::time_point last_time_{};
 };
 
 class ProcessParser : public IProcessParser {
@@ -266,19 +523,213 @@ class ProcessParser : public IProcessParser {
   std::string GetRam(int pid) override;
   std::string GetUid(int pid) override;
   std::string GetUser(int pid) override;
+  // GetCommand() into a string the caller reuses, false once the process
+  // exited
+  bool ReadCommand(int pid, std::string& command);
+  // GetUser() without a copy, the view lives as long as the parser. Empty
+  // once the process exited.
+  std::string_view ReadUser(int pid);
   long GetUpTime(int pid) override;
+  bool GetStat(int pid, pid_stat_t& stat) override;
+  // False when the process exited or the kernel lacks schedstats
+  bool GetSchedStat(int pid, pid_schedstat_t& schedstat) override;
+  // rss_kb and shared_kb only, false when the process exited
+  bool GetStatm(int pid, pid_memory_t& memory) override;
+  // Every field, false when the process exited or is not ours to inspect
+  bool GetSmapsRollup(int pid, pid_memory_t& memory) override;
+  // False when the file could not be read, errno is EACCES for processes
+  // of other users, which stay unreadable for their whole life
+  bool GetIo(int pid, pid_io_t& io) override;
+  // Entries of /proc/[pid]/fd, -1 when the process exited or is not ours
+  // to inspect. Only the directory is read, no descriptor is resolved.
+  int CountFds(int pid) override;
+  // Resolves every descriptor with readlink, false like CountFds() and
+  // when none of them could be resolved
+  bool GetFds(int pid, pid_fds_t& fds) override;
+  // Soft RLIMIT_NOFILE from /proc/[pid]/limits, -1 when unlimited or gone
+  long GetFdLimit(int pid) override;
+  // cgroup v2 path of a process, empty when unknown or gone
+  static std::string GetCgroup(int pid);
+  // Decoders behind GetStat() and GetIo(), for contents read elsewhere,
+  // e.g. by a BatchReader
+  bool DecodeStat(std::string_view data, int id, pid_stat_t& stat);
+  static bool DecodeIo(std::string_view data, pid_io_t& io);
+  // /proc/[pid]/task/[tid]/stat through the same decoder as GetStat(),
+  // stat.pid is the tid then
+  bool GetTaskStat(int pid, int tid, pid_stat_t& stat) override;
+  // Sorted thread ids, empty once the process exited
+  std::vector<int> GetTids(int pid) override;
   std::vector<int> GetPids() override;
   int GetTotalProcesses() override;
   int GetRunningProcesses() override;
+
+ private:
+  bool ReadStat(const char* path, int id, pid_stat_t& stat);
+
+  Logger& logger_ = Logger::GetInstance();
+  // uid -> user name, /etc/passwd is read once per parser
+  std::unordered_map<unsigned, std::string> users_;
+};
+
+/*
+Reads PSI averages and owns PSI triggers. A trigger is a file
+descriptor the kernel marks with POLLPRI whenever stall time exceeds
+its threshold within its window, WaitForEvents() sleeps in poll() on
+all of them so nothing is polled while the system is calm.
+*/
+class PressureParser : public IPressureParser {
+ public:
+  static constexpr std::size_t kMaxEvents = 64;
+
+  PressureParser() = default;
+  PressureParser(const PressureParser&) = delete;
+  PressureParser& operator=(const PressureParser&) = delete;
+  ~PressureParser();
+
+  bool GetPressure(PsiResource resource, pressure_t& pressure) override;
+  bool GetPressure(const std::string& path, pressure_t& pressure) override;
+  std::string GetCgroup2Root() override;
+
+  // Registers "some|full <stall us> <window us>", false when the kernel
+  // refuses it (no PSI, or a window unprivileged users may not use)
+  bool AddTrigger(PsiResource resource, const std::string& spec);
+  std::size_t TriggerCount() const { return triggers_.size(); }
+  // Sleeps until a trigger fires or wake_fd turns readable, returns the
+  // events that fired. Meant for a single waiting thread.
+  std::vector<psi_event_t> WaitForEvents(int wake_fd);
+  // Last kMaxEvents events, oldest first, and the count since start
+  std::vector<psi_event_t> RecentEvents() const;
+  std::uint64_t EventCount() const;
+
+ private:
+  typedef struct Trigger {
+    PsiResource resource;
+    std::string spec;
+    int fd;
+  } trigger_t;
+
+  Logger& logger_ = Logger::GetInstance();
+  std::vector<trigger_t> triggers_;
+  mutable std::mutex events_mutex_;
+  std::deque<psi_event_t> events_;
+  std::uint64_t event_count_{0};
+};
+
+/*
+Reads /proc/interrupts and /proc/softirqs with pread() on descriptors
+kept open, into one buffer that keeps its capacity, and decodes each in
+a single pass straight into the counter matrix of the table. On hosts
+with hundreds of CPUs these files are hundreds of kilobytes wide, so a
+steady table is refreshed without allocating.
+*/
+class InterruptParser : public IInterruptParser {
+ public:
+  InterruptParser() = default;
+  InterruptParser(const InterruptParser&) = delete;
+  InterruptParser& operator=(const InterruptParser&) = delete;
+  ~InterruptParser();
+
+  bool GetInterrupts(interrupt_table_t& table) override;
+  bool GetSoftirqs(interrupt_table_t& table) override;
+  // The decoder behind both, for contents read elsewhere
+  static bool Decode(std::string_view data, interrupt_table_t& table);
+
+ private:
+  bool Read(int& fd, const std::string& path, interrupt_table_t& table);
+
+  int interrupts_fd_{-1};
+  int softirqs_fd_{-1};
+  std::vector<char> buffer_;
+};
+
+/*
+Walks the cgroup v2 hierarchy once and then follows it with inotify:
+Refresh() drains IN_CREATE / IN_DELETE events for the directories, so
+finding new and removed groups never rescans the tree. The stat files
+of each group stay open once read and are re-read with pread().
+*/
+class CgroupParser : public ICgroupParser {
+ public:
+  // root defaults to the cgroup2 mount from /proc/self/mounts
+  explicit CgroupParser(std::string root = std::string());
+  CgroupParser(const CgroupParser&) = delete;
+  CgroupParser& operator=(const CgroupParser&) = delete;
+  ~CgroupParser();
+
+  const std::string& Root() const { return root_; }
+  // Applies pending inotify events, true when groups came or went
+  bool Refresh();
+  std::vector<std::string> GetCgroups() override;
+  bool GetStat(const std::string& cgroup, cgroup_stat_t& stat) override;
+  std::string GetProcessCgroup(int pid) override;
+
+ private:
+  enum StatFile { kCpuStat = 0, kMemoryCurrent, kMemoryStat, kIoStat };
+  static constexpr int kStatFileCount = 4;
+
+  typedef struct Cgroup {
+    int watch;
+    int fds[kStatFileCount];
+    bool opened;
+  } cgroup_t;
+
+  // Adds cgroup and everything below it
+  void Add(const std::string& cgroup);
+  // Removes cgroup and everything below it
+  void Remove(const std::string& cgroup);
+  void Rescan();
+
+  Logger& logger_ = Logger::GetInstance();
+  std::string root_;
+  int inotify_fd_{-1};
+  // Ordered by path, a group's descendants form one contiguous range
+  std::map<std::string, cgroup_t> cgroups_;
+  std::unordered_map<int, std::string> watches_;
+};
+
+/*
+NUMA topology and per-node counters under /sys/devices/system/node. The
+meminfo and numastat files of a node stay open once read and are re-read
+with pread(), its CPU list is read once. numa_maps walks every mapping of
+a process, it is meant for the few processes somebody asked about.
+*/
+class NumaParser : public INumaParser {
+ public:
+  // root defaults to /sys/devices/system/node
+  explicit NumaParser(std::string root = std::string());
+  NumaParser(const NumaParser&) = delete;
+  NumaParser& operator=(const NumaParser&) = delete;
+  ~NumaParser();
+
+  // Node ids in ascending order, empty on a kernel without NUMA support
+  std::vector<int> GetNodes() override;
+  bool GetNode(int node, numa_node_stat_t& stat) override;
+  // Resident kB of pid on each node, indexed by node id. False when the
+  // process exited or is not ours to inspect.
+  bool GetNumaMaps(int pid, std::vector<unsigned long long>& node_kb) override;
+
+ private:
+  typedef struct NodeFiles {
+    int meminfo_fd;
+    int numastat_fd;
+    std::vector<int> cpus;
+  } node_files_t;
+
+  std::string root_;
+  std::map<int, node_files_t> nodes_;
+  std::vector<char> buffer_;
 };
 
 class SystemParser : public ISystemParser {
  public:
   SystemParser(CpuParser& cpuParser, MemoryParser& memoryParser,
-               ProcessParser& processParser);
+               ProcessParser& processParser, PressureParser& pressureParser);
+  SystemParser(const SystemParser&) = delete;
+  SystemParser& operator=(const SystemParser&) = delete;
+  ~SystemParser();
 
-  std::string GetSystemInfo() override;
-  std::string GetSystemUptime() override;
+  // Uptime and load fields of metrics from /proc/uptime and /proc/loadavg
+  bool Collect(metric_snapshot_t& metrics) override;
   std::string GetTemperature() override;
   std::string GetDiskUsage() override;
   std::string GetLogs() override;
@@ -286,11 +737,18 @@ class SystemParser : public ISystemParser {
   std::string GetResponseTime() override;
   std::string GetLatency() override;
   std::string GetPlatformSpecificData() override;
+  // System-wide PSI averages, one line per resource
+  std::string GetPressure() override;
+  // PSI triggers that fired recently, one line per event
+  std::string GetPressureEvents() override;
 
  private:
   CpuParser& cpuParser_;
   MemoryParser& memoryParser_;
   ProcessParser& processParser_;
+  PressureParser& pressureParser_;
+  int uptime_fd_{-1};
+  int loadavg_fd_{-1};
 };
 
 }  // namespace parser_factory
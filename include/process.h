@@ -1,23 +1,70 @@
 #ifndef PROCESS_H
 #define PROCESS_H
 
-#include <string>
+#include <cstdint>
+
+#include "parser_factory/parser.h"
+
+// Per-second rates of the /proc/[pid]/io counters
+typedef struct IoRates {
+  double read_bytes;
+  double write_bytes;  // less the writes cancelled by truncation
+  double cancelled_write_bytes;
+  double syscr;
+  double syscw;
+} io_rates_t;
+
 /*
 Basic class for Process representation
 It contains relevant attributes as shown below
 */
 class Process {
  public:
-  int Pid();                               // TODO: See src/process.cpp
-  std::string User();                      // TODO: See src/process.cpp
-  std::string Command();                   // TODO: See src/process.cpp
-  float CpuUtilization();                  // TODO: See src/process.cpp
-  std::string Ram();                       // TODO: See src/process.cpp
-  long int UpTime();                       // TODO: See src/process.cpp
-  bool operator<(Process const& a) const;  // TODO: See src/process.cpp
+  explicit Process(int pid);
+  int Pid() const;
+  float CpuUtilization();
+  long int UpTime();
+  double Energy() const { return energy_joules_; }
+  // False while /proc/[pid]/io could not be read, rates start at zero
+  bool IoReadable() const { return io_sampled_ && !io_denied_; }
+  const io_rates_t& Io() const { return io_rates_; }
+  // Orders by CPU utilization
+  bool operator<(Process const& a) const;
+
+  // Refreshes the cheap /proc/[pid]/stat and /proc/[pid]/io fields, false
+  // once the pid is gone
+  bool Update(parser_factory::ProcessParser& parser, double system_uptime);
+  // The /proc/[pid]/io half of Update(), a no-op once access was denied
+  void UpdateIo(parser_factory::ProcessParser& parser, double system_uptime);
+  // The same from contents read elsewhere, e.g. by a BatchReader. io is
+  // null when /proc/[pid]/io failed with errno error.
+  void Refresh(const parser_factory::pid_stat_t& stat, double system_uptime);
+  bool WantsIo() const { return !io_denied_; }
+  void RefreshIo(const parser_factory::pid_io_t* io, int error,
+                 double system_uptime);
+  const parser_factory::pid_stat_t& Stat() const { return stat_; }
+  void AddEnergy(double joules) { energy_joules_ += joules; }
+  // Generation of the process filter whose pid, user, cgroup and command
+  // line tests this process passed for good, 0 for none
+  std::uint64_t Admitted() const { return admitted_; }
+  void Admit(std::uint64_t generation) { admitted_ = generation; }
 
-  // TODO: Declare any necessary private members
  private:
+  int pid_;
+  parser_factory::pid_stat_t stat_{};
+  float cpu_utilization_{0.0f};
+  long uptime_{0};
+  bool sampled_{false};
+  double last_system_uptime_{0.0};
+  unsigned long last_jiffies_{0};
+  double energy_joules_{0.0};
+  parser_factory::pid_io_t last_io_{};
+  double last_io_uptime_{0.0};
+  io_rates_t io_rates_{};
+  bool io_sampled_{false};
+  // Permission denied once, not tried again for the life of the process
+  bool io_denied_{false};
+  std::uint64_t admitted_{0};
 };
 
-#endif
\ No newline at end of file
+#endif
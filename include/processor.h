@@ -1,12 +1,17 @@
 #ifndef PROCESSOR_H
 #define PROCESSOR_H
 
+#include "parser_factory/parser.h"
+
 class Processor {
  public:
-  float Utilization();  // TODO: See src/processor.cpp
+  // Share of busy jiffies since the previous call, never sleeps. The
+  // first call has no previous sample and returns 0.
+  float Utilization();
 
-  // TODO: Declare any necessary private members
  private:
+  parser_factory::CpuParser parser_;
+  float utilization_{0.0f};
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,57 @@
+#ifndef CGROUP_SAMPLER_H
+#define CGROUP_SAMPLER_H
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "parser_factory/parser.h"
+#include "snapshot/system_snapshot.h"
+
+namespace snapshot {
+
+/*
+Turns cgroup v2 counters into per-group rates and maps processes onto
+the groups. A process is looked up in /proc/[pid]/cgroup once, when it
+is first seen; processes in a group that is not sampled count towards
+the nearest sampled ancestor.
+*/
+class CgroupSampler {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  // Groups beyond max_cgroups, in path order, are left out
+  explicit CgroupSampler(std::size_t max_cgroups = 256,
+                         std::string root = std::string());
+
+  // Fills rows, returns the largest change in CPUs used by one group
+  double Sample(std::vector<CgroupRow>& rows, Clock::time_point now);
+  // Sets the cgroup index of every process and the process counts of
+  // rows, both must belong to the same snapshot
+  void Assign(std::vector<ProcessRow>& processes,
+              std::vector<CgroupRow>& rows);
+
+ private:
+  typedef struct Sample {
+    parser_factory::cgroup_stat_t stat;
+    Clock::time_point when;
+  } sample_t;
+
+  typedef struct Membership {
+    unsigned long long starttime;
+    std::string cgroup;
+  } membership_t;
+
+  std::size_t max_cgroups_;
+  parser_factory::CgroupParser parser_;
+  std::unordered_map<std::string, sample_t> samples_;
+  std::unordered_map<std::string, sample_t> next_samples_;
+  // pid -> group it was born in
+  std::unordered_map<int, membership_t> members_;
+};
+
+}  // namespace snapshot
+
+#endif  // CGROUP_SAMPLER_H
@@ -0,0 +1,117 @@
+#ifndef COLLECTOR_H
+#define COLLECTOR_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "snapshot/cgroup_sampler.h"
+#include "snapshot/fd_sampler.h"
+#include "snapshot/interrupt_sampler.h"
+#include "snapshot/memory_sampler.h"
+#include "snapshot/numa_sampler.h"
+#include "snapshot/pressure_monitor.h"
+#include "snapshot/process_filter.h"
+#include "snapshot/process_tree.h"
+#include "snapshot/run_queue.h"
+#include "snapshot/sampling_scheduler.h"
+#include "snapshot/snapshot_publisher.h"
+#include "snapshot/system_snapshot.h"
+#include "snapshot/thread_sampler.h"
+#include "snapshot/work_pool.h"
+#include "system.h"
+#include "telemetry/latency.h"
+
+namespace snapshot {
+
+/*
+Owns the collection thread. A SamplingScheduler runs the system-wide
+counters, the run queues, interrupts, NUMA nodes, pressure, cgroups,
+threads, smaps memory, file descriptors and the process scan at their
+own, adaptive periods; after every wakeup the latest values are copied
+into a fresh SystemSnapshot and handed to the publisher, so consumers
+never call into System themselves and never wait for a slow collector.
+
+The collectors due in one wakeup run side by side on a WorkPool, the
+process scan split in chunks, so a wakeup takes about as long as its
+slowest collector. All of them sample at the time of the wakeup, which
+becomes the timestamp of the snapshot.
+*/
+class Collector {
+ public:
+  // interval is the starting period of both collectors. adaptive lets the
+  // system counters range from interval / 8 and the process scan from
+  // interval / 4 up to interval * 8, within overhead_budget of one core.
+  Collector(System& system, SnapshotPublisher& publisher,
+            std::chrono::milliseconds interval = std::chrono::seconds(1),
+            bool adaptive = true, double overhead_budget = 0.01);
+  Collector(const Collector&) = delete;
+  Collector& operator=(const Collector&) = delete;
+  ~Collector();
+
+  void Start();
+  void Stop();
+  // Samples every collector and publishes on the calling thread
+  void CollectOnce();
+  // Safe from any thread, e.g. a PressureMonitor callback: counts the
+  // PSI events and has the collection thread publish out of schedule
+  void OnPressureEvents(std::size_t count);
+  // Which processes get per-thread collection, safe from any thread
+  ThreadSampler& Threads() { return threads_; }
+  // Which processes get their NUMA placement read, safe from any thread
+  NumaSampler& Numa() { return numa_; }
+  // Limits the process scan to the matches of filter, null for every
+  // process. Safe from any thread, applies from the next scan.
+  void SetFilter(std::shared_ptr<const ProcessFilter> filter);
+
+ private:
+  void Run();
+  // Fixes the time every collector of this wakeup samples at
+  void BeginTick();
+  void Publish();
+  // Each returns the change score the scheduler adapts on
+  double SampleSystem();
+  double SampleProcesses();
+  double SampleRunQueues();
+  double SampleInterrupts();
+  double SamplePressure();
+  double SampleNuma();
+  double SampleCgroups();
+  double SampleThreads();
+  double SampleMemory();
+  double SampleFds();
+
+  System& system_;
+  SnapshotPublisher& publisher_;
+  WorkPool pool_;
+  SamplingScheduler scheduler_;
+  RunQueueSampler run_queues_;
+  InterruptSampler interrupts_;
+  PressureSampler pressure_;
+  NumaSampler numa_;
+  CgroupSampler cgroups_;
+  ProcessTree tree_;
+  ThreadSampler threads_;
+  MemorySampler memory_;
+  FdSampler fds_;
+  // Set when processes or cgroups changed since they were last matched
+  std::atomic<bool> cgroups_stale_{false};
+  SamplingScheduler::Clock::time_point tick_{};
+  std::chrono::system_clock::time_point tick_wall_{};
+  // Latest values of every collector, copied out on publish
+  SystemSnapshot latest_;
+  telemetry::LatencyHistogram merged_;
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable wakeup_;
+  bool running_{false};
+  bool sample_requested_{false};
+  std::uint64_t pressure_events_{0};
+};
+
+}  // namespace snapshot
+
+#endif  // COLLECTOR_H
@@ -0,0 +1,52 @@
+#ifndef FD_SAMPLER_H
+#define FD_SAMPLER_H
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+#include "parser_factory/parser.h"
+#include "snapshot/system_snapshot.h"
+#include "snapshot/top_n.h"
+
+namespace snapshot {
+
+/*
+Open file descriptors of processes, to catch leaks and socket storms.
+Counting reads only the names in /proc/[pid]/fd, so every row is
+counted. What the descriptors are takes a readlink for each of them,
+so only the top_processes rows by count are resolved, together with
+their RLIMIT_NOFILE. Both run on a slower period than the scan, scans
+in between copy the cached values over with Apply().
+*/
+class FdSampler {
+ public:
+  explicit FdSampler(std::size_t top_processes = 16);
+
+  // Counts every row and resolves the largest, returns the largest
+  // relative change in the count of a resolved row
+  double Sample(std::vector<ProcessRow>& rows);
+  // Fills the fd fields of rows read by the last Sample()
+  void Apply(std::vector<ProcessRow>& rows) const;
+
+ private:
+  typedef struct Entry {
+    unsigned long long starttime;
+    int fds;
+    parser_factory::pid_fds_t kinds;  // total is -1 when not resolved
+    long limit;
+  } fd_entry_t;
+
+  static void Fill(ProcessRow& row, const fd_entry_t& entry);
+
+  std::size_t top_processes_;
+  parser_factory::ProcessParser parser_;
+  TopNSelector selector_;
+  // By pid, only the rows read by the last Sample()
+  std::unordered_map<int, fd_entry_t> samples_;
+  std::unordered_map<int, fd_entry_t> next_samples_;
+};
+
+}  // namespace snapshot
+
+#endif  // FD_SAMPLER_H
@@ -0,0 +1,59 @@
+#ifndef INTERRUPT_SAMPLER_H
+#define INTERRUPT_SAMPLER_H
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "parser_factory/parser.h"
+#include "snapshot/system_snapshot.h"
+
+namespace snapshot {
+
+/*
+Per-CPU interrupt rates from /proc/interrupts and /proc/softirqs. Each
+table keeps the counter matrix of the previous read next to the current
+one, so the differences of a period are one subtraction over two
+contiguous arrays and the per-CPU sums one pass over the difference rows,
+both loops the compiler vectorizes. Only sources that fired are ranked
+into the busiest ones of each CPU.
+*/
+class InterruptSampler {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  // Fills both, empty until two reads were compared. Returns the largest
+  // change of a CPU's interrupt rate relative to its previous rate.
+  double Sample(std::vector<CpuInterrupts>& cpus,
+                std::vector<InterruptSource>& sources, Clock::time_point now);
+
+ private:
+  typedef struct Matrix {
+    parser_factory::interrupt_table_t table{};
+    std::vector<std::uint32_t> last;   // counts of the previous read
+    std::vector<std::uint32_t> delta;  // counts - last, modulo 2^32
+    bool valid{false};                 // last has the layout of table
+  } matrix_t;
+
+  // Takes the differences of a new read, false when there is nothing
+  // comparable yet: first read, failed read or sources came and went
+  static bool Advance(matrix_t& matrix, bool read);
+  // Adds the rows of matrix that fired to sources and their counts to
+  // the CPUs, the columns of matrix must be those of cpus
+  void Accumulate(const matrix_t& matrix, bool soft, double seconds,
+                  std::vector<CpuInterrupts>& cpus,
+                  std::vector<InterruptSource>& sources);
+
+  parser_factory::InterruptParser parser_;
+  matrix_t hard_;
+  matrix_t soft_;
+  Clock::time_point last_time_{};
+  // Scratch reused between samples
+  std::vector<std::uint64_t> column_sums_;
+  std::vector<std::uint32_t> top_counts_;  // cpus x kTopInterrupts
+  std::vector<int> order_;
+};
+
+}  // namespace snapshot
+
+#endif  // INTERRUPT_SAMPLER_H
@@ -0,0 +1,48 @@
+#ifndef MEMORY_SAMPLER_H
+#define MEMORY_SAMPLER_H
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+#include "parser_factory/parser.h"
+#include "snapshot/system_snapshot.h"
+#include "snapshot/top_n.h"
+
+namespace snapshot {
+
+/*
+Second tier of process memory. RSS comes with every scan from stat;
+PSS, USS and swap need /proc/[pid]/smaps_rollup, which walks all the
+mappings of a process, so only the top_processes rows by RSS are read,
+on a slower period than the scan. Scans in between copy the cached
+values over with Apply().
+*/
+class MemorySampler {
+ public:
+  explicit MemorySampler(std::size_t top_processes = 32);
+
+  // Reads the largest rows, returns the largest relative change in PSS
+  double Sample(std::vector<ProcessRow>& rows);
+  // Fills pss_kb, uss_kb and swap_kb of rows read by the last Sample()
+  void Apply(std::vector<ProcessRow>& rows) const;
+
+ private:
+  typedef struct Entry {
+    unsigned long long starttime;
+    parser_factory::pid_memory_t memory;
+  } memory_entry_t;
+
+  static void Fill(ProcessRow& row, const parser_factory::pid_memory_t& memory);
+
+  std::size_t top_processes_;
+  parser_factory::ProcessParser parser_;
+  TopNSelector selector_;
+  // By pid, only the rows read by the last Sample()
+  std::unordered_map<int, memory_entry_t> samples_;
+  std::unordered_map<int, memory_entry_t> next_samples_;
+};
+
+}  // namespace snapshot
+
+#endif  // MEMORY_SAMPLER_H
@@ -0,0 +1,61 @@
+#ifndef NUMA_SAMPLER_H
+#define NUMA_SAMPLER_H
+
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "parser_factory/parser.h"
+#include "snapshot/system_snapshot.h"
+
+namespace snapshot {
+
+/*
+Per-node view of a NUMA machine. Memory and numastat counters come from
+/sys/devices/system/node, the CPU load of a node from the per-core lines
+of /proc/stat summed over the node's CPUs. Where the memory of a process
+resides needs /proc/[pid]/numa_maps, which walks every mapping, so it is
+only read for the processes placed on the watch list with Locate().
+*/
+class NumaSampler {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  // root defaults to /sys/devices/system/node
+  explicit NumaSampler(std::string root = std::string());
+
+  // Thread safe, e.g. from the UI thread
+  void Locate(int pid);
+  void Forget(int pid);
+  bool Located(int pid) const;
+
+  // Fills nodes and the placements of the located processes, a process
+  // that exited or is not ours to inspect leaves the watch list. Returns
+  // the largest change in CPU utilization of a node.
+  double Sample(std::vector<NumaNodeRow>& nodes,
+                std::vector<NumaPlacement>& placements, Clock::time_point now);
+
+ private:
+  typedef struct NodeSample {
+    parser_factory::numa_node_stat_t stat;
+    Clock::time_point when;
+  } node_sample_t;
+
+  parser_factory::NumaParser parser_;
+  parser_factory::CpuParser cpu_parser_;
+  std::vector<int> nodes_;
+  bool listed_{false};
+  std::unordered_map<int, node_sample_t> samples_;
+  // (active, total) jiffies of the previous read, indexed by CPU id
+  std::vector<std::pair<long, long>> cpu_jiffies_;
+  mutable std::mutex mutex_;
+  std::set<int> located_;
+};
+
+}  // namespace snapshot
+
+#endif  // NUMA_SAMPLER_H
@@ -0,0 +1,79 @@
+#ifndef PRESSURE_MONITOR_H
+#define PRESSURE_MONITOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "parser_factory/parser.h"
+#include "snapshot/system_snapshot.h"
+
+namespace snapshot {
+
+/*
+Reads the PSI averages of the whole system and of the top-level cgroup
+v2 groups. Groups are listed again on every sample, so new ones show up
+and removed ones drop out without any bookkeeping.
+*/
+class PressureSampler {
+ public:
+  explicit PressureSampler(std::size_t max_cgroups = 16);
+
+  // Fills rows, returns the largest move of some avg10 in percent
+  double Sample(std::vector<PressureRow>& rows);
+
+ private:
+  // Reads prefix + "cpu" + suffix and likewise for memory and io
+  void AddRows(const std::string& scope, const std::string& prefix,
+               const char* suffix, std::vector<PressureRow>& rows);
+
+  std::size_t max_cgroups_;
+  parser_factory::PressureParser parser_;
+  std::string cgroup_root_;
+};
+
+/*
+Waits on PSI triggers with poll(POLLPRI) on its own thread. The kernel
+wakes the thread only when a trigger's stall threshold is crossed, so
+pressure spikes between two samples cause an immediate snapshot while an
+idle system costs nothing. Stop() wakes the thread through an eventfd.
+The triggers are registered on a parser shared with the SystemParser, so
+the events that fired are listed by GetPressureEvents() too.
+*/
+class PressureMonitor {
+ public:
+  // Called on the monitor thread with the number of events that fired
+  typedef std::function<void(std::size_t)> Callback;
+
+  // 150 ms of stall within any 1 s window, the shortest window the
+  // kernel accepts from unprivileged users is 2 s and is tried next
+  static constexpr const char* kDefaultTriggers[] = {
+      "some 150000 1000000", "some 300000 2000000"};
+
+  PressureMonitor(parser_factory::PressureParser& parser, Callback callback);
+  PressureMonitor(const PressureMonitor&) = delete;
+  PressureMonitor& operator=(const PressureMonitor&) = delete;
+  ~PressureMonitor();
+
+  // Registers the triggers and starts waiting, false when the kernel
+  // accepted none of them and there is nothing to wait for
+  bool Start();
+  void Stop();
+  std::size_t TriggerCount() const { return parser_.TriggerCount(); }
+
+ private:
+  void Run();
+
+  Callback callback_;
+  parser_factory::PressureParser& parser_;
+  int wake_fd_{-1};
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+};
+
+}  // namespace snapshot
+
+#endif  // PRESSURE_MONITOR_H
@@ -0,0 +1,80 @@
+#ifndef PROCESS_DETAILS_H
+#define PROCESS_DETAILS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "parser_factory/parser.h"
+#include "snapshot/string_arena.h"
+#include "snapshot/system_snapshot.h"
+
+namespace snapshot {
+
+// Expensive per-process fields, resolved only when a row is looked at.
+// user and command are interned in the cache that handed them out.
+typedef struct ProcessDetails {
+  std::string_view user;
+  std::string_view command;
+  long ram_mb{0};  // PSS, RSS where smaps_rollup is not readable
+  parser_factory::pid_memory_t memory{0, 0, -1, -1, -1};
+  std::uint64_t ram_sequence{0};   // snapshot the ram value was read in
+  std::uint64_t used_sequence{0};  // last snapshot the row was visible in
+} process_details_t;
+
+/*
+Per-consumer cache of ProcessDetails keyed by (source, pid, starttime),
+so a reused pid never shows the details of the process it replaced. User
+and command line are read once per process lifetime, memory is read from
+smaps_rollup every ram_refresh snapshots while the row stays visible, so
+only the rows on screen pay for it. Rows streamed from an agent are never
+looked up in the local /proc, their details come from the row itself.
+User names and command lines live in a StringArena, so a thousand
+identical workers share one copy; the arena is compacted when Sweep()
+drops rows.
+*/
+class ProcessDetailCache {
+ public:
+  explicit ProcessDetailCache(std::size_t capacity = 4096,
+                              std::uint64_t ram_refresh = 3);
+
+  const ProcessDetails& Get(const ProcessRow& row, std::uint64_t sequence);
+  // Drops rows not seen for a while, only once the cache is over capacity,
+  // and moves the strings of the others into a new arena generation
+  void Sweep(std::uint64_t sequence);
+  std::size_t Size() const { return entries_.size(); }
+  const StringArena& Strings() const { return strings_; }
+
+ private:
+  typedef struct Key {
+    int source;
+    int pid;
+    unsigned long long starttime;
+    bool operator==(const Key& other) const {
+      return source == other.source && pid == other.pid &&
+             starttime == other.starttime;
+    }
+  } detail_key_t;
+  struct KeyHash {
+    std::size_t operator()(const Key& key) const {
+      return std::hash<unsigned long long>()(
+          (key.starttime * 31 + key.pid) * 31 + key.source);
+    }
+  };
+
+  std::size_t capacity_;
+  std::uint64_t ram_refresh_;
+  // Interns "[comm]", the name of a process without a command line
+  std::string_view InternComm(const ProcessRow& row);
+
+  std::unordered_map<detail_key_t, ProcessDetails, KeyHash> entries_;
+  parser_factory::ProcessParser parser_;
+  StringArena strings_;
+  std::string command_;  // read buffer, reused
+};
+
+}  // namespace snapshot
+
+#endif  // PROCESS_DETAILS_H
@@ -0,0 +1,90 @@
+#ifndef PROCESS_FILTER_H
+#define PROCESS_FILTER_H
+
+#include <string>
+#include <vector>
+
+namespace snapshot {
+
+// Values a filter can compare, grouped by the file they are read from
+enum class FilterField {
+  kPid = 0,  // the /proc listing itself
+  kPpid,     // /proc/[pid]/stat
+  kState,
+  kComm,
+  kCpu,      // percent of one core
+  kRss,      // megabytes
+  kThreads,
+  kUptime,   // seconds
+  kUser,     // uid from /proc/[pid]/status
+  kCgroup,   // /proc/[pid]/cgroup
+  kCmd       // /proc/[pid]/cmdline
+};
+
+enum class FilterResult {
+  kMatch,
+  kMismatch,  // failed on a value that changes, e.g. cpu
+  kExcluded,  // failed on the pid, user, cgroup or command line
+  kGone       // a value could not be read, the process exited
+};
+
+// One process as seen by a filter. Values are read when the filter first
+// asks for them, both return false once the process is gone.
+class FilterSubject {
+ public:
+  virtual ~FilterSubject() = default;
+  virtual bool Number(FilterField field, double& value) = 0;
+  virtual bool Text(FilterField field, std::string& text) = 0;
+};
+
+/*
+A compiled process filter such as
+
+  user=postgres && cpu>5 && cmd~"worker"
+
+which is a conjunction of comparisons of a field with a number, a bare
+word or a quoted string. Numeric fields take = != < <= > >=, text fields
+= != and ~ / !~ for contains. Users are resolved to a uid once here.
+
+Compiling orders the comparisons by the cost of the file their field is
+read from: the pid first, stat next, then status, cgroup and cmdline.
+Evaluate() stops at the first lifetime comparison that fails. A failed
+value that changes, e.g. cpu, only skips the other values that change:
+the lifetime comparisons still run once, so a process of another user or
+command is excluded for good instead of being read again every scan.
+*/
+class ProcessFilter {
+ public:
+  // Throws std::invalid_argument naming the part it could not parse
+  explicit ProcessFilter(const std::string& expression);
+
+  // settled skips the comparisons on the pid, user, cgroup and command
+  // line, for a process that already passed them, and then stops at the
+  // first failure
+  FilterResult Evaluate(FilterSubject& subject, bool settled = false) const;
+  const std::string& Expression() const { return expression_; }
+  // True for the fields that stay the same once a process has exec'd
+  static bool Lifetime(FilterField field);
+
+ private:
+  enum class Op { kEqual, kNotEqual, kLess, kLessEqual, kGreater,
+                  kGreaterEqual, kContains, kNotContains };
+
+  typedef struct Predicate {
+    FilterField field;
+    Op op;
+    double number;
+    std::string text;
+  } predicate_t;
+
+  static bool Compare(const predicate_t& predicate, double value);
+  static bool Compare(const predicate_t& predicate, const std::string& value);
+
+  std::string expression_;
+  // Cheapest first
+  std::vector<predicate_t> plan_;
+};
+
+}  // namespace snapshot
+
+#endif  // PROCESS_FILTER_H
@@ -0,0 +1,71 @@
+#ifndef PROCESS_TREE_H
+#define PROCESS_TREE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "snapshot/system_snapshot.h"
+
+namespace snapshot {
+
+/*
+Parent/child tree of the scanned processes with the totals of every
+subtree. The totals are kept up to date incrementally: a process that
+was born, exited, moved to another parent or changed its values only
+touches itself and its ancestors, O(depth), instead of every subtree
+being summed again on each scan.
+*/
+class ProcessTree {
+ public:
+  // rows is one complete scan, fills the subtree of every row
+  void Update(std::vector<ProcessRow>& rows);
+  std::size_t Size() const { return nodes_.size(); }
+  // Totals of the subtree rooted at pid, false when pid is unknown
+  bool Subtree(int pid, subtree_t& subtree) const;
+
+  // Lists rows depth first, children by subtree CPU, and leaves out the
+  // descendants of collapsed pids. depths holds the level of each entry.
+  static void Flatten(const std::vector<ProcessRow>& rows,
+                      const std::unordered_set<int>& collapsed,
+                      std::vector<std::uint32_t>& order,
+                      std::vector<std::uint16_t>& depths);
+
+ private:
+  // Internal sums are doubles so repeated deltas do not drift
+  typedef struct Totals {
+    double cpu_utilization;
+    long rss_kb;
+    long num_threads;
+    double io_rate;
+    long processes;
+  } totals_t;
+
+  typedef struct Node {
+    int ppid;    // parent pid as the scan reported it
+    int parent;  // 0 while not attached below another process
+    unsigned long long starttime;
+    std::uint64_t generation;
+    totals_t self;
+    totals_t total;
+    std::vector<int> children;
+  } node_t;
+
+  static totals_t TotalsOf(const ProcessRow& row);
+  // Adds delta, scaled by sign, to the totals of pid and its ancestors
+  void AddUp(int pid, const totals_t& delta, int sign);
+  // Links node below parent, or leaves it a root when parent is
+  // unknown or one of its own descendants
+  void Attach(int pid, node_t& node, int parent);
+  void Detach(int pid, node_t& node);
+  void Remove(int pid);
+
+  std::unordered_map<int, node_t> nodes_;
+  std::uint64_t generation_{0};
+};
+
+}  // namespace snapshot
+
+#endif  // PROCESS_TREE_H
@@ -0,0 +1,53 @@
+#ifndef RUN_QUEUE_H
+#define RUN_QUEUE_H
+
+#include <chrono>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+#include "parser_factory/parser.h"
+#include "snapshot/system_snapshot.h"
+#include "snapshot/top_n.h"
+
+namespace snapshot {
+
+/*
+Derives how long runnable tasks wait for a CPU from schedstat deltas.
+Per-CPU counters come from one read of /proc/schedstat. Per-process
+waits cost one read per thread, so only the top_processes rows by CPU
+are sampled each round and the rest keep run_wait negative.
+*/
+class RunQueueSampler {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  explicit RunQueueSampler(std::size_t top_processes = 32);
+
+  // Fills run_queues, returns the largest change in waiting tasks
+  double SampleCpus(std::vector<RunQueue>& run_queues, Clock::time_point now);
+  // Sets run_wait of the busiest rows, rows must come from one scan
+  void SampleProcesses(std::vector<ProcessRow>& rows, Clock::time_point now);
+
+ private:
+  typedef struct Sample {
+    unsigned long long starttime;
+    unsigned long long wait_ns;
+    Clock::time_point when;
+  } sample_t;
+
+  std::size_t top_processes_;
+  parser_factory::CpuParser cpu_parser_;
+  parser_factory::ProcessParser process_parser_;
+  TopNSelector selector_;
+  std::vector<parser_factory::cpu_schedstat_t> cpus_;
+  std::vector<parser_factory::cpu_schedstat_t> last_cpus_;
+  Clock::time_point last_cpu_time_{};
+  // Previous reads of the processes sampled last round, by pid
+  std::unordered_map<int, sample_t> samples_;
+  std::unordered_map<int, sample_t> next_samples_;
+};
+
+}  // namespace snapshot
+
+#endif  // RUN_QUEUE_H
@@ -0,0 +1,97 @@
+#ifndef SAMPLING_SCHEDULER_H
+#define SAMPLING_SCHEDULER_H
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "parser_factory/parser.h"
+#include "snapshot/work_pool.h"
+
+namespace snapshot {
+
+// Share of one core used by the monitor itself, from /proc/self/stat
+class OverheadMeter {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  // Jiffies are coarse, so shorter windows are folded into the next one
+  explicit OverheadMeter(
+      std::chrono::milliseconds window = std::chrono::seconds(1));
+
+  // Returns true when a window completed and Overhead() changed
+  bool Sample(Clock::time_point now);
+  double Overhead() const { return overhead_; }
+
+ private:
+  parser_factory::ProcessParser parser_;
+  std::chrono::milliseconds window_;
+  double ticks_per_second_;
+  unsigned long last_jiffies_{0};
+  Clock::time_point last_time_{};
+  double overhead_{0.0};
+};
+
+/*
+Runs each collector at its own period and adapts the periods.
+
+Periods are quantum << level, so every period divides the longer ones
+and deadlines sit on multiples of the period since construction: tasks
+sharing a period, and any longer one, fall into the same wakeup. A task
+returns how much its metrics moved, 1.0 or more speeds it up by one
+level, a run of quiet samples backs it off by one. While the monitor's
+own CPU use is above the budget every task backs off instead.
+
+With a WorkPool the tasks due in one wakeup run concurrently; a task
+added with after waits for that task when both are due together.
+*/
+class SamplingScheduler {
+ public:
+  typedef OverheadMeter::Clock Clock;
+  // Samples one collector and returns its change score
+  typedef std::function<double()> Task;
+
+  // overhead_budget is a share of one core, e.g. 0.01 for 1%
+  SamplingScheduler(Clock::duration quantum, double overhead_budget,
+                    bool adaptive, Clock::time_point epoch = Clock::now());
+
+  // Levels are clamped to [min_level, max_level], returns the task id.
+  // after is the id of an earlier task this one reads the results of.
+  int AddTask(std::string name, int min_level, int level, int max_level,
+              Task task, int after = -1);
+  // Runs due tasks on pool from now on, null runs them one by one
+  void SetPool(WorkPool* pool) { pool_ = pool; }
+  // Runs every task whose deadline has passed, returns how many ran
+  int RunDue(Clock::time_point now);
+  Clock::time_point NextDeadline() const;
+  Clock::duration Period(int id) const;
+  double Overhead() const { return meter_.Overhead(); }
+
+ private:
+  typedef struct Entry {
+    std::string name;
+    int min_level;
+    int level;
+    int max_level;
+    Task task;
+    int after;
+    Clock::time_point deadline;
+    int quiet_runs;
+  } entry_t;
+
+  void Adapt(entry_t& entry, double score, bool throttled);
+  void Reschedule(entry_t& entry, Clock::time_point now);
+
+  Clock::duration quantum_;
+  double overhead_budget_;
+  bool adaptive_;
+  Clock::time_point epoch_;
+  OverheadMeter meter_;
+  std::vector<entry_t> entries_;
+  WorkPool* pool_{nullptr};
+};
+
+}  // namespace snapshot
+
+#endif  // SAMPLING_SCHEDULER_H
@@ -0,0 +1,118 @@
+#ifndef SNAPSHOT_PUBLISHER_H
+#define SNAPSHOT_PUBLISHER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "snapshot/system_snapshot.h"
+
+namespace snapshot {
+
+/*
+Single writer, many reader hand-off of immutable snapshots.
+
+The collector swaps a fully built snapshot in with one atomic exchange.
+Readers never lock: they announce the epoch they entered in, load the
+current pointer and clear their slot when done. A replaced snapshot is
+kept on a retire list until every active reader has moved past the
+epoch in which it was replaced (epoch-based reclamation).
+*/
+class SnapshotPublisher {
+ public:
+  static constexpr int kMaxReaders = 16;
+
+  class Reader;
+
+  // Keeps the snapshot it points at alive until it goes out of scope
+  class ReadGuard {
+   public:
+    ReadGuard(ReadGuard&& other) noexcept
+        : slot_(std::exchange(other.slot_, nullptr)),
+          snapshot_(other.snapshot_) {}
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+    ~ReadGuard();
+
+    const SystemSnapshot& operator*() const { return *snapshot_; }
+    const SystemSnapshot* operator->() const { return snapshot_; }
+
+   private:
+    friend class Reader;
+    ReadGuard(std::atomic<std::uint64_t>* slot, const SystemSnapshot* snapshot)
+        : slot_(slot), snapshot_(snapshot) {}
+    std::atomic<std::uint64_t>* slot_;
+    const SystemSnapshot* snapshot_;
+  };
+
+  // A registered consumer, owns one reader slot for its lifetime
+  class Reader {
+   public:
+    explicit Reader(SnapshotPublisher& publisher);
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+    ~Reader();
+
+    ReadGuard Acquire();
+
+   private:
+    SnapshotPublisher& publisher_;
+    std::atomic<std::uint64_t>* slot_;
+  };
+
+  SnapshotPublisher();
+  SnapshotPublisher(const SnapshotPublisher&) = delete;
+  SnapshotPublisher& operator=(const SnapshotPublisher&) = delete;
+  ~SnapshotPublisher();
+
+  // Writer side, must only be called from the collector thread
+  void Publish(std::unique_ptr<SystemSnapshot> snapshot);
+  std::uint64_t Sequence() const;
+  // Blocks until a snapshot newer than sequence is published or the
+  // timeout expires, returns the latest sequence. Only consumers that
+  // want to be woken pay for the lock, Acquire() stays lock free.
+  std::uint64_t WaitForNewer(std::uint64_t sequence,
+                             std::chrono::milliseconds timeout);
+  // Called on the collector thread after every publish with the new
+  // sequence, must not block (e.g. write to an eventfd). Returns an id
+  // for RemoveListener.
+  int AddListener(std::function<void(std::uint64_t)> listener);
+  void RemoveListener(int id);
+  std::size_t RetiredCount() const { return retired_.size(); }
+
+ private:
+  static constexpr std::uint64_t kIdle = 0;
+  static constexpr std::uint64_t kUnclaimed = ~std::uint64_t{0};
+
+  typedef struct Retired {
+    const SystemSnapshot* snapshot;
+    std::uint64_t epoch;
+  } retired_t;
+
+  void Reclaim();
+
+  std::atomic<const SystemSnapshot*> current_;
+  std::atomic<std::uint64_t> epoch_{1};
+  std::atomic<std::uint64_t> sequence_{0};
+  // Each slot is alone on its cache line so readers do not share lines
+  struct alignas(64) Slot {
+    std::atomic<std::uint64_t> epoch{kUnclaimed};
+  };
+  std::array<Slot, kMaxReaders> slots_;
+  std::vector<retired_t> retired_;
+  std::mutex wait_mutex_;
+  std::condition_variable published_;
+  std::vector<std::pair<int, std::function<void(std::uint64_t)>>> listeners_;
+  int next_listener_{0};
+};
+
+}  // namespace snapshot
+
+#endif  // SNAPSHOT_PUBLISHER_H
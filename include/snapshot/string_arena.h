@@ -0,0 +1,51 @@
+#ifndef STRING_ARENA_H
+#define STRING_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace snapshot {
+
+/*
+Interns strings into large blocks, equal strings share one copy. A view
+returned by Intern() stays valid for as long as its generation. Nothing
+is freed string by string: NextGeneration() starts fresh blocks, the
+owner interns again whatever is still in use, and DropGeneration()
+releases the blocks of the previous generation at once.
+*/
+class StringArena {
+ public:
+  explicit StringArena(std::size_t block_size = 64 * 1024);
+  StringArena(const StringArena&) = delete;
+  StringArena& operator=(const StringArena&) = delete;
+
+  std::string_view Intern(std::string_view text);
+  // Intern() copies into new blocks from now on, views into the previous
+  // generation stay valid until DropGeneration()
+  void NextGeneration();
+  void DropGeneration();
+  // Distinct strings and their bytes in the current generation
+  std::size_t Strings() const { return current_.index.size(); }
+  std::size_t Bytes() const { return current_.bytes; }
+
+ private:
+  typedef struct Generation {
+    std::vector<std::unique_ptr<char[]>> blocks;
+    std::size_t used{0};  // of the last block
+    std::size_t bytes{0};
+    std::unordered_set<std::string_view> index;
+  } generation_t;
+
+  char* Allocate(std::size_t size);
+
+  std::size_t block_size_;
+  generation_t current_;
+  generation_t previous_;
+};
+
+}  // namespace snapshot
+
+#endif  // STRING_ARENA_H
@@ -0,0 +1,214 @@
+#ifndef SYSTEM_SNAPSHOT_H
+#define SYSTEM_SNAPSHOT_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "parser_factory/metrics.h"
+
+namespace snapshot {
+
+// -----------------------------
+// Totals of a process and all of its descendants
+typedef struct Subtree {
+  float cpu_utilization;
+  long rss_kb;
+  long num_threads;
+  double io_rate;
+  int processes;  // the process itself included
+} subtree_t;
+
+// One row of the process table as it was seen by the collector. Only
+// fields that come from /proc/[pid]/stat are collected for every
+// process, user, command line and memory details are resolved on demand
+// through ProcessDetailCache for the rows somebody actually looks at.
+typedef struct ProcessRow {
+  int pid;
+  int ppid;
+  char state;
+  char comm[16];
+  unsigned long long starttime;  // jiffies after boot, with pid the identity
+  float cpu_utilization;         // share of one CPU, 0.0 - 1.0 per core
+  long uptime;                   // seconds
+  long num_threads;
+  long rss_kb;           // from stat, every scan
+  long pss_kb;           // from smaps_rollup for the largest rows,
+  long uss_kb;           // refreshed less often than the scan,
+  long swap_kb;          // negative when not sampled
+  double io_rate;        // bytes per second read and written
+  double read_rate;      // bytes per second from storage, negative when
+  double write_rate;     // /proc/[pid]/io is not readable
+  float syscr_rate;      // read and write syscalls per second
+  float syscw_rate;
+  double energy_joules;  // package energy attributed since first seen
+  float run_wait;        // seconds per second spent waiting for a CPU,
+                         // summed over threads, negative when not sampled
+  int fds;               // open descriptors, negative when not counted
+  int fd_sockets;        // kinds of descriptors of the rows with the most,
+  int fd_pipes;          // resolved less often than they are counted,
+  int fd_files;          // negative when not resolved
+  long fd_limit;         // soft RLIMIT_NOFILE of those rows, negative when
+                         // not read or unlimited
+  int cgroup;            // index into SystemSnapshot::cgroups, -1 if unknown
+  subtree_t subtree;     // maintained by ProcessTree
+  int source;            // 0 when collected here, n for the agent behind
+                         // SystemSnapshot::sources[n - 1]
+} process_row_t;
+
+// One thread of a process whose threads are being watched
+typedef struct ThreadRow {
+  int pid;
+  int tid;
+  char state;
+  char comm[16];
+  int processor;          // CPU the thread last ran on
+  float cpu_utilization;  // share of one CPU, 0.0 - 1.0
+} thread_row_t;
+
+// Run-queue wait of one CPU over the last sampling period
+typedef struct RunQueue {
+  int cpu;
+  float waiting;        // mean number of runnable tasks waiting for it
+  double avg_wait_ns;   // wait per timeslice run
+} run_queue_t;
+
+// Busiest interrupt sources kept for each CPU
+constexpr int kTopInterrupts = 3;
+
+// A hard IRQ line or softirq kind that fired over the last period
+typedef struct InterruptSource {
+  std::string name;         // "24", "LOC", "NET_RX"
+  std::string description;  // chip and device of a hard IRQ, else empty
+  bool soft;
+  float rate;               // per second, summed over all CPUs
+} interrupt_source_t;
+
+// Interrupts one CPU handled over the last period
+typedef struct CpuInterrupts {
+  int cpu;
+  float hard_rate;  // per second
+  float soft_rate;
+  // Busiest sources on this CPU, indexes into
+  // SystemSnapshot::interrupt_sources, -1 past the last one
+  int top[kTopInterrupts];
+  float top_rate[kTopInterrupts];
+} cpu_interrupts_t;
+
+// One NUMA node over the last period
+typedef struct NumaNodeRow {
+  int node;
+  int cpus;               // online CPUs on the node, 0 for memory only
+  float cpu_utilization;  // busy share of those CPUs
+  long total_kb;
+  long free_kb;
+  // Page allocations per second served by this node, from numastat
+  float hit_rate;      // the node was the preferred one
+  float miss_rate;     // another node was preferred but full
+  float foreign_rate;  // this node was preferred, the page came from another
+  float other_rate;    // for a task running on another node
+} numa_node_row_t;
+
+// Where the memory of a process somebody asked about resides
+typedef struct NumaPlacement {
+  int pid;
+  std::vector<long> node_kb;  // indexed by node id
+} numa_placement_t;
+
+// One cgroup v2 group, counters include all of its descendants
+typedef struct CgroupRow {
+  std::string path;        // below the v2 root, "/" for the root itself
+  float cpu_utilization;   // CPUs kept busy, 1.0 per fully used core
+  float throttled;         // share of wall time throttled by cpu.max
+  long memory_kb;
+  long anon_kb;
+  long file_kb;            // page cache charged to the group
+  double read_rate;        // bytes per second
+  double write_rate;       // bytes per second
+  int processes;           // processes of the last scan in the subtree
+} cgroup_row_t;
+
+// Pressure stall averages of one resource in one scope, in percent of
+// wall time some or all non-idle tasks were stalled on it
+typedef struct PressureRow {
+  std::string scope;     // "system" or a cgroup path below the v2 root
+  std::string resource;  // "cpu", "memory" or "io"
+  float some_avg10;
+  float some_avg60;
+  float some_avg300;
+  float full_avg10;
+  float full_avg60;
+  float full_avg300;
+} pressure_row_t;
+
+// One agent streaming its snapshots to an aggregator
+typedef struct SourceRow {
+  std::string name;
+  bool connected;
+  std::uint64_t frames;  // received since the aggregator started
+  std::uint64_t bytes;
+  std::chrono::system_clock::time_point last_seen;
+  float cpu_utilization;
+  float memory_utilization;
+  int total_processes;
+  std::vector<float> cpu_history;  // one value per frame, oldest first
+} source_row_t;
+
+// Latency of one instrumented collector, merged over all threads
+typedef struct LatencySummary {
+  std::string name;
+  std::uint64_t count;
+  std::uint64_t sum_ns;
+  std::uint64_t p50_ns;
+  std::uint64_t p99_ns;
+  std::uint64_t max_ns;
+} latency_summary_t;
+
+/*
+Everything the UI and exporters need for one tick. A snapshot is built
+completely by the collector and never modified once it is published,
+so readers can use it without any synchronisation.
+*/
+typedef struct SystemSnapshot {
+  std::uint64_t sequence{0};  // 0 until the first collection finished
+  std::chrono::system_clock::time_point timestamp{};
+  std::string operating_system;
+  std::string kernel;
+  float cpu_utilization{0.0f};     // 0.0 - 1.0
+  float memory_utilization{0.0f};  // 0.0 - 1.0
+  long uptime{0};                  // seconds
+  int total_processes{0};
+  int running_processes{0};
+  // Load, memory, network and /proc/stat counters of the tick
+  parser_factory::metric_snapshot_t metrics{};
+  // Filter expression the processes were selected with, empty for all
+  std::string filter;
+  std::vector<process_row_t> processes;
+  // Threads of expanded or filtered processes, by pid then busiest first
+  std::vector<thread_row_t> threads;
+  // Empty when the kernel does not provide /proc/schedstat
+  std::vector<run_queue_t> run_queues;
+  // Empty on a kernel without NUMA support
+  std::vector<numa_node_row_t> numa_nodes;
+  // Only for processes placed on the watch list, by pid
+  std::vector<numa_placement_t> numa_placements;
+  // Empty until /proc/interrupts was read twice
+  std::vector<cpu_interrupts_t> interrupts;
+  // Every source that fired over the last period, busiest first
+  std::vector<interrupt_source_t> interrupt_sources;
+  // Parents before their children, empty without a cgroup v2 hierarchy
+  std::vector<cgroup_row_t> cgroups;
+  // System-wide rows first, empty when the kernel has no PSI
+  std::vector<pressure_row_t> pressure;
+  // PSI trigger events seen since start
+  std::uint64_t pressure_events{0};
+  // Agents of an aggregator by first contact, empty everywhere else
+  std::vector<source_row_t> sources;
+  // The monitor's own timing, probes without samples are left out
+  std::vector<latency_summary_t> latencies;
+} system_snapshot_t;
+
+}  // namespace snapshot
+
+#endif  // SYSTEM_SNAPSHOT_H
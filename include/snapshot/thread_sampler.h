@@ -0,0 +1,66 @@
+#ifndef THREAD_SAMPLER_H
+#define THREAD_SAMPLER_H
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "parser_factory/parser.h"
+#include "snapshot/system_snapshot.h"
+
+namespace snapshot {
+
+/*
+Per-thread CPU of the processes somebody asked for, from
+/proc/[pid]/task/[tid]/stat. Only processes that were expanded or whose
+command matches the filter are looked at, and at most max_reads thread
+stats are read per sample: a process with thousands of threads is
+refreshed over a few samples, round robin, instead of stalling one.
+*/
+class ThreadSampler {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  explicit ThreadSampler(std::size_t max_reads = 512);
+
+  // Thread safe, e.g. from the UI thread
+  void Expand(int pid);
+  void Collapse(int pid);
+  bool Expanded(int pid) const;
+  // Processes whose comm contains filter are watched too, empty for none
+  void SetFilter(std::string filter);
+
+  // Fills threads for the watched rows of processes, returns the largest
+  // change in CPU of a thread that was read
+  double Sample(const std::vector<ProcessRow>& processes,
+                std::vector<ThreadRow>& threads, Clock::time_point now);
+
+ private:
+  typedef struct State {
+    unsigned long long starttime;
+    unsigned long jiffies;
+    Clock::time_point when;
+    thread_row_t row;
+    bool measured;  // cpu_utilization comes from a delta
+  } state_t;
+
+  std::size_t max_reads_;
+  double ticks_per_second_;
+  parser_factory::ProcessParser parser_;
+  mutable std::mutex mutex_;
+  std::unordered_set<int> expanded_;
+  std::string filter_;
+  // By tid, thread ids are unique across processes
+  std::unordered_map<int, state_t> states_;
+  std::vector<std::pair<int, int>> tasks_;
+  std::size_t cursor_{0};
+};
+
+}  // namespace snapshot
+
+#endif  // THREAD_SAMPLER_H
@@ -0,0 +1,42 @@
+#ifndef TOP_N_H
+#define TOP_N_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "snapshot/system_snapshot.h"
+
+namespace snapshot {
+
+// Orderings offered for the process table, all descending
+enum class SortKey { kCpu = 0, kRss, kIoRate, kStartTime, kEnergy, kFds };
+
+const char* SortKeyName(SortKey key);
+
+/*
+Picks the n highest ranked rows of a snapshot without sorting the whole
+table. Ranking works on compact (key, index) pairs built from fields the
+snapshot already holds, so changing the key never touches /proc.
+Small n relative to the table uses a bounded heap, larger n nth_element.
+*/
+class TopNSelector {
+ public:
+  // Returns row indices, best first. The reference stays valid until the
+  // next call.
+  const std::vector<std::uint32_t>& Select(
+      const std::vector<ProcessRow>& processes, SortKey key, std::size_t n);
+
+ private:
+  typedef struct Ranked {
+    double key;
+    std::uint32_t index;
+  } ranked_t;
+
+  std::vector<ranked_t> ranked_;
+  std::vector<std::uint32_t> order_;
+};
+
+}  // namespace snapshot
+
+#endif  // TOP_N_H
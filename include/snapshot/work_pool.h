@@ -0,0 +1,88 @@
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace snapshot {
+
+/*
+Small fork/join pool for one collection tick. Every worker owns a
+deque: it runs its own jobs newest first and, when it runs dry, steals
+the oldest job of another worker. The thread that waits on a group
+helps by running queued jobs too, so a job may spawn and wait on more
+jobs (e.g. the process scan splitting into chunks) without deadlock,
+and a pool of zero workers runs everything on the caller.
+*/
+class WorkPool {
+ public:
+  typedef std::function<void()> Job;
+
+  // Jobs spawned together and waited on together. The first exception a
+  // job throws is rethrown by Wait().
+  class Group {
+   public:
+    Group() = default;
+    Group(const Group&) = delete;
+    Group& operator=(const Group&) = delete;
+
+   private:
+    friend class WorkPool;
+    std::atomic<std::size_t> pending_{0};
+    std::mutex mutex_;
+    std::condition_variable done_;
+    std::exception_ptr error_;
+  };
+
+  // Defaults to one worker less than the cores, at most three
+  explicit WorkPool(std::size_t workers = DefaultWorkers());
+  WorkPool(const WorkPool&) = delete;
+  WorkPool& operator=(const WorkPool&) = delete;
+  ~WorkPool();
+
+  void Spawn(Group& group, Job job);
+  // Runs queued jobs until every job of group finished
+  void Wait(Group& group);
+  // Calls body on chunks of at most grain indices of [0, count) and waits
+  void ParallelFor(std::size_t count, std::size_t grain,
+                   const std::function<void(std::size_t, std::size_t)>& body);
+  std::size_t Workers() const { return threads_.size(); }
+
+  static std::size_t DefaultWorkers();
+
+ private:
+  typedef struct Queued {
+    Job job;
+    Group* group;
+  } queued_t;
+
+  typedef struct Deque {
+    std::mutex mutex;
+    std::deque<queued_t> jobs;
+  } deque_t;
+
+  void Work(std::size_t index);
+  // Own deque from the back, then the others from the front
+  bool RunOne(std::size_t index);
+  void Finish(queued_t& queued);
+
+  // One deque per worker and a last one shared by outside threads
+  std::vector<std::unique_ptr<deque_t>> deques_;
+  std::vector<std::thread> threads_;
+  std::atomic<std::size_t> queued_{0};
+  std::mutex sleep_mutex_;
+  std::condition_variable wake_;
+  bool stopping_{false};
+};
+
+}  // namespace snapshot
+
+#endif  // WORK_POOL_H
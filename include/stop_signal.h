@@ -0,0 +1,14 @@
+#ifndef STOP_SIGNAL_H
+#define STOP_SIGNAL_H
+
+// SIGINT/SIGTERM end headless modes gracefully, SIGPIPE is ignored so a
+// closed reader shows up as EPIPE instead of killing the monitor
+void InstallStopHandlers();
+bool StopRequested();
+// Sleeps until SIGINT or SIGTERM arrives
+void WaitForStopSignal();
+// Called first thing on worker threads so stop signals reach the main
+// thread and wake WaitForStopSignal()
+void BlockStopSignals();
+
+#endif  // STOP_SIGNAL_H
@@ -1,27 +1,91 @@
 #ifndef SYSTEM_H
 #define SYSTEM_H
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
+#include "parser_factory/batch_reader.h"
+#include "parser_factory/parser.h"
 #include "process.h"
 #include "processor.h"
 
+namespace snapshot {
+class ProcessFilter;
+class WorkPool;
+}
+
 class System {
  public:
+  // batch_reads scans through a BatchReader, io_uring where available
+  explicit System(bool batch_reads = false);
   Processor& Cpu();                   // TODO: See src/system.cpp
-  std::vector<Process>& Processes();  // TODO: See src/system.cpp
-  float MemoryUtilization();          // TODO: See src/system.cpp
-  long UpTime();                      // TODO: See src/system.cpp
-  int TotalProcesses();               // TODO: See src/system.cpp
-  int RunningProcesses();             // TODO: See src/system.cpp
+  // Shared with a PressureMonitor, whose trigger events it then reports
+  parser_factory::PressureParser& Pressure() { return pressure_parser_; }
+  // Rescans /proc, processes keep their cached state across calls. With a
+  // pool the processes are refreshed in chunks on its workers.
+  std::vector<Process>& Processes(snapshot::WorkPool* pool = nullptr);
+  // Limits Processes() to the matches of filter from the next scan on,
+  // null lists every process. Safe from any thread.
+  void SetFilter(std::shared_ptr<const snapshot::ProcessFilter> filter);
+  // Expression of the filter the last scan used, empty for none
+  std::string FilterExpression() const;
+  // Fills the system-wide fields of metrics, false when a source failed
+  bool Collect(parser_factory::metric_snapshot_t& metrics);
+  long UpTime();
+  int TotalProcesses();  // listed by the last scan, matching or not
+  // Files under /proc/[pid] that Processes() read so far
+  std::uint64_t ScanReads() const { return scan_reads_.load(); }
   std::string Kernel();               // TODO: See src/system.cpp
   std::string OperatingSystem();      // TODO: See src/system.cpp
 
-  // TODO: Define any necessary private members
  private:
+  // What a scan does with a process
+  enum class ScanResult : char {
+    kGone = 0,  // exited
+    kListed,    // matched, returned by Processes()
+    kHidden,    // failed the filter this time, sampled again next scan
+    kExcluded   // failed the filter for good, rechecked a few a scan
+  };
+
+  double ReadUpTime();
+  void AttributeEnergy();
+  // Refreshes one process through the filter of the scan, reads io only
+  // once it is listed. refreshed tells that its stat was read already.
+  ScanResult Scan(Process& process, double uptime, bool refreshed);
+  // Reads stat, then io, of every process in batches
+  void UpdateBatched(std::vector<Process>& processes, double uptime,
+                     std::vector<ScanResult>& results);
+
   Processor cpu_ = {};
   std::vector<Process> processes_ = {};
+  // Sorted by pid like processes_
+  std::vector<Process> hidden_ = {};
+  // Sorted by pid
+  std::vector<int> excluded_ = {};
+  // Last excluded pid put back through the filter
+  int rechecked_pid_{0};
+  std::atomic<std::uint64_t> scan_reads_{0};
+  int seen_{0};
+  parser_factory::ProcessParser process_parser_;
+  parser_factory::CpuParser cpu_parser_;
+  parser_factory::MemoryParser memory_parser_;
+  parser_factory::NetworkParser network_parser_;
+  parser_factory::PressureParser pressure_parser_;
+  parser_factory::SystemParser system_parser_{cpu_parser_, memory_parser_,
+                                              process_parser_,
+                                              pressure_parser_};
+  std::unique_ptr<parser_factory::BatchReader> batch_reader_;
+  double last_energy_{-1.0};
+  std::mutex filter_mutex_;
+  std::shared_ptr<const snapshot::ProcessFilter> filter_;
+  std::uint64_t filter_generation_{0};
+  // Copies of the above taken by the scan, collection thread only
+  std::shared_ptr<const snapshot::ProcessFilter> scan_filter_;
+  std::uint64_t scan_generation_{0};
 };
 
-#endif
\ No newline at end of file
+#endif
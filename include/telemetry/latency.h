@@ -0,0 +1,98 @@
+#ifndef TELEMETRY_LATENCY_H
+#define TELEMETRY_LATENCY_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+
+namespace telemetry {
+
+// Instrumented collectors, one histogram each per thread
+enum class Probe {
+  kCpu,
+  kMemory,
+  kProcess,
+  kSystem,
+  kCgroup,
+  kNetwork,
+  kPressure,
+  kInterrupts,
+  kNuma,
+  kCollection
+};
+constexpr int kProbeCount = 10;
+
+const char* ProbeName(Probe probe);
+
+// Reads the TSC on x86-64 hosts with an invariant TSC, CLOCK_MONOTONIC
+// everywhere else
+class ProbeClock {
+ public:
+  static std::uint64_t Now();
+  static std::uint64_t ToNanoseconds(std::uint64_t ticks);
+  static bool UsesTsc();
+};
+
+/*
+HDR-style histogram of nanosecond latencies. Buckets are log-linear:
+32 linear sub-buckets per power of two, which keeps every recorded
+value within about 3% while covering 1 ns to 2^40 ns in ~1200 counters.
+Only the owning thread records, others merge with relaxed loads.
+*/
+class LatencyHistogram {
+ public:
+  static constexpr int kSubBucketBits = 5;
+  static constexpr int kMaxValueBits = 40;
+  static constexpr std::size_t kBucketCount =
+      (2 << kSubBucketBits) +
+      (kMaxValueBits - kSubBucketBits - 1) * (1 << kSubBucketBits);
+
+  LatencyHistogram() = default;
+  LatencyHistogram(const LatencyHistogram&) = delete;
+  LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+  void Record(std::uint64_t nanoseconds);
+  void Merge(const LatencyHistogram& other);
+  void Reset();
+
+  std::uint64_t Count() const;
+  std::uint64_t Sum() const;
+  std::uint64_t Max() const;
+  // Upper bound of the bucket holding the given percentile (0 - 100)
+  std::uint64_t Percentile(double percentile) const;
+
+  static std::size_t BucketFor(std::uint64_t nanoseconds);
+  static std::uint64_t HighestValueIn(std::size_t bucket);
+
+ private:
+  std::array<std::atomic<std::uint64_t>, kBucketCount> buckets_{};
+  std::atomic<std::uint64_t> count_{0};
+  std::atomic<std::uint64_t> sum_{0};
+  std::atomic<std::uint64_t> max_{0};
+};
+
+// Merges the histograms every thread recorded for probe into merged
+void MergeProbe(Probe probe, LatencyHistogram& merged);
+// One line per probe with samples: "cpu: p50 12.3us p99 40.1us max ..."
+std::string Describe(std::initializer_list<Probe> probes);
+
+// Times its scope into the calling thread's histogram of probe. Nested
+// probes of the same kind only record the outermost scope.
+class ScopedProbe {
+ public:
+  explicit ScopedProbe(Probe probe);
+  ScopedProbe(const ScopedProbe&) = delete;
+  ScopedProbe& operator=(const ScopedProbe&) = delete;
+  ~ScopedProbe();
+
+ private:
+  Probe probe_;
+  std::uint64_t start_;
+};
+
+}  // namespace telemetry
+
+#endif  // TELEMETRY_LATENCY_H
@@ -0,0 +1,229 @@
+#include "exporter/agent.h"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include "exporter/socket_address.h"
+#include "logger/logger_singletone.h"
+#include "stop_signal.h"
+
+using namespace exporter;
+
+namespace
+{
+constexpr int kFirstBackoffMs = 100;
+constexpr int kMaxBackoffMs = 5000;
+} // namespace
+
+Agent::Agent(snapshot::SnapshotPublisher &publisher, std::string address,
+             std::string name)
+    : publisher_(publisher), reader_(publisher), address_(std::move(address)),
+      name_(std::move(name))
+{
+}
+
+Agent::~Agent() { Stop(); }
+
+void Agent::Start()
+{
+  wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wake_fd_ < 0)
+  {
+    throw std::runtime_error(std::string("Failed to set up agent: ") +
+                             std::strerror(errno));
+  }
+  Connect();
+  int wake_fd = wake_fd_;
+  listener_id_ = publisher_.AddListener([wake_fd](std::uint64_t)
+                                        {
+    std::uint64_t one = 1;
+    ssize_t ignored = write(wake_fd, &one, sizeof(one));
+    (void)ignored; });
+  running_ = true;
+  thread_ = std::thread(&Agent::Run, this);
+}
+
+void Agent::Stop()
+{
+  if (!running_.exchange(false))
+  {
+    return;
+  }
+  publisher_.RemoveListener(listener_id_);
+  std::uint64_t one = 1;
+  ssize_t ignored = write(wake_fd_, &one, sizeof(one));
+  (void)ignored;
+  if (thread_.joinable())
+  {
+    thread_.join();
+  }
+  if (socket_fd_ >= 0)
+  {
+    close(socket_fd_);
+    socket_fd_ = -1;
+  }
+  close(wake_fd_);
+}
+
+void Agent::Connect()
+{
+  socket_fd_ = ConnectTo(address_);
+  if (socket_fd_ < 0)
+  {
+    if (backoff_ms_ == 0)
+    {
+      Logger::GetInstance().Log(LogLevel::ERROR,
+                                "Aggregator at " + address_ +
+                                    " not reachable, retrying: " +
+                                    std::strerror(errno));
+    }
+    backoff_ms_ = std::clamp(backoff_ms_ * 2, kFirstBackoffMs, kMaxBackoffMs);
+    reconnect_at_ = std::chrono::steady_clock::now() +
+                    std::chrono::milliseconds(backoff_ms_);
+    return;
+  }
+  backoff_ms_ = 0;
+  encoder_.Reset();
+  frame_ = std::string_view();
+  sent_ = 0;
+  sent_sequence_ = 0; // the current snapshot opens the new stream
+  Logger::GetInstance().Log(LogLevel::INFO,
+                            "Streaming snapshots to " + address_);
+}
+
+void Agent::Disconnect()
+{
+  close(socket_fd_);
+  socket_fd_ = -1;
+  frame_ = std::string_view();
+  sent_ = 0;
+  reconnect_at_ = std::chrono::steady_clock::now(); // retry right away
+  Logger::GetInstance().Log(LogLevel::ERROR,
+                            "Lost the aggregator at " + address_);
+}
+
+void Agent::Run()
+{
+  BlockStopSignals();
+  while (running_)
+  {
+    pollfd fds[2] = {{wake_fd_, POLLIN, 0}, {socket_fd_, POLLIN, 0}};
+    if (sent_ < frame_.size())
+    {
+      fds[1].events |= POLLOUT;
+    }
+    int const count = socket_fd_ < 0 ? 1 : 2;
+    int timeout = -1;
+    if (socket_fd_ < 0)
+    {
+      // Ticks wake the poll too, so wait only for what is left of the
+      // backoff instead of restarting it
+      auto const left = std::chrono::ceil<std::chrono::milliseconds>(
+          reconnect_at_ - std::chrono::steady_clock::now());
+      timeout = static_cast<int>(std::max<std::int64_t>(left.count(), 0));
+    }
+    int const ready = poll(fds, count, timeout);
+    if (ready < 0 && errno != EINTR)
+    {
+      Logger::GetInstance().Log(LogLevel::ERROR, "Agent poll failed.");
+      return;
+    }
+    if (fds[0].revents & POLLIN)
+    {
+      std::uint64_t wakes;
+      ssize_t ignored = read(wake_fd_, &wakes, sizeof(wakes));
+      (void)ignored;
+    }
+    if (!running_)
+    {
+      break;
+    }
+    if (socket_fd_ < 0)
+    {
+      if (std::chrono::steady_clock::now() >= reconnect_at_)
+      {
+        Connect();
+      }
+      if (socket_fd_ < 0)
+      {
+        continue;
+      }
+    }
+    else if (count == 2 && (fds[1].revents & (POLLIN | POLLHUP | POLLERR)))
+    {
+      // The aggregator never sends, readable means it hung up
+      char discard[256];
+      ssize_t length = recv(socket_fd_, discard, sizeof(discard), 0);
+      if (length == 0 ||
+          (length < 0 && errno != EAGAIN && errno != EINTR) ||
+          (fds[1].revents & (POLLHUP | POLLERR)))
+      {
+        Disconnect();
+        continue;
+      }
+    }
+    // A tick published while the last frame was in flight goes out as
+    // soon as that frame is done
+    do
+    {
+      Encode();
+      if (!Flush())
+      {
+        Disconnect();
+        break;
+      }
+    } while (sent_ == frame_.size() && sent_sequence_ < publisher_.Sequence());
+  }
+}
+
+void Agent::Encode()
+{
+  if (sent_ < frame_.size())
+  {
+    return; // the latest snapshot is encoded once this one is out
+  }
+  auto snapshot = reader_.Acquire();
+  std::uint64_t const sequence = snapshot->sequence;
+  if (sequence == 0 || sequence == sent_sequence_)
+  {
+    return;
+  }
+  if (sent_sequence_ != 0 && sequence > sent_sequence_ + 1)
+  {
+    skipped_ += sequence - sent_sequence_ - 1;
+  }
+  frame_ = encoder_.Encode(*snapshot, name_);
+  sent_ = 0;
+  sent_sequence_ = sequence;
+}
+
+bool Agent::Flush()
+{
+  while (sent_ < frame_.size())
+  {
+    ssize_t written = send(socket_fd_, frame_.data() + sent_,
+                           frame_.size() - sent_, MSG_NOSIGNAL);
+    if (written < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return errno == EAGAIN; // wait for POLLOUT
+    }
+    sent_ += static_cast<std::size_t>(written);
+    bytes_ += static_cast<std::uint64_t>(written);
+    if (sent_ == frame_.size())
+    {
+      ++frames_;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,350 @@
+#include "exporter/aggregator.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#include "exporter/socket_address.h"
+#include "logger/logger_singletone.h"
+#include "stop_signal.h"
+
+using namespace exporter;
+
+namespace
+{
+// A frame is one process table, anything larger is a broken stream
+constexpr std::uint32_t kMaxFrameSize = 64u << 20;
+constexpr int kMaxEvents = 64;
+
+std::runtime_error SocketError(const std::string &what)
+{
+  return std::runtime_error(what + ": " + std::strerror(errno));
+}
+} // namespace
+
+Aggregator::Aggregator(snapshot::SnapshotPublisher &publisher,
+                       std::string address,
+                       std::chrono::milliseconds interval, std::size_t history)
+    : publisher_(publisher), address_(std::move(address)),
+      interval_(interval), history_(history)
+{
+}
+
+Aggregator::~Aggregator() { Stop(); }
+
+void Aggregator::Start()
+{
+  listen_fd_ = ListenOn(address_);
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (epoll_fd_ < 0 || wake_fd_ < 0 || timer_fd_ < 0)
+  {
+    throw SocketError("Failed to set up aggregator");
+  }
+  itimerspec period{};
+  auto const seconds =
+      std::chrono::duration_cast<std::chrono::seconds>(interval_);
+  period.it_interval.tv_sec = seconds.count();
+  period.it_interval.tv_nsec =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(interval_ - seconds)
+          .count();
+  period.it_value = period.it_interval;
+  timerfd_settime(timer_fd_, 0, &period, nullptr);
+
+  epoll_event event{};
+  event.events = EPOLLIN;
+  for (int fd : {listen_fd_, wake_fd_, timer_fd_})
+  {
+    event.data.fd = fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+  }
+  running_ = true;
+  thread_ = std::thread(&Aggregator::Run, this);
+  Logger::GetInstance().Log(LogLevel::INFO,
+                            "Aggregating agents on " + address_);
+}
+
+void Aggregator::Stop()
+{
+  if (!running_.exchange(false))
+  {
+    return;
+  }
+  std::uint64_t one = 1;
+  ssize_t ignored = write(wake_fd_, &one, sizeof(one));
+  (void)ignored;
+  if (thread_.joinable())
+  {
+    thread_.join();
+  }
+  for (auto &connection : connections_)
+  {
+    close(connection.first);
+  }
+  connections_.clear();
+  close(listen_fd_);
+  close(epoll_fd_);
+  close(wake_fd_);
+  close(timer_fd_);
+  std::string const path = UnixPath(address_);
+  if (!path.empty())
+  {
+    unlink(path.c_str());
+  }
+}
+
+void Aggregator::Run()
+{
+  BlockStopSignals();
+  epoll_event events[kMaxEvents];
+  while (running_)
+  {
+    int ready = epoll_wait(epoll_fd_, events, kMaxEvents, -1);
+    if (ready < 0 && errno != EINTR)
+    {
+      Logger::GetInstance().Log(LogLevel::ERROR,
+                                "Aggregator epoll_wait failed.");
+      return;
+    }
+    for (int i = 0; i < ready && running_; ++i)
+    {
+      int fd = events[i].data.fd;
+      if (fd == wake_fd_)
+      {
+        continue; // Stop()
+      }
+      if (fd == timer_fd_)
+      {
+        std::uint64_t expirations;
+        ssize_t ignored = read(timer_fd_, &expirations, sizeof(expirations));
+        (void)ignored;
+        if (changed_)
+        {
+          Publish();
+        }
+      }
+      else if (fd == listen_fd_)
+      {
+        Accept();
+      }
+      else
+      {
+        auto connection = connections_.find(fd);
+        if (connection == connections_.end())
+        {
+          continue;
+        }
+        if (events[i].events & EPOLLIN)
+        {
+          OnReadable(fd, connection->second);
+        }
+        else if (events[i].events & (EPOLLERR | EPOLLHUP))
+        {
+          Close(fd);
+        }
+      }
+    }
+  }
+}
+
+void Aggregator::Accept()
+{
+  while (true)
+  {
+    int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0)
+    {
+      return; // EAGAIN once the backlog is drained
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+    connections_.emplace(fd, connection_t{});
+  }
+}
+
+void Aggregator::OnReadable(int fd, Connection &connection)
+{
+  char buffer[64 * 1024];
+  bool closed = false;
+  while (true)
+  {
+    ssize_t length = read(fd, buffer, sizeof(buffer));
+    if (length == 0 || (length < 0 && errno != EAGAIN && errno != EINTR))
+    {
+      closed = true;
+      break;
+    }
+    if (length < 0)
+    {
+      break;
+    }
+    connection.buffer.append(buffer, length);
+  }
+
+  // Decodes every complete frame, a partial one waits for more bytes
+  std::size_t offset = 0;
+  while (connection.buffer.size() - offset >= sizeof(std::uint32_t))
+  {
+    std::uint32_t const length =
+        FrameLength(connection.buffer.data() + offset);
+    if (length > kMaxFrameSize)
+    {
+      Logger::GetInstance().Log(LogLevel::ERROR,
+                                "Dropping an agent that sent an oversized "
+                                "frame.");
+      Close(fd);
+      return;
+    }
+    if (connection.buffer.size() - offset < sizeof(length) + length)
+    {
+      break;
+    }
+    std::string_view const payload(
+        connection.buffer.data() + offset + sizeof(length), length);
+    if (!OnFrame(fd, connection, payload))
+    {
+      Logger::GetInstance().Log(LogLevel::ERROR,
+                                "Dropping an agent that sent a malformed "
+                                "frame.");
+      Close(fd);
+      return;
+    }
+    offset += sizeof(length) + length;
+  }
+  connection.buffer.erase(0, offset);
+  if (closed)
+  {
+    Close(fd);
+  }
+}
+
+bool Aggregator::OnFrame(int fd, Connection &connection,
+                         std::string_view payload)
+{
+  if (!connection.decoder.Decode(payload))
+  {
+    return false;
+  }
+  const snapshot::SystemSnapshot &decoded = connection.decoder.Snapshot();
+  const std::string &name = connection.decoder.Name();
+  if (connection.source < 0 || sources_[connection.source].row.name != name)
+  {
+    if (connection.source >= 0)
+    {
+      sources_[connection.source].fd = -1;
+      sources_[connection.source].row.connected = false;
+      sources_[connection.source].processes.clear();
+    }
+    // The slot an agent of this name had before, unless it is taken
+    auto slot = std::find_if(sources_.begin(), sources_.end(),
+                             [&name](const source_t &source)
+                             { return source.fd < 0 && source.row.name == name; });
+    if (slot == sources_.end())
+    {
+      slot = sources_.emplace(sources_.end());
+      slot->row.name = name;
+    }
+    slot->fd = fd;
+    slot->row.connected = true;
+    connection.source = static_cast<int>(slot - sources_.begin());
+    Logger::GetInstance().Log(LogLevel::INFO, "Agent " + name + " connected");
+  }
+
+  source_t &source = sources_[connection.source];
+  source.row.frames += 1;
+  source.row.bytes += sizeof(std::uint32_t) + payload.size();
+  source.row.last_seen = std::chrono::system_clock::now();
+  source.row.cpu_utilization = decoded.cpu_utilization;
+  source.row.memory_utilization = decoded.memory_utilization;
+  source.row.total_processes = decoded.total_processes;
+  source.row.cpu_history.push_back(decoded.cpu_utilization);
+  if (source.row.cpu_history.size() > history_)
+  {
+    source.row.cpu_history.erase(source.row.cpu_history.begin());
+  }
+  source.uptime = decoded.uptime;
+  source.running_processes = decoded.running_processes;
+  source.operating_system = decoded.operating_system;
+  source.kernel = decoded.kernel;
+  source.processes = decoded.processes;
+  int const index = connection.source + 1;
+  for (snapshot::ProcessRow &row : source.processes)
+  {
+    row.source = index;
+  }
+  source.tree.Update(source.processes);
+  changed_ = true;
+  return true;
+}
+
+void Aggregator::Close(int fd)
+{
+  auto connection = connections_.find(fd);
+  if (connection != connections_.end() && connection->second.source >= 0)
+  {
+    source_t &source = sources_[connection->second.source];
+    source.fd = -1;
+    source.row.connected = false;
+    source.processes.clear();
+    source.tree = snapshot::ProcessTree();
+    changed_ = true;
+    Logger::GetInstance().Log(LogLevel::INFO,
+                              "Agent " + source.row.name + " disconnected");
+  }
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+  close(fd);
+  connections_.erase(fd);
+}
+
+void Aggregator::Publish()
+{
+  auto merged = std::make_unique<snapshot::SystemSnapshot>();
+  merged->timestamp = std::chrono::system_clock::now();
+  int connected = 0;
+  std::size_t rows = 0;
+  for (const source_t &source : sources_)
+  {
+    rows += source.processes.size();
+  }
+  merged->processes.reserve(rows);
+  for (const source_t &source : sources_)
+  {
+    merged->sources.push_back(source.row);
+    if (source.fd < 0)
+    {
+      continue;
+    }
+    if (connected++ == 0)
+    {
+      merged->operating_system = source.operating_system;
+      merged->kernel = source.kernel;
+    }
+    merged->cpu_utilization += source.row.cpu_utilization;
+    merged->memory_utilization += source.row.memory_utilization;
+    merged->uptime = std::max(merged->uptime, source.uptime);
+    merged->total_processes += source.row.total_processes;
+    merged->running_processes += source.running_processes;
+    // Sources are in index order and each one by pid, so the merged
+    // table is ordered by (source, pid)
+    merged->processes.insert(merged->processes.end(),
+                             source.processes.begin(), source.processes.end());
+  }
+  if (connected > 0)
+  {
+    merged->cpu_utilization /= connected;
+    merged->memory_utilization /= connected;
+  }
+  publisher_.Publish(std::move(merged));
+  changed_ = false;
+}
@@ -0,0 +1,87 @@
+#include "exporter/batch_writer.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "exporter/record_serializer.h"
+#include "logger/logger_singletone.h"
+#include "stop_signal.h"
+
+bool exporter::WriteAll(int fd, std::string_view data)
+{
+  while (!data.empty())
+  {
+    ssize_t written = write(fd, data.data(), data.size());
+    if (written < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return false;
+    }
+    data.remove_prefix(static_cast<std::size_t>(written));
+  }
+  return true;
+}
+
+int exporter::RunBatch(snapshot::SnapshotPublisher &publisher,
+                       const Options &options)
+{
+  Logger &logger = Logger::GetInstance();
+  int fd = STDOUT_FILENO;
+  if (!options.output.empty())
+  {
+    fd = open(options.output.c_str(),
+              O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+      logger.Log(LogLevel::ERROR, "Failed to open batch output " +
+                                      options.output + ": " +
+                                      std::strerror(errno));
+      return EXIT_FAILURE;
+    }
+  }
+
+  RecordSerializer serializer(options.format);
+  snapshot::SnapshotPublisher::Reader reader(publisher);
+
+  int status = EXIT_SUCCESS;
+  if (!WriteAll(fd, serializer.Preamble()))
+  {
+    status = EXIT_FAILURE;
+  }
+  std::uint64_t written_sequence = 0;
+  long records = 0;
+  while (status == EXIT_SUCCESS && !StopRequested() &&
+         (options.count == 0 || records < options.count))
+  {
+    // Wake up regularly to notice signals even if collection stalls
+    if (publisher.WaitForNewer(written_sequence,
+                               std::chrono::milliseconds(200)) <=
+        written_sequence)
+    {
+      continue;
+    }
+    auto snapshot = reader.Acquire();
+    written_sequence = snapshot->sequence;
+    if (!WriteAll(fd, serializer.Serialize(*snapshot)))
+    {
+      logger.Log(LogLevel::ERROR, "Batch output failed: " +
+                                      std::string(std::strerror(errno)));
+      status = EXIT_FAILURE;
+    }
+    ++records;
+  }
+
+  if (fd != STDOUT_FILENO)
+  {
+    close(fd);
+  }
+  return status;
+}
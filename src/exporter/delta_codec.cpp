@@ -0,0 +1,696 @@
+#include "exporter/delta_codec.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <type_traits>
+
+using namespace exporter;
+
+namespace
+{
+constexpr std::uint8_t kKeyframe = 1;
+constexpr std::uint8_t kDelta = 2;
+
+// System fields
+constexpr std::uint32_t kSequence = 1u << 0;
+constexpr std::uint32_t kTimestamp = 1u << 1;
+constexpr std::uint32_t kCpu = 1u << 2;
+constexpr std::uint32_t kMemory = 1u << 3;
+constexpr std::uint32_t kUptime = 1u << 4;
+constexpr std::uint32_t kTotal = 1u << 5;
+constexpr std::uint32_t kRunning = 1u << 6;
+constexpr std::uint32_t kOperatingSystem = 1u << 7;
+constexpr std::uint32_t kKernel = 1u << 8;
+constexpr std::uint32_t kName = 1u << 9;
+
+// Unsigned integer as wide as T, to put T on the wire byte by byte
+template <typename T>
+using Bits = std::conditional_t<
+    sizeof(T) == 1, std::uint8_t,
+    std::conditional_t<sizeof(T) == 2, std::uint16_t,
+                       std::conditional_t<sizeof(T) == 4, std::uint32_t,
+                                          std::uint64_t>>>;
+
+// Process row fields
+constexpr std::uint32_t kPpid = 1u << 0;
+constexpr std::uint32_t kState = 1u << 1;
+constexpr std::uint32_t kComm = 1u << 2;
+constexpr std::uint32_t kStarttime = 1u << 3;
+constexpr std::uint32_t kRowCpu = 1u << 4;
+constexpr std::uint32_t kThreads = 1u << 5;
+constexpr std::uint32_t kRss = 1u << 6;
+constexpr std::uint32_t kPss = 1u << 7;
+constexpr std::uint32_t kUss = 1u << 8;
+constexpr std::uint32_t kSwap = 1u << 9;
+constexpr std::uint32_t kIoRate = 1u << 10;
+constexpr std::uint32_t kReadRate = 1u << 11;
+constexpr std::uint32_t kWriteRate = 1u << 12;
+constexpr std::uint32_t kSyscr = 1u << 13;
+constexpr std::uint32_t kSyscw = 1u << 14;
+constexpr std::uint32_t kEnergy = 1u << 15;
+constexpr std::uint32_t kRunWait = 1u << 16;
+constexpr std::uint32_t kFds = 1u << 17; // count, kinds and limit together
+constexpr std::uint32_t kAllRowFields = (1u << 18) - 1;
+
+std::int64_t TimestampNs(const snapshot::SystemSnapshot &snapshot)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             snapshot.timestamp.time_since_epoch())
+      .count();
+}
+
+std::string_view CommOf(const snapshot::ProcessRow &row)
+{
+  return std::string_view(row.comm, strnlen(row.comm, sizeof(row.comm)));
+}
+
+// -----------------------------
+// Encoding
+
+void PutVarint(std::string &out, std::uint64_t value)
+{
+  while (value >= 0x80)
+  {
+    out.push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+void PutSigned(std::string &out, std::int64_t value)
+{
+  PutVarint(out, (static_cast<std::uint64_t>(value) << 1) ^
+                     static_cast<std::uint64_t>(value >> 63));
+}
+
+// Least significant byte first, whatever the byte order of the host
+template <typename T>
+void PutRaw(std::string &out, T value)
+{
+  static_assert(sizeof(T) == sizeof(Bits<T>), "no integer of this width");
+  Bits<T> bits;
+  std::memcpy(&bits, &value, sizeof(T));
+  for (std::size_t i = 0; i < sizeof(T); ++i)
+  {
+    out.push_back(static_cast<char>(bits >> (8 * i)));
+  }
+}
+
+void PutString(std::string &out, std::string_view text)
+{
+  PutVarint(out, text.size());
+  out.append(text.data(), text.size());
+}
+
+std::uint32_t RowChanges(const snapshot::ProcessRow &a,
+                         const snapshot::ProcessRow &b)
+{
+  std::uint32_t mask = 0;
+  mask |= a.ppid != b.ppid ? kPpid : 0;
+  mask |= a.state != b.state ? kState : 0;
+  mask |= CommOf(a) != CommOf(b) ? kComm : 0;
+  mask |= a.cpu_utilization != b.cpu_utilization ? kRowCpu : 0;
+  mask |= a.num_threads != b.num_threads ? kThreads : 0;
+  mask |= a.rss_kb != b.rss_kb ? kRss : 0;
+  mask |= a.pss_kb != b.pss_kb ? kPss : 0;
+  mask |= a.uss_kb != b.uss_kb ? kUss : 0;
+  mask |= a.swap_kb != b.swap_kb ? kSwap : 0;
+  mask |= a.io_rate != b.io_rate ? kIoRate : 0;
+  mask |= a.read_rate != b.read_rate ? kReadRate : 0;
+  mask |= a.write_rate != b.write_rate ? kWriteRate : 0;
+  mask |= a.syscr_rate != b.syscr_rate ? kSyscr : 0;
+  mask |= a.syscw_rate != b.syscw_rate ? kSyscw : 0;
+  mask |= a.energy_joules != b.energy_joules ? kEnergy : 0;
+  mask |= a.run_wait != b.run_wait ? kRunWait : 0;
+  mask |= a.fds != b.fds || a.fd_sockets != b.fd_sockets ||
+                  a.fd_pipes != b.fd_pipes || a.fd_files != b.fd_files ||
+                  a.fd_limit != b.fd_limit
+              ? kFds
+              : 0;
+  return mask;
+}
+
+// Memory sizes go out as differences to base, the row last sent for the
+// pid or an empty one for a new process
+void PutRow(std::string &out, const snapshot::ProcessRow &row,
+            const snapshot::ProcessRow &base, std::uint32_t mask)
+{
+  PutVarint(out, mask);
+  if (mask & kPpid)
+  {
+    PutSigned(out, row.ppid);
+  }
+  if (mask & kState)
+  {
+    out.push_back(row.state);
+  }
+  if (mask & kComm)
+  {
+    PutString(out, CommOf(row));
+  }
+  if (mask & kStarttime)
+  {
+    PutVarint(out, row.starttime);
+  }
+  if (mask & kRowCpu)
+  {
+    PutRaw(out, row.cpu_utilization);
+  }
+  if (mask & kThreads)
+  {
+    PutSigned(out, row.num_threads);
+  }
+  if (mask & kRss)
+  {
+    PutSigned(out, row.rss_kb - base.rss_kb);
+  }
+  if (mask & kPss)
+  {
+    PutSigned(out, row.pss_kb - base.pss_kb);
+  }
+  if (mask & kUss)
+  {
+    PutSigned(out, row.uss_kb - base.uss_kb);
+  }
+  if (mask & kSwap)
+  {
+    PutSigned(out, row.swap_kb - base.swap_kb);
+  }
+  if (mask & kIoRate)
+  {
+    PutRaw(out, row.io_rate);
+  }
+  if (mask & kReadRate)
+  {
+    PutRaw(out, row.read_rate);
+  }
+  if (mask & kWriteRate)
+  {
+    PutRaw(out, row.write_rate);
+  }
+  if (mask & kSyscr)
+  {
+    PutRaw(out, row.syscr_rate);
+  }
+  if (mask & kSyscw)
+  {
+    PutRaw(out, row.syscw_rate);
+  }
+  if (mask & kEnergy)
+  {
+    PutRaw(out, row.energy_joules);
+  }
+  if (mask & kRunWait)
+  {
+    PutRaw(out, row.run_wait);
+  }
+  if (mask & kFds)
+  {
+    PutSigned(out, row.fds);
+    PutSigned(out, row.fd_sockets);
+    PutSigned(out, row.fd_pipes);
+    PutSigned(out, row.fd_files);
+    PutSigned(out, row.fd_limit);
+  }
+}
+
+// -----------------------------
+// Decoding
+
+// Reads a payload front to back, every read fails once one did
+class Cursor
+{
+public:
+  explicit Cursor(std::string_view data) : data_(data) {}
+
+  bool Ok() const { return ok_; }
+  bool AtEnd() const { return position_ == data_.size(); }
+  std::size_t Left() const { return data_.size() - position_; }
+
+  std::uint64_t Varint()
+  {
+    std::uint64_t value = 0;
+    for (int shift = 0; shift < 64 && ok_; shift += 7)
+    {
+      if (position_ >= data_.size())
+      {
+        ok_ = false;
+        break;
+      }
+      std::uint8_t const byte = static_cast<std::uint8_t>(data_[position_++]);
+      value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0)
+      {
+        return value;
+      }
+    }
+    ok_ = false;
+    return 0;
+  }
+
+  std::int64_t Signed()
+  {
+    std::uint64_t const value = Varint();
+    return static_cast<std::int64_t>(value >> 1) ^
+           -static_cast<std::int64_t>(value & 1);
+  }
+
+  template <typename T>
+  T Raw()
+  {
+    T value{};
+    if (ok_ && Left() >= sizeof(T))
+    {
+      Bits<T> bits = 0;
+      for (std::size_t i = 0; i < sizeof(T); ++i)
+      {
+        bits |= static_cast<Bits<T>>(
+            static_cast<Bits<T>>(
+                static_cast<unsigned char>(data_[position_ + i]))
+            << (8 * i));
+      }
+      std::memcpy(&value, &bits, sizeof(T));
+      position_ += sizeof(T);
+    }
+    else
+    {
+      ok_ = false;
+    }
+    return value;
+  }
+
+  std::string_view String()
+  {
+    std::uint64_t const length = Varint();
+    if (!ok_ || length > Left())
+    {
+      ok_ = false;
+      return std::string_view();
+    }
+    std::string_view const text = data_.substr(position_, length);
+    position_ += length;
+    return text;
+  }
+
+private:
+  std::string_view data_;
+  std::size_t position_{0};
+  bool ok_{true};
+};
+
+void GetRow(Cursor &cursor, snapshot::ProcessRow &row)
+{
+  std::uint32_t const mask = static_cast<std::uint32_t>(cursor.Varint());
+  if (mask & kStarttime)
+  {
+    // A new process behind the pid, nothing is relative to the old one
+    int const pid = row.pid;
+    row = snapshot::ProcessRow{};
+    row.pid = pid;
+  }
+  if (mask & kPpid)
+  {
+    row.ppid = static_cast<int>(cursor.Signed());
+  }
+  if (mask & kState)
+  {
+    row.state = cursor.Raw<char>();
+  }
+  if (mask & kComm)
+  {
+    std::string_view const comm = cursor.String();
+    std::size_t const length = std::min(comm.size(), sizeof(row.comm) - 1);
+    std::memcpy(row.comm, comm.data(), length);
+    std::memset(row.comm + length, 0, sizeof(row.comm) - length);
+  }
+  if (mask & kStarttime)
+  {
+    row.starttime = cursor.Varint();
+  }
+  if (mask & kRowCpu)
+  {
+    row.cpu_utilization = cursor.Raw<float>();
+  }
+  if (mask & kThreads)
+  {
+    row.num_threads = static_cast<long>(cursor.Signed());
+  }
+  if (mask & kRss)
+  {
+    row.rss_kb += static_cast<long>(cursor.Signed());
+  }
+  if (mask & kPss)
+  {
+    row.pss_kb += static_cast<long>(cursor.Signed());
+  }
+  if (mask & kUss)
+  {
+    row.uss_kb += static_cast<long>(cursor.Signed());
+  }
+  if (mask & kSwap)
+  {
+    row.swap_kb += static_cast<long>(cursor.Signed());
+  }
+  if (mask & kIoRate)
+  {
+    row.io_rate = cursor.Raw<double>();
+  }
+  if (mask & kReadRate)
+  {
+    row.read_rate = cursor.Raw<double>();
+  }
+  if (mask & kWriteRate)
+  {
+    row.write_rate = cursor.Raw<double>();
+  }
+  if (mask & kSyscr)
+  {
+    row.syscr_rate = cursor.Raw<float>();
+  }
+  if (mask & kSyscw)
+  {
+    row.syscw_rate = cursor.Raw<float>();
+  }
+  if (mask & kEnergy)
+  {
+    row.energy_joules = cursor.Raw<double>();
+  }
+  if (mask & kRunWait)
+  {
+    row.run_wait = cursor.Raw<float>();
+  }
+  if (mask & kFds)
+  {
+    row.fds = static_cast<int>(cursor.Signed());
+    row.fd_sockets = static_cast<int>(cursor.Signed());
+    row.fd_pipes = static_cast<int>(cursor.Signed());
+    row.fd_files = static_cast<int>(cursor.Signed());
+    row.fd_limit = static_cast<long>(cursor.Signed());
+  }
+}
+
+bool ByPid(const snapshot::ProcessRow &a, const snapshot::ProcessRow &b)
+{
+  return a.pid < b.pid;
+}
+} // namespace
+
+// -----------------------------
+// DeltaEncoder Implementation
+
+void DeltaEncoder::Reset() { keyframe_ = true; }
+
+std::string_view DeltaEncoder::Encode(const snapshot::SystemSnapshot &snapshot,
+                                      const std::string &name)
+{
+  if (keyframe_)
+  {
+    last_ = snapshot::SystemSnapshot();
+    name_.clear();
+    rows_.clear();
+  }
+  buffer_.assign(sizeof(std::uint32_t), '\0');
+  buffer_.push_back(static_cast<char>(keyframe_ ? kKeyframe : kDelta));
+
+  std::uint32_t mask = 0;
+  mask |= snapshot.sequence != last_.sequence ? kSequence : 0;
+  mask |= snapshot.timestamp != last_.timestamp ? kTimestamp : 0;
+  mask |= snapshot.cpu_utilization != last_.cpu_utilization ? kCpu : 0;
+  mask |= snapshot.memory_utilization != last_.memory_utilization ? kMemory
+                                                                   : 0;
+  mask |= snapshot.uptime != last_.uptime ? kUptime : 0;
+  mask |= snapshot.total_processes != last_.total_processes ? kTotal : 0;
+  mask |= snapshot.running_processes != last_.running_processes ? kRunning
+                                                                 : 0;
+  mask |= snapshot.operating_system != last_.operating_system
+              ? kOperatingSystem
+              : 0;
+  mask |= snapshot.kernel != last_.kernel ? kKernel : 0;
+  mask |= name != name_ ? kName : 0;
+  PutVarint(buffer_, mask);
+  if (mask & kSequence)
+  {
+    PutVarint(buffer_, snapshot.sequence - last_.sequence);
+  }
+  if (mask & kTimestamp)
+  {
+    PutSigned(buffer_, TimestampNs(snapshot) - TimestampNs(last_));
+  }
+  if (mask & kCpu)
+  {
+    PutRaw(buffer_, snapshot.cpu_utilization);
+  }
+  if (mask & kMemory)
+  {
+    PutRaw(buffer_, snapshot.memory_utilization);
+  }
+  if (mask & kUptime)
+  {
+    PutSigned(buffer_, snapshot.uptime);
+  }
+  if (mask & kTotal)
+  {
+    PutSigned(buffer_, snapshot.total_processes);
+  }
+  if (mask & kRunning)
+  {
+    PutSigned(buffer_, snapshot.running_processes);
+  }
+  if (mask & kOperatingSystem)
+  {
+    PutString(buffer_, snapshot.operating_system);
+  }
+  if (mask & kKernel)
+  {
+    PutString(buffer_, snapshot.kernel);
+  }
+  if (mask & kName)
+  {
+    PutString(buffer_, name);
+  }
+
+  scratch_.assign(snapshot.processes.begin(), snapshot.processes.end());
+  std::sort(scratch_.begin(), scratch_.end(), ByPid);
+  // Exited pids, both tables are ordered by pid
+  std::size_t exited = 0;
+  std::string pids;
+  int previous = 0;
+  auto next = scratch_.begin();
+  for (const snapshot::ProcessRow &row : rows_)
+  {
+    next = std::lower_bound(next, scratch_.end(), row, ByPid);
+    if (next == scratch_.end() || next->pid != row.pid)
+    {
+      PutVarint(pids, static_cast<std::uint32_t>(row.pid - previous));
+      previous = row.pid;
+      ++exited;
+    }
+  }
+  PutVarint(buffer_, exited);
+  buffer_.append(pids);
+
+  // New and changed rows, written behind a count patched in afterwards
+  static const snapshot::ProcessRow kEmpty{};
+  std::size_t changed = 0;
+  std::string rows;
+  previous = 0;
+  auto old = rows_.begin();
+  for (const snapshot::ProcessRow &row : scratch_)
+  {
+    old = std::lower_bound(old, rows_.end(), row, ByPid);
+    bool const known = old != rows_.end() && old->pid == row.pid &&
+                       old->starttime == row.starttime;
+    std::uint32_t const mask =
+        known ? RowChanges(row, *old) : kAllRowFields;
+    if (mask == 0 || row.pid <= previous)
+    {
+      continue; // unchanged, or a duplicate pid
+    }
+    PutVarint(rows, static_cast<std::uint32_t>(row.pid - previous));
+    PutRow(rows, row, known ? *old : kEmpty, mask);
+    previous = row.pid;
+    ++changed;
+  }
+  PutVarint(buffer_, changed);
+  buffer_.append(rows);
+
+  std::uint32_t const length =
+      static_cast<std::uint32_t>(buffer_.size() - sizeof(std::uint32_t));
+  for (std::size_t i = 0; i < sizeof(length); ++i)
+  {
+    buffer_[i] = static_cast<char>(length >> (8 * i));
+  }
+
+  last_.sequence = snapshot.sequence;
+  last_.timestamp = snapshot.timestamp;
+  last_.cpu_utilization = snapshot.cpu_utilization;
+  last_.memory_utilization = snapshot.memory_utilization;
+  last_.uptime = snapshot.uptime;
+  last_.total_processes = snapshot.total_processes;
+  last_.running_processes = snapshot.running_processes;
+  last_.operating_system = snapshot.operating_system;
+  last_.kernel = snapshot.kernel;
+  name_ = name;
+  rows_.swap(scratch_);
+  keyframe_ = false;
+  return buffer_;
+}
+
+std::uint32_t exporter::FrameLength(const char *data)
+{
+  std::uint32_t length = 0;
+  for (std::size_t i = 0; i < sizeof(length); ++i)
+  {
+    length |= static_cast<std::uint32_t>(static_cast<unsigned char>(data[i]))
+              << (8 * i);
+  }
+  return length;
+}
+
+// -----------------------------
+// DeltaDecoder Implementation
+
+bool DeltaDecoder::Decode(std::string_view payload)
+{
+  Cursor cursor(payload);
+  std::uint8_t const kind = cursor.Raw<std::uint8_t>();
+  if (kind == kKeyframe)
+  {
+    snapshot_ = snapshot::SystemSnapshot();
+    name_.clear();
+    synced_ = true;
+  }
+  else if (kind != kDelta || !synced_)
+  {
+    synced_ = false;
+    return false;
+  }
+
+  std::uint32_t const mask = static_cast<std::uint32_t>(cursor.Varint());
+  if (mask & kSequence)
+  {
+    snapshot_.sequence += cursor.Varint();
+  }
+  if (mask & kTimestamp)
+  {
+    snapshot_.timestamp += std::chrono::duration_cast<
+        std::chrono::system_clock::duration>(
+        std::chrono::nanoseconds(cursor.Signed()));
+  }
+  if (mask & kCpu)
+  {
+    snapshot_.cpu_utilization = cursor.Raw<float>();
+  }
+  if (mask & kMemory)
+  {
+    snapshot_.memory_utilization = cursor.Raw<float>();
+  }
+  if (mask & kUptime)
+  {
+    snapshot_.uptime = static_cast<long>(cursor.Signed());
+  }
+  if (mask & kTotal)
+  {
+    snapshot_.total_processes = static_cast<int>(cursor.Signed());
+  }
+  if (mask & kRunning)
+  {
+    snapshot_.running_processes = static_cast<int>(cursor.Signed());
+  }
+  if (mask & kOperatingSystem)
+  {
+    snapshot_.operating_system = cursor.String();
+  }
+  if (mask & kKernel)
+  {
+    snapshot_.kernel = cursor.String();
+  }
+  if (mask & kName)
+  {
+    name_ = cursor.String();
+  }
+
+  // Every entry takes at least a byte, larger counts cannot be real
+  std::uint64_t const exited = cursor.Varint();
+  if (exited > cursor.Left())
+  {
+    synced_ = false;
+    return false;
+  }
+  exited_.clear();
+  long pid = 0;
+  for (std::uint64_t i = 0; i < exited && cursor.Ok(); ++i)
+  {
+    pid = std::min<long>(
+        pid + static_cast<long>(std::min<std::uint64_t>(cursor.Varint(), INT_MAX)),
+        INT_MAX);
+    exited_.push_back(static_cast<int>(pid));
+  }
+
+  std::uint64_t const changed = cursor.Varint();
+  if (changed > cursor.Left())
+  {
+    synced_ = false;
+    return false;
+  }
+  // Merges the changes into the rows of the previous frame, all three
+  // lists are ordered by pid
+  std::vector<snapshot::ProcessRow> &rows = snapshot_.processes;
+  scratch_.clear();
+  scratch_.reserve(rows.size() + changed);
+  auto old = rows.begin();
+  auto gone = exited_.begin();
+  auto carry = [&](long below)
+  {
+    for (; old != rows.end() && old->pid < below; ++old)
+    {
+      gone = std::lower_bound(gone, exited_.end(), old->pid);
+      if (gone == exited_.end() || *gone != old->pid)
+      {
+        scratch_.push_back(*old);
+      }
+    }
+  };
+  pid = 0;
+  for (std::uint64_t i = 0; i < changed && cursor.Ok(); ++i)
+  {
+    std::uint64_t const step = cursor.Varint();
+    pid += static_cast<long>(std::min<std::uint64_t>(step, INT_MAX));
+    if (step == 0 || pid > INT_MAX)
+    {
+      synced_ = false;
+      return false;
+    }
+    carry(pid);
+    snapshot::ProcessRow row{};
+    if (old != rows.end() && old->pid == pid)
+    {
+      row = *old++;
+    }
+    row.pid = static_cast<int>(pid);
+    GetRow(cursor, row);
+    scratch_.push_back(row);
+  }
+  carry(static_cast<long>(INT_MAX) + 1);
+  if (!cursor.Ok() || !cursor.AtEnd())
+  {
+    synced_ = false;
+    return false;
+  }
+  rows.swap(scratch_);
+
+  static const long ticks = sysconf(_SC_CLK_TCK);
+  for (snapshot::ProcessRow &row : rows)
+  {
+    row.uptime = snapshot_.uptime -
+                 static_cast<long>(row.starttime / static_cast<unsigned long long>(
+                                                       ticks > 0 ? ticks : 100));
+    row.cgroup = -1;
+    row.subtree = snapshot::subtree_t{};
+  }
+  return true;
+}
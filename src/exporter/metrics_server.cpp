@@ -0,0 +1,282 @@
+#include "exporter/metrics_server.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include "exporter/socket_address.h"
+#include "logger/logger_singletone.h"
+#include "stop_signal.h"
+
+using namespace exporter;
+
+namespace
+{
+constexpr std::size_t kMaxRequestSize = 8192;
+constexpr int kMaxEvents = 64;
+
+std::shared_ptr<const std::string> StaticResponse(const char *status,
+                                                  const char *body)
+{
+  std::string response = std::string("HTTP/1.1 ") + status +
+                         "\r\nContent-Type: text/plain\r\n"
+                         "Connection: close\r\nContent-Length: " +
+                         std::to_string(std::strlen(body)) + "\r\n\r\n" + body;
+  return std::make_shared<const std::string>(std::move(response));
+}
+
+const std::shared_ptr<const std::string> &NotFound()
+{
+  static const auto response = StaticResponse("404 Not Found", "not found\n");
+  return response;
+}
+
+const std::shared_ptr<const std::string> &NotReady()
+{
+  static const auto response =
+      StaticResponse("503 Service Unavailable", "no snapshot yet\n");
+  return response;
+}
+
+std::runtime_error SocketError(const std::string &what)
+{
+  return std::runtime_error(what + ": " + std::strerror(errno));
+}
+} // namespace
+
+MetricsServer::MetricsServer(snapshot::SnapshotPublisher &publisher,
+                             std::string address)
+    : publisher_(publisher), reader_(publisher), address_(std::move(address))
+{
+}
+
+MetricsServer::~MetricsServer() { Stop(); }
+
+void MetricsServer::Start()
+{
+  listen_fd_ = ListenOn(address_);
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epoll_fd_ < 0 || wake_fd_ < 0)
+  {
+    throw SocketError("Failed to set up metrics server");
+  }
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.fd = listen_fd_;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &event);
+  event.data.fd = wake_fd_;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event);
+
+  int wake_fd = wake_fd_;
+  listener_id_ = publisher_.AddListener([wake_fd](std::uint64_t)
+                                        {
+    std::uint64_t one = 1;
+    ssize_t ignored = write(wake_fd, &one, sizeof(one));
+    (void)ignored; });
+  running_ = true;
+  Render();
+  thread_ = std::thread(&MetricsServer::Run, this);
+  Logger::GetInstance().Log(LogLevel::INFO,
+                            "Serving metrics on " + address_);
+}
+
+void MetricsServer::Stop()
+{
+  if (!running_.exchange(false))
+  {
+    return;
+  }
+  publisher_.RemoveListener(listener_id_);
+  std::uint64_t one = 1;
+  ssize_t ignored = write(wake_fd_, &one, sizeof(one));
+  (void)ignored;
+  if (thread_.joinable())
+  {
+    thread_.join();
+  }
+  for (auto &connection : connections_)
+  {
+    close(connection.first);
+  }
+  connections_.clear();
+  close(listen_fd_);
+  close(epoll_fd_);
+  close(wake_fd_);
+  std::string const path = UnixPath(address_);
+  if (!path.empty())
+  {
+    unlink(path.c_str());
+  }
+}
+
+void MetricsServer::Run()
+{
+  BlockStopSignals();
+  epoll_event events[kMaxEvents];
+  while (running_)
+  {
+    int ready = epoll_wait(epoll_fd_, events, kMaxEvents, -1);
+    if (ready < 0 && errno != EINTR)
+    {
+      Logger::GetInstance().Log(LogLevel::ERROR,
+                                "Metrics server epoll_wait failed.");
+      return;
+    }
+    for (int i = 0; i < ready; ++i)
+    {
+      int fd = events[i].data.fd;
+      if (fd == wake_fd_)
+      {
+        std::uint64_t count;
+        ssize_t ignored = read(wake_fd_, &count, sizeof(count));
+        (void)ignored;
+        if (running_)
+        {
+          Render();
+        }
+      }
+      else if (fd == listen_fd_)
+      {
+        Accept();
+      }
+      else
+      {
+        auto connection = connections_.find(fd);
+        if (connection == connections_.end())
+        {
+          continue;
+        }
+        if (events[i].events & (EPOLLERR | EPOLLHUP))
+        {
+          Close(fd);
+        }
+        else if (events[i].events & EPOLLIN)
+        {
+          OnReadable(fd, connection->second);
+        }
+        else if (events[i].events & EPOLLOUT)
+        {
+          OnWritable(fd, connection->second);
+        }
+      }
+    }
+  }
+}
+
+// Renders once per published snapshot, scrapes share the result
+void MetricsServer::Render()
+{
+  auto snapshot = reader_.Acquire();
+  if (snapshot->sequence == 0 || snapshot->sequence == rendered_sequence_)
+  {
+    return;
+  }
+  rendered_sequence_ = snapshot->sequence;
+  response_ =
+      std::make_shared<const std::string>(renderer_.RenderResponse(*snapshot));
+}
+
+void MetricsServer::Accept()
+{
+  while (true)
+  {
+    int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0)
+    {
+      return; // EAGAIN once the backlog is drained
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+    connections_.emplace(fd, connection_t{});
+  }
+}
+
+void MetricsServer::OnReadable(int fd, Connection &connection)
+{
+  char buffer[2048];
+  while (true)
+  {
+    ssize_t length = read(fd, buffer, sizeof(buffer));
+    if (length == 0)
+    {
+      // A client may half-close right after sending its request; answer
+      // whatever complete request is buffered before giving up on it.
+      if (connection.request.find("\r\n\r\n") == std::string::npos)
+      {
+        Close(fd);
+        return;
+      }
+      break;
+    }
+    if (length < 0 && errno != EAGAIN && errno != EINTR)
+    {
+      Close(fd);
+      return;
+    }
+    if (length < 0)
+    {
+      break;
+    }
+    connection.request.append(buffer, length);
+    if (connection.request.size() > kMaxRequestSize)
+    {
+      Close(fd);
+      return;
+    }
+  }
+  if (connection.request.find("\r\n\r\n") == std::string::npos)
+  {
+    return; // headers not complete yet
+  }
+
+  const std::string &request = connection.request;
+  if (request.compare(0, 13, "GET /metrics ") == 0 ||
+      request.compare(0, 6, "GET / ") == 0)
+  {
+    connection.response = response_ ? response_ : NotReady();
+  }
+  else
+  {
+    connection.response = NotFound();
+  }
+  epoll_event event{};
+  event.events = EPOLLOUT;
+  event.data.fd = fd;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &event);
+  OnWritable(fd, connection);
+}
+
+void MetricsServer::OnWritable(int fd, Connection &connection)
+{
+  const std::string &response = *connection.response;
+  while (connection.sent < response.size())
+  {
+    ssize_t written = send(fd, response.data() + connection.sent,
+                           response.size() - connection.sent, MSG_NOSIGNAL);
+    if (written < 0)
+    {
+      if (errno == EAGAIN || errno == EINTR)
+      {
+        return; // wait for EPOLLOUT
+      }
+      break;
+    }
+    connection.sent += static_cast<std::size_t>(written);
+  }
+  Close(fd);
+}
+
+void MetricsServer::Close(int fd)
+{
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+  close(fd);
+  connections_.erase(fd);
+}
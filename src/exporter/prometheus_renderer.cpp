@@ -0,0 +1,584 @@
+#include "exporter/prometheus_renderer.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+using namespace exporter;
+
+PrometheusRenderer::PrometheusRenderer(std::size_t top_processes)
+    : top_processes_(top_processes) {}
+
+std::string
+PrometheusRenderer::RenderResponse(const snapshot::SystemSnapshot &snapshot)
+{
+  std::string_view body = RenderBody(snapshot);
+  char length[24];
+  auto end = std::to_chars(length, length + sizeof(length), body.size()).ptr;
+
+  std::string response;
+  response.reserve(body.size() + 160);
+  response += "HTTP/1.1 200 OK\r\n"
+              "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+              "Connection: close\r\n"
+              "Content-Length: ";
+  response.append(length, end - length);
+  response += "\r\n\r\n";
+  response.append(body.data(), body.size());
+  return response;
+}
+
+std::string_view
+PrometheusRenderer::RenderBody(const snapshot::SystemSnapshot &snapshot)
+{
+  body_.clear();
+  Family("monitor_cpu_utilization_ratio", "gauge",
+         "Share of CPU time spent busy across all CPUs.");
+  Sample("monitor_cpu_utilization_ratio", snapshot.cpu_utilization);
+  Family("monitor_memory_utilization_ratio", "gauge",
+         "Share of physical memory in use.");
+  Sample("monitor_memory_utilization_ratio", snapshot.memory_utilization);
+  Family("monitor_uptime_seconds", "gauge", "Seconds since boot.");
+  Sample("monitor_uptime_seconds", static_cast<double>(snapshot.uptime));
+  Family("monitor_processes", "gauge", "Processes seen by the last scan.");
+  Sample("monitor_processes", snapshot.total_processes);
+  Family("monitor_processes_running", "gauge", "Runnable processes.");
+  Sample("monitor_processes_running", snapshot.running_processes);
+  // Zero on an aggregator, whose agents do not stream these
+  const parser_factory::metric_snapshot_t &metrics = snapshot.metrics;
+  if (metrics.mem_total_kb != 0)
+  {
+    Family("monitor_processes_blocked", "gauge",
+           "Processes waiting for I/O to complete.");
+    Sample("monitor_processes_blocked", metrics.procs_blocked);
+    Family("monitor_context_switches_total", "counter",
+           "Context switches since boot.");
+    Sample("monitor_context_switches_total",
+           static_cast<double>(metrics.context_switches));
+    Family("monitor_forks_total", "counter", "Processes created since boot.");
+    Sample("monitor_forks_total", static_cast<double>(metrics.forks));
+    Family("monitor_load_average", "gauge",
+           "Mean number of runnable and uninterruptible tasks.");
+    LabeledSample("monitor_load_average", "window", "1m", metrics.load1);
+    LabeledSample("monitor_load_average", "window", "5m", metrics.load5);
+    LabeledSample("monitor_load_average", "window", "15m", metrics.load15);
+    Family("monitor_memory_bytes", "gauge", "Physical memory by kind.");
+    LabeledSample("monitor_memory_bytes", "kind", "total",
+                  metrics.mem_total_kb * 1024.0);
+    LabeledSample("monitor_memory_bytes", "kind", "free",
+                  metrics.mem_free_kb * 1024.0);
+    LabeledSample("monitor_memory_bytes", "kind", "available",
+                  metrics.mem_available_kb * 1024.0);
+    LabeledSample("monitor_memory_bytes", "kind", "buffers",
+                  metrics.buffers_kb * 1024.0);
+    LabeledSample("monitor_memory_bytes", "kind", "cached",
+                  metrics.cached_kb * 1024.0);
+    Family("monitor_swap_bytes", "gauge", "Swap space by kind.");
+    LabeledSample("monitor_swap_bytes", "kind", "total",
+                  metrics.swap_total_kb * 1024.0);
+    LabeledSample("monitor_swap_bytes", "kind", "free",
+                  metrics.swap_free_kb * 1024.0);
+    Family("monitor_network_receive_bytes_total", "counter",
+           "Bytes received by every interface but loopback.");
+    Sample("monitor_network_receive_bytes_total",
+           static_cast<double>(metrics.rx_bytes));
+    Family("monitor_network_transmit_bytes_total", "counter",
+           "Bytes sent by every interface but loopback.");
+    Sample("monitor_network_transmit_bytes_total",
+           static_cast<double>(metrics.tx_bytes));
+  }
+  Family("monitor_snapshot_sequence", "counter",
+         "Snapshots collected since the monitor started.");
+  Sample("monitor_snapshot_sequence", static_cast<double>(snapshot.sequence));
+  Family("monitor_snapshot_timestamp_seconds", "gauge",
+         "Wall clock time the snapshot was taken.");
+  Sample("monitor_snapshot_timestamp_seconds",
+         std::chrono::duration<double>(snapshot.timestamp.time_since_epoch())
+             .count());
+
+  Family("monitor_cpu_runqueue_waiting", "gauge",
+         "Mean number of runnable tasks waiting for each CPU.");
+  for (const snapshot::RunQueue &queue : snapshot.run_queues)
+  {
+    CpuSample("monitor_cpu_runqueue_waiting", queue.cpu, queue.waiting);
+  }
+  Family("monitor_cpu_runqueue_wait_seconds", "gauge",
+         "Mean run-queue wait per timeslice on each CPU.");
+  for (const snapshot::RunQueue &queue : snapshot.run_queues)
+  {
+    CpuSample("monitor_cpu_runqueue_wait_seconds", queue.cpu,
+              queue.avg_wait_ns / 1e9);
+  }
+  Family("monitor_cpu_hardirqs_per_second", "gauge",
+         "Hardware interrupts each CPU handled, /proc/interrupts.");
+  for (const snapshot::CpuInterrupts &cpu : snapshot.interrupts)
+  {
+    CpuSample("monitor_cpu_hardirqs_per_second", cpu.cpu, cpu.hard_rate);
+  }
+  Family("monitor_cpu_softirqs_per_second", "gauge",
+         "Softirqs each CPU ran, /proc/softirqs.");
+  for (const snapshot::CpuInterrupts &cpu : snapshot.interrupts)
+  {
+    CpuSample("monitor_cpu_softirqs_per_second", cpu.cpu, cpu.soft_rate);
+  }
+  Family("monitor_interrupt_source_per_second", "gauge",
+         "Rate of the busiest interrupt lines and softirq kinds, all CPUs.");
+  std::size_t const interrupt_sources =
+      std::min(snapshot.interrupt_sources.size(), top_processes_);
+  for (std::size_t i = 0; i < interrupt_sources; ++i)
+  {
+    InterruptSample(snapshot.interrupt_sources[i]);
+  }
+  Family("monitor_numa_node_cpu_utilization_ratio", "gauge",
+         "Share of CPU time the CPUs of each NUMA node spent busy.");
+  for (const snapshot::NumaNodeRow &node : snapshot.numa_nodes)
+  {
+    NodeSample("monitor_numa_node_cpu_utilization_ratio", node.node, {},
+               node.cpu_utilization);
+  }
+  Family("monitor_numa_node_memory_bytes", "gauge",
+         "Memory of each NUMA node.");
+  for (const snapshot::NumaNodeRow &node : snapshot.numa_nodes)
+  {
+    NodeSample("monitor_numa_node_memory_bytes", node.node, {},
+               node.total_kb * 1024.0);
+  }
+  Family("monitor_numa_node_memory_free_bytes", "gauge",
+         "Free memory of each NUMA node.");
+  for (const snapshot::NumaNodeRow &node : snapshot.numa_nodes)
+  {
+    NodeSample("monitor_numa_node_memory_free_bytes", node.node, {},
+               node.free_kb * 1024.0);
+  }
+  Family("monitor_numa_node_allocations_per_second", "gauge",
+         "Page allocations served by each NUMA node, numastat hit, miss, "
+         "foreign and other_node.");
+  for (const snapshot::NumaNodeRow &node : snapshot.numa_nodes)
+  {
+    NodeSample("monitor_numa_node_allocations_per_second", node.node, "hit",
+               node.hit_rate);
+    NodeSample("monitor_numa_node_allocations_per_second", node.node, "miss",
+               node.miss_rate);
+    NodeSample("monitor_numa_node_allocations_per_second", node.node,
+               "foreign", node.foreign_rate);
+    NodeSample("monitor_numa_node_allocations_per_second", node.node, "other",
+               node.other_rate);
+  }
+  Family("monitor_pressure_stall_ratio", "gauge",
+         "Share of time some or all tasks stalled on a resource, PSI "
+         "averages.");
+  for (const snapshot::PressureRow &pressure : snapshot.pressure)
+  {
+    PressureSample(pressure, "some", "10", pressure.some_avg10);
+    PressureSample(pressure, "some", "60", pressure.some_avg60);
+    PressureSample(pressure, "some", "300", pressure.some_avg300);
+    PressureSample(pressure, "full", "10", pressure.full_avg10);
+    PressureSample(pressure, "full", "60", pressure.full_avg60);
+    PressureSample(pressure, "full", "300", pressure.full_avg300);
+  }
+  Family("monitor_pressure_events", "counter",
+         "PSI trigger events since the monitor started.");
+  Sample("monitor_pressure_events",
+         static_cast<double>(snapshot.pressure_events));
+  Family("monitor_cgroup_cpu_ratio", "gauge",
+         "CPUs kept busy by each cgroup and its descendants.");
+  for (const snapshot::CgroupRow &cgroup : snapshot.cgroups)
+  {
+    CgroupSample("monitor_cgroup_cpu_ratio", cgroup, cgroup.cpu_utilization);
+  }
+  Family("monitor_cgroup_throttled_ratio", "gauge",
+         "Share of time each cgroup was throttled by its CPU limit.");
+  for (const snapshot::CgroupRow &cgroup : snapshot.cgroups)
+  {
+    CgroupSample("monitor_cgroup_throttled_ratio", cgroup, cgroup.throttled);
+  }
+  Family("monitor_cgroup_memory_bytes", "gauge",
+         "Memory charged to each cgroup.");
+  for (const snapshot::CgroupRow &cgroup : snapshot.cgroups)
+  {
+    CgroupSample("monitor_cgroup_memory_bytes", cgroup,
+                 cgroup.memory_kb * 1024.0);
+  }
+  Family("monitor_cgroup_read_bytes_per_second", "gauge",
+         "Block I/O read rate of each cgroup.");
+  for (const snapshot::CgroupRow &cgroup : snapshot.cgroups)
+  {
+    CgroupSample("monitor_cgroup_read_bytes_per_second", cgroup,
+                 cgroup.read_rate);
+  }
+  Family("monitor_cgroup_write_bytes_per_second", "gauge",
+         "Block I/O write rate of each cgroup.");
+  for (const snapshot::CgroupRow &cgroup : snapshot.cgroups)
+  {
+    CgroupSample("monitor_cgroup_write_bytes_per_second", cgroup,
+                 cgroup.write_rate);
+  }
+  Family("monitor_cgroup_processes", "gauge",
+         "Processes in each cgroup and its descendants.");
+  for (const snapshot::CgroupRow &cgroup : snapshot.cgroups)
+  {
+    CgroupSample("monitor_cgroup_processes", cgroup, cgroup.processes);
+  }
+  Family("monitor_collector_latency_seconds", "summary",
+         "Time the monitor spent in each collector.");
+  for (const snapshot::LatencySummary &latency : snapshot.latencies)
+  {
+    LatencySample("monitor_collector_latency_seconds", latency.name, "0.5",
+                  latency.p50_ns / 1e9);
+    LatencySample("monitor_collector_latency_seconds", latency.name, "0.99",
+                  latency.p99_ns / 1e9);
+    LatencySample("monitor_collector_latency_seconds_sum", latency.name, {},
+                  latency.sum_ns / 1e9);
+    LatencySample("monitor_collector_latency_seconds_count", latency.name, {},
+                  static_cast<double>(latency.count));
+  }
+  Family("monitor_collector_latency_max_seconds", "gauge",
+         "Slowest run of each collector since the monitor started.");
+  for (const snapshot::LatencySummary &latency : snapshot.latencies)
+  {
+    LatencySample("monitor_collector_latency_max_seconds", latency.name, {},
+                  latency.max_ns / 1e9);
+  }
+
+  Family("monitor_source_connected", "gauge",
+         "Whether each agent of an aggregator is connected.");
+  for (const snapshot::SourceRow &source : snapshot.sources)
+  {
+    SourceSample("monitor_source_connected", source, source.connected);
+  }
+  Family("monitor_source_frames", "counter",
+         "Frames received from each agent since the aggregator started.");
+  for (const snapshot::SourceRow &source : snapshot.sources)
+  {
+    SourceSample("monitor_source_frames", source,
+                 static_cast<double>(source.frames));
+  }
+  Family("monitor_source_received_bytes", "counter",
+         "Bytes received from each agent since the aggregator started.");
+  for (const snapshot::SourceRow &source : snapshot.sources)
+  {
+    SourceSample("monitor_source_received_bytes", source,
+                 static_cast<double>(source.bytes));
+  }
+  Family("monitor_source_cpu_utilization_ratio", "gauge",
+         "Share of CPU time each agent's host spent busy.");
+  for (const snapshot::SourceRow &source : snapshot.sources)
+  {
+    SourceSample("monitor_source_cpu_utilization_ratio", source,
+                 source.cpu_utilization);
+  }
+
+  sources_ = &snapshot.sources;
+  const auto &order = selector_.Select(snapshot.processes,
+                                       snapshot::SortKey::kCpu, top_processes_);
+  Family("monitor_process_cpu_ratio", "gauge",
+         "Share of one CPU used by the busiest processes.");
+  for (std::uint32_t index : order)
+  {
+    const auto &row = snapshot.processes[index];
+    ProcessSample("monitor_process_cpu_ratio", row, row.cpu_utilization);
+  }
+  Family("monitor_process_resident_bytes", "gauge",
+         "Resident set size of the busiest processes.");
+  for (std::uint32_t index : order)
+  {
+    const auto &row = snapshot.processes[index];
+    ProcessSample("monitor_process_resident_bytes", row, row.rss_kb * 1024.0);
+  }
+  Family("monitor_process_runqueue_wait_ratio", "gauge",
+         "Seconds per second the busiest processes waited for a CPU.");
+  for (std::uint32_t index : order)
+  {
+    const auto &row = snapshot.processes[index];
+    if (row.run_wait >= 0.0f)
+    {
+      ProcessSample("monitor_process_runqueue_wait_ratio", row, row.run_wait);
+    }
+  }
+  Family("monitor_process_energy_joules", "counter",
+         "Package energy attributed to the busiest processes.");
+  for (std::uint32_t index : order)
+  {
+    const auto &row = snapshot.processes[index];
+    ProcessSample("monitor_process_energy_joules", row, row.energy_joules);
+  }
+
+  // Disk I/O goes by its own ranking, the busiest CPUs rarely saturate it
+  const auto &by_io = selector_.Select(
+      snapshot.processes, snapshot::SortKey::kIoRate, top_processes_);
+  Family("monitor_process_read_bytes_per_second", "gauge",
+         "Bytes per second the busiest I/O processes read from storage.");
+  for (std::uint32_t index : by_io)
+  {
+    const auto &row = snapshot.processes[index];
+    if (row.read_rate >= 0.0)
+    {
+      ProcessSample("monitor_process_read_bytes_per_second", row,
+                    row.read_rate);
+    }
+  }
+  Family("monitor_process_write_bytes_per_second", "gauge",
+         "Bytes per second the busiest I/O processes wrote to storage.");
+  for (std::uint32_t index : by_io)
+  {
+    const auto &row = snapshot.processes[index];
+    if (row.write_rate >= 0.0)
+    {
+      ProcessSample("monitor_process_write_bytes_per_second", row,
+                    row.write_rate);
+    }
+  }
+
+  // Leaks show up by descriptor count, kinds are resolved for those only
+  const auto &by_fds = selector_.Select(
+      snapshot.processes, snapshot::SortKey::kFds, top_processes_);
+  Family("monitor_process_open_fds", "gauge",
+         "Open file descriptors of the processes with the most.");
+  for (std::uint32_t index : by_fds)
+  {
+    const auto &row = snapshot.processes[index];
+    if (row.fds >= 0)
+    {
+      ProcessSample("monitor_process_open_fds", row, row.fds);
+    }
+  }
+  Family("monitor_process_open_sockets", "gauge",
+         "Open sockets of the processes with the most descriptors.");
+  for (std::uint32_t index : by_fds)
+  {
+    const auto &row = snapshot.processes[index];
+    if (row.fd_sockets >= 0)
+    {
+      ProcessSample("monitor_process_open_sockets", row, row.fd_sockets);
+    }
+  }
+  Family("monitor_process_open_pipes", "gauge",
+         "Open pipes of the processes with the most descriptors.");
+  for (std::uint32_t index : by_fds)
+  {
+    const auto &row = snapshot.processes[index];
+    if (row.fd_pipes >= 0)
+    {
+      ProcessSample("monitor_process_open_pipes", row, row.fd_pipes);
+    }
+  }
+  Family("monitor_process_max_fds", "gauge",
+         "Soft RLIMIT_NOFILE of the processes with the most descriptors.");
+  for (std::uint32_t index : by_fds)
+  {
+    const auto &row = snapshot.processes[index];
+    if (row.fd_limit >= 0)
+    {
+      ProcessSample("monitor_process_max_fds", row,
+                    static_cast<double>(row.fd_limit));
+    }
+  }
+  return body_;
+}
+
+void PrometheusRenderer::Family(std::string_view name, std::string_view type,
+                                std::string_view help)
+{
+  Append("# HELP ");
+  Append(name);
+  body_ += ' ';
+  Append(help);
+  Append("\n# TYPE ");
+  Append(name);
+  body_ += ' ';
+  Append(type);
+  body_ += '\n';
+}
+
+void PrometheusRenderer::Sample(std::string_view name, double value)
+{
+  Append(name);
+  body_ += ' ';
+  AppendValue(value);
+  body_ += '\n';
+}
+
+void PrometheusRenderer::CpuSample(std::string_view name, int cpu,
+                                   double value)
+{
+  char label[16];
+  auto end = std::to_chars(label, label + sizeof(label), cpu).ptr;
+  Append(name);
+  Append("{cpu=\"");
+  Append(std::string_view(label, end - label));
+  Append("\"} ");
+  AppendValue(value);
+  body_ += '\n';
+}
+
+void PrometheusRenderer::LabeledSample(std::string_view name,
+                                       std::string_view label,
+                                       std::string_view text, double value)
+{
+  Append(name);
+  body_ += '{';
+  Append(label);
+  Append("=\"");
+  Append(text);
+  Append("\"} ");
+  AppendValue(value);
+  body_ += '\n';
+}
+
+void PrometheusRenderer::LatencySample(std::string_view name,
+                                       std::string_view collector,
+                                       std::string_view quantile, double value)
+{
+  Append(name);
+  Append("{collector=\"");
+  AppendLabelValue(collector);
+  if (!quantile.empty())
+  {
+    Append("\",quantile=\"");
+    Append(quantile);
+  }
+  Append("\"} ");
+  AppendValue(value);
+  body_ += '\n';
+}
+
+void PrometheusRenderer::CgroupSample(std::string_view name,
+                                      const snapshot::CgroupRow &cgroup,
+                                      double value)
+{
+  Append(name);
+  Append("{cgroup=\"");
+  AppendLabelValue(cgroup.path);
+  Append("\"} ");
+  AppendValue(value);
+  body_ += '\n';
+}
+
+void PrometheusRenderer::PressureSample(const snapshot::PressureRow &pressure,
+                                        std::string_view kind,
+                                        std::string_view window, float percent)
+{
+  Append("monitor_pressure_stall_ratio{scope=\"");
+  AppendLabelValue(pressure.scope);
+  Append("\",resource=\"");
+  Append(pressure.resource);
+  Append("\",kind=\"");
+  Append(kind);
+  Append("\",window=\"");
+  Append(window);
+  Append("\"} ");
+  AppendValue(percent / 100.0);
+  body_ += '\n';
+}
+
+void PrometheusRenderer::NodeSample(std::string_view name, int node,
+                                    std::string_view kind, double value)
+{
+  char label[16];
+  auto end = std::to_chars(label, label + sizeof(label), node).ptr;
+  Append(name);
+  Append("{node=\"");
+  Append(std::string_view(label, end - label));
+  if (!kind.empty())
+  {
+    Append("\",kind=\"");
+    Append(kind);
+  }
+  Append("\"} ");
+  AppendValue(value);
+  body_ += '\n';
+}
+
+void PrometheusRenderer::InterruptSample(
+    const snapshot::InterruptSource &source)
+{
+  Append("monitor_interrupt_source_per_second{source=\"");
+  AppendLabelValue(source.name);
+  Append(source.soft ? "\",kind=\"soft" : "\",kind=\"hard");
+  if (!source.description.empty())
+  {
+    Append("\",description=\"");
+    AppendLabelValue(source.description);
+  }
+  Append("\"} ");
+  AppendValue(source.rate);
+  body_ += '\n';
+}
+
+void PrometheusRenderer::SourceSample(std::string_view name,
+                                      const snapshot::SourceRow &source,
+                                      double value)
+{
+  Append(name);
+  Append("{source=\"");
+  AppendLabelValue(source.name);
+  Append("\"} ");
+  AppendValue(value);
+  body_ += '\n';
+}
+
+void PrometheusRenderer::ProcessSample(std::string_view name,
+                                       const snapshot::ProcessRow &row,
+                                       double value)
+{
+  char pid[16];
+  auto end = std::to_chars(pid, pid + sizeof(pid), row.pid).ptr;
+  Append(name);
+  Append("{pid=\"");
+  Append(std::string_view(pid, end - pid));
+  Append("\",comm=\"");
+  AppendLabelValue(std::string_view(row.comm, strnlen(row.comm, sizeof(row.comm))));
+  // Pids of different agents only differ by their source
+  if (row.source > 0 && row.source <= static_cast<int>(sources_->size()))
+  {
+    Append("\",source=\"");
+    AppendLabelValue((*sources_)[row.source - 1].name);
+  }
+  Append("\"} ");
+  AppendValue(value);
+  body_ += '\n';
+}
+
+void PrometheusRenderer::Append(std::string_view text)
+{
+  body_.append(text.data(), text.size());
+}
+
+void PrometheusRenderer::AppendValue(double value)
+{
+  if (std::isnan(value))
+  {
+    Append("NaN");
+    return;
+  }
+  if (std::isinf(value))
+  {
+    Append(value > 0 ? "+Inf" : "-Inf");
+    return;
+  }
+  char buffer[32];
+  auto end = std::to_chars(buffer, buffer + sizeof(buffer), value).ptr;
+  body_.append(buffer, end - buffer);
+}
+
+void PrometheusRenderer::AppendLabelValue(std::string_view text)
+{
+  for (char c : text)
+  {
+    if (c == '\\' || c == '"')
+    {
+      body_ += '\\';
+      body_ += c;
+    }
+    else if (c == '\n')
+    {
+      Append("\\n");
+    }
+    else
+    {
+      body_ += c;
+    }
+  }
+}
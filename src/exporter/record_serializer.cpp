@@ -0,0 +1,713 @@
+#include "exporter/record_serializer.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+using namespace exporter;
+
+namespace
+{
+constexpr std::string_view kCsvColumns =
+    "timestamp_ns,sequence,pid,ppid,state,comm,cpu,rss_kb,threads,"
+    "starttime,uptime,io_rate,energy_j,run_wait,subtree_cpu,subtree_rss_kb,"
+    "subtree_threads,subtree_io_rate,subtree_processes,pss_kb,uss_kb,"
+    "swap_kb,read_rate,write_rate,syscr_rate,syscw_rate,fds,fd_sockets,"
+    "fd_pipes,fd_files,fd_limit\n";
+
+std::int64_t TimestampNs(const snapshot::SystemSnapshot &snapshot)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             snapshot.timestamp.time_since_epoch())
+      .count();
+}
+
+std::string_view CommOf(const snapshot::ProcessRow &row)
+{
+  return std::string_view(row.comm, strnlen(row.comm, sizeof(row.comm)));
+}
+
+std::string_view CommOf(const snapshot::ThreadRow &row)
+{
+  return std::string_view(row.comm, strnlen(row.comm, sizeof(row.comm)));
+}
+} // namespace
+
+RecordSerializer::RecordSerializer(RecordFormat format) : format_(format)
+{
+  buffer_.resize(64 * 1024);
+}
+
+std::string_view RecordSerializer::Preamble()
+{
+  return format_ == RecordFormat::kCsv ? kCsvColumns : std::string_view();
+}
+
+std::string_view
+RecordSerializer::Serialize(const snapshot::SystemSnapshot &snapshot)
+{
+  size_ = 0;
+  switch (format_)
+  {
+  case RecordFormat::kJsonLines:
+    SerializeJson(snapshot);
+    break;
+  case RecordFormat::kCsv:
+    SerializeCsv(snapshot);
+    break;
+  case RecordFormat::kBinary:
+    SerializeBinary(snapshot);
+    break;
+  }
+  return std::string_view(buffer_.data(), size_);
+}
+
+void RecordSerializer::SerializeJson(const snapshot::SystemSnapshot &snapshot)
+{
+  Append("{\"timestamp_ns\":");
+  AppendNumber(TimestampNs(snapshot));
+  Append(",\"sequence\":");
+  AppendNumber(snapshot.sequence);
+  Append(",\"cpu\":");
+  AppendFixed(snapshot.cpu_utilization, 4);
+  Append(",\"memory\":");
+  AppendFixed(snapshot.memory_utilization, 4);
+  Append(",\"uptime\":");
+  AppendNumber(snapshot.uptime);
+  Append(",\"total_processes\":");
+  AppendNumber(snapshot.total_processes);
+  if (!snapshot.filter.empty())
+  {
+    Append(",\"filter\":");
+    AppendJsonString(snapshot.filter);
+  }
+  Append(",\"running_processes\":");
+  AppendNumber(snapshot.running_processes);
+  const parser_factory::metric_snapshot_t &metrics = snapshot.metrics;
+  if (metrics.mem_total_kb != 0)
+  {
+    Append(",\"blocked_processes\":");
+    AppendNumber(metrics.procs_blocked);
+    Append(",\"load\":[");
+    AppendFixed(metrics.load1, 2);
+    Append(',');
+    AppendFixed(metrics.load5, 2);
+    Append(',');
+    AppendFixed(metrics.load15, 2);
+    Append("],\"memory_kb\":{\"total\":");
+    AppendNumber(metrics.mem_total_kb);
+    Append(",\"free\":");
+    AppendNumber(metrics.mem_free_kb);
+    Append(",\"available\":");
+    AppendNumber(metrics.mem_available_kb);
+    Append(",\"buffers\":");
+    AppendNumber(metrics.buffers_kb);
+    Append(",\"cached\":");
+    AppendNumber(metrics.cached_kb);
+    Append(",\"swap_total\":");
+    AppendNumber(metrics.swap_total_kb);
+    Append(",\"swap_free\":");
+    AppendNumber(metrics.swap_free_kb);
+    Append("},\"network\":{\"rx_bytes\":");
+    AppendNumber(metrics.rx_bytes);
+    Append(",\"tx_bytes\":");
+    AppendNumber(metrics.tx_bytes);
+    Append(",\"rx_rate\":");
+    AppendFixed(metrics.rx_rate, 0);
+    Append(",\"tx_rate\":");
+    AppendFixed(metrics.tx_rate, 0);
+    Append("},\"context_switches\":");
+    AppendNumber(metrics.context_switches);
+    Append(",\"forks\":");
+    AppendNumber(metrics.forks);
+  }
+  Append(",\"run_queues\":[");
+  for (std::size_t i = 0; i < snapshot.run_queues.size(); ++i)
+  {
+    const snapshot::RunQueue &queue = snapshot.run_queues[i];
+    Append(i == 0 ? "{\"cpu\":" : ",{\"cpu\":");
+    AppendNumber(queue.cpu);
+    Append(",\"waiting\":");
+    AppendFixed(queue.waiting, 4);
+    Append(",\"avg_wait_ns\":");
+    AppendFixed(queue.avg_wait_ns, 0);
+    Append('}');
+  }
+  Append(']');
+  Append(",\"numa_nodes\":[");
+  for (std::size_t i = 0; i < snapshot.numa_nodes.size(); ++i)
+  {
+    const snapshot::NumaNodeRow &node = snapshot.numa_nodes[i];
+    Append(i == 0 ? "{\"node\":" : ",{\"node\":");
+    AppendNumber(node.node);
+    Append(",\"cpus\":");
+    AppendNumber(node.cpus);
+    Append(",\"cpu\":");
+    AppendFixed(node.cpu_utilization, 4);
+    Append(",\"total_kb\":");
+    AppendNumber(node.total_kb);
+    Append(",\"free_kb\":");
+    AppendNumber(node.free_kb);
+    Append(",\"hit_rate\":");
+    AppendFixed(node.hit_rate, 1);
+    Append(",\"miss_rate\":");
+    AppendFixed(node.miss_rate, 1);
+    Append(",\"foreign_rate\":");
+    AppendFixed(node.foreign_rate, 1);
+    Append(",\"other_rate\":");
+    AppendFixed(node.other_rate, 1);
+    Append('}');
+  }
+  Append(']');
+  if (!snapshot.numa_placements.empty())
+  {
+    Append(",\"numa_placements\":[");
+    for (std::size_t i = 0; i < snapshot.numa_placements.size(); ++i)
+    {
+      const snapshot::NumaPlacement &placement = snapshot.numa_placements[i];
+      Append(i == 0 ? "{\"pid\":" : ",{\"pid\":");
+      AppendNumber(placement.pid);
+      Append(",\"node_kb\":[");
+      for (std::size_t node = 0; node < placement.node_kb.size(); ++node)
+      {
+        if (node > 0)
+        {
+          Append(',');
+        }
+        AppendNumber(placement.node_kb[node]);
+      }
+      Append("]}");
+    }
+    Append(']');
+  }
+  // Per-CPU rates with the busiest sources resolved to their names
+  Append(",\"interrupts\":[");
+  for (std::size_t i = 0; i < snapshot.interrupts.size(); ++i)
+  {
+    const snapshot::CpuInterrupts &cpu = snapshot.interrupts[i];
+    Append(i == 0 ? "{\"cpu\":" : ",{\"cpu\":");
+    AppendNumber(cpu.cpu);
+    Append(",\"hard\":");
+    AppendFixed(cpu.hard_rate, 1);
+    Append(",\"soft\":");
+    AppendFixed(cpu.soft_rate, 1);
+    Append(",\"top\":[");
+    for (int slot = 0; slot < snapshot::kTopInterrupts && cpu.top[slot] >= 0;
+         ++slot)
+    {
+      const snapshot::InterruptSource &source =
+          snapshot.interrupt_sources[cpu.top[slot]];
+      Append(slot == 0 ? "{\"source\":" : ",{\"source\":");
+      AppendJsonString(source.name);
+      Append(",\"soft\":");
+      Append(source.soft ? "true" : "false");
+      Append(",\"rate\":");
+      AppendFixed(cpu.top_rate[slot], 1);
+      Append('}');
+    }
+    Append("]}");
+  }
+  Append(']');
+  Append(",\"cgroups\":[");
+  for (std::size_t i = 0; i < snapshot.cgroups.size(); ++i)
+  {
+    const snapshot::CgroupRow &cgroup = snapshot.cgroups[i];
+    Append(i == 0 ? "{\"path\":" : ",{\"path\":");
+    AppendJsonString(cgroup.path);
+    Append(",\"cpu\":");
+    AppendFixed(cgroup.cpu_utilization, 4);
+    Append(",\"throttled\":");
+    AppendFixed(cgroup.throttled, 4);
+    Append(",\"memory_kb\":");
+    AppendNumber(cgroup.memory_kb);
+    Append(",\"anon_kb\":");
+    AppendNumber(cgroup.anon_kb);
+    Append(",\"file_kb\":");
+    AppendNumber(cgroup.file_kb);
+    Append(",\"read_rate\":");
+    AppendFixed(cgroup.read_rate, 1);
+    Append(",\"write_rate\":");
+    AppendFixed(cgroup.write_rate, 1);
+    Append(",\"processes\":");
+    AppendNumber(cgroup.processes);
+    Append('}');
+  }
+  Append(']');
+  Append(",\"pressure\":[");
+  for (std::size_t i = 0; i < snapshot.pressure.size(); ++i)
+  {
+    const snapshot::PressureRow &pressure = snapshot.pressure[i];
+    Append(i == 0 ? "{\"scope\":" : ",{\"scope\":");
+    AppendJsonString(pressure.scope);
+    Append(",\"resource\":");
+    AppendJsonString(pressure.resource);
+    Append(",\"some\":[");
+    AppendFixed(pressure.some_avg10, 2);
+    Append(',');
+    AppendFixed(pressure.some_avg60, 2);
+    Append(',');
+    AppendFixed(pressure.some_avg300, 2);
+    Append("],\"full\":[");
+    AppendFixed(pressure.full_avg10, 2);
+    Append(',');
+    AppendFixed(pressure.full_avg60, 2);
+    Append(',');
+    AppendFixed(pressure.full_avg300, 2);
+    Append("]}");
+  }
+  Append("],\"pressure_events\":");
+  AppendNumber(snapshot.pressure_events);
+  if (!snapshot.sources.empty())
+  {
+    Append(",\"sources\":[");
+    for (std::size_t i = 0; i < snapshot.sources.size(); ++i)
+    {
+      const snapshot::SourceRow &source = snapshot.sources[i];
+      Append(i == 0 ? "{\"name\":" : ",{\"name\":");
+      AppendJsonString(source.name);
+      Append(",\"connected\":");
+      Append(source.connected ? "true" : "false");
+      Append(",\"frames\":");
+      AppendNumber(source.frames);
+      Append(",\"bytes\":");
+      AppendNumber(source.bytes);
+      Append(",\"cpu\":");
+      AppendFixed(source.cpu_utilization, 4);
+      Append(",\"memory\":");
+      AppendFixed(source.memory_utilization, 4);
+      Append(",\"total_processes\":");
+      AppendNumber(source.total_processes);
+      Append('}');
+    }
+    Append(']');
+  }
+  Append(",\"latency\":{");
+  bool first_latency = true;
+  for (const snapshot::LatencySummary &latency : snapshot.latencies)
+  {
+    if (!first_latency)
+    {
+      Append(',');
+    }
+    first_latency = false;
+    AppendJsonString(latency.name);
+    Append(":{\"count\":");
+    AppendNumber(latency.count);
+    Append(",\"p50_ns\":");
+    AppendNumber(latency.p50_ns);
+    Append(",\"p99_ns\":");
+    AppendNumber(latency.p99_ns);
+    Append(",\"max_ns\":");
+    AppendNumber(latency.max_ns);
+    Append('}');
+  }
+  Append('}');
+  Append(",\"processes\":[");
+  bool first = true;
+  for (const snapshot::ProcessRow &row : snapshot.processes)
+  {
+    Append(first ? "{\"pid\":" : ",{\"pid\":");
+    first = false;
+    AppendNumber(row.pid);
+    if (row.source != 0)
+    {
+      Append(",\"source\":");
+      AppendNumber(row.source);
+    }
+    Append(",\"ppid\":");
+    AppendNumber(row.ppid);
+    Append(",\"state\":");
+    AppendJsonString(std::string_view(&row.state, 1));
+    Append(",\"comm\":");
+    AppendJsonString(CommOf(row));
+    Append(",\"cpu\":");
+    AppendFixed(row.cpu_utilization, 4);
+    Append(",\"rss_kb\":");
+    AppendNumber(row.rss_kb);
+    Append(",\"threads\":");
+    AppendNumber(row.num_threads);
+    Append(",\"starttime\":");
+    AppendNumber(row.starttime);
+    Append(",\"uptime\":");
+    AppendNumber(row.uptime);
+    Append(",\"io_rate\":");
+    AppendFixed(row.io_rate, 1);
+    Append(",\"energy_j\":");
+    AppendFixed(row.energy_joules, 3);
+    if (row.run_wait >= 0.0f)
+    {
+      Append(",\"run_wait\":");
+      AppendFixed(row.run_wait, 4);
+    }
+    if (row.read_rate >= 0.0)
+    {
+      Append(",\"read_rate\":");
+      AppendFixed(row.read_rate, 1);
+      Append(",\"write_rate\":");
+      AppendFixed(row.write_rate, 1);
+      Append(",\"syscr_rate\":");
+      AppendFixed(row.syscr_rate, 1);
+      Append(",\"syscw_rate\":");
+      AppendFixed(row.syscw_rate, 1);
+    }
+    if (row.pss_kb >= 0)
+    {
+      Append(",\"pss_kb\":");
+      AppendNumber(row.pss_kb);
+      Append(",\"uss_kb\":");
+      AppendNumber(row.uss_kb);
+      Append(",\"swap_kb\":");
+      AppendNumber(row.swap_kb);
+    }
+    if (row.fds >= 0)
+    {
+      Append(",\"fds\":");
+      AppendNumber(row.fds);
+    }
+    if (row.fd_sockets >= 0)
+    {
+      Append(",\"fd_kinds\":{\"sockets\":");
+      AppendNumber(row.fd_sockets);
+      Append(",\"pipes\":");
+      AppendNumber(row.fd_pipes);
+      Append(",\"files\":");
+      AppendNumber(row.fd_files);
+      Append('}');
+    }
+    if (row.fd_limit >= 0)
+    {
+      Append(",\"fd_limit\":");
+      AppendNumber(row.fd_limit);
+    }
+    if (row.subtree.processes > 1)
+    {
+      Append(",\"subtree\":{\"cpu\":");
+      AppendFixed(row.subtree.cpu_utilization, 4);
+      Append(",\"rss_kb\":");
+      AppendNumber(row.subtree.rss_kb);
+      Append(",\"threads\":");
+      AppendNumber(row.subtree.num_threads);
+      Append(",\"io_rate\":");
+      AppendFixed(row.subtree.io_rate, 1);
+      Append(",\"processes\":");
+      AppendNumber(row.subtree.processes);
+      Append('}');
+    }
+    if (row.cgroup >= 0 &&
+        static_cast<std::size_t>(row.cgroup) < snapshot.cgroups.size())
+    {
+      Append(",\"cgroup\":");
+      AppendJsonString(snapshot.cgroups[row.cgroup].path);
+    }
+    Append('}');
+  }
+  Append("],\"threads\":[");
+  for (std::size_t i = 0; i < snapshot.threads.size(); ++i)
+  {
+    const snapshot::ThreadRow &thread = snapshot.threads[i];
+    Append(i == 0 ? "{\"pid\":" : ",{\"pid\":");
+    AppendNumber(thread.pid);
+    Append(",\"tid\":");
+    AppendNumber(thread.tid);
+    Append(",\"state\":");
+    AppendJsonString(std::string_view(&thread.state, 1));
+    Append(",\"comm\":");
+    AppendJsonString(CommOf(thread));
+    Append(",\"cpu\":");
+    AppendFixed(thread.cpu_utilization, 4);
+    Append(",\"processor\":");
+    AppendNumber(thread.processor);
+    Append('}');
+  }
+  Append("]}\n");
+}
+
+void RecordSerializer::SerializeCsv(const snapshot::SystemSnapshot &snapshot)
+{
+  std::int64_t timestamp = TimestampNs(snapshot);
+  for (const snapshot::ProcessRow &row : snapshot.processes)
+  {
+    AppendNumber(timestamp);
+    Append(',');
+    AppendNumber(snapshot.sequence);
+    Append(',');
+    AppendNumber(row.pid);
+    Append(',');
+    AppendNumber(row.ppid);
+    Append(',');
+    Append(row.state);
+    Append(',');
+    AppendCsvString(CommOf(row));
+    Append(',');
+    AppendFixed(row.cpu_utilization, 4);
+    Append(',');
+    AppendNumber(row.rss_kb);
+    Append(',');
+    AppendNumber(row.num_threads);
+    Append(',');
+    AppendNumber(row.starttime);
+    Append(',');
+    AppendNumber(row.uptime);
+    Append(',');
+    AppendFixed(row.io_rate, 1);
+    Append(',');
+    AppendFixed(row.energy_joules, 3);
+    Append(',');
+    if (row.run_wait >= 0.0f)
+    {
+      AppendFixed(row.run_wait, 4);
+    }
+    Append(',');
+    AppendFixed(row.subtree.cpu_utilization, 4);
+    Append(',');
+    AppendNumber(row.subtree.rss_kb);
+    Append(',');
+    AppendNumber(row.subtree.num_threads);
+    Append(',');
+    AppendFixed(row.subtree.io_rate, 1);
+    Append(',');
+    AppendNumber(row.subtree.processes);
+    Append(',');
+    if (row.pss_kb >= 0)
+    {
+      AppendNumber(row.pss_kb);
+      Append(',');
+      AppendNumber(row.uss_kb);
+      Append(',');
+      AppendNumber(row.swap_kb);
+    }
+    else
+    {
+      Append(",,");
+    }
+    Append(',');
+    if (row.read_rate >= 0.0)
+    {
+      AppendFixed(row.read_rate, 1);
+      Append(',');
+      AppendFixed(row.write_rate, 1);
+      Append(',');
+      AppendFixed(row.syscr_rate, 1);
+      Append(',');
+      AppendFixed(row.syscw_rate, 1);
+    }
+    else
+    {
+      Append(",,,");
+    }
+    Append(',');
+    if (row.fds >= 0)
+    {
+      AppendNumber(row.fds);
+    }
+    Append(',');
+    if (row.fd_sockets >= 0)
+    {
+      AppendNumber(row.fd_sockets);
+      Append(',');
+      AppendNumber(row.fd_pipes);
+      Append(',');
+      AppendNumber(row.fd_files);
+    }
+    else
+    {
+      Append(",,");
+    }
+    Append(',');
+    if (row.fd_limit >= 0)
+    {
+      AppendNumber(row.fd_limit);
+    }
+    Append('\n');
+  }
+}
+
+void RecordSerializer::SerializeBinary(const snapshot::SystemSnapshot &snapshot)
+{
+  std::size_t const payload = sizeof(system_header_t) +
+                              snapshot.processes.size() * sizeof(process_record_t);
+  std::uint32_t const length = static_cast<std::uint32_t>(payload);
+  std::memcpy(Reserve(sizeof(length)), &length, sizeof(length));
+  size_ += sizeof(length);
+
+  system_header_t header = ToHeader(snapshot);
+  std::memcpy(Reserve(sizeof(header)), &header, sizeof(header));
+  size_ += sizeof(header);
+
+  char *out = Reserve(snapshot.processes.size() * sizeof(process_record_t));
+  for (const snapshot::ProcessRow &row : snapshot.processes)
+  {
+    process_record_t record = ToRecord(row);
+    std::memcpy(out, &record, sizeof(record));
+    out += sizeof(record);
+  }
+  size_ += snapshot.processes.size() * sizeof(process_record_t);
+}
+
+RecordSerializer::system_header_t
+RecordSerializer::ToHeader(const snapshot::SystemSnapshot &snapshot)
+{
+  system_header_t header;
+  header.sequence = snapshot.sequence;
+  header.timestamp_ns = TimestampNs(snapshot);
+  header.cpu_utilization = snapshot.cpu_utilization;
+  header.memory_utilization = snapshot.memory_utilization;
+  header.uptime = snapshot.uptime;
+  header.total_processes = snapshot.total_processes;
+  header.running_processes = snapshot.running_processes;
+  header.process_count = static_cast<std::uint32_t>(snapshot.processes.size());
+  return header;
+}
+
+RecordSerializer::process_record_t
+RecordSerializer::ToRecord(const snapshot::ProcessRow &row)
+{
+  process_record_t record;
+  record.pid = row.pid;
+  record.ppid = row.ppid;
+  record.state = row.state;
+  std::memcpy(record.comm, row.comm, sizeof(record.comm));
+  record.cpu_utilization = row.cpu_utilization;
+  record.rss_kb = row.rss_kb;
+  record.num_threads = row.num_threads;
+  record.starttime = row.starttime;
+  record.uptime = row.uptime;
+  record.io_rate = row.io_rate;
+  record.energy_joules = row.energy_joules;
+  return record;
+}
+
+void RecordSerializer::FromHeader(const system_header_t &header,
+                                  snapshot::SystemSnapshot &snapshot)
+{
+  snapshot.sequence = header.sequence;
+  snapshot.timestamp = std::chrono::system_clock::time_point(
+      std::chrono::duration_cast<std::chrono::system_clock::duration>(
+          std::chrono::nanoseconds(header.timestamp_ns)));
+  snapshot.cpu_utilization = header.cpu_utilization;
+  snapshot.memory_utilization = header.memory_utilization;
+  snapshot.uptime = header.uptime;
+  snapshot.total_processes = header.total_processes;
+  snapshot.running_processes = header.running_processes;
+}
+
+snapshot::ProcessRow
+RecordSerializer::FromRecord(const process_record_t &record)
+{
+  snapshot::ProcessRow row{};
+  row.pid = record.pid;
+  row.ppid = record.ppid;
+  row.state = record.state;
+  std::memcpy(row.comm, record.comm, sizeof(row.comm));
+  row.comm[sizeof(row.comm) - 1] = '\0';
+  row.cpu_utilization = record.cpu_utilization;
+  row.rss_kb = record.rss_kb;
+  row.num_threads = record.num_threads;
+  row.starttime = record.starttime;
+  row.uptime = record.uptime;
+  row.io_rate = record.io_rate;
+  row.energy_joules = record.energy_joules;
+  row.run_wait = -1.0f; // not part of the binary layout
+  row.cgroup = -1;
+  row.pss_kb = row.uss_kb = row.swap_kb = -1;
+  row.fds = row.fd_sockets = row.fd_pipes = row.fd_files = -1;
+  row.fd_limit = -1;
+  row.read_rate = row.write_rate = -1.0;
+  row.syscr_rate = row.syscw_rate = 0.0f;
+  // Subtree totals are not part of the binary layout either
+  row.subtree = {row.cpu_utilization, row.rss_kb, row.num_threads, row.io_rate,
+                 1};
+  return row;
+}
+
+// Makes room for bytes more at the end of the buffer, doubling as needed
+char *RecordSerializer::Reserve(std::size_t bytes)
+{
+  if (size_ + bytes > buffer_.size())
+  {
+    buffer_.resize(std::max(buffer_.size() * 2, size_ + bytes));
+  }
+  return buffer_.data() + size_;
+}
+
+void RecordSerializer::Append(std::string_view text)
+{
+  std::memcpy(Reserve(text.size()), text.data(), text.size());
+  size_ += text.size();
+}
+
+void RecordSerializer::Append(char c)
+{
+  *Reserve(1) = c;
+  ++size_;
+}
+
+template <typename T>
+void RecordSerializer::AppendNumber(T value)
+{
+  char *out = Reserve(24);
+  size_ = std::to_chars(out, out + 24, value).ptr - buffer_.data();
+}
+
+void RecordSerializer::AppendFixed(double value, int precision)
+{
+  // Fixed notation of any finite double fits, larger values fall back
+  if (!std::isfinite(value))
+  {
+    value = 0.0;
+  }
+  char *out = Reserve(64);
+  auto result =
+      std::to_chars(out, out + 64, value, std::chars_format::fixed, precision);
+  if (result.ec != std::errc())
+  {
+    result = std::to_chars(out, out + 64, value);
+  }
+  size_ = result.ptr - buffer_.data();
+}
+
+void RecordSerializer::AppendJsonString(std::string_view text)
+{
+  static const char kHex[] = "0123456789abcdef";
+  Append('"');
+  for (char c : text)
+  {
+    unsigned char const u = static_cast<unsigned char>(c);
+    if (c == '"' || c == '\\')
+    {
+      Append('\\');
+      Append(c);
+    }
+    else if (u < 0x20)
+    {
+      char escape[6] = {'\\', 'u', '0', '0', kHex[u >> 4], kHex[u & 0xf]};
+      Append(std::string_view(escape, sizeof(escape)));
+    }
+    else
+    {
+      Append(c);
+    }
+  }
+  Append('"');
+}
+
+void RecordSerializer::AppendCsvString(std::string_view text)
+{
+  if (text.find_first_of(",\"\n") == std::string_view::npos)
+  {
+    Append(text);
+    return;
+  }
+  Append('"');
+  for (char c : text)
+  {
+    if (c == '"')
+    {
+      Append('"');
+    }
+    Append(c);
+  }
+  Append('"');
+}
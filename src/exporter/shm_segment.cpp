@@ -0,0 +1,302 @@
+#include "exporter/shm_segment.h"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+
+#include "logger/logger_singletone.h"
+#include "stop_signal.h"
+
+using namespace exporter;
+
+namespace
+{
+constexpr char kMagic[8] = {'G', 'R', 'N', 'S', 'Y', 'S', '\0', '\0'};
+constexpr int kReadAttempts = 64;
+
+std::size_t SegmentSize(std::uint32_t capacity)
+{
+  return sizeof(ShmLayout) +
+         static_cast<std::size_t>(capacity) * sizeof(RecordSerializer::ProcessRecord);
+}
+
+std::runtime_error ShmError(const std::string &what, const std::string &name)
+{
+  return std::runtime_error(what + " " + name + ": " + std::strerror(errno));
+}
+
+void CopyString(char *target, std::size_t size, const std::string &source)
+{
+  std::size_t length = std::min(source.size(), size - 1);
+  std::memcpy(target, source.data(), length);
+  target[length] = '\0';
+}
+} // namespace
+
+// -----------------------------
+// ShmWriter Implementation
+ShmWriter::ShmWriter(snapshot::SnapshotPublisher &publisher, std::string name,
+                     std::uint32_t capacity)
+    : publisher_(publisher), reader_(publisher), name_(std::move(name)),
+      capacity_(capacity)
+{
+}
+
+ShmWriter::~ShmWriter() { Stop(); }
+
+void ShmWriter::Start()
+{
+  size_ = SegmentSize(capacity_);
+  int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0644);
+  bool const existed = fd < 0 && errno == EEXIST;
+  if (existed)
+  {
+    fd = shm_open(name_.c_str(), O_RDWR | O_CLOEXEC, 0);
+  }
+  if (fd < 0)
+  {
+    throw ShmError("Failed to create shared memory", name_);
+  }
+  // A writer holds the lock until Stop(), and the kernel drops it when
+  // the writer dies. An existing segment whose lock can be taken was
+  // left behind and is reused, one still locked belongs to a live writer.
+  if (flock(fd, LOCK_EX | LOCK_NB) < 0)
+  {
+    int const error = errno;
+    close(fd);
+    if (error == EWOULDBLOCK)
+    {
+      throw std::runtime_error("Shared memory " + name_ +
+                               " is in use by another monitor.");
+    }
+    errno = error;
+    throw ShmError("Failed to lock shared memory", name_);
+  }
+  if (existed)
+  {
+    Logger::GetInstance().Log(LogLevel::INFO,
+                              "Reclaiming shared memory " + name_ +
+                                  " left by a monitor that exited.");
+  }
+  if (ftruncate(fd, static_cast<off_t>(size_)) < 0)
+  {
+    close(fd);
+    throw ShmError("Failed to size shared memory", name_);
+  }
+  void *memory = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (memory == MAP_FAILED)
+  {
+    close(fd);
+    throw ShmError("Failed to map shared memory", name_);
+  }
+  fd_ = fd;
+
+  if (existed)
+  {
+    // Readers of the old segment stop trusting it until the header is redone
+    std::memset(memory, 0, sizeof(kMagic));
+  }
+  layout_ = new (memory) ShmLayout;
+  layout_->version = kShmVersion;
+  layout_->capacity = capacity_;
+  layout_->record_size = sizeof(RecordSerializer::ProcessRecord);
+  layout_->truncated = 0;
+  layout_->sequence.store(0);
+  layout_->system = {};
+  // Magic last, readers ignore the segment until the header is complete
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(layout_->magic, kMagic, sizeof(kMagic));
+
+  listener_id_ = publisher_.AddListener([this](std::uint64_t)
+                                        { Write(*reader_.Acquire()); });
+  Logger::GetInstance().Log(LogLevel::INFO,
+                            "Publishing snapshots to shared memory " + name_);
+}
+
+void ShmWriter::Stop()
+{
+  if (layout_ == nullptr)
+  {
+    return;
+  }
+  publisher_.RemoveListener(listener_id_);
+  munmap(layout_, size_);
+  // Unlinked while still locked, so no other writer reclaims it meanwhile
+  shm_unlink(name_.c_str());
+  close(fd_);
+  fd_ = -1;
+  layout_ = nullptr;
+}
+
+void ShmWriter::Write(const snapshot::SystemSnapshot &snapshot)
+{
+  std::uint64_t sequence = layout_->sequence.load(std::memory_order_relaxed);
+  layout_->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  std::size_t count = std::min<std::size_t>(snapshot.processes.size(), capacity_);
+  layout_->system = RecordSerializer::ToHeader(snapshot);
+  layout_->system.process_count = static_cast<std::uint32_t>(count);
+  layout_->truncated = static_cast<std::uint32_t>(snapshot.processes.size() - count);
+  CopyString(layout_->operating_system, sizeof(layout_->operating_system),
+             snapshot.operating_system);
+  CopyString(layout_->kernel, sizeof(layout_->kernel), snapshot.kernel);
+  auto *records = reinterpret_cast<RecordSerializer::ProcessRecord *>(layout_ + 1);
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    records[i] = RecordSerializer::ToRecord(snapshot.processes[i]);
+  }
+
+  layout_->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+// -----------------------------
+// ShmReader Implementation
+ShmReader::ShmReader(std::string name) : name_(std::move(name)) {}
+
+ShmReader::~ShmReader()
+{
+  if (layout_ != nullptr)
+  {
+    munmap(const_cast<ShmLayout *>(layout_), size_);
+  }
+}
+
+void ShmReader::Open()
+{
+  int fd = shm_open(name_.c_str(), O_RDONLY | O_CLOEXEC, 0);
+  if (fd < 0)
+  {
+    throw ShmError("Failed to open shared memory", name_);
+  }
+  struct stat info;
+  if (fstat(fd, &info) < 0 || static_cast<std::size_t>(info.st_size) < sizeof(ShmLayout))
+  {
+    close(fd);
+    throw std::runtime_error("Shared memory " + name_ + " is too small.");
+  }
+  size_ = static_cast<std::size_t>(info.st_size);
+  void *memory = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (memory == MAP_FAILED)
+  {
+    throw ShmError("Failed to map shared memory", name_);
+  }
+  layout_ = static_cast<const ShmLayout *>(memory);
+  if (std::memcmp(layout_->magic, kMagic, sizeof(kMagic)) != 0 ||
+      layout_->version != kShmVersion ||
+      layout_->record_size != sizeof(RecordSerializer::ProcessRecord) ||
+      SegmentSize(layout_->capacity) > size_)
+  {
+    throw std::runtime_error("Shared memory " + name_ +
+                             " has an incompatible layout.");
+  }
+}
+
+std::uint64_t ShmReader::Sequence() const
+{
+  return layout_->sequence.load(std::memory_order_acquire);
+}
+
+std::uint64_t ShmReader::Read(snapshot::SystemSnapshot &snapshot) const
+{
+  const auto *records =
+      reinterpret_cast<const RecordSerializer::ProcessRecord *>(layout_ + 1);
+  for (int attempt = 0; attempt < kReadAttempts; ++attempt)
+  {
+    std::uint64_t before = layout_->sequence.load(std::memory_order_acquire);
+    if (before == 0 || (before & 1) != 0)
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    RecordSerializer::SystemHeader system;
+    std::memcpy(&system, &layout_->system, sizeof(system));
+    char operating_system[sizeof(layout_->operating_system)];
+    char kernel[sizeof(layout_->kernel)];
+    std::memcpy(operating_system, layout_->operating_system, sizeof(operating_system));
+    std::memcpy(kernel, layout_->kernel, sizeof(kernel));
+    std::uint32_t count = std::min(system.process_count, layout_->capacity);
+    snapshot.processes.resize(count);
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+      RecordSerializer::ProcessRecord record;
+      std::memcpy(&record, records + i, sizeof(record));
+      snapshot.processes[i] = RecordSerializer::FromRecord(record);
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (layout_->sequence.load(std::memory_order_relaxed) != before)
+    {
+      continue; // torn read, the writer was active meanwhile
+    }
+    RecordSerializer::FromHeader(system, snapshot);
+    operating_system[sizeof(operating_system) - 1] = '\0';
+    kernel[sizeof(kernel) - 1] = '\0';
+    snapshot.operating_system = operating_system;
+    snapshot.kernel = kernel;
+    return before;
+  }
+  return 0;
+}
+
+// -----------------------------
+// ShmAttach Implementation
+ShmAttach::ShmAttach(ShmReader &reader, snapshot::SnapshotPublisher &publisher,
+                     std::chrono::milliseconds poll)
+    : reader_(reader), publisher_(publisher), poll_(poll)
+{
+}
+
+ShmAttach::~ShmAttach() { Stop(); }
+
+void ShmAttach::Start()
+{
+  if (running_.exchange(true))
+  {
+    return;
+  }
+  thread_ = std::thread(&ShmAttach::Run, this);
+}
+
+void ShmAttach::Stop()
+{
+  running_ = false;
+  if (thread_.joinable())
+  {
+    thread_.join();
+  }
+}
+
+void ShmAttach::Run()
+{
+  BlockStopSignals();
+  std::uint64_t seen = 0;
+  while (running_)
+  {
+    // Checking for a new tick is one load from the mapping
+    if (reader_.Sequence() != seen)
+    {
+      auto snapshot = std::make_unique<snapshot::SystemSnapshot>();
+      // Remember the sequence the copy was validated against, a tick
+      // published after it must still look new on the next poll
+      std::uint64_t sequence = reader_.Read(*snapshot);
+      if (sequence != 0)
+      {
+        seen = sequence;
+        publisher_.Publish(std::move(snapshot));
+      }
+    }
+    std::this_thread::sleep_for(poll_);
+  }
+}
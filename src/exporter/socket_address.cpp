@@ -0,0 +1,134 @@
+#include "exporter/socket_address.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+using namespace exporter;
+
+namespace
+{
+typedef struct SocketAddress
+{
+  sockaddr_storage storage;
+  socklen_t length;
+  int family;
+} socket_address_t;
+
+socket_address_t Parse(const std::string &address)
+{
+  socket_address_t parsed{};
+  std::string const path = UnixPath(address);
+  if (address.compare(0, 5, "unix:") == 0)
+  {
+    sockaddr_un *addr = reinterpret_cast<sockaddr_un *>(&parsed.storage);
+    if (path.empty() || path.size() >= sizeof(addr->sun_path))
+    {
+      throw std::runtime_error("Invalid unix socket path: " + path);
+    }
+    addr->sun_family = AF_UNIX;
+    std::memcpy(addr->sun_path, path.c_str(), path.size() + 1);
+    parsed.length = sizeof(sockaddr_un);
+    parsed.family = AF_UNIX;
+    return parsed;
+  }
+  std::size_t colon = address.rfind(':');
+  sockaddr_in *addr = reinterpret_cast<sockaddr_in *>(&parsed.storage);
+  addr->sin_family = AF_INET;
+  std::string host =
+      colon == std::string::npos ? "127.0.0.1" : address.substr(0, colon);
+  std::string port_text =
+      colon == std::string::npos ? address : address.substr(colon + 1);
+  int port = 0;
+  auto result = std::from_chars(port_text.data(),
+                                port_text.data() + port_text.size(), port);
+  if (result.ec != std::errc() || port <= 0 || port > 65535 ||
+      inet_pton(AF_INET, host.c_str(), &addr->sin_addr) != 1)
+  {
+    throw std::runtime_error("Invalid socket address: " + address);
+  }
+  // The endpoints have no authentication, keep them off other interfaces
+  if ((ntohl(addr->sin_addr.s_addr) >> 24) != 127)
+  {
+    throw std::runtime_error("Socket address is not loopback: " + address);
+  }
+  addr->sin_port = htons(static_cast<std::uint16_t>(port));
+  parsed.length = sizeof(sockaddr_in);
+  parsed.family = AF_INET;
+  return parsed;
+}
+
+std::runtime_error SocketError(const std::string &what)
+{
+  return std::runtime_error(what + ": " + std::strerror(errno));
+}
+} // namespace
+
+std::string exporter::UnixPath(const std::string &address)
+{
+  return address.compare(0, 5, "unix:") == 0 ? address.substr(5)
+                                             : std::string();
+}
+
+int exporter::ListenOn(const std::string &address)
+{
+  socket_address_t const parsed = Parse(address);
+  int fd = socket(parsed.family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+  {
+    throw SocketError("Failed to bind " + address);
+  }
+  if (parsed.family == AF_UNIX)
+  {
+    // A stale socket file from a previous run would make bind fail
+    unlink(UnixPath(address).c_str());
+  }
+  else
+  {
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  }
+  if (bind(fd, reinterpret_cast<const sockaddr *>(&parsed.storage),
+           parsed.length) < 0)
+  {
+    std::runtime_error error = SocketError("Failed to bind " + address);
+    close(fd);
+    throw error;
+  }
+  if (listen(fd, SOMAXCONN) < 0)
+  {
+    std::runtime_error error = SocketError("Failed to listen on " + address);
+    close(fd);
+    throw error;
+  }
+  return fd;
+}
+
+int exporter::ConnectTo(const std::string &address)
+{
+  socket_address_t const parsed = Parse(address);
+  int fd = socket(parsed.family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+  {
+    return -1;
+  }
+  // Loopback and unix connects complete or fail right away
+  if (connect(fd, reinterpret_cast<const sockaddr *>(&parsed.storage),
+              parsed.length) < 0)
+  {
+    int const error = errno;
+    close(fd);
+    errno = error;
+    return -1;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  return fd;
+}
@@ -1,11 +1,44 @@
+#include <cstdio>
 #include <string>
 
 #include "format.h"
 
 using std::string;
 
-// TODO: Complete this helper function
 // INPUT: Long int measuring seconds
 // OUTPUT: HH:MM:SS
-// REMOVE: [[maybe_unused]] once you define the function
-string Format::ElapsedTime(long seconds[[maybe_unused]]) { return string(); }
\ No newline at end of file
+string Format::ElapsedTime(long seconds) {
+  char buffer[32];
+  return string(buffer, ElapsedTime(seconds, buffer, sizeof(buffer)));
+}
+
+std::size_t Format::ElapsedTime(long seconds, char* buffer, std::size_t size) {
+  if (size == 0) return 0;
+  if (seconds < 0) seconds = 0;
+  long const hours = seconds / 3600;
+  long const minutes = (seconds % 3600) / 60;
+  long const secs = seconds % 60;
+  int const written =
+      std::snprintf(buffer, size, "%02ld:%02ld:%02ld", hours, minutes, secs);
+  if (written < 0) return 0;
+  return static_cast<std::size_t>(written) < size ? written : size - 1;
+}
+
+std::size_t Format::Duration(std::uint64_t nanoseconds, char* buffer,
+                             std::size_t size) {
+  if (size == 0) return 0;
+  double const value = static_cast<double>(nanoseconds);
+  int written;
+  if (nanoseconds < 1000) {
+    written = std::snprintf(buffer, size, "%lluns",
+                            static_cast<unsigned long long>(nanoseconds));
+  } else if (nanoseconds < 1000000) {
+    written = std::snprintf(buffer, size, "%.1fus", value / 1e3);
+  } else if (nanoseconds < 1000000000) {
+    written = std::snprintf(buffer, size, "%.2fms", value / 1e6);
+  } else {
+    written = std::snprintf(buffer, size, "%.2fs", value / 1e9);
+  }
+  if (written < 0) return 0;
+  return static_cast<std::size_t>(written) < size ? written : size - 1;
+}
@@ -24,12 +24,19 @@ void Logger::SetLogLevel(LogLevel level) {
     current_log_level = level;
 }
 
+void Logger::SetConsoleOutput(bool enabled) {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    console_output = enabled;
+}
+
 void Logger::Log(LogLevel level, const std::string& message) {
     std::lock_guard<std::mutex> lock(log_mutex);
     if (level >= current_log_level) {
         std::string log_entry = GetTimestamp() + " [" + LogLevelToString(level) + "] " + message;
         
-        std::cout << log_entry << std::endl; // Print to console
+        if (console_output) {
+            std::cout << log_entry << std::endl; // Print to console
+        }
         if (log_file.is_open()) {
             log_file << log_entry << std::endl; // Write to file
         }
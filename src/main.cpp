@@ -1,12 +1,130 @@
+#include <unistd.h>
+
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "exporter/agent.h"
+#include "exporter/aggregator.h"
+#include "exporter/batch_writer.h"
+#include "exporter/metrics_server.h"
+#include "exporter/shm_segment.h"
 #include "ncurses_display.h"
+#include "options.h"
+#include "snapshot/collector.h"
+#include "snapshot/pressure_monitor.h"
+#include "snapshot/process_filter.h"
+#include "snapshot/snapshot_publisher.h"
+#include "stop_signal.h"
 #include "system.h"
 #include "logger/logger_singletone.h"
 
 int main(int argc, char **argv) {
+  Options options;
+  std::shared_ptr<const snapshot::ProcessFilter> filter;
+  try {
+    options = ParseOptions(std::vector<std::string>(argv + 1, argv + argc));
+    if (!options.filter.empty()) {
+      filter = std::make_shared<const snapshot::ProcessFilter>(options.filter);
+    }
+  } catch (const std::invalid_argument& e) {
+    std::cerr << e.what() << "\n" << Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (options.help) {
+    std::cout << Usage(argv[0]);
+    return EXIT_SUCCESS;
+  }
 
+  bool const headless =
+      options.batch || !options.listen.empty() || !options.agent.empty();
   Logger& logger_ = Logger::GetInstance();
+  // Records may go to stdout, logs only go to the log file then
+  logger_.SetConsoleOutput(!headless);
   logger_.Log(LogLevel::INFO, "Starting System Monitor");
-  System system;
-  NCursesDisplay::Display(system);
-  return EXIT_SUCCESS;
-}
\ No newline at end of file
+  if (headless) InstallStopHandlers();
+
+  // One collector feeds every consumer of this process, an attached
+  // monitor takes its snapshots from another monitor's segment and an
+  // aggregator from the agents streaming to it instead
+  snapshot::SnapshotPublisher publisher;
+  std::unique_ptr<System> system;
+  std::unique_ptr<snapshot::Collector> collector;
+  std::unique_ptr<snapshot::PressureMonitor> pressure;
+  std::unique_ptr<exporter::ShmReader> shm_reader;
+  std::unique_ptr<exporter::ShmAttach> shm_attach;
+  std::unique_ptr<exporter::ShmWriter> shm_writer;
+  std::unique_ptr<exporter::MetricsServer> server;
+  std::unique_ptr<exporter::Aggregator> aggregator;
+  std::unique_ptr<exporter::Agent> agent;
+  try {
+    if (options.attach) {
+      shm_reader = std::make_unique<exporter::ShmReader>(options.shm_name);
+      shm_reader->Open();
+      shm_attach =
+          std::make_unique<exporter::ShmAttach>(*shm_reader, publisher);
+    } else if (!options.aggregate.empty()) {
+      aggregator = std::make_unique<exporter::Aggregator>(
+          publisher, options.aggregate, options.interval);
+      aggregator->Start();
+    } else {
+      system = std::make_unique<System>(options.io_uring);
+      collector = std::make_unique<snapshot::Collector>(
+          *system, publisher, options.interval, options.adaptive,
+          options.overhead_budget);
+      collector->Threads().SetFilter(options.threads);
+      collector->SetFilter(filter);
+      // PSI triggers publish a snapshot as soon as a stall begins
+      pressure = std::make_unique<snapshot::PressureMonitor>(
+          system->Pressure(), [&collector](std::size_t events) {
+            collector->OnPressureEvents(events);
+          });
+    }
+    if (options.shm) {
+      shm_writer =
+          std::make_unique<exporter::ShmWriter>(publisher, options.shm_name);
+      shm_writer->Start();
+    }
+    if (!options.listen.empty()) {
+      server =
+          std::make_unique<exporter::MetricsServer>(publisher, options.listen);
+      server->Start();
+    }
+    if (!options.agent.empty()) {
+      std::string name = options.source_name;
+      if (name.empty()) {
+        char host[256] = {};
+        gethostname(host, sizeof(host) - 1);
+        name = host;
+      }
+      agent = std::make_unique<exporter::Agent>(publisher, options.agent, name);
+      agent->Start();
+    }
+  } catch (const std::runtime_error& e) {
+    logger_.Log(LogLevel::FATAL, e.what());
+    std::cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+  if (collector) collector->Start();
+  if (pressure) pressure->Start();
+  if (shm_attach) shm_attach->Start();
+
+  int status = EXIT_SUCCESS;
+  if (options.batch) {
+    status = exporter::RunBatch(publisher, options);
+  } else if (server || agent) {
+    WaitForStopSignal();
+  } else {
+    NCursesDisplay::Display(publisher, collector.get());
+  }
+  if (pressure) pressure->Stop();
+  if (collector) collector->Stop();
+  if (shm_attach) shm_attach->Stop();
+  if (shm_writer) shm_writer->Stop();
+  if (server) server->Stop();
+  if (agent) agent->Stop();
+  if (aggregator) aggregator->Stop();
+  return status;
+}
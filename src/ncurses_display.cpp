@@ -1,60 +1,598 @@
 #include <curses.h>
-#include <chrono>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
 #include <string>
-#include <thread>
+#include <string_view>
 #include <vector>
 
 #include "format.h"
 #include "ncurses_display.h"
-#include "system.h"
+#include "snapshot/process_filter.h"
+#include "snapshot/process_tree.h"
+#include "snapshot/snapshot_publisher.h"
 
 using std::string;
-using std::to_string;
+
+namespace {
+// Scratch space reused by every cell of a frame
+constexpr std::size_t kCellBufferSize{512};
+// Threads listed below an expanded process
+constexpr int kThreadLines{8};
+
+std::size_t CopyText(char* buffer, std::size_t size, const char* text,
+                     std::size_t len) {
+  len = std::min(len, size);
+  std::memcpy(buffer, text, len);
+  return len;
+}
+
+template <typename T>
+std::size_t FormatInteger(char* buffer, std::size_t size, T value) {
+  auto result = std::to_chars(buffer, buffer + size, value);
+  return result.ec == std::errc() ? result.ptr - buffer : 0;
+}
+
+// Sort key shortcuts, returns true when the key changed the ordering
+bool SortKeyFor(int key, snapshot::SortKey& sort_key) {
+  snapshot::SortKey selected;
+  switch (key) {
+    case 'c':
+      selected = snapshot::SortKey::kCpu;
+      break;
+    case 'm':
+      selected = snapshot::SortKey::kRss;
+      break;
+    case 'i':
+      selected = snapshot::SortKey::kIoRate;
+      break;
+    case 's':
+      selected = snapshot::SortKey::kStartTime;
+      break;
+    case 'e':
+      selected = snapshot::SortKey::kEnergy;
+      break;
+    case 'f':
+      selected = snapshot::SortKey::kFds;
+      break;
+    default:
+      return false;
+  }
+  bool const changed = selected != sort_key;
+  sort_key = selected;
+  return changed;
+}
+
+// Reads a line typed on the bottom border of window, blocking until enter
+string Prompt(WINDOW* window, const char* label) {
+  int const row = getmaxy(window) - 1;
+  mvwhline(window, row, 1, ' ', getmaxx(window) - 2);
+  mvwaddstr(window, row, 2, label);
+  echo();
+  curs_set(1);
+  wtimeout(window, -1);
+  char line[256] = {};
+  wgetnstr(window, line, sizeof(line) - 1);
+  wtimeout(window, 100);
+  curs_set(0);
+  noecho();
+  return line;
+}
+
+// Redraws the bottom border of window with text set into it
+void ShowStatus(WINDOW* window, const string& text) {
+  box(window, 0, 0);
+  if (text.empty()) return;
+  string const padded = " " + text + " ";
+  mvwaddnstr(window, getmaxy(window) - 1, 2, padded.c_str(),
+             std::max(getmaxx(window) - 4, 0));
+}
+
+// Bottom border text: the ordering, the filter and the placement of
+// located processes
+string StatusLine(const snapshot::SystemSnapshot& system, const char* order) {
+  string status = string("sort: ") + order;
+  if (!system.filter.empty()) status += "  filter: " + system.filter;
+  for (const auto& placement : system.numa_placements) {
+    if (!status.empty()) status += "  ";
+    status += "pid " + std::to_string(placement.pid) + " on";
+    for (std::size_t node = 0; node < placement.node_kb.size(); ++node) {
+      if (placement.node_kb[node] == 0) continue;
+      status += " n" + std::to_string(node) + " " +
+                std::to_string(placement.node_kb[node] / 1024) + " MB";
+    }
+  }
+  return status;
+}
+
+// Lines the expanded threads of a snapshot take in the process list
+std::size_t ThreadLines(const snapshot::SystemSnapshot& system) {
+  std::size_t lines{0};
+  int shown{0};
+  for (std::size_t i = 0; i < system.threads.size(); ++i) {
+    if (i == 0 || system.threads[i].pid != system.threads[i - 1].pid) {
+      shown = 0;
+    }
+    if (shown++ < kThreadLines) ++lines;
+  }
+  return lines;
+}
+
+std::size_t FormatFixed(char* buffer, std::size_t size, float value,
+                        int precision) {
+  auto result = std::to_chars(buffer, buffer + size, value,
+                              std::chars_format::fixed, precision);
+  return result.ec == std::errc() ? result.ptr - buffer : 0;
+}
+}  // namespace
+
+// -----------------------------
+// FrameCache Implementation
+void NCursesDisplay::FrameCache::Reset(int rows, int cols) {
+  rows_ = std::max(rows, 0);
+  cols_ = std::max(cols, 0);
+  cells_.assign(static_cast<std::size_t>(rows_) * cols_, '\0');
+  attrs_.assign(cells_.size(), A_NORMAL);
+}
+
+// Forget the previous frame so the next one is emitted in full
+void NCursesDisplay::FrameCache::Invalidate() {
+  std::fill(cells_.begin(), cells_.end(), '\0');
+}
+
+bool NCursesDisplay::FrameCache::Put(WINDOW* window, int row, int col,
+                                     int width, const char* text,
+                                     std::size_t len, attr_t attr) {
+  if (row < 0 || row >= rows_ || col < 0 || col >= cols_) return false;
+  width = std::min(width, cols_ - col);
+  if (width <= 0) return false;
+  std::size_t const cell_width = static_cast<std::size_t>(width);
+  len = std::min(len, cell_width);
+
+  // Attributes are kept per character like the text, so a row mixing
+  // them, e.g. a highlighted selection, stays cached
+  std::size_t const offset = static_cast<std::size_t>(row) * cols_ + col;
+  char* cell = cells_.data() + offset;
+  attr_t* attrs = attrs_.data() + offset;
+  bool changed = std::memcmp(cell, text, len) != 0;
+  for (std::size_t i = len; !changed && i < cell_width; ++i) {
+    changed = cell[i] != ' ';
+  }
+  for (std::size_t i = 0; !changed && i < cell_width; ++i) {
+    changed = attrs[i] != attr;
+  }
+  if (!changed) return false;
+
+  std::memcpy(cell, text, len);
+  std::memset(cell + len, ' ', cell_width - len);
+  std::fill(attrs, attrs + cell_width, attr);
+  wattrset(window, attr);
+  mvwaddnstr(window, row, col, cell, width);
+  wattrset(window, A_NORMAL);
+  return true;
+}
+
+// -----------------------------
+// ProcessListView Implementation
+bool NCursesDisplay::ProcessListView::HandleKey(int key, std::size_t count,
+                                                std::size_t page) {
+  std::size_t const previous = selected_;
+  switch (key) {
+    case KEY_UP:
+    case 'k':
+      if (selected_ > 0) --selected_;
+      break;
+    case KEY_DOWN:
+    case 'j':
+      ++selected_;
+      break;
+    case KEY_PPAGE:
+      selected_ = selected_ > page ? selected_ - page : 0;
+      break;
+    case KEY_NPAGE:
+      selected_ += page;
+      break;
+    case KEY_HOME:
+    case 'g':
+      selected_ = 0;
+      break;
+    case KEY_END:
+    case 'G':
+      selected_ = count;
+      break;
+    default:
+      return false;
+  }
+  Clamp(count, page);
+  selected_pid_ = -1;
+  return selected_ != previous;
+}
+
+void NCursesDisplay::ProcessListView::Follow(
+    const std::vector<snapshot::ProcessRow>& processes,
+    const std::vector<std::uint32_t>& order, std::size_t page) {
+  auto pid_at = [&](std::size_t position) {
+    return position < order.size() ? processes[order[position]].pid : -1;
+  };
+  if (selected_pid_ >= 0 && pid_at(selected_) != selected_pid_) {
+    // Cheap path first, the pid usually stays at the same position
+    for (std::size_t i = 0; i < order.size(); ++i) {
+      if (pid_at(i) == selected_pid_) {
+        selected_ = i;
+        break;
+      }
+    }
+  }
+  Clamp(processes.size(), page);
+  selected_pid_ = pid_at(selected_);
+}
+
+void NCursesDisplay::ProcessListView::Clamp(std::size_t count,
+                                            std::size_t page) {
+  if (count == 0) {
+    top_ = selected_ = 0;
+    return;
+  }
+  selected_ = std::min(selected_, count - 1);
+  if (selected_ < top_) top_ = selected_;
+  if (page > 0 && selected_ >= top_ + page) top_ = selected_ - page + 1;
+  top_ = std::min(top_, count > page ? count - page : 0);
+}
+
+// -----------------------------
+// ProcessTreeView Implementation
+bool NCursesDisplay::ProcessTreeView::HandleKey(int key, int selected_pid) {
+  if (key == 't') {
+    enabled_ = !enabled_;
+    dirty_ = true;
+    return true;
+  }
+  if (key != ' ' || !enabled_ || selected_pid < 0) return false;
+  if (collapsed_.erase(selected_pid) == 0) collapsed_.insert(selected_pid);
+  dirty_ = true;
+  return true;
+}
+
+const std::vector<std::uint32_t>& NCursesDisplay::ProcessTreeView::Order(
+    const snapshot::SystemSnapshot& system) {
+  if (system.sequence == built_sequence_ && !dirty_) return order_;
+  // Pids that exited can not be expanded again, forget them
+  if (collapsed_.size() > system.processes.size()) collapsed_.clear();
+  snapshot::ProcessTree::Flatten(system.processes, collapsed_, order_,
+                                 depths_);
+  built_sequence_ = system.sequence;
+  dirty_ = false;
+  return order_;
+}
 
 // 50 bars uniformly displayed from 0 - 100 %
 // 2% is one bar(|)
+std::size_t NCursesDisplay::ProgressBar(float percent, char* buffer,
+                                        std::size_t size) {
+  constexpr int kBars{50};
+  // "0%" + bars + " " + "100.0" + "/100%"
+  constexpr std::size_t kLength{2 + kBars + 1 + 5 + 5};
+  if (size < kLength) return 0;
+
+  percent = std::clamp(percent, 0.0f, 1.0f);
+  int const filled = std::min(kBars, static_cast<int>(percent * kBars) + 1);
+  char* out = buffer;
+  out += CopyText(out, 2, "0%", 2);
+  std::memset(out, '|', filled);
+  std::memset(out + filled, ' ', kBars - filled);
+  out += kBars;
+  *out++ = ' ';
+
+  char number[8];
+  std::size_t number_len = FormatFixed(number, sizeof(number), percent * 100, 1);
+  std::size_t const pad = number_len < 5 ? 5 - number_len : 0;
+  std::memset(out, ' ', pad);
+  out += pad;
+  out += CopyText(out, number_len, number, number_len);
+  out += CopyText(out, 5, "/100%", 5);
+  return out - buffer;
+}
+
 std::string NCursesDisplay::ProgressBar(float percent) {
-  std::string result{"0%"};
-  int size{50};
-  float bars{percent * size};
+  char buffer[kCellBufferSize];
+  return string(buffer, ProgressBar(percent, buffer, sizeof(buffer)));
+}
+
+void NCursesDisplay::DisplaySystem(const snapshot::SystemSnapshot& system,
+                                   WINDOW* window, FrameCache& cache) {
+  static char buffer[kCellBufferSize];
+  int const label_column{2};
+  int const value_column{10};
+  int const width = cache.Cols() - 1;
+  int row{0};
+
+  auto put_line = [&](const char* label, const string& value) {
+    std::size_t len = CopyText(buffer, sizeof(buffer), label, std::strlen(label));
+    len += CopyText(buffer + len, sizeof(buffer) - len, value.data(),
+                    value.size());
+    cache.Put(window, ++row, label_column, width - label_column, buffer, len);
+  };
+  auto put_count = [&](const char* label, long value) {
+    std::size_t len = CopyText(buffer, sizeof(buffer), label, std::strlen(label));
+    len += FormatInteger(buffer + len, sizeof(buffer) - len, value);
+    cache.Put(window, ++row, label_column, width - label_column, buffer, len);
+  };
+  auto put_bar = [&](const char* label, float percent) {
+    cache.Put(window, ++row, label_column, value_column - label_column, label,
+              std::strlen(label));
+    cache.Put(window, row, value_column, width - value_column, buffer,
+              ProgressBar(percent, buffer, sizeof(buffer)), COLOR_PAIR(1));
+  };
+
+  if (system.sources.empty()) {
+    put_line("OS: ", system.operating_system);
+  } else {
+    // An aggregator shows its agents where a single host shows its OS
+    long connected{0};
+    for (const auto& source : system.sources) {
+      connected += source.connected ? 1 : 0;
+    }
+    std::size_t len = CopyText(buffer, sizeof(buffer), "Sources: ", 9);
+    len += FormatInteger(buffer + len, sizeof(buffer) - len, connected);
+    len += CopyText(buffer + len, sizeof(buffer) - len, "/", 1);
+    len += FormatInteger(buffer + len, sizeof(buffer) - len,
+                         static_cast<long>(system.sources.size()));
+    len += CopyText(buffer + len, sizeof(buffer) - len, " connected", 10);
+    cache.Put(window, ++row, label_column, width - label_column, buffer, len);
+  }
+  put_line("Kernel: ", system.kernel);
+  put_bar("CPU: ", system.cpu_utilization);
+  put_bar("Memory: ", system.memory_utilization);
+  if (system.filter.empty()) {
+    put_count("Total Processes: ", system.total_processes);
+  } else {
+    std::size_t len = CopyText(buffer, sizeof(buffer), "Total Processes: ", 17);
+    len += FormatInteger(buffer + len, sizeof(buffer) - len,
+                         system.total_processes);
+    len += CopyText(buffer + len, sizeof(buffer) - len, ", matching: ", 12);
+    len += FormatInteger(buffer + len, sizeof(buffer) - len,
+                         system.processes.size());
+    cache.Put(window, ++row, label_column, width - label_column, buffer, len);
+  }
+  put_count("Running Processes: ", system.running_processes);
+
+  std::size_t len = CopyText(buffer, sizeof(buffer), "Up Time: ", 9);
+  len += Format::ElapsedTime(system.uptime, buffer + len,
+                             sizeof(buffer) - len);
+  len += CopyText(buffer + len, sizeof(buffer) - len, "  Load:", 7);
+  for (float load : {system.metrics.load1, system.metrics.load5,
+                     system.metrics.load15}) {
+    len += CopyText(buffer + len, sizeof(buffer) - len, " ", 1);
+    len += FormatFixed(buffer + len, sizeof(buffer) - len, load, 2);
+  }
+  cache.Put(window, ++row, label_column, width - label_column, buffer, len);
+
+  // Tasks waiting for a CPU across all run queues
+  len = CopyText(buffer, sizeof(buffer), "Run Queue: ", 11);
+  if (system.run_queues.empty()) {
+    len += CopyText(buffer + len, sizeof(buffer) - len, "n/a", 3);
+  } else {
+    double waiting{0.0};
+    double slowest{0.0};
+    for (const auto& queue : system.run_queues) {
+      waiting += queue.waiting;
+      slowest = std::max(slowest, queue.avg_wait_ns);
+    }
+    len += FormatFixed(buffer + len, sizeof(buffer) - len, waiting, 2);
+    len += CopyText(buffer + len, sizeof(buffer) - len, " waiting  worst ", 16);
+    len += Format::Duration(static_cast<std::uint64_t>(slowest), buffer + len,
+                            sizeof(buffer) - len);
+    len += CopyText(buffer + len, sizeof(buffer) - len, " per slice", 10);
+  }
+  cache.Put(window, ++row, label_column, width - label_column, buffer, len);
+
+  // Interrupts per second on all CPUs, then the busiest CPU and what
+  // keeps it busy
+  len = CopyText(buffer, sizeof(buffer), "Interrupts: ", 12);
+  if (system.interrupts.empty()) {
+    len += CopyText(buffer + len, sizeof(buffer) - len, "n/a", 3);
+  } else {
+    double hard{0.0};
+    double soft{0.0};
+    const snapshot::CpuInterrupts* busiest = &system.interrupts.front();
+    for (const auto& cpu : system.interrupts) {
+      hard += cpu.hard_rate;
+      soft += cpu.soft_rate;
+      if (cpu.hard_rate + cpu.soft_rate >
+          busiest->hard_rate + busiest->soft_rate) {
+        busiest = &cpu;
+      }
+    }
+    len += FormatInteger(buffer + len, sizeof(buffer) - len,
+                         std::lround(hard));
+    len += CopyText(buffer + len, sizeof(buffer) - len, " hard ", 6);
+    len += FormatInteger(buffer + len, sizeof(buffer) - len,
+                         std::lround(soft));
+    len += CopyText(buffer + len, sizeof(buffer) - len, " soft/s  busiest cpu",
+                    20);
+    len += FormatInteger(buffer + len, sizeof(buffer) - len, busiest->cpu);
+    if (busiest->top[0] >= 0) {
+      // A hard IRQ is named by its device, the last word of its description
+      const snapshot::InterruptSource& source =
+          system.interrupt_sources[busiest->top[0]];
+      std::string_view label = source.name;
+      std::size_t const space = source.description.find_last_of(' ');
+      if (!source.soft && !source.description.empty()) {
+        label = std::string_view(source.description)
+                    .substr(space == std::string::npos ? 0 : space + 1);
+      }
+      len += CopyText(buffer + len, sizeof(buffer) - len, " ", 1);
+      len += CopyText(buffer + len, sizeof(buffer) - len, label.data(),
+                      label.size());
+      len += CopyText(buffer + len, sizeof(buffer) - len, " ", 1);
+      len += FormatInteger(buffer + len, sizeof(buffer) - len,
+                           std::lround(busiest->top_rate[0]));
+      len += CopyText(buffer + len, sizeof(buffer) - len, "/s", 2);
+    }
+  }
+  cache.Put(window, ++row, label_column, width - label_column, buffer, len);
+
+  // CPU load and free memory of each node, misses are pages that had to
+  // come from another node than the preferred one
+  len = CopyText(buffer, sizeof(buffer), "NUMA: ", 6);
+  if (system.numa_nodes.empty()) {
+    len += CopyText(buffer + len, sizeof(buffer) - len, "n/a", 3);
+  }
+  for (const auto& node : system.numa_nodes) {
+    if (&node != &system.numa_nodes.front()) {
+      len += CopyText(buffer + len, sizeof(buffer) - len, "  ", 2);
+    }
+    len += CopyText(buffer + len, sizeof(buffer) - len, "n", 1);
+    len += FormatInteger(buffer + len, sizeof(buffer) - len, node.node);
+    len += CopyText(buffer + len, sizeof(buffer) - len, " ", 1);
+    len += FormatFixed(buffer + len, sizeof(buffer) - len,
+                       node.cpu_utilization * 100, 0);
+    len += CopyText(buffer + len, sizeof(buffer) - len, "% ", 2);
+    len += FormatFixed(buffer + len, sizeof(buffer) - len,
+                       node.free_kb / 1048576.0f, 1);
+    len += CopyText(buffer + len, sizeof(buffer) - len, "/", 1);
+    len += FormatFixed(buffer + len, sizeof(buffer) - len,
+                       node.total_kb / 1048576.0f, 1);
+    len += CopyText(buffer + len, sizeof(buffer) - len, " GB free", 8);
+    if (node.miss_rate > 0.0f) {
+      len += CopyText(buffer + len, sizeof(buffer) - len, " miss ", 6);
+      len += FormatInteger(buffer + len, sizeof(buffer) - len,
+                           std::lround(node.miss_rate));
+      len += CopyText(buffer + len, sizeof(buffer) - len, "/s", 2);
+    }
+  }
+  cache.Put(window, ++row, label_column, width - label_column, buffer, len);
+
+  // Busiest cgroup below the root, counters include its descendants
+  len = CopyText(buffer, sizeof(buffer), "Cgroups: ", 9);
+  const snapshot::CgroupRow* busiest{nullptr};
+  for (const auto& cgroup : system.cgroups) {
+    if (cgroup.path != "/" &&
+        (busiest == nullptr ||
+         cgroup.cpu_utilization > busiest->cpu_utilization)) {
+      busiest = &cgroup;
+    }
+  }
+  if (system.cgroups.empty()) {
+    len += CopyText(buffer + len, sizeof(buffer) - len, "n/a", 3);
+  } else {
+    len += FormatInteger(buffer + len, sizeof(buffer) - len,
+                         system.cgroups.size());
+    if (busiest != nullptr) {
+      len += CopyText(buffer + len, sizeof(buffer) - len, "  busiest ", 10);
+      len += CopyText(buffer + len, sizeof(buffer) - len,
+                      busiest->path.data(), busiest->path.size());
+      len += CopyText(buffer + len, sizeof(buffer) - len, " ", 1);
+      len += FormatFixed(buffer + len, sizeof(buffer) - len,
+                         busiest->cpu_utilization, 2);
+      len += CopyText(buffer + len, sizeof(buffer) - len, " CPUs ", 6);
+      len += FormatInteger(buffer + len, sizeof(buffer) - len,
+                           busiest->memory_kb / 1024);
+      len += CopyText(buffer + len, sizeof(buffer) - len, " MB", 3);
+    }
+  }
+  cache.Put(window, ++row, label_column, width - label_column, buffer, len);
 
-  for (int i{0}; i < size; ++i) {
-    result += i <= bars ? '|' : ' ';
+  // Process closest to its descriptor limit, or with the most descriptors
+  len = CopyText(buffer, sizeof(buffer), "Descriptors: ", 13);
+  long open_fds{0};
+  const snapshot::ProcessRow* fullest{nullptr};
+  auto share = [](const snapshot::ProcessRow& process) {
+    return process.fd_limit > 0
+               ? static_cast<double>(process.fds) / process.fd_limit
+               : 0.0;
+  };
+  for (const auto& process : system.processes) {
+    if (process.fds < 0) continue;
+    open_fds += process.fds;
+    if (fullest == nullptr || share(process) > share(*fullest) ||
+        (share(process) == share(*fullest) && process.fds > fullest->fds)) {
+      fullest = &process;
+    }
+  }
+  if (fullest == nullptr) {
+    len += CopyText(buffer + len, sizeof(buffer) - len, "n/a", 3);
+  } else {
+    len += FormatInteger(buffer + len, sizeof(buffer) - len, open_fds);
+    len += CopyText(buffer + len, sizeof(buffer) - len, " open  top ", 11);
+    len += FormatInteger(buffer + len, sizeof(buffer) - len, fullest->pid);
+    len += CopyText(buffer + len, sizeof(buffer) - len, " ", 1);
+    len += CopyText(buffer + len, sizeof(buffer) - len, fullest->comm,
+                    strnlen(fullest->comm, sizeof(fullest->comm)));
+    len += CopyText(buffer + len, sizeof(buffer) - len, " ", 1);
+    len += FormatInteger(buffer + len, sizeof(buffer) - len, fullest->fds);
+    if (fullest->fd_limit > 0) {
+      len += CopyText(buffer + len, sizeof(buffer) - len, "/", 1);
+      len += FormatInteger(buffer + len, sizeof(buffer) - len,
+                           fullest->fd_limit);
+    }
+    if (fullest->fd_sockets >= 0) {
+      len += CopyText(buffer + len, sizeof(buffer) - len, " sock ", 6);
+      len += FormatInteger(buffer + len, sizeof(buffer) - len,
+                           fullest->fd_sockets);
+      len += CopyText(buffer + len, sizeof(buffer) - len, " pipe ", 6);
+      len += FormatInteger(buffer + len, sizeof(buffer) - len,
+                           fullest->fd_pipes);
+      len += CopyText(buffer + len, sizeof(buffer) - len, " file ", 6);
+      len += FormatInteger(buffer + len, sizeof(buffer) - len,
+                           fullest->fd_files);
+    }
   }
+  cache.Put(window, ++row, label_column, width - label_column, buffer, len);
 
-  string display{to_string(percent * 100).substr(0, 4)};
-  if (percent < 0.1 || percent == 1.0)
-    display = " " + to_string(percent * 100).substr(0, 3);
-  return result + " " + display + "/100%";
+  // System-wide stall share over the last 10 seconds
+  len = CopyText(buffer, sizeof(buffer), "Pressure: ", 10);
+  bool any_pressure{false};
+  for (const auto& pressure : system.pressure) {
+    if (pressure.scope != "system") continue;
+    if (any_pressure) {
+      len += CopyText(buffer + len, sizeof(buffer) - len, "  ", 2);
+    }
+    any_pressure = true;
+    len += CopyText(buffer + len, sizeof(buffer) - len,
+                    pressure.resource.data(), pressure.resource.size());
+    len += CopyText(buffer + len, sizeof(buffer) - len, " ", 1);
+    len += FormatFixed(buffer + len, sizeof(buffer) - len,
+                       pressure.some_avg10, 1);
+    len += CopyText(buffer + len, sizeof(buffer) - len, "%", 1);
+  }
+  if (!any_pressure) {
+    len += CopyText(buffer + len, sizeof(buffer) - len, "n/a", 3);
+  } else if (system.pressure_events > 0) {
+    len += CopyText(buffer + len, sizeof(buffer) - len, "  events ", 9);
+    len += FormatInteger(buffer + len, sizeof(buffer) - len,
+                         static_cast<long>(system.pressure_events));
+  }
+  cache.Put(window, ++row, label_column, width - label_column, buffer, len);
+
+  // The monitor's own collection cycle, wakeup to publish
+  len = CopyText(buffer, sizeof(buffer), "Latency: ", 9);
+  for (const auto& latency : system.latencies) {
+    if (latency.name != "collection") continue;
+    auto put_duration = [&](const char* label, std::uint64_t nanoseconds) {
+      len += CopyText(buffer + len, sizeof(buffer) - len, label,
+                      std::strlen(label));
+      len += Format::Duration(nanoseconds, buffer + len, sizeof(buffer) - len);
+    };
+    put_duration("p50 ", latency.p50_ns);
+    put_duration("  p99 ", latency.p99_ns);
+    put_duration("  max ", latency.max_ns);
+  }
+  cache.Put(window, ++row, label_column, width - label_column, buffer, len);
 }
 
-void NCursesDisplay::DisplaySystem(System& system, WINDOW* window) {
-  int row{0};
-  mvwprintw(window, ++row, 2, ("OS: " + system.OperatingSystem()).c_str());
-  mvwprintw(window, ++row, 2, ("Kernel: " + system.Kernel()).c_str());
-  mvwprintw(window, ++row, 2, "CPU: ");
-  wattron(window, COLOR_PAIR(1));
-  mvwprintw(window, row, 10, "");
-  wprintw(window, ProgressBar(system.Cpu().Utilization()).c_str());
-  wattroff(window, COLOR_PAIR(1));
-  mvwprintw(window, ++row, 2, "Memory: ");
-  wattron(window, COLOR_PAIR(1));
-  mvwprintw(window, row, 10, "");
-  wprintw(window, ProgressBar(system.MemoryUtilization()).c_str());
-  wattroff(window, COLOR_PAIR(1));
-  mvwprintw(window, ++row, 2,
-            ("Total Processes: " + to_string(system.TotalProcesses())).c_str());
-  mvwprintw(
-      window, ++row, 2,
-      ("Running Processes: " + to_string(system.RunningProcesses())).c_str());
-  mvwprintw(window, ++row, 2,
-            ("Up Time: " + Format::ElapsedTime(system.UpTime())).c_str());
-  wrefresh(window);
-}
-
-void NCursesDisplay::DisplayProcesses(std::vector<Process>& processes,
-                                      WINDOW* window, int n) {
-                                        
+void NCursesDisplay::DisplayProcesses(const snapshot::SystemSnapshot& system,
+                                      WINDOW* window,
+                                      const std::vector<std::uint32_t>& order,
+                                      const ProcessListView& view,
+                                      const ProcessTreeView& tree,
+                                      snapshot::ProcessDetailCache& details,
+                                      FrameCache& cache) {
+  static char buffer[kCellBufferSize];
   int row{0};
   int const pid_column{2};
   int const user_column{9};
@@ -62,52 +600,235 @@ void NCursesDisplay::DisplayProcesses(std::vector<Process>& processes,
   int const ram_column{26};
   int const time_column{35};
   int const command_column{46};
-  int width = getmaxx(window);
-  wattron(window, COLOR_PAIR(2));
-  mvwprintw(window, ++row, pid_column, "PID");
-  mvwprintw(window, row, user_column, "USER");
-  mvwprintw(window, row, cpu_column, "CPU[%%]");
-  mvwprintw(window, row, ram_column, "RAM[MB]");
-  mvwprintw(window, row, time_column, "TIME+");
-  mvwprintw(window, row, command_column, "COMMAND");
-  wattroff(window, COLOR_PAIR(2));
-  int const num_processes = int(processes.size()) > n ? n : processes.size();
-  for (int i = 0; i < num_processes; ++i) {
-    mvwprintw(window, ++row, pid_column, to_string(processes[i].Pid()).c_str());
-    mvwprintw(window, row, user_column, processes[i].User().c_str());
-    float cpu = processes[i].CpuUtilization() * 100;
-    mvwprintw(window, row, cpu_column, to_string(cpu).substr(0, 4).c_str());
-    mvwprintw(window, row, ram_column, processes[i].Ram().c_str());
-    mvwprintw(window, row, time_column,
-              Format::ElapsedTime(processes[i].UpTime()).c_str());
-    mvwprintw(window, row, command_column,
-              processes[i].Command().substr(0, width - 46).c_str());
-  }
-}
-
-void NCursesDisplay::Display(System& system, int n) {
+  int const width = cache.Cols() - 1;
+  attr_t attr{COLOR_PAIR(2)};
+
+  auto put = [&](int column, int next_column, const char* text,
+                 std::size_t len) {
+    cache.Put(window, row, column, next_column - column, text, len, attr);
+  };
+
+  ++row;
+  put(pid_column, user_column, "PID", 3);
+  put(user_column, cpu_column, "USER", 4);
+  // Tree mode shows the totals of each subtree
+  if (tree.Enabled()) {
+    put(cpu_column, ram_column, "CPU[%]+", 7);
+    put(ram_column, time_column, "RAM[MB]+", 8);
+  } else {
+    put(cpu_column, ram_column, "CPU[%]", 6);
+    put(ram_column, time_column, "RAM[MB]", 7);
+  }
+  put(time_column, command_column, "TIME+", 5);
+  put(command_column, width, "COMMAND", 7);
+
+  // Only the visible slice is formatted, details are resolved for it alone
+  std::vector<snapshot::ProcessRow> const& processes = system.processes;
+  std::size_t const page = std::max(cache.Rows() - 3, 0);
+  std::size_t i = view.Top();
+  for (std::size_t line = 0; line < page; ++line, ++i) {
+    ++row;
+    attr = i == view.Selected() ? A_REVERSE : A_NORMAL;
+    if (i >= order.size()) {
+      // Blank rows left over from a longer list in the previous frame
+      attr = A_NORMAL;
+      put(pid_column, width, "", 0);
+      continue;
+    }
+    snapshot::ProcessRow const& process = processes[order[i]];
+    snapshot::ProcessDetails const& detail =
+        details.Get(process, system.sequence);
+    put(pid_column, user_column, buffer,
+        FormatInteger(buffer, sizeof(buffer), process.pid));
+    // Rows streamed from an agent name their host instead of a user
+    std::string_view const user =
+        process.source > 0 &&
+                process.source <= static_cast<int>(system.sources.size())
+            ? std::string_view(system.sources[process.source - 1].name)
+            : detail.user;
+    put(user_column, cpu_column, user.data(), user.size());
+    if (tree.Enabled()) {
+      put(cpu_column, ram_column, buffer,
+          FormatFixed(buffer, sizeof(buffer),
+                      process.subtree.cpu_utilization * 100, 1));
+      put(ram_column, time_column, buffer,
+          FormatInteger(buffer, sizeof(buffer), process.subtree.rss_kb / 1024));
+    } else {
+      put(cpu_column, ram_column, buffer,
+          FormatFixed(buffer, sizeof(buffer), process.cpu_utilization * 100, 1));
+      put(ram_column, time_column, buffer,
+          FormatInteger(buffer, sizeof(buffer), detail.ram_mb));
+    }
+    put(time_column, command_column, buffer,
+        Format::ElapsedTime(process.uptime, buffer, sizeof(buffer)));
+    if (tree.Enabled()) {
+      // Two columns per level, then + for a collapsed subtree, - for an
+      // expanded one
+      std::size_t len = std::min<std::size_t>(2 * tree.Depth(i), 40);
+      std::memset(buffer, ' ', len);
+      char const marker = process.subtree.processes <= 1 ? ' '
+                          : tree.Collapsed(process.pid) ? '+'
+                                                        : '-';
+      buffer[len++] = marker;
+      buffer[len++] = ' ';
+      len += CopyText(buffer + len, sizeof(buffer) - len,
+                      detail.command.data(), detail.command.size());
+      put(command_column, width, buffer, len);
+    } else {
+      put(command_column, width, detail.command.data(), detail.command.size());
+    }
+
+    // Busiest threads of an expanded process take the following lines
+    auto thread = std::lower_bound(
+        system.threads.begin(), system.threads.end(), process.pid,
+        [](const snapshot::ThreadRow& a, int pid) { return a.pid < pid; });
+    attr = A_NORMAL;
+    for (int shown = 0; shown < kThreadLines && line + 1 < page &&
+                        thread != system.threads.end() &&
+                        thread->pid == process.pid;
+         ++shown, ++thread) {
+      ++line;
+      ++row;
+      put(pid_column, user_column, buffer,
+          FormatInteger(buffer, sizeof(buffer), thread->tid));
+      put(user_column, cpu_column, &thread->state, 1);
+      put(cpu_column, ram_column, buffer,
+          FormatFixed(buffer, sizeof(buffer), thread->cpu_utilization * 100, 1));
+      std::size_t len = CopyText(buffer, sizeof(buffer), "cpu ", 4);
+      len += FormatInteger(buffer + len, sizeof(buffer) - len,
+                           thread->processor);
+      put(ram_column, time_column, buffer, len);
+      put(time_column, command_column, "", 0);
+      len = CopyText(buffer, sizeof(buffer), "  `- ", 5);
+      len += CopyText(buffer + len, sizeof(buffer) - len, thread->comm,
+                      strnlen(thread->comm, sizeof(thread->comm)));
+      put(command_column, width, buffer, len);
+    }
+  }
+}
+
+void NCursesDisplay::Display(snapshot::SnapshotPublisher& publisher,
+                             snapshot::Collector* collector, int n) {
+  snapshot::SnapshotPublisher::Reader reader(publisher);
+
   initscr();      // start ncurses
   noecho();       // do not print input values
   cbreak();       // terminate ncurses on ctrl + c
   start_color();  // enable color
+  curs_set(0);
+  init_pair(1, COLOR_BLUE, COLOR_BLACK);
+  init_pair(2, COLOR_GREEN, COLOR_BLACK);
+  refresh();
 
   int x_max{getmaxx(stdscr)};
-  WINDOW* system_window = newwin(9, x_max - 1, 0, 0);
+  WINDOW* system_window = newwin(16, x_max - 1, 0, 0);
   int height = getmaxy(system_window);
+  int const rows = std::max(n, getmaxy(stdscr) - height - 4);
   WINDOW* process_window =
-      newwin(3 + n, x_max - 1, height + 1, 0);
-
-  while (1) {
-    init_pair(1, COLOR_BLUE, COLOR_BLACK);
-    init_pair(2, COLOR_GREEN, COLOR_BLACK);
-    box(system_window, 0, 0);
-    box(process_window, 0, 0);
-    DisplaySystem(system, system_window);
-    DisplayProcesses(system.Processes(), process_window, n);
-    wrefresh(system_window);
-    wrefresh(process_window);
-    refresh();
-    std::this_thread::sleep_for(std::chrono::seconds(1));
+      newwin(3 + rows, x_max - 1, height + 1, 0);
+  // Keyboard is polled between frames, rendering never waits on collection
+  wtimeout(process_window, 100);
+  keypad(process_window, TRUE);
+
+  // Borders never change, draw them once and let the caches handle the rest
+  box(system_window, 0, 0);
+  box(process_window, 0, 0);
+  FrameCache system_cache;
+  FrameCache process_cache;
+  system_cache.Reset(getmaxy(system_window), getmaxx(system_window));
+  process_cache.Reset(getmaxy(process_window), getmaxx(process_window));
+
+  ProcessListView view;
+  ProcessTreeView tree;
+  snapshot::ProcessDetailCache details;
+  snapshot::TopNSelector selector;
+  snapshot::SortKey sort_key{snapshot::SortKey::kCpu};
+  std::uint64_t rendered_sequence{0};
+  std::size_t process_count{0};
+  int selected_pid{-1};
+  std::size_t page = rows;
+  string shown_status;
+  bool moved{false};
+  bool quit{false};
+  while (!quit) {
+    {
+      auto snapshot = reader.Acquire();
+      bool const fresh = snapshot->sequence != rendered_sequence;
+      // Rank just enough rows to fill the page the view is looking at,
+      // the tree lists every row that is not collapsed
+      auto rank = [&] {
+        return tree.Enabled() ? &tree.Order(*snapshot)
+                              : &selector.Select(snapshot->processes, sort_key,
+                                                 view.Top() + 2 * rows);
+      };
+      if (fresh) {
+        rendered_sequence = snapshot->sequence;
+        // Keep the selection on screen below expanded threads
+        page = rows - std::min<std::size_t>(rows / 2, ThreadLines(*snapshot));
+        view.Follow(snapshot->processes, *rank(), page);
+        details.Sweep(rendered_sequence);
+        DisplaySystem(*snapshot, system_window, system_cache);
+        wnoutrefresh(system_window);
+      }
+      if (fresh || moved) {
+        string const status = StatusLine(
+            *snapshot,
+            tree.Enabled() ? "TREE" : snapshot::SortKeyName(sort_key));
+        if (status != shown_status) {
+          shown_status = status;
+          ShowStatus(process_window, shown_status);
+        }
+        const auto& order = *rank();
+        process_count =
+            tree.Enabled() ? order.size() : snapshot->processes.size();
+        DisplayProcesses(*snapshot, process_window, order, view, tree, details,
+                         process_cache);
+        selected_pid = view.Selected() < order.size()
+                           ? snapshot->processes[order[view.Selected()]].pid
+                           : -1;
+        wnoutrefresh(process_window);
+        doupdate();
+      }
+    }
+    int const key = wgetch(process_window);
+    quit = key == 'q' || key == 'Q';
+    moved = view.HandleKey(key, process_count, page) ||
+            SortKeyFor(key, sort_key) || tree.HandleKey(key, selected_pid);
+    // Threads show up with the next snapshot that sampled them
+    if (key == 'x' && collector != nullptr && selected_pid >= 0) {
+      snapshot::ThreadSampler& threads = collector->Threads();
+      if (threads.Expanded(selected_pid)) {
+        threads.Collapse(selected_pid);
+      } else {
+        threads.Expand(selected_pid);
+      }
+    }
+    // numa_maps is read from the next NUMA sample on, until 'n' again
+    if (key == 'n' && collector != nullptr && selected_pid >= 0) {
+      snapshot::NumaSampler& numa = collector->Numa();
+      if (numa.Located(selected_pid)) {
+        numa.Forget(selected_pid);
+      } else {
+        numa.Locate(selected_pid);
+      }
+    }
+    // The filter takes effect with the next scan, an empty line clears it
+    if (key == '/' && collector != nullptr) {
+      string const expression = Prompt(process_window, "filter: ");
+      try {
+        collector->SetFilter(
+            expression.empty()
+                ? nullptr
+                : std::make_shared<const snapshot::ProcessFilter>(expression));
+        ShowStatus(process_window,
+                   expression.empty() ? "" : "filter: " + expression);
+      } catch (const std::invalid_argument& e) {
+        ShowStatus(process_window, e.what());
+      }
+      moved = true;
+    }
   }
+  delwin(system_window);
+  delwin(process_window);
   endwin();
 }
@@ -0,0 +1,156 @@
+#include "options.h"
+
+#include <charconv>
+#include <stdexcept>
+
+namespace {
+long ParseNumber(const std::string& flag, const std::string& value) {
+  long number = 0;
+  auto result =
+      std::from_chars(value.data(), value.data() + value.size(), number);
+  if (result.ec != std::errc() || result.ptr != value.data() + value.size() ||
+      number < 0) {
+    throw std::invalid_argument("Invalid value for " + flag + ": " + value);
+  }
+  return number;
+}
+
+// Percent of one core, returned as a share
+double ParsePercent(const std::string& flag, const std::string& value) {
+  double percent = 0.0;
+  auto result =
+      std::from_chars(value.data(), value.data() + value.size(), percent);
+  if (result.ec != std::errc() || result.ptr != value.data() + value.size() ||
+      percent <= 0.0) {
+    throw std::invalid_argument("Invalid value for " + flag + ": " + value);
+  }
+  return percent / 100.0;
+}
+
+RecordFormat ParseFormat(const std::string& value) {
+  if (value == "jsonl" || value == "json") return RecordFormat::kJsonLines;
+  if (value == "csv") return RecordFormat::kCsv;
+  if (value == "binary") return RecordFormat::kBinary;
+  throw std::invalid_argument("Unknown format: " + value);
+}
+}  // namespace
+
+Options ParseOptions(const std::vector<std::string>& args) {
+  Options options;
+  for (std::size_t i = 0; i < args.size(); ++i) {
+    const std::string& arg = args[i];
+    // Flags taking a value accept both "--flag value" and "--flag=value"
+    std::string flag = arg;
+    std::string value;
+    bool inline_value = false;
+    std::size_t equals = arg.find('=');
+    if (arg.compare(0, 2, "--") == 0 && equals != std::string::npos) {
+      flag = arg.substr(0, equals);
+      value = arg.substr(equals + 1);
+      inline_value = true;
+    }
+    auto next_value = [&]() -> const std::string& {
+      if (inline_value) return value;
+      if (i + 1 >= args.size()) {
+        throw std::invalid_argument("Missing value for " + flag);
+      }
+      return args[++i];
+    };
+
+    if (flag == "--batch") {
+      options.batch = true;
+    } else if (flag == "--format") {
+      options.format = ParseFormat(next_value());
+    } else if (flag == "--output" || flag == "-o") {
+      options.output = next_value();
+    } else if (flag == "--interval") {
+      options.interval = std::chrono::milliseconds(ParseNumber(flag, next_value()));
+      if (options.interval.count() == 0) {
+        throw std::invalid_argument("--interval must be positive");
+      }
+    } else if (flag == "--fixed-interval") {
+      options.adaptive = false;
+    } else if (flag == "--overhead-budget") {
+      options.overhead_budget = ParsePercent(flag, next_value());
+    } else if (flag == "--count") {
+      options.count = ParseNumber(flag, next_value());
+    } else if (flag == "--listen") {
+      options.listen = next_value();
+    } else if (flag == "--shm") {
+      options.shm = true;
+    } else if (flag == "--attach") {
+      options.attach = true;
+    } else if (flag == "--shm-name") {
+      options.shm_name = next_value();
+      if (options.shm_name.size() < 2 || options.shm_name[0] != '/') {
+        throw std::invalid_argument("--shm-name must look like /name");
+      }
+    } else if (flag == "--threads") {
+      options.threads = next_value();
+    } else if (flag == "--io-uring") {
+      options.io_uring = true;
+    } else if (flag == "--filter") {
+      options.filter = next_value();
+    } else if (flag == "--agent") {
+      options.agent = next_value();
+    } else if (flag == "--aggregate") {
+      options.aggregate = next_value();
+    } else if (flag == "--source-name") {
+      options.source_name = next_value();
+    } else if (flag == "--help" || flag == "-h") {
+      options.help = true;
+    } else {
+      throw std::invalid_argument("Unknown argument: " + arg);
+    }
+  }
+  // Records of a batch are samples of one fixed period
+  if (options.batch) options.adaptive = false;
+  if (options.shm && options.attach) {
+    throw std::invalid_argument("--shm and --attach are exclusive");
+  }
+  if (options.attach && !options.filter.empty()) {
+    throw std::invalid_argument("--filter needs a collector, not --attach");
+  }
+  if (!options.aggregate.empty()) {
+    if (options.attach || !options.agent.empty()) {
+      throw std::invalid_argument(
+          "--aggregate is exclusive with --attach and --agent");
+    }
+    if (!options.filter.empty()) {
+      throw std::invalid_argument("--filter needs a collector, not --aggregate");
+    }
+  }
+  return options;
+}
+
+std::string Usage(const std::string& program) {
+  return "Usage: " + program + " [options]\n"
+         "  --batch              write one record per tick instead of the TUI\n"
+         "  --format FORMAT      jsonl (default), csv or binary\n"
+         "  --output, -o PATH    append records to PATH instead of stdout\n"
+         "  --interval MS        collection interval in milliseconds (1000)\n"
+         "  --fixed-interval     sample at --interval instead of adapting the\n"
+         "                       period to activity (always on with --batch)\n"
+         "  --overhead-budget P  CPU the monitor may use, percent of one core (1)\n"
+         "  --count N            stop after N records, 0 runs until signalled\n"
+         "  --listen ADDR        serve Prometheus metrics on 127.0.0.1:PORT or\n"
+         "                       unix:/path, headless unless --batch is given\n"
+         "  --shm                publish every snapshot into shared memory\n"
+         "  --attach             show snapshots of a monitor running with --shm\n"
+         "                       instead of reading /proc\n"
+         "  --shm-name NAME      shared-memory segment name (/green_sys)\n"
+         "  --threads TEXT       collect per-thread CPU of processes whose\n"
+         "                       command contains TEXT ('x' expands one in the TUI)\n"
+         "  --io-uring           read per-process files in batches through\n"
+         "                       io_uring, falls back to pread where missing\n"
+         "  --filter EXPR        list only matching processes, e.g.\n"
+         "                       'user=postgres && cpu>5 && cmd~\"worker\"'\n"
+         "                       ('/' edits it in the TUI)\n"
+         "  --agent ADDR         stream snapshots to an aggregator on\n"
+         "                       unix:/path or 127.0.0.1:PORT, headless\n"
+         "  --source-name NAME   name the aggregator shows for this agent\n"
+         "                       (the hostname)\n"
+         "  --aggregate ADDR     show the merged snapshots of the agents\n"
+         "                       streaming to ADDR instead of reading /proc\n"
+         "  --help, -h           show this help\n";
+}
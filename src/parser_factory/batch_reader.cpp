@@ -0,0 +1,409 @@
+#include "parser_factory/batch_reader.h"
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include "logger/logger_singletone.h"
+
+using namespace parser_factory;
+
+namespace
+{
+// An openat, a read and a close per file
+constexpr unsigned kOpsPerFile = 3;
+
+enum Op : std::uint64_t
+{
+  kOpen = 0,
+  kRead = 1,
+  kClose = 2
+};
+
+// No liburing, the three syscalls are all it takes
+int CreateRing(unsigned entries, io_uring_params *params)
+{
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int EnterRing(int fd, unsigned submit, unsigned wait)
+{
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd, submit, wait,
+                                  IORING_ENTER_GETEVENTS, nullptr, 0));
+}
+
+int RegisterRing(int fd, unsigned opcode, const void *arg, unsigned count)
+{
+  return static_cast<int>(
+      syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+} // namespace
+
+// -----------------------------
+// Mapped rings of one io_uring instance
+struct BatchReader::Ring
+{
+  int fd{-1};
+  void *sq_ring{MAP_FAILED};
+  std::size_t sq_ring_size{0};
+  void *cq_ring{MAP_FAILED};
+  std::size_t cq_ring_size{0};
+  io_uring_sqe *sqes{static_cast<io_uring_sqe *>(MAP_FAILED)};
+  std::size_t sqes_size{0};
+  unsigned *sq_tail{nullptr};
+  unsigned *sq_mask{nullptr};
+  unsigned *sq_array{nullptr};
+  unsigned *cq_head{nullptr};
+  unsigned *cq_tail{nullptr};
+  unsigned *cq_mask{nullptr};
+  io_uring_cqe *cqes{nullptr};
+
+  // Submits op alone and waits for it, returns its result
+  int RunOne(const io_uring_sqe &op)
+  {
+    unsigned tail = *sq_tail;
+    unsigned const index = tail & *sq_mask;
+    sqes[index] = op;
+    sq_array[index] = index;
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+    int result;
+    do
+    {
+      result = EnterRing(fd, 1, 1);
+    } while (result < 0 && errno == EINTR);
+    if (result < 0)
+    {
+      return -errno;
+    }
+    unsigned const head = *cq_head;
+    if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))
+    {
+      return -EAGAIN;
+    }
+    int const res = cqes[head & *cq_mask].res;
+    __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+    return res;
+  }
+
+  ~Ring()
+  {
+    if (sqes != MAP_FAILED)
+    {
+      munmap(sqes, sqes_size);
+    }
+    if (cq_ring != MAP_FAILED && cq_ring != sq_ring)
+    {
+      munmap(cq_ring, cq_ring_size);
+    }
+    if (sq_ring != MAP_FAILED)
+    {
+      munmap(sq_ring, sq_ring_size);
+    }
+    if (fd >= 0)
+    {
+      close(fd);
+    }
+  }
+};
+
+BatchReader::BatchReader(Backend backend, std::size_t slots,
+                         std::size_t slot_size)
+    : slots_(std::max<std::size_t>(slots, 1)),
+      slot_size_(std::max<std::size_t>(slot_size, 64)),
+      slab_(slots_ * slot_size_), paths_(slots_ * kPathSize),
+      lengths_(slots_), errors_(slots_)
+{
+  if (backend == Backend::kAuto && !SetupRing())
+  {
+    ring_.reset();
+    Logger::GetInstance().Log(LogLevel::INFO,
+                              "io_uring unavailable, reading with pread.");
+  }
+}
+
+BatchReader::~BatchReader() = default;
+
+bool BatchReader::SetupRing()
+{
+  ring_ = std::make_unique<Ring>();
+  Ring &ring = *ring_;
+  io_uring_params params{};
+  ring.fd = CreateRing(static_cast<unsigned>(slots_ * kOpsPerFile), &params);
+  if (ring.fd < 0)
+  {
+    return false; // ENOSYS, or disabled by kernel.io_uring_disabled
+  }
+  ring.sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring.cq_ring_size =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool const single = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single)
+  {
+    ring.sq_ring_size = ring.cq_ring_size =
+        std::max(ring.sq_ring_size, ring.cq_ring_size);
+  }
+  ring.sq_ring = mmap(nullptr, ring.sq_ring_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQ_RING);
+  if (ring.sq_ring == MAP_FAILED)
+  {
+    return false;
+  }
+  ring.cq_ring = single ? ring.sq_ring
+                        : mmap(nullptr, ring.cq_ring_size,
+                               PROT_READ | PROT_WRITE,
+                               MAP_SHARED | MAP_POPULATE, ring.fd,
+                               IORING_OFF_CQ_RING);
+  ring.sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+  void *sqes = mmap(nullptr, ring.sqes_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQES);
+  ring.sqes = static_cast<io_uring_sqe *>(sqes);
+  if (ring.cq_ring == MAP_FAILED || sqes == MAP_FAILED)
+  {
+    return false;
+  }
+  char *sq = static_cast<char *>(ring.sq_ring);
+  char *cq = static_cast<char *>(ring.cq_ring);
+  ring.sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+  ring.sq_mask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+  ring.sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+  ring.cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+  ring.cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+  ring.cq_mask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+  ring.cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+  // Opening into direct descriptors needs 5.15, older kernels fall back
+  std::vector<unsigned char> probe_space(sizeof(io_uring_probe) +
+                                         256 * sizeof(io_uring_probe_op));
+  auto *probe = reinterpret_cast<io_uring_probe *>(probe_space.data());
+  if (RegisterRing(ring.fd, IORING_REGISTER_PROBE, probe, 256) < 0)
+  {
+    return false;
+  }
+  for (unsigned opcode : {IORING_OP_OPENAT, IORING_OP_READ_FIXED,
+                          IORING_OP_CLOSE})
+  {
+    if (opcode > probe->last_op ||
+        !(probe->ops[opcode].flags & IO_URING_OP_SUPPORTED))
+    {
+      return false;
+    }
+  }
+  // One empty direct descriptor and one registered buffer per slot
+  std::vector<int> files(slots_, -1);
+  if (RegisterRing(ring.fd, IORING_REGISTER_FILES, files.data(),
+                   static_cast<unsigned>(slots_)) < 0)
+  {
+    return false;
+  }
+  std::vector<iovec> buffers(slots_);
+  for (std::size_t slot = 0; slot < slots_; ++slot)
+  {
+    buffers[slot] = {slab_.data() + slot * slot_size_, slot_size_};
+  }
+  if (RegisterRing(ring.fd, IORING_REGISTER_BUFFERS, buffers.data(),
+                   static_cast<unsigned>(slots_)) < 0)
+  {
+    return false;
+  }
+  return TrialRead();
+}
+
+bool BatchReader::TrialRead()
+{
+  // The probe only says the opcodes exist, file_index opens and closes
+  // came later. Run one file through them step by step so a kernel that
+  // ignores file_index is caught before a linked close could hit fd 0.
+  Ring &ring = *ring_;
+  static const char kTrialPath[] = "/proc/self/stat";
+  io_uring_sqe op{};
+  op.opcode = IORING_OP_OPENAT;
+  op.fd = AT_FDCWD;
+  op.addr = reinterpret_cast<std::uint64_t>(kTrialPath);
+  op.open_flags = O_RDONLY;
+  op.file_index = 1;
+  int const opened = ring.RunOne(op);
+  if (opened != 0)
+  {
+    if (opened > 0)
+    {
+      close(opened); // a plain descriptor, file_index was ignored
+    }
+    return false;
+  }
+  op = io_uring_sqe{};
+  op.opcode = IORING_OP_READ_FIXED;
+  op.flags = IOSQE_FIXED_FILE;
+  op.fd = 0;
+  op.addr = reinterpret_cast<std::uint64_t>(slab_.data());
+  op.len = static_cast<std::uint32_t>(slot_size_);
+  op.buf_index = 0;
+  int const length = ring.RunOne(op);
+  op = io_uring_sqe{};
+  op.opcode = IORING_OP_CLOSE;
+  op.file_index = 1;
+  int const closed = ring.RunOne(op);
+  return length > 0 && closed == 0;
+}
+
+void BatchReader::Read(std::size_t count, const PathFn &path,
+                       const DoneFn &done)
+{
+  for (std::size_t first = 0; first < count; first += slots_)
+  {
+    std::size_t const batch = std::min(slots_, count - first);
+    for (std::size_t slot = 0; slot < batch; ++slot)
+    {
+      char *name = paths_.data() + slot * kPathSize;
+      path(first + slot, name, kPathSize);
+      name[kPathSize - 1] = '\0';
+    }
+    if (ring_)
+    {
+      ReadUring(first, batch, done);
+    }
+    else
+    {
+      ReadSync(first, batch, done);
+    }
+  }
+}
+
+void BatchReader::ReadUring(std::size_t first, std::size_t count,
+                            const DoneFn &done)
+{
+  Ring &ring = *ring_;
+  unsigned tail = *ring.sq_tail;
+  for (std::size_t slot = 0; slot < count; ++slot)
+  {
+    lengths_[slot] = 0;
+    errors_[slot] = 0;
+    io_uring_sqe *ops[kOpsPerFile];
+    for (io_uring_sqe *&op : ops)
+    {
+      unsigned const index = tail & *ring.sq_mask;
+      op = &ring.sqes[index];
+      std::memset(op, 0, sizeof(*op));
+      ring.sq_array[index] = index;
+      ++tail;
+    }
+    // A failed open cancels the rest of the chain. The close is hard
+    // linked so a failed read still frees the descriptor.
+    ops[kOpen]->opcode = IORING_OP_OPENAT;
+    ops[kOpen]->flags = IOSQE_IO_LINK;
+    ops[kOpen]->fd = AT_FDCWD;
+    ops[kOpen]->addr =
+        reinterpret_cast<std::uint64_t>(paths_.data() + slot * kPathSize);
+    ops[kOpen]->open_flags = O_RDONLY;
+    ops[kOpen]->file_index = static_cast<std::uint32_t>(slot + 1);
+    ops[kRead]->opcode = IORING_OP_READ_FIXED;
+    ops[kRead]->flags = IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+    ops[kRead]->fd = static_cast<int>(slot);
+    ops[kRead]->addr =
+        reinterpret_cast<std::uint64_t>(slab_.data() + slot * slot_size_);
+    ops[kRead]->len = static_cast<std::uint32_t>(slot_size_);
+    ops[kRead]->buf_index = static_cast<std::uint16_t>(slot);
+    ops[kClose]->opcode = IORING_OP_CLOSE;
+    ops[kClose]->file_index = static_cast<std::uint32_t>(slot + 1);
+    for (std::uint64_t op = kOpen; op <= kClose; ++op)
+    {
+      ops[op]->user_data = (slot << 2) | op;
+    }
+  }
+  __atomic_store_n(ring.sq_tail, tail, __ATOMIC_RELEASE);
+
+  unsigned const total = static_cast<unsigned>(count * kOpsPerFile);
+  unsigned submitted = 0;
+  unsigned completed = 0;
+  while (completed < total)
+  {
+    int const result = EnterRing(ring.fd, total - submitted, total - completed);
+    ++syscalls_;
+    if (result < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+    {
+      // The ring is unusable, read the rest of this batch synchronously.
+      // Reads already submitted may still run on io-wq, reap them before
+      // the ring goes; ReadSync() never touches the registered slab.
+      Logger::GetInstance().Log(LogLevel::ERROR,
+                                "io_uring_enter failed: " +
+                                    std::string(std::strerror(errno)));
+      while (completed < submitted)
+      {
+        unsigned head = *ring.cq_head;
+        unsigned const cq_tail =
+            __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+        completed += cq_tail - head;
+        __atomic_store_n(ring.cq_head, cq_tail, __ATOMIC_RELEASE);
+        if (completed < submitted && EnterRing(ring.fd, 0, 1) < 0 &&
+            errno != EINTR)
+        {
+          break;
+        }
+      }
+      ring_.reset();
+      ReadSync(first, count, done);
+      return;
+    }
+    submitted += result > 0 ? static_cast<unsigned>(result) : 0;
+    unsigned head = *ring.cq_head;
+    unsigned const cq_tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != cq_tail; ++head, ++completed)
+    {
+      const io_uring_cqe &cqe = ring.cqes[head & *ring.cq_mask];
+      std::size_t const slot = cqe.user_data >> 2;
+      std::uint64_t const op = cqe.user_data & 3;
+      if (op == kOpen && cqe.res < 0)
+      {
+        errors_[slot] = -cqe.res; // over the read's ECANCELED
+      }
+      else if (op == kRead && cqe.res >= 0)
+      {
+        lengths_[slot] = cqe.res;
+      }
+      else if (op == kRead && errors_[slot] == 0)
+      {
+        errors_[slot] = -cqe.res;
+      }
+    }
+    __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+  }
+  for (std::size_t slot = 0; slot < count; ++slot)
+  {
+    done(first + slot,
+         std::string_view(slab_.data() + slot * slot_size_,
+                          errors_[slot] ? 0 : lengths_[slot]),
+         errors_[slot]);
+  }
+}
+
+void BatchReader::ReadSync(std::size_t first, std::size_t count,
+                           const DoneFn &done)
+{
+  // Not the slab, which a ring that failed may still have registered
+  sync_buffer_.resize(slot_size_);
+  char *buffer = sync_buffer_.data();
+  for (std::size_t slot = 0; slot < count; ++slot)
+  {
+    int const fd = open(paths_.data() + slot * kPathSize, O_RDONLY | O_CLOEXEC);
+    ++syscalls_;
+    if (fd < 0)
+    {
+      done(first + slot, std::string_view(), errno);
+      continue;
+    }
+    ssize_t const length = pread(fd, buffer, slot_size_, 0);
+    int const error = length < 0 ? errno : 0;
+    close(fd);
+    syscalls_ += 2;
+    done(first + slot,
+         std::string_view(buffer, length < 0 ? 0 : static_cast<std::size_t>(length)),
+         error);
+  }
+}
@@ -1,69 +1,229 @@
 #include "parser_factory/parser.h"
 
+#include <dirent.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <sys/inotify.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <charconv>
 #include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
 #include <iostream>
+#include <limits>
 #include <sstream>
+#include <string_view>
 #include <stdexcept>
 #include <thread>
 
+#include "format.h"
+#include "telemetry/latency.h"
+
 using namespace parser_factory;
 namespace fs = std::filesystem;
 
-// -----------------------------
-// CpuParser Implementation
-std::string CpuParser::GetCPUUsage()
+namespace
+{
+const char *SkipBlanks(const char *p, const char *end)
 {
-  const int num_samples = 5;
-  long total_time_diff = 0;
-  long active_time_diff = 0;
+  while (p < end && (*p == ' ' || *p == '\t'))
+  {
+    ++p;
+  }
+  return p;
+}
 
-  // Take multiple samples for averaging
-  for (int i = 0; i < num_samples; ++i)
+// Reads a whole file from its start through fd, opened on first use and
+// kept open. buffer grows until the file fits and keeps that size, so a
+// warm read allocates nothing. Returns the size read, -1 on failure.
+ssize_t ReadWhole(int &fd, const std::string &path, std::vector<char> &buffer)
+{
+  if (fd < 0)
   {
-    std::vector<cpu_data_t> old_cpu_data_list = GetCpuUtilization();
-    if (old_cpu_data_list.empty())
+    fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+      return -1;
+    }
+  }
+  if (buffer.empty())
+  {
+    buffer.resize(4096);
+  }
+  std::size_t size = 0;
+  while (true)
+  {
+    ssize_t const length =
+        pread(fd, buffer.data() + size, buffer.size() - size, size);
+    if (length < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (length < 0)
     {
-      logger_.Log(LogLevel::ERROR, "Failed to retrieve CPU data.");
+      return -1;
     }
+    if (length == 0)
+    {
+      break;
+    }
+    size += static_cast<std::size_t>(length);
+    if (size == buffer.size())
+    {
+      buffer.resize(buffer.size() * 2);
+    }
+  }
+  return static_cast<ssize_t>(size);
+}
 
-    std::this_thread::sleep_for(
-        std::chrono::milliseconds(500)); // Shorter sleep
+// Reads a file of a line or two from its start through fd, opened on
+// first use and kept open
+ssize_t ReadSmall(int &fd, const std::string &path, char *buffer,
+                  std::size_t size)
+{
+  if (fd < 0)
+  {
+    fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  }
+  return fd < 0 ? -1 : pread(fd, buffer, size, 0);
+}
 
-    std::vector<cpu_data_t> new_cpu_data_list = GetCpuUtilization();
-    if (new_cpu_data_list.empty())
+// Picks "key value" lines, e.g. of cpu.stat, memory.stat or /proc/stat
+void ParseFlatKeyed(const char *p, const char *end,
+                    std::initializer_list<std::pair<std::string_view,
+                                                    unsigned long long *>>
+                        keys)
+{
+  while (p < end)
+  {
+    const char *line_end = std::find(p, end, '\n');
+    const char *space = std::find(p, line_end, ' ');
+    std::string_view const key(p, space - p);
+    for (const auto &wanted : keys)
     {
-      logger_.Log(LogLevel::ERROR, "Failed to retrieve new CPU data.");
+      if (key == wanted.first && space < line_end)
+      {
+        std::from_chars(space + 1, line_end, *wanted.second);
+      }
     }
+    p = line_end + 1;
+  }
+}
 
-    long old_total_time = old_cpu_data_list.front().getTotalJiffies();
-    long old_active_time = old_cpu_data_list.front().getActiveJiffies();
-    long new_total_time = new_cpu_data_list.front().getTotalJiffies();
-    long new_active_time = new_cpu_data_list.front().getActiveJiffies();
-
-    if (new_total_time == old_total_time)
+// Picks "Key:   value kB" lines of meminfo files, the key is the last word
+// before the colon so the "Node 0 " prefix of a node's meminfo is skipped
+void ParseColonKeyed(const char *p, const char *end,
+                     std::initializer_list<std::pair<std::string_view,
+                                                     unsigned long long *>>
+                         keys)
+{
+  while (p < end)
+  {
+    const char *line_end = std::find(p, end, '\n');
+    const char *colon = std::find(p, line_end, ':');
+    const char *key = colon;
+    while (key > p && key[-1] != ' ')
+    {
+      --key;
+    }
+    std::string_view const name(key, colon - key);
+    for (const auto &wanted : keys)
     {
-      logger_.Log(
-          LogLevel::INFO,
-          "Total time difference is zero, unable to calculate CPU usage.");
+      if (name == wanted.first && colon < line_end)
+      {
+        std::from_chars(SkipBlanks(colon + 1, line_end), line_end,
+                        *wanted.second);
+      }
     }
+    p = line_end + 1;
+  }
+}
+} // namespace
+
+// -----------------------------
+// CpuParser Implementation
+CpuParser::~CpuParser()
+{
+  if (stat_fd_ >= 0)
+  {
+    close(stat_fd_);
+  }
+}
+
+bool CpuParser::Collect(metric_snapshot_t &metrics)
+{
+  telemetry::ScopedProbe probe(telemetry::Probe::kCpu);
+  ssize_t const size =
+      ReadWhole(stat_fd_, LinuxFilesSet.at("kStatFilename"), stat_buffer_);
+  if (size <= 0)
+  {
+    return false;
+  }
+  const char *p = stat_buffer_.data();
+  const char *const end = p + size;
 
-    total_time_diff += new_total_time - old_total_time;
-    active_time_diff += new_active_time - old_active_time;
+  // "cpu  4705 356 584 3699 23 23 0 0 0 0", guest time is part of user
+  const char *line_end = std::find(p, end, '\n');
+  if (line_end - p < 4 || std::strncmp(p, "cpu ", 4) != 0)
+  {
+    return false;
+  }
+  unsigned long long *const fields[] = {
+      &metrics.cpu_user,   &metrics.cpu_nice,   &metrics.cpu_system,
+      &metrics.cpu_idle,   &metrics.cpu_iowait, &metrics.cpu_irq,
+      &metrics.cpu_softirq, &metrics.cpu_steal};
+  const char *q = p + 3;
+  for (unsigned long long *field : fields)
+  {
+    q = SkipBlanks(q, line_end);
+    auto result = std::from_chars(q, line_end, *field);
+    *field = result.ec == std::errc() ? *field : 0;  // older kernels
+    q = result.ptr;
+  }
+  // One "cpuN" line per online CPU, then the counters
+  int cpus = 0;
+  for (p = line_end + 1; end - p > 3 && std::strncmp(p, "cpu", 3) == 0;
+       p = std::find(p, end, '\n') + 1)
+  {
+    ++cpus;
   }
+  metrics.cpu_count = cpus;
+  unsigned long long running = 0;
+  unsigned long long blocked = 0;
+  ParseFlatKeyed(p, end,
+                 {{"ctxt", &metrics.context_switches},
+                  {"processes", &metrics.forks},
+                  {"procs_running", &running},
+                  {"procs_blocked", &blocked}});
+  metrics.procs_running = static_cast<int>(running);
+  metrics.procs_blocked = static_cast<int>(blocked);
 
-  // Calculate average CPU usage
-  double cpu_utilization_percentage = (static_cast<double>(active_time_diff) /
-                                       static_cast<double>(total_time_diff)) *
-                                      100;
-  return std::to_string(cpu_utilization_percentage) + "%";
+  unsigned long long const busy = metrics.cpu_user + metrics.cpu_nice +
+                                  metrics.cpu_system + metrics.cpu_irq +
+                                  metrics.cpu_softirq + metrics.cpu_steal;
+  unsigned long long const total = busy + metrics.cpu_idle + metrics.cpu_iowait;
+  if (last_total_ == 0)
+  {
+    metrics.cpu_utilization = 0.0f;
+  }
+  else if (total > last_total_)
+  {
+    metrics.cpu_utilization = static_cast<float>(busy - last_busy_) /
+                              static_cast<float>(total - last_total_);
+  }
+  last_busy_ = busy;
+  last_total_ = total;
+  return true;
 }
 
 std::string CpuParser::GetCPUInfo()
 {
+  telemetry::ScopedProbe probe(telemetry::Probe::kCpu);
   // Implementation to retrieve CPU Info
   std::ifstream cpu_info_file(LinuxFilesSet.at("kCpuinfoFilename"));
   if (!cpu_info_file.is_open())
@@ -77,6 +237,7 @@ std::string CpuParser::GetCPUInfo()
 
 std::vector<cpu_data_t> CpuParser::GetCpuUtilization()
 {
+  telemetry::ScopedProbe probe(telemetry::Probe::kCpu);
   // Implementation to retrieve CPU utilization statistics
   if (!fs::exists(LinuxFilesSet.at("kStatFilename")))
   {
@@ -93,6 +254,8 @@ std::vector<cpu_data_t> CpuParser::GetCpuUtilization()
   {
     cpu_data_list_ = std::make_shared<std::vector<cpu_data_t>>();
   }
+  // Each call returns one fresh sample, not every sample taken so far
+  cpu_data_list_->clear();
   std::string rLine;
   while (std::getline(stat_file, rLine))
   {
@@ -107,6 +270,8 @@ std::vector<cpu_data_t> CpuParser::GetCpuUtilization()
           cpu_data_.idle >> cpu_data_.iowait >> cpu_data_.irq >>
           cpu_data_.softirq >> cpu_data_.steal >> cpu_data_.guest >>
           cpu_data_.guest_nice;
+      cpu_data_.cpu = -1;
+      std::from_chars(key.data() + 3, key.data() + key.size(), cpu_data_.cpu);
       cpu_data_list_->push_back(cpu_data_);
     }
     else
@@ -119,6 +284,7 @@ std::vector<cpu_data_t> CpuParser::GetCpuUtilization()
 
 long CpuParser::GetJiffies()
 {
+  telemetry::ScopedProbe probe(telemetry::Probe::kCpu);
   // Implementation to retrieve jiffies (system ticks)
 
   return cpu_data_list_->front().getTotalJiffies();
@@ -126,6 +292,7 @@ long CpuParser::GetJiffies()
 
 std::vector<std::string> CpuParser::GetProcessorUtilization(int pid)
 {
+  telemetry::ScopedProbe probe(telemetry::Probe::kCpu);
   fs::path pid_stat_path = "/proc/" + std::to_string(pid) + "/stat";
   if (!fs::exists(pid_stat_path))
   {
@@ -194,6 +361,7 @@ long CpuParser::GetActiveJiffies()
 
 long CpuParser::GetActiveJiffies(int pid)
 {
+  telemetry::ScopedProbe probe(telemetry::Probe::kCpu);
   // Implementation to retrieve active jiffies for a specific process
   std::vector<std::string> v = GetProcessorUtilization(pid);
   if (v.size() < 17) // Ensuring we have at least 17 elements
@@ -220,6 +388,7 @@ long CpuParser::GetActiveJiffies(int pid)
 
 long CpuParser::GetIdleJiffies()
 {
+  telemetry::ScopedProbe probe(telemetry::Probe::kCpu);
   // Implementation to retrieve idle jiffies
   if (cpu_data_list_->empty())
   {
@@ -228,37 +397,188 @@ long CpuParser::GetIdleJiffies()
   return cpu_data_list_->front().getIdleJiffies();
 }
 
+double CpuParser::GetPackageEnergy()
+{
+  telemetry::ScopedProbe probe(telemetry::Probe::kCpu);
+  // Implementation to retrieve the RAPL package energy counter
+  std::ifstream energy_file(LinuxFilesSet.at("kRaplEnergyFilename"));
+  double microjoules = -1e6;
+  if (energy_file.is_open())
+  {
+    energy_file >> microjoules;
+  }
+  return microjoules / 1e6;
+}
+
+double CpuParser::GetPackageEnergyRange()
+{
+  telemetry::ScopedProbe probe(telemetry::Probe::kCpu);
+  std::ifstream range_file(LinuxFilesSet.at("kRaplMaxEnergyFilename"));
+  double microjoules = 0;
+  if (range_file.is_open())
+  {
+    range_file >> microjoules;
+  }
+  return microjoules / 1e6;
+}
+
+bool CpuParser::GetSchedStat(std::vector<cpu_schedstat_t> &cpus)
+{
+  telemetry::ScopedProbe probe(telemetry::Probe::kCpu);
+  cpus.clear();
+  std::ifstream schedstat_file(LinuxFilesSet.at("kSchedstatFilename"));
+  if (!schedstat_file.is_open())
+  {
+    return false;
+  }
+  // cpuN yld_count 0 sched_count sched_goidle ttwu_count ttwu_local
+  //      rq_cpu_time run_delay pcount
+  std::string line;
+  while (std::getline(schedstat_file, line))
+  {
+    if (line.compare(0, 3, "cpu") != 0)
+    {
+      continue;
+    }
+    std::istringstream iss(line.substr(3));
+    cpu_schedstat_t cpu{};
+    unsigned long long ignored;
+    iss >> cpu.cpu;
+    for (int i = 0; i < 6; ++i)
+    {
+      iss >> ignored;
+    }
+    iss >> cpu.run_ns >> cpu.wait_ns >> cpu.timeslices;
+    if (iss)
+    {
+      cpus.push_back(cpu);
+    }
+  }
+  return !cpus.empty();
+}
+
 // -----------------------------
 // MemoryParser Implementation
 
-std::string MemoryParser::GetMemoryUsage()
+MemoryParser::~MemoryParser()
 {
-  // Implementation to retrieve memory usage
-  // Example:
-  return "Memory Usage Data";
+  if (meminfo_fd_ >= 0)
+  {
+    close(meminfo_fd_);
+  }
 }
 
-std::string MemoryParser::GetRAMInfo()
+bool MemoryParser::Collect(metric_snapshot_t &metrics)
 {
-  // Implementation to retrieve RAM info
-  std::ifstream ram_info_file(LinuxFilesSet.at("kMeminfoFilename"));
-  if (!ram_info_file.is_open())
+  telemetry::ScopedProbe probe(telemetry::Probe::kMemory);
+  ssize_t const size =
+      ReadWhole(meminfo_fd_, LinuxFilesSet.at("kMeminfoFilename"), buffer_);
+  if (size <= 0)
   {
-    throw std::runtime_error("Failed to open RAM info file.");
+    return false;
   }
-  std::stringstream buffer;
-  buffer << ram_info_file.rdbuf();
-  return buffer.str();
+  metrics.mem_total_kb = metrics.mem_free_kb = metrics.mem_available_kb = 0;
+  metrics.buffers_kb = metrics.cached_kb = 0;
+  metrics.swap_total_kb = metrics.swap_free_kb = 0;
+  ParseColonKeyed(buffer_.data(), buffer_.data() + size,
+                  {{"MemTotal", &metrics.mem_total_kb},
+                   {"MemFree", &metrics.mem_free_kb},
+                   {"MemAvailable", &metrics.mem_available_kb},
+                   {"Buffers", &metrics.buffers_kb},
+                   {"Cached", &metrics.cached_kb},
+                   {"SwapTotal", &metrics.swap_total_kb},
+                   {"SwapFree", &metrics.swap_free_kb}});
+  metrics.memory_utilization =
+      metrics.mem_total_kb == 0
+          ? 0.0f
+          : 1.0f - static_cast<float>(metrics.mem_available_kb) /
+                       static_cast<float>(metrics.mem_total_kb);
+  return true;
 }
 
 // -----------------------------
 // NetworkParser Implementation
 
-std::string NetworkParser::GetNetworkUsage()
+NetworkParser::~NetworkParser()
 {
-  // Implementation to retrieve network usage data
-  // Example:
-  return "Network Usage Data";
+  if (dev_fd_ >= 0)
+  {
+    close(dev_fd_);
+  }
+}
+
+bool NetworkParser::Collect(metric_snapshot_t &metrics)
+{
+  telemetry::ScopedProbe probe(telemetry::Probe::kNetwork);
+  ssize_t const size =
+      ReadWhole(dev_fd_, LinuxFilesSet.at("kNetDevFilename"), buffer_);
+  if (size <= 0)
+  {
+    return false;
+  }
+  // Two header lines without a colon, then one line per interface:
+  // "  eth0: 1234 5 0 0 0 0 0 0 5678 9 0 0 0 0 0 0"
+  metrics.rx_bytes = metrics.tx_bytes = 0;
+  metrics.rx_packets = metrics.tx_packets = 0;
+  const char *p = buffer_.data();
+  const char *const end = p + size;
+  while (p < end)
+  {
+    const char *const line_end = std::find(p, end, '\n');
+    const char *const colon = std::find(p, line_end, ':');
+    const char *const name = SkipBlanks(p, colon);
+    p = line_end + 1;
+    if (colon == line_end || std::string_view(name, colon - name) == "lo")
+    {
+      continue;
+    }
+    const char *q = colon + 1;
+    for (int column = 0; column < 10; ++column)
+    {
+      unsigned long long value = 0;
+      auto result = std::from_chars(SkipBlanks(q, line_end), line_end, value);
+      if (result.ec != std::errc())
+      {
+        break;
+      }
+      q = result.ptr;
+      switch (column)
+      {
+      case 0:
+        metrics.rx_bytes += value;
+        break;
+      case 1:
+        metrics.rx_packets += value;
+        break;
+      case 8:
+        metrics.tx_bytes += value;
+        break;
+      case 9:
+        metrics.tx_packets += value;
+        break;
+      default:
+        break;
+      }
+    }
+  }
+
+  auto const now = std::chrono::steady_clock::now();
+  double const seconds = std::chrono::duration<double>(now - last_time_).count();
+  metrics.rx_rate = metrics.tx_rate = 0.0;
+  // An interface that went away takes its counters along
+  if (last_time_ != std::chrono::steady_clock::time_point() && seconds > 0.0)
+  {
+    metrics.rx_rate =
+        (metrics.rx_bytes - std::min(metrics.rx_bytes, last_rx_bytes_)) /
+        seconds;
+    metrics.tx_rate =
+        (metrics.tx_bytes - std::min(metrics.tx_bytes, last_tx_bytes_)) /
+        seconds;
+  }
+  last_rx_bytes_ = metrics.rx_bytes;
+  last_tx_bytes_ = metrics.tx_bytes;
+  last_time_ = now;
+  return true;
 }
 
 // -----------------------------
@@ -266,137 +586,1736 @@ std::string NetworkParser::GetNetworkUsage()
 
 std::string ProcessParser::GetCommand(int pid)
 {
-  // Implementation to retrieve the command line for a process
-  std::ifstream cmd_file(LinuxFilesSet.at("kProcDirectory") +
-                         std::to_string(pid) +
-                         LinuxFilesSet.at("kCmdlineFilename"));
-  if (!cmd_file.is_open())
+  std::string command;
+  if (!ReadCommand(pid, command))
   {
     throw std::runtime_error("Failed to open command file.");
   }
-  std::stringstream buffer;
-  buffer << cmd_file.rdbuf();
-  return buffer.str();
+  return command;
+}
+
+bool ProcessParser::ReadCommand(int pid, std::string &command)
+{
+  telemetry::ScopedProbe probe(telemetry::Probe::kProcess);
+  char path[32];
+  std::snprintf(path, sizeof(path), "/proc/%d/cmdline", pid);
+  int const fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    return false;
+  }
+  // Straight into the caller's string, its capacity is kept across calls
+  std::size_t size = 0;
+  command.resize(std::max<std::size_t>(command.capacity(), 256));
+  ssize_t length = 0;
+  while ((length = read(fd, &command[size], command.size() - size)) > 0)
+  {
+    size += static_cast<std::size_t>(length);
+    if (size == command.size())
+    {
+      command.resize(size * 2);
+    }
+  }
+  close(fd);
+  command.resize(size);
+  // Arguments are NUL separated
+  while (!command.empty() && command.back() == '\0')
+  {
+    command.pop_back();
+  }
+  std::replace(command.begin(), command.end(), '\0', ' ');
+  return length == 0;
 }
 
 std::string ProcessParser::GetRam(int pid)
 {
-  // Implementation to retrieve RAM usage for a specific process
-  // Example:
-  return "RAM Usage Data";
+  // Resident memory in MB, statm is a few numbers where status is a page
+  pid_memory_t memory;
+  if (!GetStatm(pid, memory))
+  {
+    throw std::runtime_error("Failed to read statm file.");
+  }
+  return std::to_string(memory.rss_kb / 1024);
 }
 
 std::string ProcessParser::GetUid(int pid)
 {
-  // Implementation to retrieve UID for a specific process
-  // Example:
-  return "User ID";
+  telemetry::ScopedProbe probe(telemetry::Probe::kProcess);
+  // Implementation to retrieve the real UID for a specific process
+  std::ifstream status_file(LinuxFilesSet.at("kProcDirectory") +
+                            std::to_string(pid) +
+                            LinuxFilesSet.at("kPidStatusFilename"));
+  if (!status_file.is_open())
+  {
+    throw std::runtime_error("Failed to open status file.");
+  }
+  std::string line;
+  while (std::getline(status_file, line))
+  {
+    if (line.compare(0, 4, "Uid:") == 0)
+    {
+      std::istringstream iss(line.substr(4));
+      std::string uid;
+      iss >> uid;
+      return uid;
+    }
+  }
+  throw std::runtime_error("No Uid entry in /proc/[pid]/status.");
 }
 
 std::string ProcessParser::GetUser(int pid)
 {
-  // Implementation to retrieve the user name for a specific process
-  // Example:
-  return "User Name";
+  std::string_view const user = ReadUser(pid);
+  if (user.empty())
+  {
+    throw std::runtime_error("Failed to open status file.");
+  }
+  return std::string(user);
 }
 
-long ProcessParser::GetUpTime(int pid)
+std::string_view ProcessParser::ReadUser(int pid)
 {
-  // Implementation to retrieve uptime for a specific process
-  // Example:
-  return 120;
+  telemetry::ScopedProbe probe(telemetry::Probe::kProcess);
+  if (users_.empty())
+  {
+    std::ifstream passwd_file(LinuxFilesSet.at("kPasswordFilename"));
+    std::string line;
+    while (std::getline(passwd_file, line))
+    {
+      // name:password:uid:...
+      std::size_t name_end = line.find(':');
+      std::size_t uid_begin = line.find(':', name_end + 1);
+      if (name_end == std::string::npos || uid_begin == std::string::npos)
+      {
+        continue;
+      }
+      unsigned uid = 0;
+      auto result = std::from_chars(line.data() + uid_begin + 1,
+                                    line.data() + line.size(), uid);
+      if (result.ec == std::errc() && *result.ptr == ':')
+      {
+        users_.emplace(uid, line.substr(0, name_end));
+      }
+    }
+  }
+  char path[32];
+  std::snprintf(path, sizeof(path), "/proc/%d/status", pid);
+  int const fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    return std::string_view();
+  }
+  // Uid is in the first dozen lines
+  char buffer[1024];
+  ssize_t const length = read(fd, buffer, sizeof(buffer));
+  close(fd);
+  std::string_view const data(buffer, length > 0 ? length : 0);
+  std::size_t const line = data.find("\nUid:");
+  if (line == std::string_view::npos)
+  {
+    return std::string_view();
+  }
+  const char *const end = buffer + data.size();
+  unsigned uid = 0;
+  if (std::from_chars(SkipBlanks(buffer + line + 5, end), end, uid).ec !=
+      std::errc())
+  {
+    return std::string_view();
+  }
+  // Unnamed uids are remembered as their number
+  auto user = users_.try_emplace(uid);
+  if (user.second)
+  {
+    user.first->second = std::to_string(uid);
+  }
+  return user.first->second;
 }
 
-std::vector<int> ProcessParser::GetPids()
+long ProcessParser::GetUpTime(int pid)
 {
-  // Implementation to retrieve the list of process IDs
-  std::vector<int> pids = {1, 2, 3}; // Example PIDs
-  return pids;
+  telemetry::ScopedProbe probe(telemetry::Probe::kProcess);
+  // Implementation to retrieve uptime in seconds for a specific process
+  pid_stat_t stat;
+  if (!GetStat(pid, stat))
+  {
+    throw std::runtime_error("Failed to read /proc/[pid]/stat.");
+  }
+  std::ifstream uptime_file(LinuxFilesSet.at("kUptimeFilename"));
+  double system_uptime = 0;
+  uptime_file >> system_uptime;
+  return static_cast<long>(system_uptime) -
+         static_cast<long>(stat.starttime / sysconf(_SC_CLK_TCK));
 }
 
-int ProcessParser::GetTotalProcesses()
+bool ProcessParser::GetStat(int pid, pid_stat_t &stat)
 {
-  // Implementation to retrieve total number of processes
-  // Example:
-  return 1000;
+  telemetry::ScopedProbe probe(telemetry::Probe::kProcess);
+  char path[32];
+  std::snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+  return ReadStat(path, pid, stat);
 }
 
-int ProcessParser::GetRunningProcesses()
+bool ProcessParser::GetTaskStat(int pid, int tid, pid_stat_t &stat)
 {
-  // Implementation to retrieve number of running processes
-  // Example:
-  return 500;
+  telemetry::ScopedProbe probe(telemetry::Probe::kProcess);
+  char path[48];
+  std::snprintf(path, sizeof(path), "/proc/%d/task/%d/stat", pid, tid);
+  return ReadStat(path, tid, stat);
 }
 
-// -----------------------------
-// SystemParser Implementation
-
-SystemParser::SystemParser(CpuParser &cpuParser, MemoryParser &memoryParser,
-                           ProcessParser &processParser)
-    : cpuParser_(cpuParser),
-      memoryParser_(memoryParser),
-      processParser_(processParser) {}
+std::vector<int> ProcessParser::GetTids(int pid)
+{
+  telemetry::ScopedProbe probe(telemetry::Probe::kProcess);
+  std::vector<int> tids;
+  char path[32];
+  std::snprintf(path, sizeof(path), "/proc/%d/task", pid);
+  DIR *directory = opendir(path);
+  if (directory == nullptr)
+  {
+    return tids; // process exited
+  }
+  while (dirent *entry = readdir(directory))
+  {
+    const char *name = entry->d_name;
+    int tid = 0;
+    auto result = std::from_chars(name, name + std::strlen(name), tid);
+    if (result.ec == std::errc() && *result.ptr == '\0')
+    {
+      tids.push_back(tid);
+    }
+  }
+  closedir(directory);
+  std::sort(tids.begin(), tids.end());
+  return tids;
+}
 
-std::string SystemParser::GetSystemInfo()
+bool ProcessParser::ReadStat(const char *path, int id, pid_stat_t &stat)
 {
-  // Implementation to retrieve system information
-  // Example:
-  return "System Information Data";
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    return false; // process exited
+  }
+  char buffer[1024];
+  ssize_t length = read(fd, buffer, sizeof(buffer) - 1);
+  close(fd);
+  if (length <= 0)
+  {
+    return false;
+  }
+  return DecodeStat(std::string_view(buffer, length), id, stat);
 }
 
-std::string SystemParser::GetSystemUptime()
+bool ProcessParser::DecodeStat(std::string_view data, int id,
+                               pid_stat_t &stat)
 {
-  // Implementation to retrieve system uptime
-  std::ifstream uptime_file(LinuxFilesSet.at("kUptimeFilename"));
-  if (!uptime_file.is_open())
+  // Decode the stat line straight from the read buffer
+  const char *buffer = data.data();
+  std::size_t const length = data.size();
+  if (length == 0)
   {
-    throw std::runtime_error("Failed to open uptime file.");
+    return false;
   }
-  std::stringstream buffer;
-  buffer << uptime_file.rdbuf();
-  return buffer.str();
+  const char *end = buffer + length;
+
+  // comm may contain spaces and ')' so it ends at the last ')'
+  const char *comm_begin = static_cast<const char *>(
+      std::memchr(buffer, '(', length));
+  const char *comm_end = comm_begin;
+  for (const char *p = end - 1; p > comm_begin; --p)
+  {
+    if (*p == ')')
+    {
+      comm_end = p;
+      break;
+    }
+  }
+  if (comm_begin == nullptr || comm_end == comm_begin || comm_end + 2 >= end)
+  {
+    logger_.Log(LogLevel::ERROR, "Failed to parse /proc/[pid]/stat correctly.");
+    return false;
+  }
+  std::size_t comm_length =
+      std::min<std::size_t>(comm_end - comm_begin - 1, sizeof(stat.comm) - 1);
+  std::memcpy(stat.comm, comm_begin + 1, comm_length);
+  stat.comm[comm_length] = '\0';
+  stat.pid = id;
+  stat.state = comm_end[2];
+
+  // Fields are numbered as in proc(5), field 3 is the state
+  const char *cursor = comm_end + 3;
+  int field = 3;
+  auto next = [&](auto &value) {
+    while (cursor < end && *cursor == ' ')
+    {
+      ++cursor;
+    }
+    auto result = std::from_chars(cursor, end, value);
+    cursor = result.ptr;
+    ++field;
+    return result.ec == std::errc();
+  };
+  auto skip_to = [&](int target) {
+    while (field + 1 < target && cursor < end)
+    {
+      while (cursor < end && *cursor == ' ')
+      {
+        ++cursor;
+      }
+      while (cursor < end && *cursor != ' ')
+      {
+        ++cursor;
+      }
+      ++field;
+    }
+  };
+
+  bool ok = next(stat.ppid);
+  skip_to(14);
+  ok = ok && next(stat.utime) && next(stat.stime) && next(stat.cutime) &&
+       next(stat.cstime);
+  skip_to(20);
+  ok = ok && next(stat.num_threads);
+  skip_to(22);
+  ok = ok && next(stat.starttime) && next(stat.vsize) && next(stat.rss);
+  skip_to(39);
+  ok = ok && next(stat.processor);
+  if (!ok)
+  {
+    logger_.Log(LogLevel::ERROR, "Failed to parse /proc/[pid]/stat correctly.");
+  }
+  return ok;
 }
 
-std::string SystemParser::GetTemperature()
+bool ProcessParser::GetSchedStat(int pid, pid_schedstat_t &schedstat)
 {
-  // Implementation to retrieve system temperature (if available)
-  // Example:
-  return "Temperature Data";
+  telemetry::ScopedProbe probe(telemetry::Probe::kProcess);
+  // /proc/[pid]/schedstat only covers the thread group leader, the
+  // process is the sum of its tasks
+  char path[32];
+  std::snprintf(path, sizeof(path), "/proc/%d/task", pid);
+  DIR *directory = opendir(path);
+  if (directory == nullptr)
+  {
+    return false; // process exited
+  }
+  schedstat = pid_schedstat_t{};
+  bool read_any = false;
+  char buffer[96];
+  while (dirent *entry = readdir(directory))
+  {
+    const char *task = entry->d_name;
+    int tid = 0;
+    auto named = std::from_chars(task, task + std::strlen(task), tid);
+    if (named.ec != std::errc() || *named.ptr != '\0')
+    {
+      continue;
+    }
+    char name[32];
+    std::snprintf(name, sizeof(name), "%d/schedstat", tid);
+    int fd = openat(dirfd(directory), name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+      continue; // thread exited
+    }
+    ssize_t length = read(fd, buffer, sizeof(buffer));
+    close(fd);
+    if (length <= 0)
+    {
+      continue;
+    }
+    const char *p = buffer;
+    const char *end = buffer + length;
+    unsigned long long values[3];
+    bool parsed = true;
+    for (unsigned long long &value : values)
+    {
+      auto result = std::from_chars(SkipBlanks(p, end), end, value);
+      if (result.ec != std::errc())
+      {
+        parsed = false;
+        break;
+      }
+      p = result.ptr;
+    }
+    if (parsed)
+    {
+      schedstat.run_ns += values[0];
+      schedstat.wait_ns += values[1];
+      schedstat.timeslices += values[2];
+      read_any = true;
+    }
+  }
+  closedir(directory);
+  return read_any;
 }
 
-std::string SystemParser::GetDiskUsage()
+bool ProcessParser::GetStatm(int pid, pid_memory_t &memory)
 {
-  // Implementation to retrieve disk usage data
-  // Example:
-  return "Disk Usage Data";
+  telemetry::ScopedProbe probe(telemetry::Probe::kProcess);
+  static const long page_kb = sysconf(_SC_PAGESIZE) / 1024;
+  char path[40];
+  std::snprintf(path, sizeof(path), "/proc/%d/statm", pid);
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    return false;
+  }
+  char buffer[128];
+  ssize_t length = read(fd, buffer, sizeof(buffer));
+  close(fd);
+  if (length <= 0)
+  {
+    return false;
+  }
+  // size resident shared text lib data dt, in pages
+  const char *p = buffer;
+  const char *end = buffer + length;
+  long pages[3];
+  for (long &field : pages)
+  {
+    while (p < end && *p == ' ')
+    {
+      ++p;
+    }
+    auto result = std::from_chars(p, end, field);
+    if (result.ec != std::errc())
+    {
+      return false;
+    }
+    p = result.ptr;
+  }
+  memory = {pages[1] * page_kb, pages[2] * page_kb, -1, -1, -1};
+  return true;
 }
 
-std::string SystemParser::GetLogs()
+bool ProcessParser::GetIo(int pid, pid_io_t &io)
 {
-  // Implementation to retrieve system logs
-  // Example:
-  return "Logs Data";
+  telemetry::ScopedProbe probe(telemetry::Probe::kProcess);
+  char path[40];
+  std::snprintf(path, sizeof(path), "/proc/%d/io", pid);
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    return false;
+  }
+  char buffer[256];
+  ssize_t length = read(fd, buffer, sizeof(buffer));
+  close(fd);
+  if (length <= 0)
+  {
+    return false;
+  }
+  return DecodeIo(std::string_view(buffer, length), io);
 }
 
-std::string SystemParser::GetHistoricalUsageData()
+std::string ProcessParser::GetCgroup(int pid)
 {
-  // Implementation to retrieve historical usage data
-  // Example:
-  return "Historical Data";
+  char path[40];
+  std::snprintf(path, sizeof(path), "/proc/%d/cgroup", pid);
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    return std::string();
+  }
+  char buffer[4096];
+  ssize_t length = read(fd, buffer, sizeof(buffer));
+  close(fd);
+  const char *p = buffer;
+  const char *end = buffer + std::max<ssize_t>(length, 0);
+  // The v2 entry is "0::/path", v1 controllers have their own lines
+  while (p < end)
+  {
+    const char *line_end = std::find(p, end, '\n');
+    if (line_end - p >= 3 && std::memcmp(p, "0::", 3) == 0)
+    {
+      return std::string(p + 3, line_end);
+    }
+    p = line_end + 1;
+  }
+  return std::string();
 }
 
-std::string SystemParser::GetResponseTime()
+bool ProcessParser::DecodeIo(std::string_view data, pid_io_t &io)
 {
-  // Implementation to retrieve response time data
-  // Example:
-  return "Response Time Data";
+  // The kernel prints the same seven lines in the same order: rchar,
+  // wchar, syscr, syscw, read_bytes, write_bytes, cancelled_write_bytes.
+  // Values are taken by line number, keys are not compared.
+  unsigned long long values[7];
+  const char *p = data.data();
+  const char *end = p + data.size();
+  for (unsigned long long &value : values)
+  {
+    p = static_cast<const char *>(std::memchr(p, ':', end - p));
+    if (p == nullptr)
+    {
+      return false;
+    }
+    ++p;
+    while (p < end && *p == ' ')
+    {
+      ++p;
+    }
+    auto result = std::from_chars(p, end, value);
+    if (result.ec != std::errc())
+    {
+      return false;
+    }
+    p = result.ptr;
+  }
+  io = {values[2], values[3], values[4], values[5], values[6]};
+  return true;
 }
 
-std::string SystemParser::GetLatency()
+bool ProcessParser::GetSmapsRollup(int pid, pid_memory_t &memory)
 {
-  // Implementation to retrieve system latency
-  // Example:
-  return "Latency Data";
+  telemetry::ScopedProbe probe(telemetry::Probe::kProcess);
+  char path[48];
+  std::snprintf(path, sizeof(path), "/proc/%d/smaps_rollup", pid);
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    return false;
+  }
+  // About 25 short lines, the kernel sums all mappings in this one read
+  char buffer[2048];
+  ssize_t length = read(fd, buffer, sizeof(buffer));
+  close(fd);
+  if (length <= 0)
+  {
+    return false;
+  }
+  memory = {0, 0, 0, 0, 0};
+  bool found = false;
+  std::string_view rest(buffer, static_cast<std::size_t>(length));
+  while (!rest.empty())
+  {
+    std::size_t const newline = rest.find('\n');
+    std::string_view line = rest.substr(0, newline);
+    rest.remove_prefix(newline == std::string_view::npos ? rest.size()
+                                                         : newline + 1);
+    std::size_t const colon = line.find(':');
+    if (colon == std::string_view::npos)
+    {
+      continue; // the header line of the rollup mapping
+    }
+    std::string_view const key = line.substr(0, colon);
+    long *field = nullptr;
+    if (key == "Rss")
+    {
+      field = &memory.rss_kb;
+    }
+    else if (key == "Pss")
+    {
+      field = &memory.pss_kb;
+      found = true;
+    }
+    else if (key == "Shared_Clean" || key == "Shared_Dirty")
+    {
+      field = &memory.shared_kb;
+    }
+    else if (key == "Private_Clean" || key == "Private_Dirty")
+    {
+      field = &memory.uss_kb;
+    }
+    else if (key == "Swap")
+    {
+      field = &memory.swap_kb;
+    }
+    else
+    {
+      continue;
+    }
+    std::string_view value = line.substr(colon + 1);
+    while (!value.empty() && value.front() == ' ')
+    {
+      value.remove_prefix(1);
+    }
+    long kilobytes = 0;
+    std::from_chars(value.data(), value.data() + value.size(), kilobytes);
+    *field += kilobytes;
+  }
+  return found;
+}
+
+std::vector<int> ProcessParser::GetPids()
+{
+  telemetry::ScopedProbe probe(telemetry::Probe::kProcess);
+  // Implementation to retrieve the list of process IDs
+  std::vector<int> pids;
+  DIR *directory = opendir(LinuxFilesSet.at("kProcDirectory").c_str());
+  if (directory == nullptr)
+  {
+    throw std::runtime_error("Failed to open /proc.");
+  }
+  struct dirent *entry;
+  while ((entry = readdir(directory)) != nullptr)
+  {
+    const char *name = entry->d_name;
+    int pid = 0;
+    auto result = std::from_chars(name, name + std::strlen(name), pid);
+    if (result.ec == std::errc() && *result.ptr == '\0')
+    {
+      pids.push_back(pid);
+    }
+  }
+  closedir(directory);
+  std::sort(pids.begin(), pids.end());
+  return pids;
+}
+
+namespace
+{
+// Calls visit(directory, name) for every entry of /proc/[pid]/fd. The
+// directory is read with getdents64 straight into a stack buffer, so
+// nothing but the names is looked at and nothing is allocated.
+template <typename Visit> bool ForEachFd(int pid, Visit visit)
+{
+  char path[32];
+  std::snprintf(path, sizeof(path), "/proc/%d/fd", pid);
+  int const directory = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (directory < 0)
+  {
+    return false;
+  }
+  alignas(dirent64) char buffer[8192];
+  long length = 0;
+  while ((length = syscall(__NR_getdents64, directory, buffer,
+                           sizeof(buffer))) > 0)
+  {
+    for (long offset = 0; offset < length;)
+    {
+      const auto *entry = reinterpret_cast<const dirent64 *>(buffer + offset);
+      if (entry->d_name[0] != '.')
+      {
+        visit(directory, entry->d_name);
+      }
+      offset += entry->d_reclen;
+    }
+  }
+  close(directory);
+  return length == 0;
+}
+} // namespace
+
+int ProcessParser::CountFds(int pid)
+{
+  telemetry::ScopedProbe probe(telemetry::Probe::kProcess);
+  int count = 0;
+  return ForEachFd(pid, [&count](int, const char *) { ++count; }) ? count
+                                                                  : -1;
+}
+
+bool ProcessParser::GetFds(int pid, pid_fds_t &fds)
+{
+  telemetry::ScopedProbe probe(telemetry::Probe::kProcess);
+  fds = {0, 0, 0, 0, 0};
+  // Only the start of the target tells its kind, longer paths are cut
+  char target[16];
+  int unresolved = 0;
+  bool const listed = ForEachFd(
+      pid,
+      [&](int directory, const char *name)
+      {
+        ++fds.total;
+        ssize_t const length =
+            readlinkat(directory, name, target, sizeof(target));
+        std::string_view const link(target, length > 0 ? length : 0);
+        if (link.rfind("socket:", 0) == 0)
+        {
+          ++fds.sockets;
+        }
+        else if (link.rfind("pipe:", 0) == 0)
+        {
+          ++fds.pipes;
+        }
+        else if (!link.empty() && link[0] == '/' && link.rfind("/dev/", 0) != 0)
+        {
+          ++fds.files;
+        }
+        else
+        {
+          unresolved += link.empty() ? 1 : 0;
+          ++fds.other;
+        }
+      });
+  // Listing needs less than resolving, e.g. under a restrictive LSM
+  return listed && (fds.total == 0 || unresolved < fds.total);
+}
+
+long ProcessParser::GetFdLimit(int pid)
+{
+  telemetry::ScopedProbe probe(telemetry::Probe::kProcess);
+  char path[32];
+  std::snprintf(path, sizeof(path), "/proc/%d/limits", pid);
+  int const fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    return -1;
+  }
+  // 17 lines of fixed width columns
+  char buffer[2048];
+  ssize_t const length = read(fd, buffer, sizeof(buffer));
+  close(fd);
+  if (length <= 0)
+  {
+    return -1;
+  }
+  // "Max open files            1024                 1048576              files"
+  std::string_view const data(buffer, static_cast<std::size_t>(length));
+  std::size_t const line = data.find("Max open files");
+  if (line == std::string_view::npos)
+  {
+    return -1;
+  }
+  const char *const end = buffer + length;
+  long limit = -1;
+  std::from_chars(SkipBlanks(buffer + line + 14, end), end, limit);
+  return limit; // "unlimited" leaves -1
+}
+
+int ProcessParser::GetTotalProcesses()
+{
+  telemetry::ScopedProbe probe(telemetry::Probe::kProcess);
+  // Implementation to retrieve total number of processes
+  return static_cast<int>(GetPids().size());
+}
+
+int ProcessParser::GetRunningProcesses()
+{
+  telemetry::ScopedProbe probe(telemetry::Probe::kProcess);
+  // Implementation to retrieve number of running processes
+  std::ifstream stat_file(LinuxFilesSet.at("kStatFilename"));
+  std::string key;
+  int value = 0;
+  while (stat_file >> key)
+  {
+    if (key == "procs_running")
+    {
+      stat_file >> value;
+      return value;
+    }
+    stat_file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+  }
+  return value;
+}
+
+// -----------------------------
+// PressureParser Implementation
+
+const char *parser_factory::PsiResourceName(PsiResource resource)
+{
+  switch (resource)
+  {
+  case PsiResource::kCpu:
+    return "cpu";
+  case PsiResource::kMemory:
+    return "memory";
+  case PsiResource::kIo:
+    return "io";
+  }
+  return "unknown";
+}
+
+namespace
+{
+// Decodes "avg10=0.12 avg60=0.05 avg300=0.01 total=1234" of one line
+bool ParsePsiLine(const char *begin, const char *end, psi_averages_t &line)
+{
+  struct
+  {
+    const char *key;
+    std::size_t length;
+  } const keys[] = {{"avg10=", 6}, {"avg60=", 6}, {"avg300=", 7}, {"total=", 6}};
+  float *averages[] = {&line.avg10, &line.avg60, &line.avg300};
+  const char *p = begin;
+  for (int i = 0; i < 4; ++i)
+  {
+    const char *found = std::search(p, end, keys[i].key, keys[i].key + keys[i].length);
+    if (found == end)
+    {
+      return false;
+    }
+    p = found + keys[i].length;
+    auto result = i < 3 ? std::from_chars(p, end, *averages[i])
+                        : std::from_chars(p, end, line.total_us);
+    if (result.ec != std::errc())
+    {
+      return false;
+    }
+    p = result.ptr;
+  }
+  return true;
+}
+
+std::string FindCgroup2Root()
+{
+  std::ifstream mounts(LinuxFilesSet.at("kMountsFilename"));
+  std::string device, mount_point, type;
+  while (mounts >> device >> mount_point >> type)
+  {
+    if (type == "cgroup2")
+    {
+      return mount_point;
+    }
+    mounts.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+  }
+  return std::string();
+}
+} // namespace
+
+PressureParser::~PressureParser()
+{
+  for (const trigger_t &trigger : triggers_)
+  {
+    close(trigger.fd);
+  }
+}
+
+bool PressureParser::GetPressure(PsiResource resource, pressure_t &pressure)
+{
+  return GetPressure(LinuxFilesSet.at("kPressureDirectory") +
+                         PsiResourceName(resource),
+                     pressure);
+}
+
+bool PressureParser::GetPressure(const std::string &path, pressure_t &pressure)
+{
+  telemetry::ScopedProbe probe(telemetry::Probe::kPressure);
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    return false; // no PSI support or the cgroup went away
+  }
+  char buffer[256];
+  ssize_t length = read(fd, buffer, sizeof(buffer));
+  close(fd);
+  if (length <= 0)
+  {
+    return false;
+  }
+  pressure = {};
+  const char *end = buffer + length;
+  const char *line = buffer;
+  bool some = false;
+  while (line < end)
+  {
+    const char *line_end = std::find(line, end, '\n');
+    if (end - line > 5 && std::memcmp(line, "some ", 5) == 0)
+    {
+      some = ParsePsiLine(line, line_end, pressure.some);
+    }
+    else if (end - line > 5 && std::memcmp(line, "full ", 5) == 0)
+    {
+      ParsePsiLine(line, line_end, pressure.full);
+    }
+    line = line_end + 1;
+  }
+  return some;
+}
+
+std::string PressureParser::GetCgroup2Root() { return FindCgroup2Root(); }
+
+bool PressureParser::AddTrigger(PsiResource resource, const std::string &spec)
+{
+  std::string const path =
+      LinuxFilesSet.at("kPressureDirectory") + PsiResourceName(resource);
+  int fd = open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+  // The kernel expects the terminating NUL as part of the write
+  if (fd < 0 || write(fd, spec.c_str(), spec.size() + 1) < 0)
+  {
+    logger_.Log(LogLevel::INFO, "PSI trigger \"" + spec + "\" on " + path +
+                                    " unavailable: " + std::strerror(errno));
+    if (fd >= 0)
+    {
+      close(fd);
+    }
+    return false;
+  }
+  triggers_.push_back({resource, spec, fd});
+  return true;
+}
+
+std::vector<psi_event_t> PressureParser::WaitForEvents(int wake_fd)
+{
+  std::vector<pollfd> fds;
+  fds.reserve(triggers_.size() + 1);
+  for (const trigger_t &trigger : triggers_)
+  {
+    fds.push_back({trigger.fd, POLLPRI, 0});
+  }
+  fds.push_back({wake_fd, POLLIN, 0});
+
+  std::vector<psi_event_t> fired;
+  if (poll(fds.data(), fds.size(), -1) <= 0)
+  {
+    return fired; // EINTR, the caller loops
+  }
+  auto const now = std::chrono::system_clock::now();
+  std::size_t kept = 0;
+  for (std::size_t i = 0; i < triggers_.size(); ++i)
+  {
+    if (fds[i].revents & POLLERR)
+    {
+      // Would report POLLERR forever, drop it instead of spinning
+      logger_.Log(LogLevel::ERROR, "PSI trigger \"" + triggers_[i].spec +
+                                       "\" is no longer valid.");
+      close(triggers_[i].fd);
+      continue;
+    }
+    if (fds[i].revents & POLLPRI)
+    {
+      fired.push_back({triggers_[i].resource, triggers_[i].spec, now});
+    }
+    triggers_[kept++] = triggers_[i];
+  }
+  triggers_.resize(kept);
+  if (!fired.empty())
+  {
+    std::lock_guard<std::mutex> lock(events_mutex_);
+    for (const psi_event_t &event : fired)
+    {
+      events_.push_back(event);
+      if (events_.size() > kMaxEvents)
+      {
+        events_.pop_front();
+      }
+    }
+    event_count_ += fired.size();
+  }
+  return fired;
+}
+
+std::vector<psi_event_t> PressureParser::RecentEvents() const
+{
+  std::lock_guard<std::mutex> lock(events_mutex_);
+  return std::vector<psi_event_t>(events_.begin(), events_.end());
+}
+
+std::uint64_t PressureParser::EventCount() const
+{
+  std::lock_guard<std::mutex> lock(events_mutex_);
+  return event_count_;
+}
+
+// -----------------------------
+// InterruptParser Implementation
+
+InterruptParser::~InterruptParser()
+{
+  for (int fd : {interrupts_fd_, softirqs_fd_})
+  {
+    if (fd >= 0)
+    {
+      close(fd);
+    }
+  }
+}
+
+bool InterruptParser::GetInterrupts(interrupt_table_t &table)
+{
+  return Read(interrupts_fd_, LinuxFilesSet.at("kInterruptsFilename"), table);
+}
+
+bool InterruptParser::GetSoftirqs(interrupt_table_t &table)
+{
+  return Read(softirqs_fd_, LinuxFilesSet.at("kSoftirqsFilename"), table);
+}
+
+bool InterruptParser::Read(int &fd, const std::string &path,
+                           interrupt_table_t &table)
+{
+  telemetry::ScopedProbe probe(telemetry::Probe::kInterrupts);
+  if (buffer_.empty())
+  {
+    buffer_.resize(64 * 1024);
+  }
+  ssize_t const size = ReadWhole(fd, path, buffer_);
+  if (size < 0)
+  {
+    return false;
+  }
+  return Decode(std::string_view(buffer_.data(), size), table);
+}
+
+bool InterruptParser::Decode(std::string_view data, interrupt_table_t &table)
+{
+  const char *p = data.data();
+  const char *const end = p + data.size();
+  const char *line_end = std::find(p, end, '\n');
+
+  // "           CPU0       CPU1       CPU3"
+  std::size_t columns = 0;
+  bool layout_changed = false;
+  for (p = SkipBlanks(p, line_end); p < line_end; p = SkipBlanks(p, line_end))
+  {
+    const char *const token_end = std::find_if(
+        p, line_end, [](char c)
+        { return c == ' ' || c == '\t'; });
+    int cpu = 0;
+    if (token_end - p > 3 && std::strncmp(p, "CPU", 3) == 0 &&
+        std::from_chars(p + 3, token_end, cpu).ec == std::errc())
+    {
+      if (columns == table.cpus.size())
+      {
+        table.cpus.push_back(cpu);
+        layout_changed = true;
+      }
+      else if (table.cpus[columns] != cpu)
+      {
+        table.cpus[columns] = cpu;
+        layout_changed = true;
+      }
+      ++columns;
+    }
+    p = token_end;
+  }
+  if (columns == 0)
+  {
+    return false;
+  }
+  if (columns != table.cpus.size())
+  {
+    table.cpus.resize(columns);
+    layout_changed = true;
+  }
+
+  // " 24:   1234   0   IR-PCI-MSI 524288-edge   eth0-TxRx-0"
+  std::size_t rows = 0;
+  for (p = line_end + 1; p < end; p = line_end + 1)
+  {
+    line_end = std::find(p, end, '\n');
+    p = SkipBlanks(p, line_end);
+    const char *const colon = std::find(p, line_end, ':');
+    if (colon == line_end)
+    {
+      continue;
+    }
+    std::string_view const name(p, colon - p);
+    if (table.counts.size() < (rows + 1) * columns)
+    {
+      table.counts.resize((rows + 1) * columns);
+    }
+    std::uint32_t *const row = table.counts.data() + rows * columns;
+    const char *q = colon + 1;
+    std::size_t column = 0;
+    for (; column < columns; ++column)
+    {
+      q = SkipBlanks(q, line_end);
+      auto result = std::from_chars(q, line_end, row[column]);
+      if (result.ec != std::errc())
+      {
+        break;
+      }
+      q = result.ptr;
+    }
+    if (column < columns)
+    {
+      continue; // ERR: and MIS: count for the whole system
+    }
+    q = SkipBlanks(q, line_end);
+    const char *description_end = line_end;
+    while (description_end > q &&
+           (description_end[-1] == ' ' || description_end[-1] == '\t'))
+    {
+      --description_end;
+    }
+    std::string_view const description(q, description_end - q);
+    if (rows == table.names.size())
+    {
+      table.names.emplace_back(name);
+      table.descriptions.emplace_back(description);
+      layout_changed = true;
+    }
+    else
+    {
+      if (table.names[rows] != name)
+      {
+        table.names[rows].assign(name.data(), name.size());
+        layout_changed = true;
+      }
+      if (table.descriptions[rows] != description)
+      {
+        table.descriptions[rows].assign(description.data(), description.size());
+      }
+    }
+    ++rows;
+  }
+  if (rows != table.names.size())
+  {
+    table.names.resize(rows);
+    table.descriptions.resize(rows);
+    layout_changed = true;
+  }
+  table.counts.resize(rows * columns);
+  table.layout_changed = layout_changed;
+  return rows > 0;
+}
+
+// -----------------------------
+// CgroupParser Implementation
+
+namespace
+{
+constexpr std::uint32_t kCgroupWatchMask =
+    IN_CREATE | IN_DELETE | IN_ONLYDIR | IN_DONT_FOLLOW;
+const char *const kCgroupStatFiles[] = {"/cpu.stat", "/memory.current",
+                                         "/memory.stat", "/io.stat"};
+
+// Reads a small stat file from the start, the descriptor stays open
+ssize_t ReadAt(int fd, char *buffer, std::size_t size)
+{
+  return fd < 0 ? -1 : pread(fd, buffer, size, 0);
+}
+
+// Sums rbytes= and wbytes= over the device lines of io.stat
+void ParseIoStat(const char *p, const char *end, cgroup_stat_t &stat)
+{
+  while (p < end)
+  {
+    const char *line_end = std::find(p, end, '\n');
+    while (p < line_end)
+    {
+      const char *token_end = std::find(p, line_end, ' ');
+      std::string_view const token(p, token_end - p);
+      unsigned long long value = 0;
+      if (token.compare(0, 7, "rbytes=") == 0 &&
+          std::from_chars(p + 7, token_end, value).ec == std::errc())
+      {
+        stat.read_bytes += value;
+      }
+      else if (token.compare(0, 7, "wbytes=") == 0 &&
+               std::from_chars(p + 7, token_end, value).ec == std::errc())
+      {
+        stat.write_bytes += value;
+      }
+      p = token_end + 1;
+    }
+    p = line_end + 1;
+  }
+}
+} // namespace
+
+CgroupParser::CgroupParser(std::string root)
+    : root_(root.empty() ? FindCgroup2Root() : std::move(root))
+{
+  if (root_.empty())
+  {
+    return; // no cgroup v2 hierarchy, every lookup comes back empty
+  }
+  while (root_.size() > 1 && root_.back() == '/')
+  {
+    root_.pop_back();
+  }
+  inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd_ < 0)
+  {
+    logger_.Log(LogLevel::ERROR,
+                std::string("inotify unavailable, cgroups are not followed: ") +
+                    std::strerror(errno));
+  }
+  Add("/");
+}
+
+CgroupParser::~CgroupParser()
+{
+  for (auto &entry : cgroups_)
+  {
+    for (int fd : entry.second.fds)
+    {
+      if (fd >= 0)
+      {
+        close(fd);
+      }
+    }
+  }
+  if (inotify_fd_ >= 0)
+  {
+    close(inotify_fd_);
+  }
+}
+
+void CgroupParser::Add(const std::string &cgroup)
+{
+  std::string const directory = cgroup == "/" ? root_ : root_ + cgroup;
+  // Watch before listing, a child created in between shows up either way
+  int watch = inotify_fd_ < 0 ? -1
+                              : inotify_add_watch(inotify_fd_, directory.c_str(),
+                                                  kCgroupWatchMask);
+  DIR *dir = opendir(directory.c_str());
+  if (dir == nullptr)
+  {
+    if (watch >= 0)
+    {
+      inotify_rm_watch(inotify_fd_, watch);
+    }
+    return; // removed again before we got to it
+  }
+  auto inserted = cgroups_.emplace(cgroup, cgroup_t{watch, {-1, -1, -1, -1}, false});
+  if (!inserted.second)
+  {
+    closedir(dir);
+    return;
+  }
+  if (watch >= 0)
+  {
+    watches_[watch] = cgroup;
+  }
+  std::vector<std::string> children;
+  while (dirent *entry = readdir(dir))
+  {
+    if (entry->d_type == DT_DIR && entry->d_name[0] != '.')
+    {
+      children.push_back((cgroup == "/" ? "/" : cgroup + "/") + entry->d_name);
+    }
+  }
+  closedir(dir);
+  for (const std::string &child : children)
+  {
+    Add(child);
+  }
+}
+
+void CgroupParser::Remove(const std::string &cgroup)
+{
+  auto group = cgroups_.find(cgroup);
+  if (group == cgroups_.end())
+  {
+    return;
+  }
+  auto release = [this](cgroup_t &removed)
+  {
+    for (int fd : removed.fds)
+    {
+      if (fd >= 0)
+      {
+        close(fd);
+      }
+    }
+    // The kernel drops the watch of a removed directory by itself
+    watches_.erase(removed.watch);
+  };
+  // Descendants share the prefix and so sort next to each other,
+  // though not necessarily right after the group ("/a-b" < "/a/b")
+  std::string const prefix = cgroup == "/" ? cgroup : cgroup + "/";
+  auto first = cgroups_.lower_bound(prefix);
+  auto last = first;
+  while (last != cgroups_.end() &&
+         last->first.compare(0, prefix.size(), prefix) == 0)
+  {
+    release(last->second);
+    ++last;
+  }
+  cgroups_.erase(first, last);
+  group = cgroups_.find(cgroup);
+  if (group != cgroups_.end())
+  {
+    release(group->second);
+    cgroups_.erase(group);
+  }
+}
+
+void CgroupParser::Rescan()
+{
+  for (const auto &watch : watches_)
+  {
+    inotify_rm_watch(inotify_fd_, watch.first);
+  }
+  watches_.clear();
+  Remove("/");
+  Add("/");
+}
+
+bool CgroupParser::Refresh()
+{
+  if (inotify_fd_ < 0)
+  {
+    return false;
+  }
+  telemetry::ScopedProbe probe(telemetry::Probe::kCgroup);
+  bool changed = false;
+  alignas(inotify_event) char buffer[4096];
+  ssize_t length;
+  while ((length = read(inotify_fd_, buffer, sizeof(buffer))) > 0)
+  {
+    for (char *p = buffer; p < buffer + length;)
+    {
+      const inotify_event *event = reinterpret_cast<inotify_event *>(p);
+      p += sizeof(inotify_event) + event->len;
+      if (event->mask & IN_Q_OVERFLOW)
+      {
+        // Events were lost, walk the tree once to catch up
+        Rescan();
+        return true;
+      }
+      auto parent = watches_.find(event->wd);
+      if (parent == watches_.end() || event->len == 0 ||
+          !(event->mask & IN_ISDIR))
+      {
+        continue;
+      }
+      std::string const cgroup =
+          (parent->second == "/" ? "/" : parent->second + "/") + event->name;
+      if (event->mask & IN_CREATE)
+      {
+        Add(cgroup);
+      }
+      else if (event->mask & IN_DELETE)
+      {
+        Remove(cgroup);
+      }
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+std::vector<std::string> CgroupParser::GetCgroups()
+{
+  std::vector<std::string> cgroups;
+  cgroups.reserve(cgroups_.size());
+  for (const auto &entry : cgroups_)
+  {
+    cgroups.push_back(entry.first);
+  }
+  return cgroups;
+}
+
+bool CgroupParser::GetStat(const std::string &cgroup, cgroup_stat_t &stat)
+{
+  telemetry::ScopedProbe probe(telemetry::Probe::kCgroup);
+  auto entry = cgroups_.find(cgroup);
+  if (entry == cgroups_.end())
+  {
+    return false;
+  }
+  cgroup_t &group = entry->second;
+  if (!group.opened)
+  {
+    std::string const directory = cgroup == "/" ? root_ : root_ + cgroup;
+    for (int i = 0; i < kStatFileCount; ++i)
+    {
+      group.fds[i] = open((directory + kCgroupStatFiles[i]).c_str(),
+                          O_RDONLY | O_CLOEXEC);
+    }
+    group.opened = true;
+  }
+  stat = {};
+  char buffer[4096];
+  ssize_t length = ReadAt(group.fds[kCpuStat], buffer, sizeof(buffer));
+  if (length <= 0)
+  {
+    return false; // cpu.stat exists in every group, it was removed
+  }
+  ParseFlatKeyed(buffer, buffer + length,
+                 {{"usage_usec", &stat.usage_usec},
+                  {"throttled_usec", &stat.throttled_usec}});
+  length = ReadAt(group.fds[kMemoryCurrent], buffer, sizeof(buffer));
+  if (length > 0)
+  {
+    std::from_chars(buffer, buffer + length, stat.memory_bytes);
+  }
+  length = ReadAt(group.fds[kMemoryStat], buffer, sizeof(buffer));
+  if (length > 0)
+  {
+    ParseFlatKeyed(buffer, buffer + length,
+                   {{"anon", &stat.anon_bytes}, {"file", &stat.file_bytes}});
+  }
+  length = ReadAt(group.fds[kIoStat], buffer, sizeof(buffer));
+  if (length > 0)
+  {
+    ParseIoStat(buffer, buffer + length, stat);
+  }
+  return true;
+}
+
+std::string CgroupParser::GetProcessCgroup(int pid)
+{
+  telemetry::ScopedProbe probe(telemetry::Probe::kCgroup);
+  return ProcessParser::GetCgroup(pid);
+}
+
+// -----------------------------
+// NumaParser Implementation
+
+namespace
+{
+// "0-3,8-11" -> 0 1 2 3 8 9 10 11, an empty list for memory-only nodes
+std::vector<int> ParseCpuList(const char *p, const char *end)
+{
+  std::vector<int> cpus;
+  while (p < end)
+  {
+    int first = 0;
+    auto result = std::from_chars(p, end, first);
+    if (result.ec != std::errc())
+    {
+      break;
+    }
+    int last = first;
+    p = result.ptr;
+    if (p < end && *p == '-')
+    {
+      result = std::from_chars(p + 1, end, last);
+      p = result.ptr;
+    }
+    for (int cpu = first; cpu <= last; ++cpu)
+    {
+      cpus.push_back(cpu);
+    }
+    if (p < end && *p == ',')
+    {
+      ++p;
+    }
+    else
+    {
+      break;
+    }
+  }
+  return cpus;
+}
+} // namespace
+
+NumaParser::NumaParser(std::string root)
+    : root_(root.empty() ? LinuxFilesSet.at("kNodeDirectory") : std::move(root))
+{
+}
+
+NumaParser::~NumaParser()
+{
+  for (auto &entry : nodes_)
+  {
+    for (int fd : {entry.second.meminfo_fd, entry.second.numastat_fd})
+    {
+      if (fd >= 0)
+      {
+        close(fd);
+      }
+    }
+  }
+}
+
+std::vector<int> NumaParser::GetNodes()
+{
+  std::vector<int> nodes;
+  DIR *dir = opendir(root_.c_str());
+  if (dir == nullptr)
+  {
+    return nodes;
+  }
+  while (dirent *entry = readdir(dir))
+  {
+    const char *const name = entry->d_name;
+    int node = 0;
+    auto const length = std::strlen(name);
+    if (length > 4 && std::strncmp(name, "node", 4) == 0 &&
+        std::from_chars(name + 4, name + length, node).ptr == name + length)
+    {
+      nodes.push_back(node);
+    }
+  }
+  closedir(dir);
+  std::sort(nodes.begin(), nodes.end());
+  return nodes;
+}
+
+bool NumaParser::GetNode(int node, numa_node_stat_t &stat)
+{
+  telemetry::ScopedProbe probe(telemetry::Probe::kNuma);
+  auto entry = nodes_.find(node);
+  if (entry == nodes_.end())
+  {
+    std::string const directory = root_ + "/node" + std::to_string(node);
+    node_files_t files{
+        open((directory + "/meminfo").c_str(), O_RDONLY | O_CLOEXEC),
+        open((directory + "/numastat").c_str(), O_RDONLY | O_CLOEXEC),
+        {}};
+    if (files.meminfo_fd < 0)
+    {
+      if (files.numastat_fd >= 0)
+      {
+        close(files.numastat_fd);
+      }
+      return false;
+    }
+    std::ifstream cpulist(directory + "/cpulist");
+    std::string line;
+    std::getline(cpulist, line);
+    files.cpus = ParseCpuList(line.data(), line.data() + line.size());
+    entry = nodes_.emplace(node, std::move(files)).first;
+  }
+  stat = {};
+  stat.cpus = entry->second.cpus;
+  char buffer[4096];
+  ssize_t length = ReadAt(entry->second.meminfo_fd, buffer, sizeof(buffer));
+  if (length <= 0)
+  {
+    return false; // the node went offline
+  }
+  // "Node 0 MemTotal:       65843088 kB"
+  ParseColonKeyed(buffer, buffer + length,
+                  {{"MemTotal", &stat.total_kb},
+                   {"MemFree", &stat.free_kb},
+                   {"FilePages", &stat.file_kb},
+                   {"AnonPages", &stat.anon_kb}});
+  length = ReadAt(entry->second.numastat_fd, buffer, sizeof(buffer));
+  if (length > 0)
+  {
+    ParseFlatKeyed(buffer, buffer + length,
+                   {{"numa_hit", &stat.numa_hit},
+                    {"numa_miss", &stat.numa_miss},
+                    {"numa_foreign", &stat.numa_foreign},
+                    {"local_node", &stat.local_node},
+                    {"other_node", &stat.other_node}});
+  }
+  return true;
+}
+
+bool NumaParser::GetNumaMaps(int pid, std::vector<unsigned long long> &node_kb)
+{
+  telemetry::ScopedProbe probe(telemetry::Probe::kNuma);
+  std::string const path = LinuxFilesSet.at("kProcDirectory") +
+                           std::to_string(pid) +
+                           LinuxFilesSet.at("kPidNumaMapsFilename");
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    return false;
+  }
+  // One line per mapping, the kernel hands it out a page at a time
+  if (buffer_.empty())
+  {
+    buffer_.resize(64 * 1024);
+  }
+  std::size_t size = 0;
+  while (true)
+  {
+    ssize_t const length =
+        read(fd, buffer_.data() + size, buffer_.size() - size);
+    if (length < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (length <= 0)
+    {
+      break;
+    }
+    size += static_cast<std::size_t>(length);
+    if (size == buffer_.size())
+    {
+      buffer_.resize(buffer_.size() * 2);
+    }
+  }
+  close(fd);
+  if (size == 0)
+  {
+    return false; // exited, or reading it needs ptrace access
+  }
+
+  // "7f3a... default file=/usr/lib/libc.so.6 mapped=40 N0=32 N1=8 kernelpagesize_kB=4"
+  node_kb.clear();
+  const char *p = buffer_.data();
+  const char *const end = p + size;
+  std::vector<std::pair<int, unsigned long long>> pages;
+  while (p < end)
+  {
+    const char *const line_end = std::find(p, end, '\n');
+    unsigned long long page_kb = 4;
+    pages.clear();
+    while (p < line_end)
+    {
+      const char *const token_end = std::find(p, line_end, ' ');
+      const char *const equals = std::find(p, token_end, '=');
+      int node = 0;
+      unsigned long long value = 0;
+      if (*p == 'N' && equals < token_end &&
+          std::from_chars(p + 1, equals, node).ptr == equals &&
+          std::from_chars(equals + 1, token_end, value).ec == std::errc())
+      {
+        pages.emplace_back(node, value);
+      }
+      else if (std::string_view(p, equals - p) == "kernelpagesize_kB")
+      {
+        std::from_chars(equals + 1, token_end, page_kb);
+      }
+      p = token_end + 1;
+    }
+    for (const auto &entry : pages)
+    {
+      if (node_kb.size() <= static_cast<std::size_t>(entry.first))
+      {
+        node_kb.resize(entry.first + 1, 0);
+      }
+      node_kb[entry.first] += entry.second * page_kb;
+    }
+    p = line_end + 1;
+  }
+  return true;
+}
+
+// -----------------------------
+// SystemParser Implementation
+
+SystemParser::SystemParser(CpuParser &cpuParser, MemoryParser &memoryParser,
+                           ProcessParser &processParser,
+                           PressureParser &pressureParser)
+    : cpuParser_(cpuParser),
+      memoryParser_(memoryParser),
+      processParser_(processParser),
+      pressureParser_(pressureParser) {}
+
+SystemParser::~SystemParser()
+{
+  for (int fd : {uptime_fd_, loadavg_fd_})
+  {
+    if (fd >= 0)
+    {
+      close(fd);
+    }
+  }
+}
+
+bool SystemParser::Collect(metric_snapshot_t &metrics)
+{
+  telemetry::ScopedProbe probe(telemetry::Probe::kSystem);
+  char buffer[128];
+  // "12345.67 54321.00"
+  ssize_t length =
+      ReadSmall(uptime_fd_, LinuxFilesSet.at("kUptimeFilename"), buffer,
+                sizeof(buffer));
+  if (length <= 0)
+  {
+    return false;
+  }
+  const char *end = buffer + length;
+  auto result = std::from_chars(buffer, end, metrics.uptime_seconds);
+  std::from_chars(SkipBlanks(result.ptr, end), end, metrics.idle_seconds);
+
+  // "0.52 0.58 0.59 2/1234 5678"
+  length = ReadSmall(loadavg_fd_, LinuxFilesSet.at("kLoadavgFilename"), buffer,
+                     sizeof(buffer));
+  if (length <= 0)
+  {
+    return false;
+  }
+  end = buffer + length;
+  const char *p = buffer;
+  for (float *load : {&metrics.load1, &metrics.load5, &metrics.load15})
+  {
+    result = std::from_chars(SkipBlanks(p, end), end, *load);
+    p = result.ptr;
+  }
+  p = std::find(p, end, '/');
+  if (p < end)
+  {
+    std::from_chars(p + 1, end, metrics.threads);
+  }
+  return true;
+}
+
+std::string SystemParser::GetTemperature()
+{
+  // Implementation to retrieve system temperature (if available)
+  // Example:
+  return "Temperature Data";
+}
+
+std::string SystemParser::GetDiskUsage()
+{
+  // Implementation to retrieve disk usage data
+  // Example:
+  return "Disk Usage Data";
+}
+
+std::string SystemParser::GetLogs()
+{
+  // Implementation to retrieve system logs
+  // Example:
+  return "Logs Data";
+}
+
+std::string SystemParser::GetHistoricalUsageData()
+{
+  // Implementation to retrieve historical usage data
+  // Example:
+  return "Historical Data";
+}
+
+std::string SystemParser::GetResponseTime()
+{
+  // Time spent inside each parser, merged over all threads that called
+  // it, and the collector's wakeup to publish cycle
+  return telemetry::Describe({telemetry::Probe::kCpu, telemetry::Probe::kMemory,
+                              telemetry::Probe::kProcess,
+                              telemetry::Probe::kSystem,
+                              telemetry::Probe::kCgroup,
+                              telemetry::Probe::kNetwork,
+                              telemetry::Probe::kPressure,
+                              telemetry::Probe::kInterrupts,
+                              telemetry::Probe::kNuma,
+                              telemetry::Probe::kCollection});
+}
+
+std::string SystemParser::GetLatency()
+{
+  // How long runnable tasks waited for each CPU, averaged since boot
+  std::vector<cpu_schedstat_t> cpus;
+  if (!cpuParser_.GetSchedStat(cpus))
+  {
+    return "Run-queue latency unavailable: no /proc/schedstat.\n";
+  }
+  std::string text;
+  char buffer[32];
+  for (const cpu_schedstat_t &cpu : cpus)
+  {
+    text += "cpu" + std::to_string(cpu.cpu) + ": ";
+    std::uint64_t const per_slice =
+        cpu.timeslices > 0 ? cpu.wait_ns / cpu.timeslices : 0;
+    text.append(buffer, Format::Duration(per_slice, buffer, sizeof(buffer)));
+    text += " per slice, ";
+    text.append(buffer, Format::Duration(cpu.wait_ns, buffer, sizeof(buffer)));
+    text += " waited\n";
+  }
+  return text;
+}
+
+std::string SystemParser::GetPressure()
+{
+  std::string text;
+  char buffer[96];
+  for (int i = 0; i < kPsiResourceCount; ++i)
+  {
+    auto const resource = static_cast<PsiResource>(i);
+    pressure_t pressure;
+    if (!pressureParser_.GetPressure(resource, pressure))
+    {
+      continue;
+    }
+    int length = std::snprintf(
+        buffer, sizeof(buffer),
+        "%s: some %.2f%% %.2f%% %.2f%%, full %.2f%% %.2f%% %.2f%%\n",
+        PsiResourceName(resource), pressure.some.avg10, pressure.some.avg60,
+        pressure.some.avg300, pressure.full.avg10, pressure.full.avg60,
+        pressure.full.avg300);
+    text.append(buffer, std::min<std::size_t>(length, sizeof(buffer) - 1));
+  }
+  return text.empty() ? "Pressure Stall Information unavailable.\n" : text;
+}
+
+std::string SystemParser::GetPressureEvents()
+{
+  std::string text;
+  char stamp[16];
+  for (const psi_event_t &event : pressureParser_.RecentEvents())
+  {
+    std::time_t const when = std::chrono::system_clock::to_time_t(event.when);
+    std::tm local;
+    localtime_r(&when, &local);
+    std::strftime(stamp, sizeof(stamp), "%H:%M:%S", &local);
+    text += std::string(stamp) + " " + PsiResourceName(event.resource) + " " +
+            event.spec + "\n";
+  }
+  return text;
 }
 
 std::string SystemParser::GetPlatformSpecificData()
@@ -1,5 +1,6 @@
 #include <unistd.h>
 #include <cctype>
+#include <cerrno>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -10,24 +11,91 @@ using std::string;
 using std::to_string;
 using std::vector;
 
-// TODO: Return this process's ID
-int Process::Pid() { return 0; }
+Process::Process(int pid) : pid_(pid) {}
 
-// TODO: Return this process's CPU utilization
-float Process::CpuUtilization() { return 0; }
+int Process::Pid() const { return pid_; }
 
-// TODO: Return the command that generated this process
-string Process::Command() { return string(); }
+// Share of one CPU used since the previous Update()
+float Process::CpuUtilization() { return cpu_utilization_; }
 
-// TODO: Return this process's memory utilization
-string Process::Ram() { return string(); }
+long int Process::UpTime() { return uptime_; }
 
-// TODO: Return the user (name) that generated this process
-string Process::User() { return string(); }
+bool Process::Update(parser_factory::ProcessParser& parser,
+                     double system_uptime) {
+  parser_factory::pid_stat_t stat;
+  if (!parser.GetStat(pid_, stat)) return false;
+  Refresh(stat, system_uptime);
+  UpdateIo(parser, system_uptime);
+  return true;
+}
 
-// TODO: Return the age of this process (in seconds)
-long int Process::UpTime() { return 0; }
+void Process::UpdateIo(parser_factory::ProcessParser& parser,
+                       double system_uptime) {
+  if (!WantsIo()) return;
+  parser_factory::pid_io_t io;
+  bool const read = parser.GetIo(pid_, io);
+  RefreshIo(read ? &io : nullptr, read ? 0 : errno, system_uptime);
+}
 
-// TODO: Overload the "less than" comparison operator for Process objects
-// REMOVE: [[maybe_unused]] once you define the function
-bool Process::operator<(Process const& a[[maybe_unused]]) const { return true; }
\ No newline at end of file
+void Process::Refresh(const parser_factory::pid_stat_t& stat,
+                      double system_uptime) {
+  // Same pid but a different start time means the pid was reused
+  if (sampled_ && stat.starttime != stat_.starttime) {
+    sampled_ = false;
+    energy_joules_ = 0.0;
+    io_rates_ = {};
+    io_sampled_ = false;
+    io_denied_ = false;
+    admitted_ = 0;
+  }
+  stat_ = stat;
+
+  static const long hertz = sysconf(_SC_CLK_TCK);
+  double const started = static_cast<double>(stat_.starttime) / hertz;
+  uptime_ = static_cast<long>(system_uptime - started);
+  unsigned long const jiffies = stat_.getActiveJiffies();
+  double const elapsed =
+      sampled_ ? system_uptime - last_system_uptime_ : system_uptime - started;
+  unsigned long const used = sampled_ ? jiffies - last_jiffies_ : jiffies;
+  cpu_utilization_ =
+      elapsed > 0 ? static_cast<float>(used / (elapsed * hertz)) : 0.0f;
+
+  sampled_ = true;
+  last_system_uptime_ = system_uptime;
+  last_jiffies_ = jiffies;
+}
+
+void Process::RefreshIo(const parser_factory::pid_io_t* io, int error,
+                        double system_uptime) {
+  if (io == nullptr) {
+    io_denied_ = error == EACCES;
+    io_sampled_ = false;
+    return;
+  }
+  double const elapsed = system_uptime - last_io_uptime_;
+  // Counters of an exec'd or setuid process can drop, start over then
+  if (io_sampled_ && elapsed > 0 && io->read_bytes >= last_io_.read_bytes &&
+      io->write_bytes >= last_io_.write_bytes &&
+      io->cancelled_write_bytes >= last_io_.cancelled_write_bytes &&
+      io->syscr >= last_io_.syscr && io->syscw >= last_io_.syscw) {
+    double const written =
+        static_cast<double>(io->write_bytes - last_io_.write_bytes);
+    double const cancelled = static_cast<double>(
+        io->cancelled_write_bytes - last_io_.cancelled_write_bytes);
+    io_rates_.read_bytes = (io->read_bytes - last_io_.read_bytes) / elapsed;
+    io_rates_.write_bytes =
+        (written > cancelled ? written - cancelled : 0.0) / elapsed;
+    io_rates_.cancelled_write_bytes = cancelled / elapsed;
+    io_rates_.syscr = (io->syscr - last_io_.syscr) / elapsed;
+    io_rates_.syscw = (io->syscw - last_io_.syscw) / elapsed;
+  } else {
+    io_rates_ = {};
+  }
+  io_sampled_ = true;
+  last_io_ = *io;
+  last_io_uptime_ = system_uptime;
+}
+
+bool Process::operator<(Process const& a) const {
+  return cpu_utilization_ < a.cpu_utilization_;
+}
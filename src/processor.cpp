@@ -1,4 +1,7 @@
 #include "processor.h"
 
-// TODO: Return the aggregate CPU utilization
-float Processor::Utilization() { return 0.0; }
\ No newline at end of file
+float Processor::Utilization() {
+  parser_factory::metric_snapshot_t metrics{};
+  if (parser_.Collect(metrics)) utilization_ = metrics.cpu_utilization;
+  return utilization_;
+}
@@ -0,0 +1,154 @@
+#include "snapshot/cgroup_sampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+#include <utility>
+
+using namespace snapshot;
+
+namespace
+{
+// "/a/b" -> "/a", "/a" -> "/", "/" -> ""
+std::string ParentOf(const std::string &cgroup)
+{
+  if (cgroup == "/")
+  {
+    return std::string();
+  }
+  std::size_t const slash = cgroup.rfind('/');
+  return slash == 0 ? std::string("/") : cgroup.substr(0, slash);
+}
+} // namespace
+
+CgroupSampler::CgroupSampler(std::size_t max_cgroups, std::string root)
+    : max_cgroups_(max_cgroups), parser_(std::move(root))
+{
+}
+
+double CgroupSampler::Sample(std::vector<CgroupRow> &rows,
+                             Clock::time_point now)
+{
+  parser_.Refresh();
+  std::vector<std::string> cgroups = parser_.GetCgroups();
+  cgroups.resize(std::min(cgroups.size(), max_cgroups_));
+
+  std::vector<CgroupRow> previous = std::move(rows);
+  rows.clear();
+  next_samples_.clear();
+  double change = 0.0;
+  auto before_row = previous.begin();
+  for (std::string &cgroup : cgroups)
+  {
+    parser_factory::cgroup_stat_t stat;
+    if (!parser_.GetStat(cgroup, stat))
+    {
+      continue; // removed since the last refresh
+    }
+    cgroup_row_t row{};
+    row.memory_kb = static_cast<long>(stat.memory_bytes / 1024);
+    row.anon_kb = static_cast<long>(stat.anon_bytes / 1024);
+    row.file_kb = static_cast<long>(stat.file_bytes / 1024);
+    auto sample = samples_.find(cgroup);
+    if (sample != samples_.end())
+    {
+      const parser_factory::cgroup_stat_t &last = sample->second.stat;
+      double const seconds =
+          std::chrono::duration<double>(now - sample->second.when).count();
+      // Counters restart when a group is removed and created again
+      if (seconds > 0.0 && stat.usage_usec >= last.usage_usec)
+      {
+        row.cpu_utilization = static_cast<float>(
+            (stat.usage_usec - last.usage_usec) / 1e6 / seconds);
+        row.throttled = static_cast<float>(
+            (stat.throttled_usec - std::min(stat.throttled_usec,
+                                            last.throttled_usec)) /
+            1e6 / seconds);
+        row.read_rate = (stat.read_bytes - std::min(stat.read_bytes,
+                                                    last.read_bytes)) /
+                        seconds;
+        row.write_rate = (stat.write_bytes - std::min(stat.write_bytes,
+                                                      last.write_bytes)) /
+                         seconds;
+      }
+    }
+    // Both lists are in path order
+    while (before_row != previous.end() && before_row->path < cgroup)
+    {
+      ++before_row;
+    }
+    if (before_row != previous.end() && before_row->path == cgroup)
+    {
+      change = std::max(change, static_cast<double>(std::abs(
+                                    row.cpu_utilization -
+                                    before_row->cpu_utilization)));
+      row.processes = before_row->processes;
+    }
+    next_samples_[cgroup] = {stat, now};
+    row.path = std::move(cgroup);
+    rows.push_back(std::move(row));
+  }
+  std::swap(samples_, next_samples_);
+  return change;
+}
+
+void CgroupSampler::Assign(std::vector<ProcessRow> &processes,
+                           std::vector<CgroupRow> &rows)
+{
+  std::unordered_map<std::string, int> index;
+  index.reserve(rows.size());
+  for (std::size_t i = 0; i < rows.size(); ++i)
+  {
+    index.emplace(rows[i].path, static_cast<int>(i));
+    rows[i].processes = 0;
+  }
+  // Nearest sampled ancestor of a group, -1 above the root
+  auto nearest = [&index](std::string cgroup)
+  {
+    for (; !cgroup.empty(); cgroup = ParentOf(cgroup))
+    {
+      auto found = index.find(cgroup);
+      if (found != index.end())
+      {
+        return found->second;
+      }
+    }
+    return -1;
+  };
+  std::vector<int> parents(rows.size());
+  for (std::size_t i = 0; i < rows.size(); ++i)
+  {
+    parents[i] = nearest(ParentOf(rows[i].path));
+  }
+
+  std::unordered_set<int> seen;
+  seen.reserve(processes.size());
+  for (ProcessRow &process : processes)
+  {
+    seen.insert(process.pid);
+    auto member = members_.find(process.pid);
+    if (member == members_.end() ||
+        member->second.starttime != process.starttime)
+    {
+      // A new process, or a reused pid
+      member = members_
+                   .insert_or_assign(process.pid,
+                                     membership_t{process.starttime,
+                                                  parser_.GetProcessCgroup(
+                                                      process.pid)})
+                   .first;
+    }
+    process.cgroup = member->second.cgroup.empty()
+                         ? -1
+                         : nearest(member->second.cgroup);
+    for (int i = process.cgroup; i >= 0; i = parents[i])
+    {
+      ++rows[i].processes;
+    }
+  }
+  for (auto member = members_.begin(); member != members_.end();)
+  {
+    member = seen.count(member->first) ? std::next(member)
+                                       : members_.erase(member);
+  }
+}
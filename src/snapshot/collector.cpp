@@ -0,0 +1,354 @@
+#include "snapshot/collector.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "logger/logger_singletone.h"
+#include "stop_signal.h"
+
+using namespace snapshot;
+
+namespace
+{
+// Periods are quantum << level, level 3 is the configured interval
+constexpr int kBaseLevel = 3;
+constexpr int kMaxLevel = 6;
+// A 5 point move of a utilization counts as a fast change
+constexpr double kFastUtilizationDelta = 0.05;
+// As does a change in 5% of the process rows
+constexpr double kFastRowShare = 0.05;
+// Or half a task more or less waiting on any run queue
+constexpr double kFastWaitingDelta = 0.5;
+// Or a quarter of a CPU more or less used by a cgroup
+constexpr double kFastCgroupCpuDelta = 0.25;
+// Or a quarter more or less interrupts on any CPU
+constexpr double kFastInterruptShare = 0.25;
+// Or 5 points of stall share within the last 10 seconds
+constexpr double kFastPressureDelta = 5.0;
+// Or a tenth more or less PSS in one of the largest processes
+constexpr double kFastMemoryShare = 0.1;
+// Or a tenth more or less descriptors in one of the processes with most
+constexpr double kFastFdShare = 0.1;
+} // namespace
+
+Collector::Collector(System &system, SnapshotPublisher &publisher,
+                     std::chrono::milliseconds interval, bool adaptive,
+                     double overhead_budget)
+    : system_(system), publisher_(publisher),
+      scheduler_(std::chrono::duration_cast<SamplingScheduler::Clock::duration>(
+                     interval) /
+                     (1 << kBaseLevel),
+                 overhead_budget, adaptive)
+{
+  scheduler_.SetPool(&pool_);
+  // Scan first so the counters describe the same process list
+  int const processes =
+      scheduler_.AddTask("processes", 1, kBaseLevel, kMaxLevel,
+                         [this] { return SampleProcesses(); });
+  scheduler_.AddTask("system", 0, kBaseLevel, kMaxLevel,
+                     [this] { return SampleSystem(); });
+  scheduler_.AddTask("run_queues", 0, kBaseLevel, kMaxLevel,
+                     [this] { return SampleRunQueues(); });
+  scheduler_.AddTask("interrupts", 0, kBaseLevel, kMaxLevel,
+                     [this] { return SampleInterrupts(); });
+  scheduler_.AddTask("pressure", 0, kBaseLevel, kMaxLevel,
+                     [this] { return SamplePressure(); });
+  scheduler_.AddTask("numa", 1, kBaseLevel, kMaxLevel,
+                     [this] { return SampleNuma(); });
+  scheduler_.AddTask("cgroups", 1, kBaseLevel, kMaxLevel,
+                     [this] { return SampleCgroups(); });
+  // Both read the rows of the scan when it ran in the same wakeup
+  scheduler_.AddTask("threads", 0, kBaseLevel, kMaxLevel,
+                     [this] { return SampleThreads(); }, processes);
+  // smaps_rollup is costly, it starts at a quarter of the scan rate
+  scheduler_.AddTask("memory", kBaseLevel, kBaseLevel + 2, kMaxLevel,
+                     [this] { return SampleMemory(); }, processes);
+  // Never as often as the scan, resolving descriptors takes a readlink each
+  scheduler_.AddTask("fds", kBaseLevel + 1, kBaseLevel + 1, kMaxLevel,
+                     [this] { return SampleFds(); }, processes);
+}
+
+Collector::~Collector() { Stop(); }
+
+void Collector::Start()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (running_)
+  {
+    return;
+  }
+  running_ = true;
+  thread_ = std::thread(&Collector::Run, this);
+}
+
+void Collector::Stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+  }
+  wakeup_.notify_all();
+  if (thread_.joinable())
+  {
+    thread_.join();
+  }
+}
+
+void Collector::CollectOnce()
+{
+  BeginTick();
+  WorkPool::Group group;
+  pool_.Spawn(group, [this, &group] {
+    SampleProcesses();
+    pool_.Spawn(group, [this] { SampleThreads(); });
+    pool_.Spawn(group, [this] { SampleMemory(); });
+    pool_.Spawn(group, [this] { SampleFds(); });
+  });
+  pool_.Spawn(group, [this] { SampleSystem(); });
+  pool_.Spawn(group, [this] { SampleRunQueues(); });
+  pool_.Spawn(group, [this] { SampleInterrupts(); });
+  pool_.Spawn(group, [this] { SamplePressure(); });
+  pool_.Spawn(group, [this] { SampleNuma(); });
+  pool_.Spawn(group, [this] { SampleCgroups(); });
+  pool_.Wait(group);
+  Publish();
+}
+
+void Collector::BeginTick()
+{
+  tick_ = SamplingScheduler::Clock::now();
+  tick_wall_ = std::chrono::system_clock::now();
+}
+
+void Collector::SetFilter(std::shared_ptr<const ProcessFilter> filter)
+{
+  system_.SetFilter(std::move(filter));
+}
+
+void Collector::OnPressureEvents(std::size_t count)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pressure_events_ += count;
+    sample_requested_ = true;
+  }
+  wakeup_.notify_all();
+}
+
+void Collector::Run()
+{
+  BlockStopSignals();
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (running_)
+  {
+    bool const requested = std::exchange(sample_requested_, false);
+    latest_.pressure_events = pressure_events_;
+    lock.unlock();
+    try
+    {
+      telemetry::ScopedProbe probe(telemetry::Probe::kCollection);
+      if (requested)
+      {
+        // A PSI trigger fired, show the spike now instead of next period
+        CollectOnce();
+      }
+      else
+      {
+        // Collectors sharing a deadline run in this one wakeup
+        BeginTick();
+        if (scheduler_.RunDue(tick_) > 0)
+        {
+          Publish();
+        }
+      }
+    }
+    catch (const std::exception &e)
+    {
+      Logger::GetInstance().Log(LogLevel::ERROR,
+                                "Snapshot collection failed: " +
+                                    std::string(e.what()));
+    }
+    lock.lock();
+    wakeup_.wait_until(lock, scheduler_.NextDeadline(),
+                       [this] { return !running_ || sample_requested_; });
+  }
+}
+
+void Collector::Publish()
+{
+  if (cgroups_stale_.exchange(false))
+  {
+    cgroups_.Assign(latest_.processes, latest_.cgroups);
+  }
+  latest_.latencies.clear();
+  for (int i = 0; i < telemetry::kProbeCount; ++i)
+  {
+    auto const probe = static_cast<telemetry::Probe>(i);
+    merged_.Reset();
+    telemetry::MergeProbe(probe, merged_);
+    if (merged_.Count() == 0)
+    {
+      continue;
+    }
+    latest_.latencies.push_back({telemetry::ProbeName(probe), merged_.Count(),
+                                 merged_.Sum(), merged_.Percentile(50),
+                                 merged_.Percentile(99), merged_.Max()});
+  }
+  auto snapshot = std::make_unique<SystemSnapshot>(latest_);
+  snapshot->timestamp = tick_wall_;
+  publisher_.Publish(std::move(snapshot));
+}
+
+double Collector::SampleSystem()
+{
+  parser_factory::metric_snapshot_t &metrics = latest_.metrics;
+  system_.Collect(metrics);
+  float const cpu = metrics.cpu_utilization;
+  float const memory = metrics.memory_utilization;
+  double const score =
+      std::max(std::abs(cpu - latest_.cpu_utilization),
+               std::abs(memory - latest_.memory_utilization)) /
+      kFastUtilizationDelta;
+  latest_.operating_system = system_.OperatingSystem();
+  latest_.kernel = system_.Kernel();
+  latest_.cpu_utilization = cpu;
+  latest_.memory_utilization = memory;
+  latest_.uptime = static_cast<long>(metrics.uptime_seconds);
+  latest_.running_processes = metrics.procs_running;
+  return score;
+}
+
+double Collector::SampleRunQueues()
+{
+  return run_queues_.SampleCpus(latest_.run_queues, tick_) / kFastWaitingDelta;
+}
+
+double Collector::SampleInterrupts()
+{
+  return interrupts_.Sample(latest_.interrupts, latest_.interrupt_sources,
+                            tick_) /
+         kFastInterruptShare;
+}
+
+double Collector::SamplePressure()
+{
+  return pressure_.Sample(latest_.pressure) / kFastPressureDelta;
+}
+
+double Collector::SampleNuma()
+{
+  return numa_.Sample(latest_.numa_nodes, latest_.numa_placements, tick_) /
+         kFastUtilizationDelta;
+}
+
+double Collector::SampleCgroups()
+{
+  cgroups_stale_ = true;
+  return cgroups_.Sample(latest_.cgroups, tick_) / kFastCgroupCpuDelta;
+}
+
+double Collector::SampleThreads()
+{
+  return threads_.Sample(latest_.processes, latest_.threads, tick_) /
+         kFastUtilizationDelta;
+}
+
+double Collector::SampleMemory()
+{
+  return memory_.Sample(latest_.processes) / kFastMemoryShare;
+}
+
+double Collector::SampleFds()
+{
+  return fds_.Sample(latest_.processes) / kFastFdShare;
+}
+
+double Collector::SampleProcesses()
+{
+  static const long page_kb = sysconf(_SC_PAGESIZE) / 1024;
+  std::vector<Process> &processes = system_.Processes(&pool_);
+  std::vector<process_row_t> rows;
+  rows.reserve(processes.size());
+  for (Process &process : processes)
+  {
+    const parser_factory::pid_stat_t &stat = process.Stat();
+    process_row_t row;
+    row.pid = process.Pid();
+    row.ppid = stat.ppid;
+    row.state = stat.state;
+    std::memcpy(row.comm, stat.comm, sizeof(row.comm));
+    row.starttime = stat.starttime;
+    row.cpu_utilization = process.CpuUtilization();
+    row.uptime = process.UpTime();
+    row.num_threads = stat.num_threads;
+    row.rss_kb = stat.rss * page_kb;
+    row.pss_kb = row.uss_kb = row.swap_kb = -1;
+    row.fds = row.fd_sockets = row.fd_pipes = row.fd_files = -1;
+    row.fd_limit = -1;
+    if (process.IoReadable())
+    {
+      const io_rates_t &io = process.Io();
+      row.read_rate = io.read_bytes;
+      row.write_rate = io.write_bytes;
+      row.syscr_rate = static_cast<float>(io.syscr);
+      row.syscw_rate = static_cast<float>(io.syscw);
+      row.io_rate = io.read_bytes + io.write_bytes;
+    }
+    else
+    {
+      row.read_rate = row.write_rate = -1.0;
+      row.syscr_rate = row.syscw_rate = 0.0f;
+      row.io_rate = 0.0;
+    }
+    row.energy_joules = process.Energy();
+    row.cgroup = -1;
+    row.source = 0;
+    rows.push_back(row);
+  }
+  run_queues_.SampleProcesses(rows, tick_);
+  memory_.Apply(rows);
+  fds_.Apply(rows);
+  tree_.Update(rows);
+
+  // Both lists are sorted by pid, count started, exited and busier rows
+  std::size_t changed = 0;
+  auto previous = latest_.processes.begin();
+  for (const process_row_t &row : rows)
+  {
+    while (previous != latest_.processes.end() && previous->pid < row.pid)
+    {
+      ++previous;
+      ++changed;
+    }
+    if (previous == latest_.processes.end() || previous->pid != row.pid ||
+        previous->starttime != row.starttime)
+    {
+      ++changed;
+      continue;
+    }
+    if (std::abs(row.cpu_utilization - previous->cpu_utilization) >=
+        kFastUtilizationDelta)
+    {
+      ++changed;
+    }
+    ++previous;
+  }
+  changed += latest_.processes.end() - previous;
+  double const share =
+      latest_.processes.empty()
+          ? 0.0
+          : static_cast<double>(changed) / std::max<std::size_t>(rows.size(), 1);
+
+  latest_.processes = std::move(rows);
+  cgroups_stale_ = true;
+  latest_.total_processes = system_.TotalProcesses();
+  latest_.filter = system_.FilterExpression();
+  return share / kFastRowShare;
+}
@@ -0,0 +1,87 @@
+#include "snapshot/fd_sampler.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+using namespace snapshot;
+
+FdSampler::FdSampler(std::size_t top_processes) : top_processes_(top_processes)
+{
+}
+
+void FdSampler::Fill(ProcessRow &row, const fd_entry_t &entry)
+{
+  row.fds = entry.fds;
+  bool const resolved = entry.kinds.total >= 0;
+  row.fd_sockets = resolved ? entry.kinds.sockets : -1;
+  row.fd_pipes = resolved ? entry.kinds.pipes : -1;
+  row.fd_files = resolved ? entry.kinds.files : -1;
+  row.fd_limit = entry.limit;
+}
+
+double FdSampler::Sample(std::vector<ProcessRow> &rows)
+{
+  next_samples_.clear();
+  for (ProcessRow &row : rows)
+  {
+    // Fails for exited processes and for those of other users without
+    // CAP_SYS_PTRACE, their rows stay uncounted
+    row.fds = parser_.CountFds(row.pid);
+    if (row.fds >= 0)
+    {
+      next_samples_[row.pid] = {row.starttime, row.fds, {-1, 0, 0, 0, 0}, -1};
+    }
+  }
+
+  double change = 0.0;
+  for (std::uint32_t index :
+       selector_.Select(rows, SortKey::kFds, top_processes_))
+  {
+    ProcessRow &row = rows[index];
+    auto next = next_samples_.find(row.pid);
+    if (next == next_samples_.end() || row.fds == 0)
+    {
+      continue;
+    }
+    fd_entry_t &entry = next->second;
+    entry.limit = parser_.GetFdLimit(row.pid);
+    if (parser_.GetFds(row.pid, entry.kinds))
+    {
+      // Resolving saw the descriptors a moment later, its total is newer
+      entry.fds = entry.kinds.total;
+    }
+    else
+    {
+      entry.kinds.total = -1;
+    }
+    auto previous = samples_.find(row.pid);
+    if (previous != samples_.end() &&
+        previous->second.starttime == row.starttime)
+    {
+      int const before = previous->second.fds;
+      change = std::max(change,
+                        static_cast<double>(std::abs(entry.fds - before)) /
+                            std::max(before, 1));
+    }
+  }
+  std::swap(samples_, next_samples_);
+  Apply(rows);
+  return change;
+}
+
+void FdSampler::Apply(std::vector<ProcessRow> &rows) const
+{
+  if (samples_.empty())
+  {
+    return;
+  }
+  for (ProcessRow &row : rows)
+  {
+    auto sample = samples_.find(row.pid);
+    if (sample != samples_.end() && sample->second.starttime == row.starttime)
+    {
+      Fill(row, sample->second);
+    }
+  }
+}
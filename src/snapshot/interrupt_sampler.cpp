@@ -0,0 +1,176 @@
+#include "snapshot/interrupt_sampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <utility>
+
+using namespace snapshot;
+
+namespace
+{
+// Rates below this many interrupts a second count as this many, so an
+// idle CPU waking up once is not a large relative change
+constexpr double kMinRate = 100.0;
+} // namespace
+
+bool InterruptSampler::Advance(matrix_t &matrix, bool read)
+{
+  if (!read)
+  {
+    matrix.valid = false;
+    return false;
+  }
+  bool const comparable = matrix.valid && !matrix.table.layout_changed &&
+                          matrix.last.size() == matrix.table.counts.size();
+  if (comparable)
+  {
+    std::size_t const size = matrix.table.counts.size();
+    matrix.delta.resize(size);
+    const std::uint32_t *const counts = matrix.table.counts.data();
+    const std::uint32_t *const last = matrix.last.data();
+    std::uint32_t *const delta = matrix.delta.data();
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      delta[i] = counts[i] - last[i];
+    }
+  }
+  // The next read decodes over the old counts, no copy either way
+  std::swap(matrix.last, matrix.table.counts);
+  matrix.valid = true;
+  return comparable;
+}
+
+void InterruptSampler::Accumulate(const matrix_t &matrix, bool soft,
+                                  double seconds,
+                                  std::vector<CpuInterrupts> &cpus,
+                                  std::vector<InterruptSource> &sources)
+{
+  std::size_t const columns = cpus.size();
+  std::size_t const rows = matrix.table.names.size();
+  column_sums_.assign(columns, 0);
+  std::uint64_t *const sums = column_sums_.data();
+  for (std::size_t row = 0; row < rows; ++row)
+  {
+    const std::uint32_t *const delta = matrix.delta.data() + row * columns;
+    std::uint64_t total = 0;
+    for (std::size_t column = 0; column < columns; ++column)
+    {
+      sums[column] += delta[column];
+      total += delta[column];
+    }
+    if (total == 0)
+    {
+      continue; // most lines are idle, they are neither listed nor ranked
+    }
+    int const index = static_cast<int>(sources.size());
+    sources.push_back({matrix.table.names[row], matrix.table.descriptions[row],
+                       soft, static_cast<float>(total / seconds)});
+    for (std::size_t column = 0; column < columns; ++column)
+    {
+      std::uint32_t const count = delta[column];
+      std::uint32_t *const top = top_counts_.data() + column * kTopInterrupts;
+      if (count <= top[kTopInterrupts - 1])
+      {
+        continue;
+      }
+      int *const top_index = cpus[column].top;
+      int slot = kTopInterrupts - 1;
+      for (; slot > 0 && top[slot - 1] < count; --slot)
+      {
+        top[slot] = top[slot - 1];
+        top_index[slot] = top_index[slot - 1];
+      }
+      top[slot] = count;
+      top_index[slot] = index;
+    }
+  }
+  for (std::size_t column = 0; column < columns; ++column)
+  {
+    float const rate = static_cast<float>(sums[column] / seconds);
+    (soft ? cpus[column].soft_rate : cpus[column].hard_rate) = rate;
+  }
+}
+
+double InterruptSampler::Sample(std::vector<CpuInterrupts> &cpus,
+                                std::vector<InterruptSource> &sources,
+                                Clock::time_point now)
+{
+  bool const hard_read = parser_.GetInterrupts(hard_.table);
+  bool const soft_read = parser_.GetSoftirqs(soft_.table);
+  bool const hard = Advance(hard_, hard_read);
+  bool soft = Advance(soft_, soft_read);
+  double const seconds =
+      std::chrono::duration<double>(now - last_time_).count();
+  bool const timed = last_time_ != Clock::time_point() && seconds > 0.0;
+  last_time_ = now;
+
+  std::vector<CpuInterrupts> previous = std::move(cpus);
+  cpus.clear();
+  sources.clear();
+  if (!timed || !(hard || soft))
+  {
+    return 0.0;
+  }
+  const std::vector<int> &columns =
+      hard ? hard_.table.cpus : soft_.table.cpus;
+  if (hard && soft && soft_.table.cpus != columns)
+  {
+    soft = false; // a CPU went on or offline between the two reads
+  }
+  cpus.resize(columns.size());
+  for (std::size_t column = 0; column < columns.size(); ++column)
+  {
+    cpu_interrupts_t &cpu = cpus[column];
+    cpu.cpu = columns[column];
+    cpu.hard_rate = cpu.soft_rate = 0.0f;
+    std::fill(std::begin(cpu.top), std::end(cpu.top), -1);
+    std::fill(std::begin(cpu.top_rate), std::end(cpu.top_rate), 0.0f);
+  }
+  top_counts_.assign(columns.size() * kTopInterrupts, 0);
+  if (hard)
+  {
+    Accumulate(hard_, false, seconds, cpus, sources);
+  }
+  if (soft)
+  {
+    Accumulate(soft_, true, seconds, cpus, sources);
+  }
+
+  // Busiest first, the tops of every CPU follow their sources
+  order_.resize(sources.size());
+  std::iota(order_.begin(), order_.end(), 0);
+  std::stable_sort(order_.begin(), order_.end(), [&sources](int a, int b)
+                   { return sources[a].rate > sources[b].rate; });
+  std::vector<InterruptSource> sorted;
+  sorted.reserve(sources.size());
+  std::vector<int> rank(sources.size());
+  for (std::size_t i = 0; i < order_.size(); ++i)
+  {
+    rank[order_[i]] = static_cast<int>(i);
+    sorted.push_back(std::move(sources[order_[i]]));
+  }
+  sources = std::move(sorted);
+
+  double change = 0.0;
+  bool const same_cpus = previous.size() == cpus.size();
+  for (std::size_t column = 0; column < cpus.size(); ++column)
+  {
+    cpu_interrupts_t &cpu = cpus[column];
+    for (int slot = 0; slot < kTopInterrupts && cpu.top[slot] >= 0; ++slot)
+    {
+      cpu.top[slot] = rank[cpu.top[slot]];
+      cpu.top_rate[slot] = static_cast<float>(
+          top_counts_[column * kTopInterrupts + slot] / seconds);
+    }
+    if (same_cpus && previous[column].cpu == cpu.cpu)
+    {
+      double const before =
+          previous[column].hard_rate + previous[column].soft_rate;
+      double const after = cpu.hard_rate + cpu.soft_rate;
+      change = std::max(change,
+                        std::abs(after - before) / std::max(before, kMinRate));
+    }
+  }
+  return change;
+}
@@ -0,0 +1,67 @@
+#include "snapshot/memory_sampler.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+using namespace snapshot;
+
+MemorySampler::MemorySampler(std::size_t top_processes)
+    : top_processes_(top_processes)
+{
+}
+
+void MemorySampler::Fill(ProcessRow &row,
+                         const parser_factory::pid_memory_t &memory)
+{
+  row.pss_kb = memory.pss_kb;
+  row.uss_kb = memory.uss_kb;
+  row.swap_kb = memory.swap_kb;
+}
+
+double MemorySampler::Sample(std::vector<ProcessRow> &rows)
+{
+  double change = 0.0;
+  next_samples_.clear();
+  for (std::uint32_t index :
+       selector_.Select(rows, SortKey::kRss, top_processes_))
+  {
+    ProcessRow &row = rows[index];
+    parser_factory::pid_memory_t memory;
+    // Fails for exited processes and for those of other users without
+    // CAP_SYS_PTRACE, their rows keep RSS only
+    if (!parser_.GetSmapsRollup(row.pid, memory))
+    {
+      continue;
+    }
+    auto previous = samples_.find(row.pid);
+    if (previous != samples_.end() &&
+        previous->second.starttime == row.starttime)
+    {
+      long const before = previous->second.memory.pss_kb;
+      change = std::max(change,
+                        static_cast<double>(std::labs(memory.pss_kb - before)) /
+                            std::max(before, 1L));
+    }
+    Fill(row, memory);
+    next_samples_[row.pid] = {row.starttime, memory};
+  }
+  std::swap(samples_, next_samples_);
+  return change;
+}
+
+void MemorySampler::Apply(std::vector<ProcessRow> &rows) const
+{
+  if (samples_.empty())
+  {
+    return;
+  }
+  for (ProcessRow &row : rows)
+  {
+    auto sample = samples_.find(row.pid);
+    if (sample != samples_.end() && sample->second.starttime == row.starttime)
+    {
+      Fill(row, sample->second.memory);
+    }
+  }
+}
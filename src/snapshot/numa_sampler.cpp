@@ -0,0 +1,145 @@
+#include "snapshot/numa_sampler.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace snapshot;
+
+namespace
+{
+// Pages per second between two reads of a numastat counter
+float Rate(unsigned long long now, unsigned long long before, double seconds)
+{
+  return static_cast<float>((now - std::min(now, before)) / seconds);
+}
+} // namespace
+
+NumaSampler::NumaSampler(std::string root) : parser_(std::move(root)) {}
+
+void NumaSampler::Locate(int pid)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  located_.insert(pid);
+}
+
+void NumaSampler::Forget(int pid)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  located_.erase(pid);
+}
+
+bool NumaSampler::Located(int pid) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return located_.count(pid) != 0;
+}
+
+double NumaSampler::Sample(std::vector<NumaNodeRow> &nodes,
+                           std::vector<NumaPlacement> &placements,
+                           Clock::time_point now)
+{
+  // Nodes come and go with memory hotplug only, they are listed once
+  if (!listed_)
+  {
+    nodes_ = parser_.GetNodes();
+    listed_ = true;
+  }
+
+  // Busy and total jiffies of every CPU since the previous read
+  std::vector<std::pair<long, long>> cpu_deltas(cpu_jiffies_.size());
+  for (const parser_factory::cpu_data_t &cpu :
+       cpu_parser_.GetCpuUtilization())
+  {
+    if (cpu.cpu < 0)
+    {
+      continue;
+    }
+    std::size_t const index = static_cast<std::size_t>(cpu.cpu);
+    if (index >= cpu_jiffies_.size())
+    {
+      cpu_jiffies_.resize(index + 1, {0, 0});
+      cpu_deltas.resize(index + 1, {0, 0});
+    }
+    long const active = cpu.getActiveJiffies();
+    long const total = cpu.getTotalJiffies();
+    if (cpu_jiffies_[index].second != 0 && total > cpu_jiffies_[index].second)
+    {
+      cpu_deltas[index] = {active - cpu_jiffies_[index].first,
+                           total - cpu_jiffies_[index].second};
+    }
+    cpu_jiffies_[index] = {active, total};
+  }
+
+  std::vector<NumaNodeRow> previous = std::move(nodes);
+  nodes.clear();
+  double change = 0.0;
+  for (int node : nodes_)
+  {
+    parser_factory::numa_node_stat_t stat;
+    if (!parser_.GetNode(node, stat))
+    {
+      continue;
+    }
+    numa_node_row_t row{};
+    row.node = node;
+    row.cpus = static_cast<int>(stat.cpus.size());
+    row.total_kb = static_cast<long>(stat.total_kb);
+    row.free_kb = static_cast<long>(stat.free_kb);
+    long active = 0;
+    long total = 0;
+    for (int cpu : stat.cpus)
+    {
+      if (static_cast<std::size_t>(cpu) < cpu_deltas.size())
+      {
+        active += cpu_deltas[cpu].first;
+        total += cpu_deltas[cpu].second;
+      }
+    }
+    row.cpu_utilization =
+        total > 0 ? static_cast<float>(active) / static_cast<float>(total)
+                  : 0.0f;
+    auto sample = samples_.find(node);
+    if (sample != samples_.end())
+    {
+      const parser_factory::numa_node_stat_t &last = sample->second.stat;
+      double const seconds =
+          std::chrono::duration<double>(now - sample->second.when).count();
+      if (seconds > 0.0)
+      {
+        row.hit_rate = Rate(stat.numa_hit, last.numa_hit, seconds);
+        row.miss_rate = Rate(stat.numa_miss, last.numa_miss, seconds);
+        row.foreign_rate = Rate(stat.numa_foreign, last.numa_foreign, seconds);
+        row.other_rate = Rate(stat.other_node, last.other_node, seconds);
+      }
+    }
+    auto before = std::find_if(previous.begin(), previous.end(),
+                               [node](const NumaNodeRow &previous_row)
+                               { return previous_row.node == node; });
+    if (before != previous.end())
+    {
+      change = std::max(change, static_cast<double>(std::abs(
+                                    row.cpu_utilization -
+                                    before->cpu_utilization)));
+    }
+    samples_[node] = {std::move(stat), now};
+    nodes.push_back(row);
+  }
+
+  std::set<int> located;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    located = located_;
+  }
+  placements.clear();
+  std::vector<unsigned long long> node_kb;
+  for (int pid : located)
+  {
+    if (!parser_.GetNumaMaps(pid, node_kb))
+    {
+      Forget(pid);
+      continue;
+    }
+    placements.push_back({pid, std::vector<long>(node_kb.begin(), node_kb.end())});
+  }
+  return change;
+}
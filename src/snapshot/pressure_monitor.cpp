@@ -0,0 +1,165 @@
+#include "snapshot/pressure_monitor.h"
+
+#include <dirent.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "logger/logger_singletone.h"
+#include "stop_signal.h"
+
+using namespace snapshot;
+using parser_factory::kPsiResourceCount;
+using parser_factory::PsiResource;
+
+// -----------------------------
+// PressureSampler Implementation
+PressureSampler::PressureSampler(std::size_t max_cgroups)
+    : max_cgroups_(max_cgroups), cgroup_root_(parser_.GetCgroup2Root())
+{
+}
+
+double PressureSampler::Sample(std::vector<PressureRow> &rows)
+{
+  std::vector<PressureRow> previous = std::move(rows);
+  rows.clear();
+  AddRows("system", parser_factory::LinuxFilesSet.at("kPressureDirectory"), "", rows);
+
+  std::vector<std::string> groups;
+  DIR *directory = cgroup_root_.empty() ? nullptr : opendir(cgroup_root_.c_str());
+  if (directory != nullptr)
+  {
+    while (dirent *entry = readdir(directory))
+    {
+      if (entry->d_type == DT_DIR && entry->d_name[0] != '.')
+      {
+        groups.emplace_back(entry->d_name);
+      }
+    }
+    closedir(directory);
+  }
+  // Sorted so the same groups are kept when there are more than the cap
+  std::sort(groups.begin(), groups.end());
+  groups.resize(std::min(groups.size(), max_cgroups_));
+  for (const std::string &group : groups)
+  {
+    AddRows("/" + group, cgroup_root_ + "/" + group + "/", ".pressure", rows);
+  }
+
+  double change = 0.0;
+  for (const PressureRow &row : rows)
+  {
+    auto before = std::find_if(previous.begin(), previous.end(),
+                               [&row](const PressureRow &other)
+                               {
+                                 return other.scope == row.scope &&
+                                        other.resource == row.resource;
+                               });
+    if (before != previous.end())
+    {
+      change = std::max(change, static_cast<double>(std::abs(
+                                    row.some_avg10 - before->some_avg10)));
+    }
+  }
+  return change;
+}
+
+void PressureSampler::AddRows(const std::string &scope,
+                              const std::string &prefix,
+                              const char *suffix,
+                              std::vector<PressureRow> &rows)
+{
+  for (int i = 0; i < kPsiResourceCount; ++i)
+  {
+    auto const resource = static_cast<PsiResource>(i);
+    const char *name = parser_factory::PsiResourceName(resource);
+    parser_factory::pressure_t pressure;
+    // Groups without a controller have no file for its resource
+    if (!parser_.GetPressure(prefix + name + suffix, pressure))
+    {
+      continue;
+    }
+    rows.push_back({scope, name, pressure.some.avg10, pressure.some.avg60,
+                    pressure.some.avg300, pressure.full.avg10,
+                    pressure.full.avg60, pressure.full.avg300});
+  }
+}
+
+// -----------------------------
+// PressureMonitor Implementation
+PressureMonitor::PressureMonitor(parser_factory::PressureParser &parser,
+                                 Callback callback)
+    : callback_(std::move(callback)), parser_(parser)
+{
+}
+
+PressureMonitor::~PressureMonitor() { Stop(); }
+
+bool PressureMonitor::Start()
+{
+  if (running_)
+  {
+    return true;
+  }
+  for (int i = 0; i < kPsiResourceCount; ++i)
+  {
+    for (const char *spec : kDefaultTriggers)
+    {
+      if (parser_.AddTrigger(static_cast<PsiResource>(i), spec))
+      {
+        break;
+      }
+    }
+  }
+  if (parser_.TriggerCount() == 0)
+  {
+    Logger::GetInstance().Log(LogLevel::INFO,
+                              "No PSI triggers, pressure is only sampled.");
+    return false;
+  }
+  wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wake_fd_ < 0)
+  {
+    throw std::runtime_error(std::string("Failed to set up PSI monitor: ") +
+                             std::strerror(errno));
+  }
+  running_ = true;
+  thread_ = std::thread(&PressureMonitor::Run, this);
+  return true;
+}
+
+void PressureMonitor::Stop()
+{
+  if (!running_.exchange(false))
+  {
+    return;
+  }
+  std::uint64_t one = 1;
+  ssize_t ignored = write(wake_fd_, &one, sizeof(one));
+  (void)ignored;
+  if (thread_.joinable())
+  {
+    thread_.join();
+  }
+  close(wake_fd_);
+  wake_fd_ = -1;
+}
+
+void PressureMonitor::Run()
+{
+  BlockStopSignals();
+  while (running_)
+  {
+    std::vector<parser_factory::psi_event_t> events =
+        parser_.WaitForEvents(wake_fd_);
+    if (!events.empty() && running_)
+    {
+      callback_(events.size());
+    }
+  }
+}
@@ -0,0 +1,91 @@
+#include "snapshot/process_details.h"
+
+#include <cstring>
+
+using namespace snapshot;
+
+ProcessDetailCache::ProcessDetailCache(std::size_t capacity,
+                                       std::uint64_t ram_refresh)
+    : capacity_(capacity), ram_refresh_(ram_refresh) {}
+
+std::string_view ProcessDetailCache::InternComm(const ProcessRow &row)
+{
+  char name[sizeof(row.comm) + 2];
+  std::size_t const length = strnlen(row.comm, sizeof(row.comm));
+  name[0] = '[';
+  std::memcpy(name + 1, row.comm, length);
+  name[length + 1] = ']';
+  return strings_.Intern(std::string_view(name, length + 2));
+}
+
+const ProcessDetails &ProcessDetailCache::Get(const ProcessRow &row,
+                                              std::uint64_t sequence)
+{
+  auto inserted = entries_.try_emplace({row.source, row.pid, row.starttime});
+  ProcessDetails &details = inserted.first->second;
+  details.used_sequence = sequence;
+  if (row.source != 0)
+  {
+    // The pid belongs to another host's /proc, the agent sent what it had
+    if (inserted.second)
+    {
+      details.command = InternComm(row);
+    }
+    details.memory = {row.rss_kb, 0, row.pss_kb, row.uss_kb, row.swap_kb};
+    details.ram_mb = (row.pss_kb >= 0 ? row.pss_kb : row.rss_kb) / 1024;
+    details.ram_sequence = sequence;
+    return details;
+  }
+  // The process may exit between the snapshot and this read, keep what
+  // the snapshot already knows in that case
+  if (inserted.second)
+  {
+    details.user = strings_.Intern(parser_.ReadUser(row.pid));
+    if (parser_.ReadCommand(row.pid, command_))
+    {
+      details.command = strings_.Intern(command_);
+    }
+    if (details.command.empty())
+    {
+      details.command = InternComm(row);
+    }
+  }
+  if (inserted.second || sequence >= details.ram_sequence + ram_refresh_)
+  {
+    parser_factory::pid_memory_t memory;
+    if (parser_.GetSmapsRollup(row.pid, memory) ||
+        parser_.GetStatm(row.pid, memory))
+    {
+      details.memory = memory;
+      details.ram_mb =
+          (memory.pss_kb >= 0 ? memory.pss_kb : memory.rss_kb) / 1024;
+    }
+    details.ram_sequence = sequence;
+  }
+  return details;
+}
+
+void ProcessDetailCache::Sweep(std::uint64_t sequence)
+{
+  if (entries_.size() <= capacity_)
+  {
+    return;
+  }
+  // The strings of the rows that stay are copied over, those of every
+  // dropped row go with the old generation in one go
+  strings_.NextGeneration();
+  for (auto it = entries_.begin(); it != entries_.end();)
+  {
+    if (it->second.used_sequence + 1 < sequence)
+    {
+      it = entries_.erase(it);
+    }
+    else
+    {
+      it->second.user = strings_.Intern(it->second.user);
+      it->second.command = strings_.Intern(it->second.command);
+      ++it;
+    }
+  }
+  strings_.DropGeneration();
+}
@@ -0,0 +1,334 @@
+#include "snapshot/process_filter.h"
+
+#include <pwd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+using namespace snapshot;
+
+namespace
+{
+typedef struct FieldName
+{
+  const char *name;
+  FilterField field;
+} field_name_t;
+
+constexpr field_name_t kFieldNames[] = {
+    {"pid", FilterField::kPid},         {"ppid", FilterField::kPpid},
+    {"state", FilterField::kState},     {"comm", FilterField::kComm},
+    {"cpu", FilterField::kCpu},         {"rss", FilterField::kRss},
+    {"threads", FilterField::kThreads}, {"uptime", FilterField::kUptime},
+    {"user", FilterField::kUser},       {"cgroup", FilterField::kCgroup},
+    {"cmd", FilterField::kCmd}};
+
+bool Numeric(FilterField field)
+{
+  return field != FilterField::kState && field != FilterField::kComm &&
+         field != FilterField::kCgroup && field != FilterField::kCmd;
+}
+
+// Rank of the file the field is read from, cheapest first
+int Cost(FilterField field)
+{
+  switch (field)
+  {
+  case FilterField::kPid:
+    return 0;
+  case FilterField::kUser:
+    return 2;
+  case FilterField::kCgroup:
+    return 3;
+  case FilterField::kCmd:
+    return 4;
+  default:
+    return 1;
+  }
+}
+
+// Walks the expression left to right, errors name the offset they are at
+class Cursor
+{
+public:
+  explicit Cursor(std::string_view text) : text_(text) {}
+
+  bool AtEnd()
+  {
+    SkipSpace();
+    return position_ >= text_.size();
+  }
+
+  bool Consume(std::string_view token)
+  {
+    SkipSpace();
+    if (text_.substr(position_, token.size()) != token)
+    {
+      return false;
+    }
+    position_ += token.size();
+    return true;
+  }
+
+  std::string_view Word()
+  {
+    SkipSpace();
+    std::size_t const begin = position_;
+    while (position_ < text_.size() &&
+           (std::isalnum(static_cast<unsigned char>(text_[position_])) ||
+            text_[position_] == '_'))
+    {
+      ++position_;
+    }
+    return text_.substr(begin, position_ - begin);
+  }
+
+  // A quoted string, or everything up to the next blank or &&
+  std::string Value()
+  {
+    SkipSpace();
+    if (position_ < text_.size() && text_[position_] == '"')
+    {
+      std::size_t const end = text_.find('"', position_ + 1);
+      if (end == std::string_view::npos)
+      {
+        Fail("unterminated string");
+      }
+      std::string value(text_.substr(position_ + 1, end - position_ - 1));
+      position_ = end + 1;
+      return value;
+    }
+    std::size_t const begin = position_;
+    while (position_ < text_.size() &&
+           !std::isspace(static_cast<unsigned char>(text_[position_])) &&
+           text_[position_] != '&')
+    {
+      ++position_;
+    }
+    if (position_ == begin)
+    {
+      Fail("missing value");
+    }
+    return std::string(text_.substr(begin, position_ - begin));
+  }
+
+  [[noreturn]] void Fail(const std::string &what) const
+  {
+    throw std::invalid_argument("Invalid filter at offset " +
+                                std::to_string(position_) + ": " + what);
+  }
+
+private:
+  void SkipSpace()
+  {
+    while (position_ < text_.size() &&
+           std::isspace(static_cast<unsigned char>(text_[position_])))
+    {
+      ++position_;
+    }
+  }
+
+  std::string_view text_;
+  std::size_t position_{0};
+};
+
+double ParseNumber(Cursor &cursor, const std::string &value)
+{
+  double number = 0.0;
+  auto result =
+      std::from_chars(value.data(), value.data() + value.size(), number);
+  if (result.ec != std::errc() || result.ptr != value.data() + value.size())
+  {
+    cursor.Fail("not a number: " + value);
+  }
+  return number;
+}
+
+// A uid, or a user name looked up once
+double ParseUser(Cursor &cursor, const std::string &value)
+{
+  if (!value.empty() && std::isdigit(static_cast<unsigned char>(value[0])))
+  {
+    return ParseNumber(cursor, value);
+  }
+  struct passwd *entry = getpwnam(value.c_str());
+  if (entry == nullptr)
+  {
+    cursor.Fail("unknown user: " + value);
+  }
+  return static_cast<double>(entry->pw_uid);
+}
+} // namespace
+
+// -----------------------------
+// ProcessFilter Implementation
+
+ProcessFilter::ProcessFilter(const std::string &expression)
+    : expression_(expression)
+{
+  Cursor cursor(expression);
+  if (cursor.AtEnd())
+  {
+    cursor.Fail("empty expression");
+  }
+  do
+  {
+    std::string_view const name = cursor.Word();
+    auto known = std::find_if(std::begin(kFieldNames), std::end(kFieldNames),
+                              [name](const field_name_t &field)
+                              { return name == field.name; });
+    if (known == std::end(kFieldNames))
+    {
+      cursor.Fail(name.empty() ? std::string("missing field")
+                               : "unknown field: " + std::string(name));
+    }
+    // Two character operators before their one character prefixes
+    static const std::pair<std::string_view, Op> kOperators[] = {
+        {"==", Op::kEqual},       {"!=", Op::kNotEqual},
+        {"!~", Op::kNotContains}, {"<=", Op::kLessEqual},
+        {">=", Op::kGreaterEqual}, {"=", Op::kEqual},
+        {"<", Op::kLess},         {">", Op::kGreater},
+        {"~", Op::kContains}};
+    auto op = std::find_if(std::begin(kOperators), std::end(kOperators),
+                           [&cursor](const std::pair<std::string_view, Op> &op)
+                           { return cursor.Consume(op.first); });
+    if (op == std::end(kOperators))
+    {
+      cursor.Fail("missing operator after " + std::string(name));
+    }
+    predicate_t predicate{known->field, op->second, 0.0, std::string()};
+    bool const ordered = predicate.op != Op::kEqual &&
+                         predicate.op != Op::kNotEqual;
+    bool const contains = predicate.op == Op::kContains ||
+                          predicate.op == Op::kNotContains;
+    std::string const value = cursor.Value();
+    if (predicate.field == FilterField::kUser)
+    {
+      if (ordered)
+      {
+        cursor.Fail("user only compares with = and !=");
+      }
+      predicate.number = ParseUser(cursor, value);
+    }
+    else if (Numeric(predicate.field))
+    {
+      if (contains)
+      {
+        cursor.Fail(std::string(name) + " is a number");
+      }
+      predicate.number = ParseNumber(cursor, value);
+    }
+    else
+    {
+      if (ordered && !contains)
+      {
+        cursor.Fail(std::string(name) + " is text");
+      }
+      predicate.text = value;
+    }
+    plan_.push_back(std::move(predicate));
+  } while (cursor.Consume("&&"));
+  if (!cursor.AtEnd())
+  {
+    cursor.Fail("expected &&");
+  }
+  std::stable_sort(plan_.begin(), plan_.end(),
+                   [](const predicate_t &a, const predicate_t &b)
+                   { return Cost(a.field) < Cost(b.field); });
+}
+
+bool ProcessFilter::Lifetime(FilterField field)
+{
+  return field == FilterField::kPid || field == FilterField::kUser ||
+         field == FilterField::kCgroup || field == FilterField::kCmd;
+}
+
+FilterResult ProcessFilter::Evaluate(FilterSubject &subject, bool settled) const
+{
+  double number = 0.0;
+  std::string text;
+  bool mismatch = false;
+  for (const predicate_t &predicate : plan_)
+  {
+    bool const lifetime = Lifetime(predicate.field);
+    // After a value that changes failed, only the comparisons that can
+    // exclude the process for good are left to run
+    if ((settled && lifetime) || (mismatch && !lifetime))
+    {
+      continue;
+    }
+    bool matched = false;
+    if (Numeric(predicate.field))
+    {
+      if (!subject.Number(predicate.field, number))
+      {
+        return FilterResult::kGone;
+      }
+      matched = Compare(predicate, number);
+    }
+    else
+    {
+      if (!subject.Text(predicate.field, text))
+      {
+        return FilterResult::kGone;
+      }
+      matched = Compare(predicate, text);
+    }
+    if (!matched)
+    {
+      if (lifetime)
+      {
+        return FilterResult::kExcluded;
+      }
+      if (settled)
+      {
+        return FilterResult::kMismatch;
+      }
+      mismatch = true;
+    }
+  }
+  return mismatch ? FilterResult::kMismatch : FilterResult::kMatch;
+}
+
+bool ProcessFilter::Compare(const predicate_t &predicate, double value)
+{
+  switch (predicate.op)
+  {
+  case Op::kEqual:
+    return value == predicate.number;
+  case Op::kNotEqual:
+    return value != predicate.number;
+  case Op::kLess:
+    return value < predicate.number;
+  case Op::kLessEqual:
+    return value <= predicate.number;
+  case Op::kGreater:
+    return value > predicate.number;
+  case Op::kGreaterEqual:
+    return value >= predicate.number;
+  default:
+    return false;
+  }
+}
+
+bool ProcessFilter::Compare(const predicate_t &predicate,
+                            const std::string &value)
+{
+  switch (predicate.op)
+  {
+  case Op::kEqual:
+    return value == predicate.text;
+  case Op::kNotEqual:
+    return value != predicate.text;
+  case Op::kContains:
+    return value.find(predicate.text) != std::string::npos;
+  case Op::kNotContains:
+    return value.find(predicate.text) == std::string::npos;
+  default:
+    return false;
+  }
+}
@@ -0,0 +1,268 @@
+#include "snapshot/process_tree.h"
+
+#include <algorithm>
+
+using namespace snapshot;
+
+ProcessTree::totals_t ProcessTree::TotalsOf(const ProcessRow &row)
+{
+  return {row.cpu_utilization, row.rss_kb, row.num_threads, row.io_rate, 1};
+}
+
+void ProcessTree::AddUp(int pid, const totals_t &delta, int sign)
+{
+  while (pid != 0)
+  {
+    auto found = nodes_.find(pid);
+    if (found == nodes_.end())
+    {
+      return;
+    }
+    totals_t &total = found->second.total;
+    total.cpu_utilization += sign * delta.cpu_utilization;
+    total.rss_kb += sign * delta.rss_kb;
+    total.num_threads += sign * delta.num_threads;
+    total.io_rate += sign * delta.io_rate;
+    total.processes += sign * delta.processes;
+    pid = found->second.parent;
+  }
+}
+
+void ProcessTree::Attach(int pid, node_t &node, int parent)
+{
+  for (int ancestor = parent; ancestor != 0;)
+  {
+    auto found = nodes_.find(ancestor);
+    if (found == nodes_.end() || ancestor == pid)
+    {
+      // Unknown parent, or a loop from a scan that raced a reparent
+      parent = 0;
+      break;
+    }
+    ancestor = found->second.parent;
+  }
+  node.parent = parent;
+  if (parent != 0)
+  {
+    nodes_.at(parent).children.push_back(pid);
+    AddUp(parent, node.total, 1);
+  }
+}
+
+void ProcessTree::Detach(int pid, node_t &node)
+{
+  if (node.parent == 0)
+  {
+    return;
+  }
+  AddUp(node.parent, node.total, -1);
+  std::vector<int> &siblings = nodes_.at(node.parent).children;
+  siblings.erase(std::find(siblings.begin(), siblings.end(), pid));
+  node.parent = 0;
+}
+
+void ProcessTree::Remove(int pid)
+{
+  auto found = nodes_.find(pid);
+  if (found == nodes_.end())
+  {
+    return;
+  }
+  node_t &node = found->second;
+  int const parent = node.parent;
+  Detach(pid, node);
+  // Like the kernel, hand the orphans to the next process up. The next
+  // scan reports their real new parent and moves them there.
+  std::vector<int> const children = std::move(node.children);
+  for (int child : children)
+  {
+    node_t &orphan = nodes_.at(child);
+    orphan.parent = 0;
+    Attach(child, orphan, parent);
+  }
+  nodes_.erase(found);
+}
+
+void ProcessTree::Update(std::vector<ProcessRow> &rows)
+{
+  ++generation_;
+  std::vector<node_t *> row_nodes(rows.size());
+  std::vector<std::size_t> born;
+  std::vector<std::size_t> moved;
+  for (std::size_t i = 0; i < rows.size(); ++i)
+  {
+    const ProcessRow &row = rows[i];
+    auto found = nodes_.find(row.pid);
+    if (found != nodes_.end() && found->second.starttime != row.starttime)
+    {
+      Remove(row.pid); // the pid was reused
+      found = nodes_.end();
+    }
+    totals_t const self = TotalsOf(row);
+    if (found == nodes_.end())
+    {
+      found = nodes_
+                  .emplace(row.pid, node_t{row.ppid, 0, row.starttime,
+                                           generation_, self, self, {}})
+                  .first;
+      born.push_back(i);
+    }
+    else
+    {
+      node_t &node = found->second;
+      node.generation = generation_;
+      totals_t const delta{self.cpu_utilization - node.self.cpu_utilization,
+                           self.rss_kb - node.self.rss_kb,
+                           self.num_threads - node.self.num_threads,
+                           self.io_rate - node.self.io_rate, 0};
+      if (delta.cpu_utilization != 0.0 || delta.rss_kb != 0 ||
+          delta.num_threads != 0 || delta.io_rate != 0.0)
+      {
+        node.self = self;
+        AddUp(row.pid, delta, 1);
+      }
+      // Reparented, or its parent was not known when it was attached
+      if (node.ppid != row.ppid ||
+          (node.parent == 0 && row.ppid != 0 && nodes_.count(row.ppid) != 0))
+      {
+        node.ppid = row.ppid;
+        moved.push_back(i);
+      }
+    }
+    row_nodes[i] = &found->second;
+  }
+
+  std::vector<int> exited;
+  for (const auto &entry : nodes_)
+  {
+    if (entry.second.generation != generation_)
+    {
+      exited.push_back(entry.first);
+    }
+  }
+  for (int pid : exited)
+  {
+    Remove(pid);
+  }
+  for (std::size_t i : moved)
+  {
+    Detach(rows[i].pid, *row_nodes[i]);
+    Attach(rows[i].pid, *row_nodes[i], rows[i].ppid);
+  }
+  // Every new node exists by now, whatever order parents were scanned in
+  for (std::size_t i : born)
+  {
+    Attach(rows[i].pid, *row_nodes[i], rows[i].ppid);
+  }
+
+  for (std::size_t i = 0; i < rows.size(); ++i)
+  {
+    const totals_t &total = row_nodes[i]->total;
+    rows[i].subtree = {
+        static_cast<float>(std::max(total.cpu_utilization, 0.0)),
+        total.rss_kb, total.num_threads, std::max(total.io_rate, 0.0),
+        static_cast<int>(total.processes)};
+  }
+}
+
+bool ProcessTree::Subtree(int pid, subtree_t &subtree) const
+{
+  auto found = nodes_.find(pid);
+  if (found == nodes_.end())
+  {
+    return false;
+  }
+  const totals_t &total = found->second.total;
+  subtree = {static_cast<float>(total.cpu_utilization), total.rss_kb,
+             total.num_threads, total.io_rate,
+             static_cast<int>(total.processes)};
+  return true;
+}
+
+void ProcessTree::Flatten(const std::vector<ProcessRow> &rows,
+                          const std::unordered_set<int> &collapsed,
+                          std::vector<std::uint32_t> &order,
+                          std::vector<std::uint16_t> &depths)
+{
+  order.clear();
+  depths.clear();
+  // Rows of different agents may share pids, parents are looked up
+  // within the row's own source
+  auto key = [](int source, int pid)
+  {
+    return static_cast<std::uint64_t>(static_cast<std::uint32_t>(source))
+               << 32 |
+           static_cast<std::uint32_t>(pid);
+  };
+  std::unordered_map<std::uint64_t, std::uint32_t> index;
+  index.reserve(rows.size());
+  for (std::uint32_t i = 0; i < rows.size(); ++i)
+  {
+    index.emplace(key(rows[i].source, rows[i].pid), i);
+  }
+  // Children of row i are children[first[i] .. first[i + 1]), roots last
+  std::vector<std::uint32_t> first(rows.size() + 2, 0);
+  std::vector<std::uint32_t> parent_of(rows.size());
+  for (std::uint32_t i = 0; i < rows.size(); ++i)
+  {
+    auto parent = index.find(key(rows[i].source, rows[i].ppid));
+    parent_of[i] = parent == index.end() || parent->second == i
+                       ? static_cast<std::uint32_t>(rows.size())
+                       : parent->second;
+    ++first[parent_of[i] + 1];
+  }
+  for (std::size_t i = 1; i < first.size(); ++i)
+  {
+    first[i] += first[i - 1];
+  }
+  std::vector<std::uint32_t> children(rows.size());
+  std::vector<std::uint32_t> fill(first.begin(), first.end() - 1);
+  for (std::uint32_t i = 0; i < rows.size(); ++i)
+  {
+    children[fill[parent_of[i]]++] = i;
+  }
+  auto busier = [&rows](std::uint32_t a, std::uint32_t b)
+  {
+    if (rows[a].subtree.cpu_utilization != rows[b].subtree.cpu_utilization)
+    {
+      return rows[a].subtree.cpu_utilization > rows[b].subtree.cpu_utilization;
+    }
+    if (rows[a].source != rows[b].source)
+    {
+      return rows[a].source < rows[b].source;
+    }
+    return rows[a].pid < rows[b].pid;
+  };
+  for (std::size_t i = 0; i + 1 < first.size(); ++i)
+  {
+    std::sort(children.begin() + first[i], children.begin() + first[i + 1],
+              busier);
+  }
+
+  // Depth first, the stack holds the siblings still to visit in reverse
+  std::vector<std::pair<std::uint32_t, std::uint16_t>> stack;
+  std::uint32_t const roots = static_cast<std::uint32_t>(rows.size());
+  for (std::uint32_t c = first[roots + 1]; c-- > first[roots];)
+  {
+    stack.emplace_back(children[c], 0);
+  }
+  order.reserve(rows.size());
+  depths.reserve(rows.size());
+  while (!stack.empty())
+  {
+    auto const [row, depth] = stack.back();
+    stack.pop_back();
+    order.push_back(row);
+    depths.push_back(depth);
+    if (collapsed.count(rows[row].pid) != 0)
+    {
+      continue;
+    }
+    std::uint16_t const next =
+        depth < UINT16_MAX ? static_cast<std::uint16_t>(depth + 1) : depth;
+    for (std::uint32_t c = first[row + 1]; c-- > first[row];)
+    {
+      stack.emplace_back(children[c], next);
+    }
+  }
+}
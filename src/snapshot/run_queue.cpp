@@ -0,0 +1,87 @@
+#include "snapshot/run_queue.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace snapshot;
+
+RunQueueSampler::RunQueueSampler(std::size_t top_processes)
+    : top_processes_(top_processes)
+{
+}
+
+double RunQueueSampler::SampleCpus(std::vector<RunQueue> &run_queues,
+                                   Clock::time_point now)
+{
+  if (!cpu_parser_.GetSchedStat(cpus_))
+  {
+    run_queues.clear();
+    return 0.0;
+  }
+  double const seconds =
+      std::chrono::duration<double>(now - last_cpu_time_).count();
+  bool const comparable = last_cpu_time_ != Clock::time_point{} &&
+                          last_cpus_.size() == cpus_.size() && seconds > 0.0;
+  double change = 0.0;
+  std::vector<RunQueue> previous = std::move(run_queues);
+  run_queues.clear();
+  if (comparable)
+  {
+    for (std::size_t i = 0; i < cpus_.size(); ++i)
+    {
+      const auto &before = last_cpus_[i];
+      const auto &after = cpus_[i];
+      run_queue_t queue;
+      queue.cpu = after.cpu;
+      double const waited = static_cast<double>(after.wait_ns - before.wait_ns);
+      unsigned long long const slices = after.timeslices - before.timeslices;
+      queue.waiting = static_cast<float>(waited / 1e9 / seconds);
+      queue.avg_wait_ns = slices > 0 ? waited / slices : 0.0;
+      if (i < previous.size())
+      {
+        change = std::max(change, std::abs(static_cast<double>(
+                                      queue.waiting - previous[i].waiting)));
+      }
+      run_queues.push_back(queue);
+    }
+  }
+  std::swap(last_cpus_, cpus_);
+  last_cpu_time_ = now;
+  return change;
+}
+
+void RunQueueSampler::SampleProcesses(std::vector<ProcessRow> &rows,
+                                      Clock::time_point now)
+{
+  for (ProcessRow &row : rows)
+  {
+    row.run_wait = -1.0f;
+  }
+  next_samples_.clear();
+  for (std::uint32_t index :
+       selector_.Select(rows, SortKey::kCpu, top_processes_))
+  {
+    ProcessRow &row = rows[index];
+    parser_factory::pid_schedstat_t schedstat;
+    if (!process_parser_.GetSchedStat(row.pid, schedstat))
+    {
+      continue;
+    }
+    auto previous = samples_.find(row.pid);
+    if (previous != samples_.end() &&
+        previous->second.starttime == row.starttime &&
+        schedstat.wait_ns >= previous->second.wait_ns)
+    {
+      double const seconds =
+          std::chrono::duration<double>(now - previous->second.when).count();
+      if (seconds > 0.0)
+      {
+        row.run_wait = static_cast<float>(
+            (schedstat.wait_ns - previous->second.wait_ns) / 1e9 / seconds);
+      }
+    }
+    next_samples_[row.pid] = {row.starttime, schedstat.wait_ns, now};
+  }
+  // Processes that left the top rows start over when they come back
+  std::swap(samples_, next_samples_);
+}
@@ -0,0 +1,198 @@
+#include "snapshot/sampling_scheduler.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+
+using namespace snapshot;
+
+namespace
+{
+// Scores below this count as a quiet sample
+constexpr double kQuietScore = 0.25;
+// Quiet samples in a row before a task backs off one level
+constexpr int kQuietRunsToBackOff = 4;
+// Above this share of the budget tasks no longer speed up
+constexpr double kHeadroom = 0.8;
+} // namespace
+
+// -----------------------------
+// OverheadMeter Implementation
+OverheadMeter::OverheadMeter(std::chrono::milliseconds window)
+    : window_(window), ticks_per_second_(static_cast<double>(sysconf(_SC_CLK_TCK)))
+{
+}
+
+bool OverheadMeter::Sample(Clock::time_point now)
+{
+  if (last_time_ != Clock::time_point{} && now - last_time_ < window_)
+  {
+    return false;
+  }
+  parser_factory::pid_stat_t stat;
+  if (!parser_.GetStat(getpid(), stat))
+  {
+    return false;
+  }
+  unsigned long const jiffies = stat.getActiveJiffies();
+  bool const first = last_time_ == Clock::time_point{};
+  double const seconds =
+      std::chrono::duration<double>(now - last_time_).count();
+  if (!first && seconds > 0.0)
+  {
+    double const used = (jiffies - last_jiffies_) / ticks_per_second_ / seconds;
+    // Smooth over two windows, one jiffy is a whole percent per second
+    overhead_ = (overhead_ + used) / 2.0;
+  }
+  last_jiffies_ = jiffies;
+  last_time_ = now;
+  return !first;
+}
+
+// -----------------------------
+// SamplingScheduler Implementation
+SamplingScheduler::SamplingScheduler(Clock::duration quantum,
+                                     double overhead_budget, bool adaptive,
+                                     Clock::time_point epoch)
+    : quantum_(std::max<Clock::duration>(quantum, std::chrono::milliseconds(1))),
+      overhead_budget_(overhead_budget), adaptive_(adaptive), epoch_(epoch)
+{
+}
+
+int SamplingScheduler::AddTask(std::string name, int min_level, int level,
+                               int max_level, Task task, int after)
+{
+  entry_t entry;
+  entry.name = std::move(name);
+  entry.min_level = min_level;
+  entry.max_level = std::max(min_level, max_level);
+  entry.level = std::clamp(level, entry.min_level, entry.max_level);
+  entry.task = std::move(task);
+  entry.after = after < static_cast<int>(entries_.size()) ? after : -1;
+  entry.deadline = epoch_; // every task runs in the first wakeup
+  entry.quiet_runs = 0;
+  entries_.push_back(std::move(entry));
+  return static_cast<int>(entries_.size()) - 1;
+}
+
+int SamplingScheduler::RunDue(Clock::time_point now)
+{
+  bool throttled = false;
+  if (adaptive_)
+  {
+    if (meter_.Sample(now) && meter_.Overhead() > overhead_budget_)
+    {
+      for (entry_t &entry : entries_)
+      {
+        entry.level = std::min(entry.level + 1, entry.max_level);
+        entry.quiet_runs = 0;
+      }
+    }
+    throttled = meter_.Overhead() > overhead_budget_ * kHeadroom;
+  }
+
+  std::vector<std::size_t> due;
+  std::vector<char> is_due(entries_.size(), 0);
+  for (std::size_t i = 0; i < entries_.size(); ++i)
+  {
+    if (entries_[i].deadline <= now)
+    {
+      // Advance first so a throwing task does not spin
+      Reschedule(entries_[i], now);
+      due.push_back(i);
+      is_due[i] = 1;
+    }
+  }
+  std::vector<double> scores(entries_.size(), 0.0);
+  if (pool_ == nullptr)
+  {
+    // In order of addition, which puts every task after its dependency
+    for (std::size_t i : due)
+    {
+      scores[i] = entries_[i].task();
+    }
+  }
+  else
+  {
+    WorkPool::Group group;
+    std::function<void(std::size_t)> run = [&](std::size_t i)
+    {
+      scores[i] = entries_[i].task();
+      for (std::size_t next : due)
+      {
+        if (entries_[next].after == static_cast<int>(i))
+        {
+          pool_->Spawn(group, [&run, next] { run(next); });
+        }
+      }
+    };
+    for (std::size_t i : due)
+    {
+      int const after = entries_[i].after;
+      if (after < 0 || !is_due[after])
+      {
+        pool_->Spawn(group, [&run, i] { run(i); });
+      }
+    }
+    pool_->Wait(group);
+  }
+
+  if (adaptive_)
+  {
+    for (std::size_t i : due)
+    {
+      entry_t &entry = entries_[i];
+      int const level = entry.level;
+      Adapt(entry, scores[i], throttled);
+      if (entry.level != level)
+      {
+        Reschedule(entry, now); // move onto the grid of the new period
+      }
+    }
+  }
+  return static_cast<int>(due.size());
+}
+
+void SamplingScheduler::Adapt(entry_t &entry, double score, bool throttled)
+{
+  if (score >= 1.0)
+  {
+    entry.quiet_runs = 0;
+    if (!throttled)
+    {
+      entry.level = std::max(entry.level - 1, entry.min_level);
+    }
+  }
+  else if (score < kQuietScore && ++entry.quiet_runs >= kQuietRunsToBackOff)
+  {
+    entry.quiet_runs = 0;
+    entry.level = std::min(entry.level + 1, entry.max_level);
+  }
+  else if (score >= kQuietScore)
+  {
+    entry.quiet_runs = 0;
+  }
+}
+
+void SamplingScheduler::Reschedule(entry_t &entry, Clock::time_point now)
+{
+  // Next multiple of the period after now, counted from the epoch
+  Clock::duration const period = quantum_ * (1 << entry.level);
+  auto const periods = (now - epoch_) / period + 1;
+  entry.deadline = epoch_ + period * periods;
+}
+
+SamplingScheduler::Clock::time_point SamplingScheduler::NextDeadline() const
+{
+  Clock::time_point next = Clock::time_point::max();
+  for (const entry_t &entry : entries_)
+  {
+    next = std::min(next, entry.deadline);
+  }
+  return next;
+}
+
+SamplingScheduler::Clock::duration SamplingScheduler::Period(int id) const
+{
+  return quantum_ * (1 << entries_.at(id).level);
+}
@@ -0,0 +1,126 @@
+#include "snapshot/snapshot_publisher.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace snapshot;
+
+// -----------------------------
+// ReadGuard Implementation
+SnapshotPublisher::ReadGuard::~ReadGuard()
+{
+  if (slot_ != nullptr)
+  {
+    slot_->store(kIdle);
+  }
+}
+
+// -----------------------------
+// Reader Implementation
+SnapshotPublisher::Reader::Reader(SnapshotPublisher &publisher)
+    : publisher_(publisher), slot_(nullptr)
+{
+  for (auto &slot : publisher_.slots_)
+  {
+    std::uint64_t expected = kUnclaimed;
+    if (slot.epoch.compare_exchange_strong(expected, kIdle))
+    {
+      slot_ = &slot.epoch;
+      return;
+    }
+  }
+  throw std::runtime_error("No free snapshot reader slot.");
+}
+
+SnapshotPublisher::Reader::~Reader() { slot_->store(kUnclaimed); }
+
+SnapshotPublisher::ReadGuard SnapshotPublisher::Reader::Acquire()
+{
+  // Announce the epoch first, the pointer loaded afterwards can then only
+  // be retired in a later epoch and stays alive while the slot is set
+  slot_->store(publisher_.epoch_.load());
+  return ReadGuard(slot_, publisher_.current_.load());
+}
+
+// -----------------------------
+// SnapshotPublisher Implementation
+SnapshotPublisher::SnapshotPublisher() : current_(new SystemSnapshot{}) {}
+
+SnapshotPublisher::~SnapshotPublisher()
+{
+  delete current_.load();
+  for (const auto &retired : retired_)
+  {
+    delete retired.snapshot;
+  }
+}
+
+void SnapshotPublisher::Publish(std::unique_ptr<SystemSnapshot> snapshot)
+{
+  snapshot->sequence = sequence_.load() + 1;
+  const SystemSnapshot *previous = current_.exchange(snapshot.release());
+  sequence_.fetch_add(1);
+  // Readers that enter from now on can no longer observe previous
+  std::uint64_t retire_epoch = epoch_.fetch_add(1) + 1;
+  retired_.push_back({previous, retire_epoch});
+  Reclaim();
+  {
+    // Pairs with the predicate check in WaitForNewer so no wakeup is lost
+    std::lock_guard<std::mutex> lock(wait_mutex_);
+    for (const auto &listener : listeners_)
+    {
+      listener.second(sequence_.load());
+    }
+  }
+  published_.notify_all();
+}
+
+int SnapshotPublisher::AddListener(
+    std::function<void(std::uint64_t)> listener)
+{
+  std::lock_guard<std::mutex> lock(wait_mutex_);
+  listeners_.emplace_back(++next_listener_, std::move(listener));
+  return next_listener_;
+}
+
+void SnapshotPublisher::RemoveListener(int id)
+{
+  std::lock_guard<std::mutex> lock(wait_mutex_);
+  listeners_.erase(std::remove_if(listeners_.begin(), listeners_.end(),
+                                  [id](const auto &listener)
+                                  { return listener.first == id; }),
+                   listeners_.end());
+}
+
+std::uint64_t SnapshotPublisher::Sequence() const { return sequence_.load(); }
+
+std::uint64_t SnapshotPublisher::WaitForNewer(std::uint64_t sequence,
+                                              std::chrono::milliseconds timeout)
+{
+  std::unique_lock<std::mutex> lock(wait_mutex_);
+  published_.wait_for(lock, timeout,
+                      [&] { return sequence_.load() > sequence; });
+  return sequence_.load();
+}
+
+void SnapshotPublisher::Reclaim()
+{
+  std::uint64_t oldest = epoch_.load();
+  for (const auto &slot : slots_)
+  {
+    std::uint64_t epoch = slot.epoch.load();
+    if (epoch != kIdle && epoch != kUnclaimed)
+    {
+      oldest = std::min(oldest, epoch);
+    }
+  }
+
+  auto reclaimable = std::stable_partition(
+      retired_.begin(), retired_.end(),
+      [oldest](const retired_t &retired) { return retired.epoch > oldest; });
+  for (auto it = reclaimable; it != retired_.end(); ++it)
+  {
+    delete it->snapshot;
+  }
+  retired_.erase(reclaimable, retired_.end());
+}
@@ -0,0 +1,61 @@
+#include "snapshot/string_arena.h"
+
+#include <cstring>
+#include <utility>
+
+using namespace snapshot;
+
+StringArena::StringArena(std::size_t block_size) : block_size_(block_size) {}
+
+std::string_view StringArena::Intern(std::string_view text)
+{
+  if (text.empty())
+  {
+    return std::string_view();
+  }
+  auto found = current_.index.find(text);
+  if (found != current_.index.end())
+  {
+    return *found;
+  }
+  char *const copy = Allocate(text.size());
+  std::memcpy(copy, text.data(), text.size());
+  std::string_view const interned(copy, text.size());
+  current_.index.insert(interned);
+  current_.bytes += text.size();
+  return interned;
+}
+
+char *StringArena::Allocate(std::size_t size)
+{
+  generation_t &generation = current_;
+  if (generation.blocks.empty() || generation.used + size > block_size_)
+  {
+    if (size > block_size_ / 4)
+    {
+      // A long string gets a block of its own, the last block stays the
+      // one that is being filled
+      generation.blocks.insert(generation.blocks.begin(),
+                               std::make_unique<char[]>(size));
+      if (generation.blocks.size() == 1)
+      {
+        generation.blocks.push_back(std::make_unique<char[]>(block_size_));
+        generation.used = 0;
+      }
+      return generation.blocks.front().get();
+    }
+    generation.blocks.push_back(std::make_unique<char[]>(block_size_));
+    generation.used = 0;
+  }
+  char *const memory = generation.blocks.back().get() + generation.used;
+  generation.used += size;
+  return memory;
+}
+
+void StringArena::NextGeneration()
+{
+  previous_ = std::move(current_);
+  current_ = generation_t();
+}
+
+void StringArena::DropGeneration() { previous_ = generation_t(); }
@@ -0,0 +1,170 @@
+#include "snapshot/thread_sampler.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string_view>
+
+using namespace snapshot;
+
+ThreadSampler::ThreadSampler(std::size_t max_reads)
+    : max_reads_(std::max<std::size_t>(max_reads, 1)),
+      ticks_per_second_(static_cast<double>(sysconf(_SC_CLK_TCK)))
+{
+}
+
+void ThreadSampler::Expand(int pid)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  expanded_.insert(pid);
+}
+
+void ThreadSampler::Collapse(int pid)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  expanded_.erase(pid);
+}
+
+bool ThreadSampler::Expanded(int pid) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return expanded_.count(pid) != 0;
+}
+
+void ThreadSampler::SetFilter(std::string filter)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  filter_ = std::move(filter);
+}
+
+double ThreadSampler::Sample(const std::vector<ProcessRow> &processes,
+                             std::vector<ThreadRow> &threads,
+                             Clock::time_point now)
+{
+  std::unordered_set<int> expanded;
+  std::string filter;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    expanded = expanded_;
+    filter = filter_;
+  }
+
+  // One readdir per watched process lists its current threads
+  tasks_.clear();
+  for (const ProcessRow &process : processes)
+  {
+    bool const watched =
+        expanded.count(process.pid) != 0 ||
+        (!filter.empty() &&
+         std::string_view(process.comm,
+                          strnlen(process.comm, sizeof(process.comm)))
+                 .find(filter) != std::string_view::npos);
+    if (!watched)
+    {
+      continue;
+    }
+    for (int tid : parser_.GetTids(process.pid))
+    {
+      tasks_.emplace_back(process.pid, tid);
+    }
+  }
+  // Expanded pids that exited are forgotten, rows are sorted by pid
+  if (!expanded.empty())
+  {
+    auto alive = [&processes](int pid)
+    {
+      auto found = std::lower_bound(processes.begin(), processes.end(), pid,
+                                    [](const ProcessRow &row, int value)
+                                    { return row.pid < value; });
+      return found != processes.end() && found->pid == pid;
+    };
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto pid = expanded_.begin(); pid != expanded_.end();)
+    {
+      pid = alive(*pid) ? std::next(pid) : expanded_.erase(pid);
+    }
+  }
+
+  double change = 0.0;
+  std::size_t const reads = std::min(max_reads_, tasks_.size());
+  if (cursor_ >= tasks_.size())
+  {
+    cursor_ = 0;
+  }
+  for (std::size_t n = 0; n < reads; ++n)
+  {
+    auto const [pid, tid] = tasks_[(cursor_ + n) % tasks_.size()];
+    parser_factory::pid_stat_t stat;
+    if (!parser_.GetTaskStat(pid, tid, stat))
+    {
+      continue; // the thread exited since the listing
+    }
+    unsigned long const jiffies = stat.getActiveJiffies();
+    auto found = states_.find(tid);
+    if (found == states_.end() || found->second.starttime != stat.starttime)
+    {
+      found = states_.insert_or_assign(tid, state_t{}).first;
+      found->second.row.cpu_utilization = 0.0f;
+      found->second.measured = false;
+    }
+    else
+    {
+      state_t &state = found->second;
+      double const seconds =
+          std::chrono::duration<double>(now - state.when).count();
+      if (seconds > 0.0 && jiffies >= state.jiffies)
+      {
+        float const cpu = static_cast<float>(
+            (jiffies - state.jiffies) / ticks_per_second_ / seconds);
+        if (state.measured)
+        {
+          change = std::max(change, static_cast<double>(std::abs(
+                                        cpu - state.row.cpu_utilization)));
+        }
+        state.row.cpu_utilization = cpu;
+        state.measured = true;
+      }
+    }
+    state_t &state = found->second;
+    state.starttime = stat.starttime;
+    state.jiffies = jiffies;
+    state.when = now;
+    state.row.pid = pid;
+    state.row.tid = tid;
+    state.row.state = stat.state;
+    std::memcpy(state.row.comm, stat.comm, sizeof(state.row.comm));
+    state.row.processor = stat.processor;
+  }
+  cursor_ = tasks_.empty() ? 0 : (cursor_ + reads) % tasks_.size();
+
+  // Threads not read this time keep their last values
+  threads.clear();
+  std::unordered_map<int, state_t> kept;
+  kept.reserve(tasks_.size());
+  for (const auto &task : tasks_)
+  {
+    auto found = states_.find(task.second);
+    if (found != states_.end())
+    {
+      threads.push_back(found->second.row);
+      kept.insert(std::move(*found));
+    }
+  }
+  std::swap(states_, kept);
+  std::sort(threads.begin(), threads.end(),
+            [](const ThreadRow &a, const ThreadRow &b)
+            {
+              if (a.pid != b.pid)
+              {
+                return a.pid < b.pid;
+              }
+              if (a.cpu_utilization != b.cpu_utilization)
+              {
+                return a.cpu_utilization > b.cpu_utilization;
+              }
+              return a.tid < b.tid;
+            });
+  return change;
+}
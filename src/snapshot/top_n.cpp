@@ -0,0 +1,115 @@
+#include "snapshot/top_n.h"
+
+#include <algorithm>
+
+using namespace snapshot;
+
+namespace
+{
+double RankOf(const ProcessRow &row, SortKey key)
+{
+  switch (key)
+  {
+  case SortKey::kCpu:
+    return row.cpu_utilization;
+  case SortKey::kRss:
+    return static_cast<double>(row.rss_kb);
+  case SortKey::kIoRate:
+    return row.io_rate;
+  case SortKey::kStartTime:
+    return static_cast<double>(row.starttime);
+  case SortKey::kEnergy:
+    return row.energy_joules;
+  case SortKey::kFds:
+    return row.fds;
+  }
+  return 0.0;
+}
+
+// Higher key first, lower pid (row index) breaks ties
+struct Better
+{
+  template <typename T>
+  bool operator()(const T &a, const T &b) const
+  {
+    return a.key > b.key || (a.key == b.key && a.index < b.index);
+  }
+};
+} // namespace
+
+const char *snapshot::SortKeyName(SortKey key)
+{
+  switch (key)
+  {
+  case SortKey::kCpu:
+    return "CPU";
+  case SortKey::kRss:
+    return "RSS";
+  case SortKey::kIoRate:
+    return "IO";
+  case SortKey::kStartTime:
+    return "START";
+  case SortKey::kEnergy:
+    return "ENERGY";
+  case SortKey::kFds:
+    return "FDS";
+  }
+  return "UNKNOWN";
+}
+
+const std::vector<std::uint32_t> &
+TopNSelector::Select(const std::vector<ProcessRow> &processes, SortKey key,
+                     std::size_t n)
+{
+  n = std::min(n, processes.size());
+  ranked_.clear();
+  order_.clear();
+  if (n == 0)
+  {
+    return order_;
+  }
+
+  Better better;
+  if (n * 8 < processes.size())
+  {
+    // Bounded heap, the worst of the current top n sits at the front
+    ranked_.reserve(n);
+    for (std::uint32_t i = 0; i < processes.size(); ++i)
+    {
+      ranked_t candidate{RankOf(processes[i], key), i};
+      if (ranked_.size() < n)
+      {
+        ranked_.push_back(candidate);
+        std::push_heap(ranked_.begin(), ranked_.end(), better);
+      }
+      else if (better(candidate, ranked_.front()))
+      {
+        std::pop_heap(ranked_.begin(), ranked_.end(), better);
+        ranked_.back() = candidate;
+        std::push_heap(ranked_.begin(), ranked_.end(), better);
+      }
+    }
+  }
+  else
+  {
+    ranked_.reserve(processes.size());
+    for (std::uint32_t i = 0; i < processes.size(); ++i)
+    {
+      ranked_.push_back({RankOf(processes[i], key), i});
+    }
+    if (n < ranked_.size())
+    {
+      std::nth_element(ranked_.begin(), ranked_.begin() + (n - 1),
+                       ranked_.end(), better);
+      ranked_.resize(n);
+    }
+  }
+  std::sort(ranked_.begin(), ranked_.end(), better);
+
+  order_.reserve(n);
+  for (const ranked_t &ranked : ranked_)
+  {
+    order_.push_back(ranked.index);
+  }
+  return order_;
+}
@@ -0,0 +1,195 @@
+#include "snapshot/work_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+#include "stop_signal.h"
+
+using namespace snapshot;
+
+namespace
+{
+// Deque of the worker running on this thread, if it belongs to a pool
+thread_local const WorkPool *tls_pool = nullptr;
+thread_local std::size_t tls_index = 0;
+
+// A waiter with nothing to steal sleeps this long before looking again
+constexpr std::chrono::microseconds kWaitPoll(200);
+} // namespace
+
+std::size_t WorkPool::DefaultWorkers()
+{
+  unsigned const cores = std::thread::hardware_concurrency();
+  return std::min<std::size_t>(cores > 1 ? cores - 1 : 0, 3);
+}
+
+WorkPool::WorkPool(std::size_t workers)
+{
+  for (std::size_t i = 0; i <= workers; ++i)
+  {
+    deques_.push_back(std::make_unique<deque_t>());
+  }
+  threads_.reserve(workers);
+  for (std::size_t i = 0; i < workers; ++i)
+  {
+    threads_.emplace_back(&WorkPool::Work, this, i);
+  }
+}
+
+WorkPool::~WorkPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread &thread : threads_)
+  {
+    thread.join();
+  }
+}
+
+void WorkPool::Spawn(Group &group, Job job)
+{
+  std::size_t const index = tls_pool == this ? tls_index : threads_.size();
+  group.pending_.fetch_add(1, std::memory_order_relaxed);
+  {
+    std::lock_guard<std::mutex> lock(deques_[index]->mutex);
+    deques_[index]->jobs.push_back({std::move(job), &group});
+  }
+  queued_.fetch_add(1, std::memory_order_release);
+  if (!threads_.empty())
+  {
+    // Taking the lock orders this against a worker about to sleep
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    wake_.notify_one();
+  }
+}
+
+void WorkPool::Wait(Group &group)
+{
+  std::size_t const index = tls_pool == this ? tls_index : threads_.size();
+  while (group.pending_.load(std::memory_order_acquire) != 0)
+  {
+    if (RunOne(index))
+    {
+      continue;
+    }
+    // Whatever is left is running on other workers
+    std::unique_lock<std::mutex> lock(group.mutex_);
+    group.done_.wait_for(lock, kWaitPoll, [&group] {
+      return group.pending_.load(std::memory_order_acquire) == 0;
+    });
+  }
+  std::lock_guard<std::mutex> lock(group.mutex_);
+  if (group.error_)
+  {
+    std::rethrow_exception(std::exchange(group.error_, nullptr));
+  }
+}
+
+void WorkPool::ParallelFor(
+    std::size_t count, std::size_t grain,
+    const std::function<void(std::size_t, std::size_t)> &body)
+{
+  grain = std::max<std::size_t>(grain, 1);
+  if (threads_.empty() || count <= grain)
+  {
+    if (count > 0)
+    {
+      body(0, count);
+    }
+    return;
+  }
+  Group group;
+  for (std::size_t begin = 0; begin < count; begin += grain)
+  {
+    std::size_t const end = std::min(count, begin + grain);
+    Spawn(group, [&body, begin, end] { body(begin, end); });
+  }
+  Wait(group);
+}
+
+void WorkPool::Work(std::size_t index)
+{
+  BlockStopSignals();
+  tls_pool = this;
+  tls_index = index;
+  for (;;)
+  {
+    if (RunOne(index))
+    {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    wake_.wait(lock, [this] {
+      return stopping_ || queued_.load(std::memory_order_acquire) != 0;
+    });
+    if (stopping_)
+    {
+      return;
+    }
+  }
+}
+
+bool WorkPool::RunOne(std::size_t index)
+{
+  if (queued_.load(std::memory_order_acquire) == 0)
+  {
+    return false;
+  }
+  queued_t queued{};
+  bool found = false;
+  for (std::size_t n = 0; n < deques_.size() && !found; ++n)
+  {
+    deque_t &deque = *deques_[(index + n) % deques_.size()];
+    std::lock_guard<std::mutex> lock(deque.mutex);
+    if (deque.jobs.empty())
+    {
+      continue;
+    }
+    if (n == 0)
+    {
+      queued = std::move(deque.jobs.back());
+      deque.jobs.pop_back();
+    }
+    else
+    {
+      queued = std::move(deque.jobs.front());
+      deque.jobs.pop_front();
+    }
+    found = true;
+  }
+  if (!found)
+  {
+    return false;
+  }
+  queued_.fetch_sub(1, std::memory_order_acq_rel);
+  Finish(queued);
+  return true;
+}
+
+void WorkPool::Finish(queued_t &queued)
+{
+  Group &group = *queued.group;
+  try
+  {
+    queued.job();
+  }
+  catch (...)
+  {
+    std::lock_guard<std::mutex> lock(group.mutex_);
+    if (!group.error_)
+    {
+      group.error_ = std::current_exception();
+    }
+  }
+  queued.job = nullptr;
+  // The waiter may destroy the group as soon as pending reaches zero
+  std::lock_guard<std::mutex> lock(group.mutex_);
+  if (group.pending_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+  {
+    group.done_.notify_all();
+  }
+}
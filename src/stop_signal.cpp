@@ -0,0 +1,45 @@
+#include "stop_signal.h"
+
+#include <pthread.h>
+
+#include <csignal>
+
+namespace {
+volatile std::sig_atomic_t stop_requested = 0;
+
+void RequestStop(int) { stop_requested = 1; }
+}  // namespace
+
+void InstallStopHandlers() {
+  std::signal(SIGPIPE, SIG_IGN);
+  std::signal(SIGINT, RequestStop);
+  std::signal(SIGTERM, RequestStop);
+}
+
+bool StopRequested() { return stop_requested != 0; }
+
+void WaitForStopSignal() {
+  // Block the stop signals around the check so one arriving between the
+  // check and the wait stays pending; sigsuspend() unblocks them atomically
+  sigset_t signals;
+  sigset_t previous;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, &previous);
+  sigset_t waiting = previous;
+  sigdelset(&waiting, SIGINT);
+  sigdelset(&waiting, SIGTERM);
+  while (!StopRequested()) {
+    sigsuspend(&waiting);
+  }
+  pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+}
+
+void BlockStopSignals() {
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+}
@@ -1,11 +1,21 @@
 #include <unistd.h>
+#include <algorithm>
+#include <charconv>
 #include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
 #include <set>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "process.h"
 #include "processor.h"
+#include "snapshot/process_filter.h"
+#include "snapshot/work_pool.h"
 #include "system.h"
 
 using std::set;
@@ -13,26 +23,383 @@ using std::size_t;
 using std::string;
 using std::vector;
 
+System::System(bool batch_reads) {
+  if (batch_reads) {
+    batch_reader_ = std::make_unique<parser_factory::BatchReader>();
+  }
+}
+
 // TODO: Return the system's CPU
 Processor& System::Cpu() { return cpu_; }
 
-// TODO: Return a container composed of the system's processes
-vector<Process>& System::Processes() { return processes_; }
+namespace {
+// Processes per chunk of a scan split across a WorkPool
+constexpr size_t kScanGrain = 256;
+// Age after which a process is taken to have finished exec'ing and
+// dropping privileges, its user and command line are final from then on
+constexpr long kSettleSeconds = 2;
+// Excluded processes put back through the filter each scan, in turn, so
+// a reused pid or an exec or setuid after settling is seen eventually
+// while a scan still skips nearly all of them
+constexpr size_t kRechecksPerScan = 16;
+
+// Reads the values of one process as the filter asks for them. stat is
+// read at most once, and only when a comparison or the listing needs it.
+class ScanSubject : public snapshot::FilterSubject {
+ public:
+  ScanSubject(Process& process, parser_factory::ProcessParser& parser,
+              double uptime, bool refreshed, std::atomic<std::uint64_t>& reads)
+      : process_(process),
+        parser_(parser),
+        uptime_(uptime),
+        refreshed_(refreshed),
+        reads_(reads) {}
+
+  // False once the process is gone
+  bool Refresh() {
+    if (refreshed_) return true;
+    ++reads_;
+    parser_factory::pid_stat_t stat;
+    if (!parser_.GetStat(process_.Pid(), stat)) return false;
+    process_.Refresh(stat, uptime_);
+    refreshed_ = true;
+    return true;
+  }
+
+  bool Number(snapshot::FilterField field, double& value) override {
+    using snapshot::FilterField;
+    static const long page_kb = sysconf(_SC_PAGESIZE) / 1024;
+    if (field == FilterField::kPid) {
+      value = process_.Pid();
+      return true;
+    }
+    if (field == FilterField::kUser) return ReadUid(value);
+    if (!Refresh()) return false;
+    const parser_factory::pid_stat_t& stat = process_.Stat();
+    switch (field) {
+      case FilterField::kPpid:
+        value = stat.ppid;
+        break;
+      case FilterField::kCpu:
+        value = process_.CpuUtilization() * 100.0;
+        break;
+      case FilterField::kRss:
+        value = stat.rss * page_kb / 1024.0;
+        break;
+      case FilterField::kThreads:
+        value = stat.num_threads;
+        break;
+      default:
+        value = process_.UpTime();
+        break;
+    }
+    return true;
+  }
+
+  bool Text(snapshot::FilterField field, string& text) override {
+    using snapshot::FilterField;
+    if (field == FilterField::kCgroup) {
+      ++reads_;
+      text = parser_factory::ProcessParser::GetCgroup(process_.Pid());
+      return true;
+    }
+    if (field == FilterField::kCmd) {
+      ++reads_;
+      return parser_.ReadCommand(process_.Pid(), text);
+    }
+    if (!Refresh()) return false;
+    const parser_factory::pid_stat_t& stat = process_.Stat();
+    if (field == FilterField::kState) {
+      text.assign(1, stat.state);
+    } else {
+      text.assign(stat.comm, strnlen(stat.comm, sizeof(stat.comm)));
+    }
+    return true;
+  }
+
+ private:
+  bool ReadUid(double& value) {
+    ++reads_;
+    string uid;
+    try {
+      uid = parser_.GetUid(process_.Pid());
+    } catch (const std::runtime_error&) {
+      return false;
+    }
+    unsigned long number = 0;
+    auto result = std::from_chars(uid.data(), uid.data() + uid.size(), number);
+    if (result.ec != std::errc()) return false;
+    value = static_cast<double>(number);
+    return true;
+  }
+
+  Process& process_;
+  parser_factory::ProcessParser& parser_;
+  double uptime_;
+  bool refreshed_;
+  std::atomic<std::uint64_t>& reads_;
+};
+}  // namespace
+
+void System::SetFilter(std::shared_ptr<const snapshot::ProcessFilter> filter) {
+  std::lock_guard<std::mutex> lock(filter_mutex_);
+  filter_ = std::move(filter);
+  ++filter_generation_;
+}
+
+string System::FilterExpression() const {
+  return scan_filter_ ? scan_filter_->Expression() : string();
+}
+
+// Merges the sorted pid list into the sorted process list so that
+// surviving processes keep their previous samples and cached details.
+// Pids a filter excluded for good are skipped without reading anything,
+// but for a few put back through the filter in turn.
+vector<Process>& System::Processes(snapshot::WorkPool* pool) {
+  {
+    std::lock_guard<std::mutex> lock(filter_mutex_);
+    if (filter_generation_ != scan_generation_) {
+      scan_filter_ = filter_;
+      scan_generation_ = filter_generation_;
+      excluded_.clear();
+    }
+  }
+  vector<int> const pids = process_parser_.GetPids();
+  double const uptime = ReadUpTime();
+  seen_ = static_cast<int>(pids.size());
+
+  // Hidden processes are sampled too, so their CPU is right once they match
+  vector<Process> tracked;
+  if (hidden_.empty()) {
+    tracked = std::move(processes_);
+  } else {
+    tracked.reserve(processes_.size() + hidden_.size());
+    std::merge(std::make_move_iterator(processes_.begin()),
+               std::make_move_iterator(processes_.end()),
+               std::make_move_iterator(hidden_.begin()),
+               std::make_move_iterator(hidden_.end()),
+               std::back_inserter(tracked),
+               [](const Process& a, const Process& b) {
+                 return a.Pid() < b.Pid();
+               });
+  }
+  vector<Process> current;
+  current.reserve(pids.size());
+  vector<int> excluded;
+  excluded.reserve(excluded_.size());
+  // The exclusions after the last one rechecked, wrapping around
+  vector<bool> recheck(excluded_.size(), false);
+  if (!excluded_.empty()) {
+    size_t const first = static_cast<size_t>(
+        std::upper_bound(excluded_.begin(), excluded_.end(), rechecked_pid_) -
+        excluded_.begin());
+    size_t const count = std::min(kRechecksPerScan, excluded_.size());
+    for (size_t i = 0; i < count; ++i) {
+      size_t const index = (first + i) % excluded_.size();
+      recheck[index] = true;
+      rechecked_pid_ = excluded_[index];
+    }
+  }
+
+  auto existing = tracked.begin();
+  auto skipped = excluded_.begin();
+  for (int pid : pids) {
+    while (skipped != excluded_.end() && *skipped < pid) ++skipped;
+    if (skipped != excluded_.end() && *skipped == pid &&
+        !recheck[skipped - excluded_.begin()]) {
+      excluded.push_back(pid);
+      continue;
+    }
+    while (existing != tracked.end() && existing->Pid() < pid) ++existing;
+    if (existing != tracked.end() && existing->Pid() == pid) {
+      current.push_back(std::move(*existing));
+      ++existing;
+    } else {
+      current.emplace_back(pid);
+    }
+  }
+
+  vector<ScanResult> results(current.size(), ScanResult::kGone);
+  if (batch_reader_) {
+    UpdateBatched(current, uptime, results);
+  } else {
+    // Every process is refreshed on its own, chunks can run in parallel
+    auto update = [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        results[i] = Scan(current[i], uptime, false);
+      }
+    };
+    if (pool != nullptr) {
+      pool->ParallelFor(current.size(), kScanGrain, update);
+    } else {
+      update(0, current.size());
+    }
+  }
+
+  processes_.clear();
+  hidden_.clear();
+  size_t const still_excluded = excluded.size();
+  for (size_t i = 0; i < current.size(); ++i) {
+    switch (results[i]) {
+      case ScanResult::kListed:
+        processes_.push_back(std::move(current[i]));
+        break;
+      case ScanResult::kHidden:
+        hidden_.push_back(std::move(current[i]));
+        break;
+      case ScanResult::kExcluded:
+        excluded.push_back(current[i].Pid());
+        break;
+      case ScanResult::kGone:
+        break;
+    }
+  }
+  std::inplace_merge(excluded.begin(), excluded.begin() + still_excluded,
+                     excluded.end());
+  excluded_ = std::move(excluded);
+  AttributeEnergy();
+  return processes_;
+}
+
+System::ScanResult System::Scan(Process& process, double uptime,
+                                 bool refreshed) {
+  if (!scan_filter_) {
+    scan_reads_ += process.WantsIo() ? 2 : 1;
+    return process.Update(process_parser_, uptime) ? ScanResult::kListed
+                                                   : ScanResult::kGone;
+  }
+  ScanSubject subject(process, process_parser_, uptime, refreshed,
+                      scan_reads_);
+  // A process that passed the lifetime tests before only needs its stat,
+  // which also tells whether the pid was reused in the meantime
+  bool settled = false;
+  if (process.Admitted() == scan_generation_) {
+    if (!subject.Refresh()) return ScanResult::kGone;
+    settled = process.Admitted() == scan_generation_;
+  }
+  ScanResult result = ScanResult::kGone;
+  // Unless settled, a mismatch also means the lifetime tests passed
+  bool admissible = false;
+  switch (scan_filter_->Evaluate(subject, settled)) {
+    case snapshot::FilterResult::kGone:
+      return ScanResult::kGone;
+    case snapshot::FilterResult::kMismatch:
+      result = ScanResult::kHidden;
+      admissible = true;
+      break;
+    case snapshot::FilterResult::kExcluded:
+      result = ScanResult::kExcluded;
+      break;
+    case snapshot::FilterResult::kMatch:
+      result = ScanResult::kListed;
+      admissible = true;
+      break;
+  }
+  if (!subject.Refresh()) return ScanResult::kGone;
+  // A young process may still exec or change its user
+  bool const settling = process.UpTime() < kSettleSeconds;
+  if (result == ScanResult::kExcluded && settling) {
+    result = ScanResult::kHidden;
+  }
+  // Hidden processes that passed are then only tested on their stat
+  if (admissible && !settling) process.Admit(scan_generation_);
+  if (result == ScanResult::kListed && !refreshed && process.WantsIo()) {
+    ++scan_reads_;
+    process.UpdateIo(process_parser_, uptime);
+  }
+  return result;
+}
+
+void System::UpdateBatched(vector<Process>& processes, double uptime,
+                           vector<ScanResult>& results) {
+  scan_reads_ += processes.size();
+  batch_reader_->Read(
+      processes.size(),
+      [&processes](size_t i, char* path, size_t size) {
+        std::snprintf(path, size, "/proc/%d/stat", processes[i].Pid());
+      },
+      [&](size_t i, std::string_view data, int error) {
+        parser_factory::pid_stat_t stat;
+        if (error == 0 &&
+            process_parser_.DecodeStat(data, processes[i].Pid(), stat)) {
+          processes[i].Refresh(stat, uptime);
+          results[i] = ScanResult::kListed;
+        }
+      });
+  // io only of the processes that are still there, listed and readable
+  vector<size_t> readable;
+  for (size_t i = 0; i < processes.size(); ++i) {
+    if (results[i] != ScanResult::kListed) continue;
+    if (scan_filter_) results[i] = Scan(processes[i], uptime, true);
+    if (results[i] == ScanResult::kListed && processes[i].WantsIo()) {
+      readable.push_back(i);
+    }
+  }
+  scan_reads_ += readable.size();
+  batch_reader_->Read(
+      readable.size(),
+      [&](size_t i, char* path, size_t size) {
+        std::snprintf(path, size, "/proc/%d/io", processes[readable[i]].Pid());
+      },
+      [&](size_t i, std::string_view data, int error) {
+        parser_factory::pid_io_t io;
+        bool const decoded =
+            error == 0 && parser_factory::ProcessParser::DecodeIo(data, io);
+        processes[readable[i]].RefreshIo(decoded ? &io : nullptr,
+                                         decoded ? 0 : error, uptime);
+      });
+}
+
+// Splits the package energy used since the last scan between processes
+// in proportion to the CPU time they used in the same interval
+void System::AttributeEnergy() {
+  double const energy = cpu_parser_.GetPackageEnergy();
+  if (energy < 0) return;
+  double used = energy - last_energy_;
+  if (used < 0) used += cpu_parser_.GetPackageEnergyRange();
+  bool const first = last_energy_ < 0;
+  last_energy_ = energy;
+  if (first) return;
+
+  double total_cpu = 0.0;
+  // Hidden processes use the package too, excluded ones are not known
+  for (vector<Process>* list : {&processes_, &hidden_}) {
+    for (Process& process : *list) total_cpu += process.CpuUtilization();
+  }
+  if (total_cpu <= 0.0) return;
+  for (vector<Process>* list : {&processes_, &hidden_}) {
+    for (Process& process : *list) {
+      process.AddEnergy(used * process.CpuUtilization() / total_cpu);
+    }
+  }
+}
 
 // TODO: Return the system's kernel identifier (string)
 std::string System::Kernel() { return string(); }
 
-// TODO: Return the system's memory utilization
-float System::MemoryUtilization() { return 0.0; }
-
 // TODO: Return the operating system name
 std::string System::OperatingSystem() { return string(); }
 
-// TODO: Return the number of processes actively running on the system
-int System::RunningProcesses() { return 0; }
+// Every collector runs even when one before it failed
+bool System::Collect(parser_factory::metric_snapshot_t& metrics) {
+  parser_factory::IMetricCollector* const collectors[] = {
+      &cpu_parser_, &memory_parser_, &network_parser_, &system_parser_};
+  bool collected = true;
+  for (parser_factory::IMetricCollector* collector : collectors) {
+    collected = collector->Collect(metrics) && collected;
+  }
+  return collected;
+}
+
+// Number of processes seen by the last Processes() scan
+int System::TotalProcesses() { return seen_; }
 
-// TODO: Return the total number of processes on the system
-int System::TotalProcesses() { return 0; }
+long int System::UpTime() { return static_cast<long>(ReadUpTime()); }
 
-// TODO: Return the number of seconds since the system started running
-long int System::UpTime() { return 0; }
\ No newline at end of file
+double System::ReadUpTime() {
+  std::ifstream uptime_file(
+      parser_factory::LinuxFilesSet.at("kUptimeFilename"));
+  double uptime = 0.0;
+  uptime_file >> uptime;
+  return uptime;
+}
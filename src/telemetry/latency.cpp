@@ -0,0 +1,331 @@
+#include "telemetry/latency.h"
+
+#include <time.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+#include "format.h"
+
+using namespace telemetry;
+
+namespace
+{
+typedef struct TscCalibration
+{
+  bool usable;
+  double ns_per_tick;
+} tsc_calibration_t;
+
+std::uint64_t MonotonicNs()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<std::uint64_t>(now.tv_sec) * 1000000000ull +
+         static_cast<std::uint64_t>(now.tv_nsec);
+}
+
+// The TSC is only a clock when it ticks at a constant rate in every
+// power state, the kernel reports both as cpuinfo flags
+tsc_calibration_t Calibrate()
+{
+  tsc_calibration_t calibration{false, 1.0};
+#if defined(__x86_64__)
+  std::ifstream cpuinfo("/proc/cpuinfo");
+  std::string line;
+  while (std::getline(cpuinfo, line))
+  {
+    if (line.compare(0, 5, "flags") != 0)
+    {
+      continue;
+    }
+    line += ' ';
+    if (line.find(" constant_tsc ") == std::string::npos ||
+        line.find(" nonstop_tsc ") == std::string::npos)
+    {
+      return calibration;
+    }
+    // Spin against CLOCK_MONOTONIC for 2 ms to learn the TSC rate
+    std::uint64_t const start_ns = MonotonicNs();
+    std::uint64_t const start_tsc = __rdtsc();
+    std::uint64_t now_ns = start_ns;
+    while (now_ns - start_ns < 2000000)
+    {
+      now_ns = MonotonicNs();
+    }
+    std::uint64_t const ticks = __rdtsc() - start_tsc;
+    if (ticks > 0)
+    {
+      calibration.usable = true;
+      calibration.ns_per_tick = static_cast<double>(now_ns - start_ns) / ticks;
+    }
+    break;
+  }
+#endif
+  return calibration;
+}
+
+const tsc_calibration_t &Calibration()
+{
+  static const tsc_calibration_t calibration = Calibrate();
+  return calibration;
+}
+
+typedef struct ThreadProbes
+{
+  std::array<LatencyHistogram, kProbeCount> histograms;
+  std::array<int, kProbeCount> depth{};
+} thread_probes_t;
+
+std::mutex registry_mutex;
+// Kept after their thread exits so merged totals never go backwards
+std::vector<std::shared_ptr<thread_probes_t>> registry;
+
+thread_probes_t &Local()
+{
+  thread_local std::shared_ptr<thread_probes_t> local = []
+  {
+    auto probes = std::make_shared<thread_probes_t>();
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    registry.push_back(probes);
+    return probes;
+  }();
+  return *local;
+}
+
+// Single writer increments, cheaper than a locked fetch_add
+void Bump(std::atomic<std::uint64_t> &counter, std::uint64_t value)
+{
+  counter.store(counter.load(std::memory_order_relaxed) + value,
+                std::memory_order_relaxed);
+}
+
+void Raise(std::atomic<std::uint64_t> &counter, std::uint64_t value)
+{
+  if (value > counter.load(std::memory_order_relaxed))
+  {
+    counter.store(value, std::memory_order_relaxed);
+  }
+}
+} // namespace
+
+const char *telemetry::ProbeName(Probe probe)
+{
+  switch (probe)
+  {
+  case Probe::kCpu:
+    return "cpu";
+  case Probe::kMemory:
+    return "memory";
+  case Probe::kProcess:
+    return "process";
+  case Probe::kSystem:
+    return "system";
+  case Probe::kCgroup:
+    return "cgroup";
+  case Probe::kNetwork:
+    return "network";
+  case Probe::kPressure:
+    return "pressure";
+  case Probe::kInterrupts:
+    return "interrupts";
+  case Probe::kNuma:
+    return "numa";
+  case Probe::kCollection:
+    return "collection";
+  }
+  return "unknown";
+}
+
+// -----------------------------
+// ProbeClock Implementation
+std::uint64_t ProbeClock::Now()
+{
+#if defined(__x86_64__)
+  if (Calibration().usable)
+  {
+    return __rdtsc();
+  }
+#endif
+  return MonotonicNs();
+}
+
+std::uint64_t ProbeClock::ToNanoseconds(std::uint64_t ticks)
+{
+  const tsc_calibration_t &calibration = Calibration();
+  return calibration.usable
+             ? static_cast<std::uint64_t>(ticks * calibration.ns_per_tick)
+             : ticks;
+}
+
+bool ProbeClock::UsesTsc() { return Calibration().usable; }
+
+// -----------------------------
+// LatencyHistogram Implementation
+std::size_t LatencyHistogram::BucketFor(std::uint64_t nanoseconds)
+{
+  constexpr std::uint64_t kLinear = 2ull << kSubBucketBits;
+  constexpr std::uint64_t kLargest = (1ull << kMaxValueBits) - 1;
+  std::uint64_t const value = std::min(nanoseconds, kLargest);
+  if (value < kLinear)
+  {
+    return static_cast<std::size_t>(value);
+  }
+  int const shift = 63 - __builtin_clzll(value) - kSubBucketBits;
+  return kLinear + (shift - 1) * (1u << kSubBucketBits) +
+         static_cast<std::size_t>((value >> shift) - (1u << kSubBucketBits));
+}
+
+std::uint64_t LatencyHistogram::HighestValueIn(std::size_t bucket)
+{
+  constexpr std::size_t kLinear = 2u << kSubBucketBits;
+  if (bucket < kLinear)
+  {
+    return bucket;
+  }
+  std::size_t const offset = bucket - kLinear;
+  int const shift = static_cast<int>(offset >> kSubBucketBits) + 1;
+  std::uint64_t const sub =
+      (offset & ((1u << kSubBucketBits) - 1)) + (1u << kSubBucketBits);
+  return (sub << shift) + (1ull << shift) - 1;
+}
+
+void LatencyHistogram::Record(std::uint64_t nanoseconds)
+{
+  Bump(buckets_[BucketFor(nanoseconds)], 1);
+  Bump(count_, 1);
+  Bump(sum_, nanoseconds);
+  Raise(max_, nanoseconds);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram &other)
+{
+  for (std::size_t i = 0; i < kBucketCount; ++i)
+  {
+    std::uint64_t const count = other.buckets_[i].load(std::memory_order_relaxed);
+    if (count != 0)
+    {
+      Bump(buckets_[i], count);
+    }
+  }
+  Bump(count_, other.count_.load(std::memory_order_relaxed));
+  Bump(sum_, other.sum_.load(std::memory_order_relaxed));
+  Raise(max_, other.max_.load(std::memory_order_relaxed));
+}
+
+void LatencyHistogram::Reset()
+{
+  for (auto &bucket : buckets_)
+  {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+  count_.store(0, std::memory_order_relaxed);
+  sum_.store(0, std::memory_order_relaxed);
+  max_.store(0, std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::Count() const
+{
+  return count_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::Sum() const
+{
+  return sum_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::Max() const
+{
+  return max_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::Percentile(double percentile) const
+{
+  // Counted from the buckets, a concurrent writer may be ahead of count_
+  std::uint64_t total = 0;
+  for (const auto &bucket : buckets_)
+  {
+    total += bucket.load(std::memory_order_relaxed);
+  }
+  if (total == 0)
+  {
+    return 0;
+  }
+  double const share = std::clamp(percentile, 0.0, 100.0) / 100.0;
+  std::uint64_t const target = std::max<std::uint64_t>(
+      1, static_cast<std::uint64_t>(std::ceil(share * total)));
+  std::uint64_t seen = 0;
+  for (std::size_t i = 0; i < kBucketCount; ++i)
+  {
+    seen += buckets_[i].load(std::memory_order_relaxed);
+    if (seen >= target)
+    {
+      return std::min(HighestValueIn(i), Max());
+    }
+  }
+  return Max();
+}
+
+void telemetry::MergeProbe(Probe probe, LatencyHistogram &merged)
+{
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  for (const auto &probes : registry)
+  {
+    merged.Merge(probes->histograms[static_cast<int>(probe)]);
+  }
+}
+
+std::string telemetry::Describe(std::initializer_list<Probe> probes)
+{
+  std::string text;
+  char buffer[32];
+  LatencyHistogram merged;
+  for (Probe probe : probes)
+  {
+    merged.Reset();
+    MergeProbe(probe, merged);
+    if (merged.Count() == 0)
+    {
+      continue;
+    }
+    text += ProbeName(probe);
+    text += ": p50 ";
+    text.append(buffer, Format::Duration(merged.Percentile(50), buffer, sizeof(buffer)));
+    text += " p99 ";
+    text.append(buffer, Format::Duration(merged.Percentile(99), buffer, sizeof(buffer)));
+    text += " max ";
+    text.append(buffer, Format::Duration(merged.Max(), buffer, sizeof(buffer)));
+    text += " n=" + std::to_string(merged.Count()) + "\n";
+  }
+  return text;
+}
+
+// -----------------------------
+// ScopedProbe Implementation
+ScopedProbe::ScopedProbe(Probe probe) : probe_(probe)
+{
+  ++Local().depth[static_cast<int>(probe_)];
+  start_ = ProbeClock::Now();
+}
+
+ScopedProbe::~ScopedProbe()
+{
+  std::uint64_t const end = ProbeClock::Now();
+  thread_probes_t &probes = Local();
+  int const index = static_cast<int>(probe_);
+  if (--probes.depth[index] == 0)
+  {
+    // A migration between cores may see a slightly older TSC
+    probes.histograms[index].Record(
+        ProbeClock::ToNanoseconds(end > start_ ? end - start_ : 0));
+  }
+}
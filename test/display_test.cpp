@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include "format.h"
+#include "ncurses_display.h"
+#include <string>
+
+using namespace NCursesDisplay;
+
+class FrameCacheTest : public ::testing::Test {
+protected:
+    void SetUp() override { cache.Reset(4, 40); }
+    FrameCache cache;
+};
+
+// First write of a cell is always emitted
+TEST_F(FrameCacheTest, Put_EmitsNewCell) {
+    EXPECT_TRUE(cache.Put(nullptr, 1, 2, 10, "hello", 5));
+}
+
+// Same contents in the next frame are skipped
+TEST_F(FrameCacheTest, Put_SkipsUnchangedCell) {
+    cache.Put(nullptr, 1, 2, 10, "hello", 5);
+    EXPECT_FALSE(cache.Put(nullptr, 1, 2, 10, "hello", 5));
+    EXPECT_TRUE(cache.Put(nullptr, 1, 2, 10, "hellp", 5));
+}
+
+// Shorter text must blank the tail left by the previous frame
+TEST_F(FrameCacheTest, Put_ShorterTextIsChange) {
+    cache.Put(nullptr, 1, 2, 10, "hello", 5);
+    EXPECT_TRUE(cache.Put(nullptr, 1, 2, 10, "hell", 4));
+    EXPECT_FALSE(cache.Put(nullptr, 1, 2, 10, "hell    ", 8));
+}
+
+// Cells of one row with different attributes are cached each on its own
+TEST_F(FrameCacheTest, Put_KeepsAttributesPerCell) {
+    cache.Put(nullptr, 1, 0, 10, "name", 4, A_REVERSE);
+    cache.Put(nullptr, 1, 10, 10, "bar", 3);
+    EXPECT_FALSE(cache.Put(nullptr, 1, 0, 10, "name", 4, A_REVERSE));
+    EXPECT_FALSE(cache.Put(nullptr, 1, 10, 10, "bar", 3));
+    EXPECT_TRUE(cache.Put(nullptr, 1, 0, 10, "name", 4));
+    EXPECT_FALSE(cache.Put(nullptr, 1, 10, 10, "bar", 3));
+}
+
+// Invalidate forces a full redraw
+TEST_F(FrameCacheTest, Invalidate_ReemitsCells) {
+    cache.Put(nullptr, 1, 2, 10, "hello", 5);
+    cache.Invalidate();
+    EXPECT_TRUE(cache.Put(nullptr, 1, 2, 10, "hello", 5));
+}
+
+// Cells outside of the window are ignored
+TEST_F(FrameCacheTest, Put_OutOfBoundsIsIgnored) {
+    EXPECT_FALSE(cache.Put(nullptr, 4, 0, 10, "x", 1));
+    EXPECT_FALSE(cache.Put(nullptr, 0, 40, 10, "x", 1));
+}
+
+// Test ProgressBar()
+TEST(ProgressBarTest, ProgressBar_HasFixedLayout) {
+    std::string empty = ProgressBar(0.0f);
+    std::string full = ProgressBar(1.0f);
+    EXPECT_EQ(empty.size(), full.size());
+    EXPECT_EQ(empty.substr(0, 3), "0%|");
+    EXPECT_NE(full.find("100.0/100%"), std::string::npos);
+    EXPECT_EQ(full.substr(2, 50), std::string(50, '|'));
+}
+
+// Test ElapsedTime()
+TEST(FormatTest, ElapsedTime_FormatsHoursMinutesSeconds) {
+    EXPECT_EQ(Format::ElapsedTime(0), "00:00:00");
+    EXPECT_EQ(Format::ElapsedTime(3661), "01:01:01");
+    EXPECT_EQ(Format::ElapsedTime(-5), "00:00:00");
+}
+
+// Test Format::Duration()
+TEST(FormatTest, Duration_PicksUnitByMagnitude) {
+    char buffer[16];
+    EXPECT_EQ(std::string(buffer, Format::Duration(850, buffer, sizeof(buffer))), "850ns");
+    EXPECT_EQ(std::string(buffer, Format::Duration(12345, buffer, sizeof(buffer))), "12.3us");
+    EXPECT_EQ(std::string(buffer, Format::Duration(4560000, buffer, sizeof(buffer))), "4.56ms");
+    EXPECT_EQ(std::string(buffer, Format::Duration(2000000000, buffer, sizeof(buffer))), "2.00s");
+}
+
+// Test ProcessListView scrolling
+TEST(ProcessListViewTest, HandleKey_KeepsSelectionInsidePage) {
+    ProcessListView view;
+    for (int i = 0; i < 25; ++i) view.HandleKey(KEY_DOWN, 100, 10);
+    EXPECT_EQ(view.Selected(), 25u);
+    EXPECT_EQ(view.Top(), 16u);
+    view.HandleKey(KEY_END, 100, 10);
+    EXPECT_EQ(view.Selected(), 99u);
+    EXPECT_EQ(view.Top(), 90u);
+    view.HandleKey(KEY_PPAGE, 100, 10);
+    EXPECT_EQ(view.Selected(), 89u);
+    EXPECT_EQ(view.Top(), 89u);
+    EXPECT_FALSE(view.HandleKey('x', 100, 10));
+}
+
+// Test ProcessListView following a pid between snapshots
+TEST(ProcessListViewTest, Follow_TracksSelectedPid) {
+    std::vector<snapshot::ProcessRow> rows(5);
+    std::vector<std::uint32_t> order;
+    for (int i = 0; i < 5; ++i) {
+        rows[i].pid = 100 + i;
+        order.push_back(i);
+    }
+    ProcessListView view;
+    view.Follow(rows, order, 3);
+    view.HandleKey(KEY_DOWN, rows.size(), 3);
+    view.HandleKey(KEY_DOWN, rows.size(), 3);
+    view.Follow(rows, order, 3);
+    // The selected pid moves to the top of a new ordering
+    std::swap(order[0], order[2]);
+    view.Follow(rows, order, 3);
+    EXPECT_EQ(view.Selected(), 0u);
+    EXPECT_EQ(rows[order[view.Selected()]].pid, 102);
+}
+
+// Test ProcessTreeView collapsing a subtree
+TEST(ProcessTreeViewTest, HandleKey_CollapsesSelectedSubtree) {
+    snapshot::SystemSnapshot system;
+    system.sequence = 1;
+    system.processes.resize(3);
+    for (int i = 0; i < 3; ++i) {
+        system.processes[i].pid = i + 1;
+        system.processes[i].ppid = i;
+    }
+    ProcessTreeView tree;
+    EXPECT_FALSE(tree.HandleKey(' ', 1));
+    EXPECT_TRUE(tree.HandleKey('t', -1));
+    EXPECT_EQ(tree.Order(system).size(), 3u);
+    EXPECT_EQ(tree.Depth(2), 2);
+    EXPECT_TRUE(tree.HandleKey(' ', 2));
+    EXPECT_TRUE(tree.Collapsed(2));
+    EXPECT_EQ(tree.Order(system).size(), 2u);
+    EXPECT_TRUE(tree.HandleKey(' ', 2));
+    EXPECT_EQ(tree.Order(system).size(), 3u);
+}
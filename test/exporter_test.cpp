@@ -0,0 +1,369 @@
+#include <gtest/gtest.h>
+#include "exporter/agent.h"
+#include "exporter/aggregator.h"
+#include "exporter/delta_codec.h"
+#include "exporter/metrics_server.h"
+#include "exporter/prometheus_renderer.h"
+#include "exporter/record_serializer.h"
+#include "exporter/shm_segment.h"
+#include "exporter/socket_address.h"
+#include "options.h"
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace exporter;
+
+// Fills one process, thread, latency and pressure row for the exporter suites
+class ExporterTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        snapshot.sequence = 7;
+        snapshot.cpu_utilization = 0.5f;
+        snapshot.total_processes = 1;
+        snapshot::ProcessRow row{};
+        row.pid = 42;
+        row.state = 'R';
+        std::strcpy(row.comm, "a\"b,c");
+        row.rss_kb = 1024;
+        row.pss_kb = 512;
+        row.uss_kb = 256;
+        row.swap_kb = 0;
+        row.read_rate = 4096.0;
+        row.write_rate = 0.0;
+        row.syscr_rate = 2.0f;
+        row.syscw_rate = 0.0f;
+        snapshot.processes.push_back(row);
+        snapshot.latencies.push_back({"cpu", 3, 3000, 900, 1100, 1200});
+        snapshot.pressure.push_back({"system", "io", 12.5f, 4, 1, 2.5f, 0, 0});
+        snapshot.pressure_events = 2;
+        snapshot::ThreadRow thread{};
+        thread.pid = 42;
+        thread.tid = 43;
+        thread.state = 'S';
+        std::strcpy(thread.comm, "worker");
+        thread.processor = 1;
+        thread.cpu_utilization = 0.25f;
+        snapshot.threads.push_back(thread);
+    }
+    snapshot::SystemSnapshot snapshot;
+};
+
+class RecordSerializerTest : public ExporterTest {};
+class PrometheusRendererTest : public ExporterTest {};
+class ShmSegmentTest : public ExporterTest {};
+class DeltaCodecTest : public ExporterTest {};
+class AggregatorTest : public ExporterTest {};
+class AgentTest : public ExporterTest {};
+
+// Test JSON Lines output
+TEST_F(RecordSerializerTest, Serialize_JsonLinesIsOneEscapedLine) {
+    RecordSerializer serializer(RecordFormat::kJsonLines);
+    std::string record(serializer.Serialize(snapshot));
+    EXPECT_EQ(record.back(), '\n');
+    EXPECT_EQ(record.find('\n'), record.size() - 1);
+    EXPECT_NE(record.find("\"sequence\":7"), std::string::npos);
+    EXPECT_NE(record.find("\"cpu\":0.5000"), std::string::npos);
+    EXPECT_NE(record.find("\"comm\":\"a\\\"b,c\""), std::string::npos);
+    EXPECT_NE(record.find("\"read_rate\":4096.0,\"write_rate\":0.0,\"syscr_rate\":2.0,"),
+              std::string::npos);
+    EXPECT_NE(record.find("\"pss_kb\":512,\"uss_kb\":256,\"swap_kb\":0"),
+              std::string::npos);
+    EXPECT_NE(record.find("\"latency\":{\"cpu\":{\"count\":3,\"p50_ns\":900,"),
+              std::string::npos);
+    EXPECT_NE(record.find("\"pressure\":[{\"scope\":\"system\",\"resource\":\"io\","
+                          "\"some\":[12.50,4.00,1.00],\"full\":[2.50,0.00,0.00]}],"
+                          "\"pressure_events\":2"),
+              std::string::npos);
+    EXPECT_NE(record.find("\"threads\":[{\"pid\":42,\"tid\":43,\"state\":\"S\","
+                          "\"comm\":\"worker\",\"cpu\":0.2500,\"processor\":1}]}"),
+              std::string::npos);
+    EXPECT_TRUE(serializer.Preamble().empty());
+}
+
+// Test CSV output
+TEST_F(RecordSerializerTest, Serialize_CsvQuotesFields) {
+    RecordSerializer serializer(RecordFormat::kCsv);
+    std::string record(serializer.Serialize(snapshot));
+    EXPECT_NE(record.find(",7,42,0,R,\"a\"\"b,c\",0.0000,1024,"), std::string::npos);
+    EXPECT_EQ(serializer.Preamble().substr(0, 13), "timestamp_ns,");
+}
+
+// Test binary output
+TEST_F(RecordSerializerTest, Serialize_BinaryIsLengthPrefixed) {
+    RecordSerializer serializer(RecordFormat::kBinary);
+    std::string_view record = serializer.Serialize(snapshot);
+    std::uint32_t length;
+    std::memcpy(&length, record.data(), sizeof(length));
+    EXPECT_EQ(length, record.size() - sizeof(length));
+    EXPECT_EQ(length, sizeof(RecordSerializer::SystemHeader) +
+                      sizeof(RecordSerializer::ProcessRecord));
+    RecordSerializer::ProcessRecord process;
+    std::memcpy(&process, record.data() + sizeof(length) +
+                sizeof(RecordSerializer::SystemHeader), sizeof(process));
+    EXPECT_EQ(process.pid, 42);
+}
+
+// Test ParseOptions()
+TEST(OptionsTest, ParseOptions_ReadsBatchFlags) {
+    Options options = ParseOptions({"--batch", "--format=csv", "-o", "out.csv",
+                                    "--interval", "100", "--count=3"});
+    EXPECT_TRUE(options.batch);
+    EXPECT_EQ(options.format, RecordFormat::kCsv);
+    EXPECT_EQ(options.output, "out.csv");
+    EXPECT_EQ(options.interval.count(), 100);
+    EXPECT_EQ(options.count, 3);
+    EXPECT_FALSE(options.adaptive);
+    EXPECT_DOUBLE_EQ(ParseOptions({"--overhead-budget=2.5"}).overhead_budget, 0.025);
+    EXPECT_EQ(ParseOptions({"--threads", "java"}).threads, "java");
+    EXPECT_TRUE(ParseOptions({"--io-uring"}).io_uring);
+}
+
+// Test ParseOptions() rejects bad input
+TEST(OptionsTest, ParseOptions_RejectsInvalidArguments) {
+    EXPECT_THROW(ParseOptions({"--format", "xml"}), std::invalid_argument);
+    EXPECT_THROW(ParseOptions({"--interval", "-1"}), std::invalid_argument);
+    EXPECT_THROW(ParseOptions({"--count"}), std::invalid_argument);
+    EXPECT_THROW(ParseOptions({"--unknown"}), std::invalid_argument);
+    EXPECT_THROW(ParseOptions({"--aggregate", "unix:/a", "--attach"}),
+                 std::invalid_argument);
+}
+
+// Test PrometheusRenderer
+TEST_F(PrometheusRendererTest, RenderBody_RendersFamiliesAndLabels) {
+    PrometheusRenderer renderer(5);
+    std::string body(renderer.RenderBody(snapshot));
+    EXPECT_NE(body.find("# TYPE monitor_cpu_utilization_ratio gauge\nmonitor_cpu_utilization_ratio 0.5\n"),
+              std::string::npos);
+    EXPECT_NE(body.find("monitor_process_read_bytes_per_second{pid=\"42\",comm=\"a\\\"b,c\"} 4096\n"),
+              std::string::npos);
+    EXPECT_NE(body.find("monitor_process_resident_bytes{pid=\"42\",comm=\"a\\\"b,c\"} 1048576\n"),
+              std::string::npos);
+    EXPECT_NE(body.find("monitor_collector_latency_seconds{collector=\"cpu\",quantile=\"0.99\"} 1.1e-06\n"),
+              std::string::npos);
+    EXPECT_NE(body.find("monitor_collector_latency_seconds_count{collector=\"cpu\"} 3\n"),
+              std::string::npos);
+    EXPECT_NE(body.find("monitor_pressure_stall_ratio{scope=\"system\",resource=\"io\","
+                        "kind=\"some\",window=\"10\"} 0.125\n"),
+              std::string::npos);
+    EXPECT_NE(body.find("monitor_pressure_events 2\n"), std::string::npos);
+    std::string response = renderer.RenderResponse(snapshot);
+    EXPECT_EQ(response.compare(0, 15, "HTTP/1.1 200 OK"), 0);
+    EXPECT_NE(response.find("Content-Length: " + std::to_string(body.size()) + "\r\n"),
+              std::string::npos);
+}
+
+namespace {
+// Sends request over a new connection to address, half-closes it and
+// returns everything the server answered
+std::string Scrape(const std::string& address, const std::string& request) {
+    int fd = ConnectTo(address);
+    if (fd < 0) {
+        return std::string();
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+    EXPECT_EQ(send(fd, request.data(), request.size(), MSG_NOSIGNAL),
+              static_cast<ssize_t>(request.size()));
+    shutdown(fd, SHUT_WR);
+    std::string response;
+    char buffer[4096];
+    ssize_t length;
+    while ((length = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+        response.append(buffer, length);
+    }
+    close(fd);
+    return response;
+}
+}  // namespace
+
+// Test MetricsServer answers scrapes over a socket, also from clients
+// that half-close right after their request
+TEST(MetricsServerTest, Start_ServesMetricsOverSocket) {
+    std::string address = "unix:/tmp/monitor_metrics_test_" + std::to_string(getpid()) + ".sock";
+    snapshot::SnapshotPublisher publisher;
+    auto published = std::make_unique<snapshot::SystemSnapshot>();
+    published->cpu_utilization = 0.5f;
+    publisher.Publish(std::move(published));
+    MetricsServer server(publisher, address);
+    server.Start();
+
+    std::string response = Scrape(address, "GET /metrics HTTP/1.1\r\nHost: x\r\n\r\n");
+    EXPECT_EQ(response.compare(0, 15, "HTTP/1.1 200 OK"), 0) << response;
+    EXPECT_NE(response.find("monitor_cpu_utilization_ratio 0.5\n"), std::string::npos);
+    response = Scrape(address, "GET /other HTTP/1.1\r\n\r\n");
+    EXPECT_NE(response.find(" 404 "), std::string::npos) << response;
+    server.Stop();
+    EXPECT_TRUE(Scrape(address, "GET / HTTP/1.1\r\n\r\n").empty());
+}
+
+// Test that TCP endpoints only bind loopback addresses
+TEST(MetricsServerTest, Start_RejectsNonLoopbackAddress) {
+    snapshot::SnapshotPublisher publisher;
+    MetricsServer server(publisher, "0.0.0.0:9100");
+    EXPECT_THROW(server.Start(), std::runtime_error);
+    EXPECT_THROW(ListenOn("192.168.1.1:9100"), std::runtime_error);
+    EXPECT_THROW(ConnectTo("10.0.0.1:9200"), std::runtime_error);
+}
+
+// Test ShmWriter and ShmReader
+TEST_F(ShmSegmentTest, Publish_RoundTripsSnapshot) {
+    std::string name = "/green_sys_test_" + std::to_string(getpid());
+    snapshot::SnapshotPublisher publisher;
+    ShmWriter writer(publisher, name, 4);
+    writer.Start();
+    ShmReader reader(name);
+    reader.Open();
+    snapshot::SystemSnapshot copy;
+    EXPECT_EQ(reader.Read(copy), 0u);
+
+    snapshot.kernel = "6.1.0";
+    publisher.Publish(std::make_unique<snapshot::SystemSnapshot>(snapshot));
+    EXPECT_EQ(reader.Sequence(), 2u);
+    ASSERT_EQ(reader.Read(copy), 2u);
+    EXPECT_EQ(copy.sequence, 1u);
+    EXPECT_EQ(copy.kernel, "6.1.0");
+    EXPECT_FLOAT_EQ(copy.cpu_utilization, 0.5f);
+    ASSERT_EQ(copy.processes.size(), 1u);
+    EXPECT_EQ(copy.processes[0].pid, 42);
+    EXPECT_STREQ(copy.processes[0].comm, "a\"b,c");
+    writer.Stop();
+    EXPECT_THROW(ShmReader(name).Open(), std::runtime_error);
+}
+
+// Test that a segment of a live writer is never taken over, while one
+// left behind by a writer that is gone is reclaimed
+TEST_F(ShmSegmentTest, Start_RefusesLiveWriterAndReclaimsStale) {
+    std::string name = "/green_sys_owner_" + std::to_string(getpid());
+    snapshot::SnapshotPublisher publisher;
+    ShmWriter first(publisher, name, 4);
+    first.Start();
+    ShmWriter second(publisher, name, 4);
+    EXPECT_THROW(second.Start(), std::runtime_error);
+    ShmReader(name).Open();  // still the first writer's segment
+    first.Stop();
+
+    // Unlocked leftovers, as after a crash
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(ftruncate(fd, 4096), 0);
+    close(fd);
+    EXPECT_NO_THROW(second.Start());
+    EXPECT_NO_THROW(ShmReader(name).Open());
+    second.Stop();
+}
+
+// Test DeltaEncoder and DeltaDecoder
+TEST_F(DeltaCodecTest, Encode_SendsOnlyWhatChanged) {
+    DeltaEncoder encoder;
+    DeltaDecoder decoder;
+    std::string keyframe(encoder.Encode(snapshot, "web-1"));
+    ASSERT_TRUE(decoder.Decode(std::string_view(keyframe).substr(4)));
+    EXPECT_EQ(decoder.Name(), "web-1");
+    EXPECT_EQ(decoder.Snapshot().sequence, 7u);
+    ASSERT_EQ(decoder.Snapshot().processes.size(), 1u);
+    EXPECT_STREQ(decoder.Snapshot().processes[0].comm, "a\"b,c");
+    EXPECT_EQ(decoder.Snapshot().processes[0].pss_kb, 512);
+
+    snapshot.sequence = 8;
+    snapshot.processes[0].rss_kb = 1030;
+    snapshot::ProcessRow child = snapshot.processes[0];
+    child.pid = 50;
+    child.ppid = 42;
+    snapshot.processes.push_back(child);
+    std::string delta(encoder.Encode(snapshot, "web-1"));
+    ASSERT_TRUE(decoder.Decode(std::string_view(delta).substr(4)));
+    ASSERT_EQ(decoder.Snapshot().processes.size(), 2u);
+    EXPECT_EQ(decoder.Snapshot().processes[0].rss_kb, 1030);
+    EXPECT_EQ(decoder.Snapshot().processes[1].ppid, 42);
+
+    // Only the exited pid and the system fields that moved are sent
+    snapshot.sequence = 9;
+    snapshot.processes.pop_back();
+    std::string exit(encoder.Encode(snapshot, "web-1"));
+    EXPECT_LT(exit.size(), 16u);
+    EXPECT_LT(exit.size(), keyframe.size());
+    ASSERT_TRUE(decoder.Decode(std::string_view(exit).substr(4)));
+    EXPECT_EQ(decoder.Snapshot().sequence, 9u);
+    ASSERT_EQ(decoder.Snapshot().processes.size(), 1u);
+    EXPECT_EQ(decoder.Snapshot().processes[0].pid, 42);
+
+    DeltaDecoder late;
+    EXPECT_FALSE(late.Decode(std::string_view(exit).substr(4)));
+    EXPECT_FALSE(decoder.Decode(std::string_view(keyframe).substr(4, 5)));
+}
+
+// Test Agent and Aggregator
+TEST_F(AggregatorTest, Start_MergesAgentsBySource) {
+    std::string address = "unix:/tmp/monitor_agg_test_" + std::to_string(getpid()) + ".sock";
+    snapshot::SnapshotPublisher merged;
+    Aggregator aggregator(merged, address, std::chrono::milliseconds(10));
+    aggregator.Start();
+    snapshot::SnapshotPublisher first, second;
+    Agent a(first, address, "a");
+    Agent b(second, address, "b");
+    a.Start();
+    b.Start();
+    first.Publish(std::make_unique<snapshot::SystemSnapshot>(snapshot));
+    snapshot.cpu_utilization = 1.0f;
+    second.Publish(std::make_unique<snapshot::SystemSnapshot>(snapshot));
+
+    snapshot::SnapshotPublisher::Reader reader(merged);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    std::size_t rows = 0;
+    while (rows < 2 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        rows = reader.Acquire()->processes.size();
+    }
+    {
+        auto view = reader.Acquire();
+        ASSERT_EQ(view->processes.size(), 2u);
+        ASSERT_EQ(view->sources.size(), 2u);
+        EXPECT_FLOAT_EQ(view->cpu_utilization, 0.75f);
+        EXPECT_EQ(view->total_processes, 2);
+        for (const auto &row : view->processes) {
+            EXPECT_EQ(row.pid, 42);
+            ASSERT_GE(row.source, 1);
+            EXPECT_TRUE(view->sources[row.source - 1].connected);
+            EXPECT_EQ(row.subtree.processes, 1);
+        }
+        EXPECT_NE(view->processes[0].source, view->processes[1].source);
+    }
+    EXPECT_EQ(a.Frames(), 1u);
+    a.Stop();
+    b.Stop();
+    aggregator.Stop();
+}
+
+// Test that an Agent started before its aggregator connects once the
+// aggregator appears, even while ticks keep waking it
+TEST_F(AgentTest, Start_ReconnectsToLateAggregator) {
+    std::string address = "unix:/tmp/monitor_agg_late_" + std::to_string(getpid()) + ".sock";
+    snapshot::SnapshotPublisher local;
+    Agent agent(local, address, "late");
+    agent.Start();
+    // Ticks come faster than the backoff, which grows past them at once
+    auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+    while (std::chrono::steady_clock::now() < until) {
+        local.Publish(std::make_unique<snapshot::SystemSnapshot>(snapshot));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    EXPECT_EQ(agent.Frames(), 0u);
+
+    snapshot::SnapshotPublisher merged;
+    Aggregator aggregator(merged, address, std::chrono::milliseconds(10));
+    aggregator.Start();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (agent.Frames() == 0 && std::chrono::steady_clock::now() < deadline) {
+        local.Publish(std::make_unique<snapshot::SystemSnapshot>(snapshot));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    EXPECT_GE(agent.Frames(), 1u);
+    agent.Stop();
+    aggregator.Stop();
+}
@@ -1,5 +1,15 @@
 #include <gtest/gtest.h>
+#include "parser_factory/batch_reader.h"
 #include "parser_factory/parser.h"
+#include <cerrno>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
 #include <fstream>
 #include <sstream>
 #include <thread>
@@ -12,11 +22,18 @@ protected:
     CpuParser cpuParser;
 };
 
-// Test GetCPUUsage()
-TEST_F(CpuParserTest, GetCPUUsage_ReturnsValidPercentage) {
-    std::string usage = cpuParser.GetCPUUsage();
-    EXPECT_FALSE(usage.empty());
-    EXPECT_TRUE(usage.find('%') != std::string::npos);  // Check if output contains '%'
+// Test Collect()
+TEST_F(CpuParserTest, Collect_FillsCountersAndUtilization) {
+    metric_snapshot_t metrics{};
+    ASSERT_TRUE(cpuParser.Collect(metrics));
+    EXPECT_GT(metrics.cpu_count, 0);
+    EXPECT_GT(metrics.cpu_user + metrics.cpu_system + metrics.cpu_idle, 0ULL);
+    EXPECT_GT(metrics.context_switches, 0ULL);
+    EXPECT_GT(metrics.forks, 0ULL);
+    EXPECT_FLOAT_EQ(metrics.cpu_utilization, 0.0f);  // no previous sample
+    ASSERT_TRUE(cpuParser.Collect(metrics));
+    EXPECT_GE(metrics.cpu_utilization, 0.0f);
+    EXPECT_LE(metrics.cpu_utilization, 1.0f);
 }
 
 // Test GetCPUInfo()
@@ -71,4 +88,366 @@ TEST_F(CpuParserTest, GetJiffies_pid_ReturnsPositiveValue) {
 TEST_F(CpuParserTest, GetIdleJiffies_ReturnsPositiveValue) {
     long idleJiffies = cpuParser.GetIdleJiffies();
     EXPECT_GE(idleJiffies, 0)<< "idleJiffies is greater than 0";
-}
\ No newline at end of file
+}
+class ProcessParserTest : public ::testing::Test {
+protected:
+    ProcessParser processParser;
+};
+
+// Test GetStat() against our own process
+TEST_F(ProcessParserTest, GetStat_DecodesOwnProcess) {
+    pid_stat_t stat;
+    ASSERT_TRUE(processParser.GetStat(getpid(), stat));
+    EXPECT_EQ(stat.pid, getpid());
+    EXPECT_EQ(stat.ppid, getppid());
+    EXPECT_EQ(stat.state, 'R');
+    EXPECT_GE(stat.num_threads, 1);
+    EXPECT_GT(stat.starttime, 0u);
+}
+
+// Test GetStat() for a pid that does not exist
+TEST_F(ProcessParserTest, GetStat_MissingPidReturnsFalse) {
+    pid_stat_t stat;
+    EXPECT_FALSE(processParser.GetStat(-1, stat));
+}
+
+// Test GetSchedStat() against our own process
+TEST_F(ProcessParserTest, GetSchedStat_ReadsOwnProcess) {
+    pid_schedstat_t schedstat;
+    ASSERT_TRUE(processParser.GetSchedStat(getpid(), schedstat));
+    EXPECT_GT(schedstat.run_ns, 0u);
+    EXPECT_GT(schedstat.timeslices, 0u);
+    EXPECT_FALSE(processParser.GetSchedStat(-1, schedstat));
+}
+
+// Test GetSchedStat() sums the threads, not only the group leader
+TEST_F(ProcessParserTest, GetSchedStat_SumsThreads) {
+    std::atomic<bool> spun{false};
+    std::atomic<bool> stop{false};
+    std::thread worker([&] {
+        auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+        while (std::chrono::steady_clock::now() < until) {
+        }
+        spun = true;
+        while (!stop) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+    while (!spun) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    unsigned long long leader_run_ns = 0;
+    std::ifstream(std::string("/proc/") + std::to_string(getpid()) + "/schedstat") >> leader_run_ns;
+    pid_schedstat_t schedstat;
+    ASSERT_TRUE(processParser.GetSchedStat(getpid(), schedstat));
+    stop = true;
+    worker.join();
+    EXPECT_GE(schedstat.run_ns, leader_run_ns + 50000000ull);
+}
+
+// Test GetPids()
+TEST_F(ProcessParserTest, GetPids_ContainsOwnPid) {
+    std::vector<int> pids = processParser.GetPids();
+    EXPECT_TRUE(std::binary_search(pids.begin(), pids.end(), getpid()));
+}
+
+// Test GetStatm() and GetSmapsRollup() agree on the own process
+TEST_F(ProcessParserTest, GetSmapsRollup_ReadsOwnProcess) {
+    parser_factory::pid_memory_t statm;
+    ASSERT_TRUE(processParser.GetStatm(getpid(), statm));
+    EXPECT_GT(statm.rss_kb, 0);
+    EXPECT_LT(statm.pss_kb, 0);
+    parser_factory::pid_memory_t rollup;
+    ASSERT_TRUE(processParser.GetSmapsRollup(getpid(), rollup));
+    EXPECT_GT(rollup.pss_kb, 0);
+    EXPECT_LE(rollup.uss_kb, rollup.pss_kb);
+    EXPECT_LE(rollup.pss_kb, rollup.rss_kb);
+    EXPECT_FALSE(processParser.GetStatm(-1, statm));
+}
+
+// Test GetIo() decodes the counters of the own process
+TEST_F(ProcessParserTest, GetIo_ReadsOwnProcess) {
+    parser_factory::pid_io_t before;
+    ASSERT_TRUE(processParser.GetIo(getpid(), before));
+    EXPECT_GT(before.syscr, 0u);
+    parser_factory::pid_io_t after;
+    ASSERT_TRUE(processParser.GetIo(getpid(), after));
+    EXPECT_GT(after.syscr, before.syscr);
+    EXPECT_FALSE(processParser.GetIo(-1, after));
+}
+
+// Test GetTids() and GetTaskStat()
+TEST_F(ProcessParserTest, GetTaskStat_DecodesOwnMainThread) {
+    std::vector<int> tids = processParser.GetTids(getpid());
+    ASSERT_TRUE(std::binary_search(tids.begin(), tids.end(), getpid()));
+    parser_factory::pid_stat_t stat;
+    ASSERT_TRUE(processParser.GetTaskStat(getpid(), getpid(), stat));
+    EXPECT_EQ(stat.pid, getpid());
+    EXPECT_TRUE(processParser.GetTids(-1).empty());
+}
+
+// Test GetCommand()
+TEST_F(ProcessParserTest, GetCommand_ReturnsOwnCommandLine) {
+    std::string command = processParser.GetCommand(getpid());
+    EXPECT_NE(command.find("monitor_tests"), std::string::npos);
+}
+
+// Test CountFds(), GetFds() and GetFdLimit()
+TEST_F(ProcessParserTest, GetFds_ClassifiesOwnDescriptors) {
+    pid_fds_t before;
+    ASSERT_TRUE(processParser.GetFds(getpid(), before));
+    int pipes[2];
+    int sockets[2];
+    ASSERT_EQ(pipe(pipes), 0);
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), 0);
+    pid_fds_t after;
+    ASSERT_TRUE(processParser.GetFds(getpid(), after));
+    // The directory of the scan is open during it, but in both scans
+    EXPECT_EQ(after.total, before.total + 4);
+    EXPECT_EQ(after.pipes, before.pipes + 2);
+    EXPECT_EQ(after.sockets, before.sockets + 2);
+    EXPECT_EQ(after.total, after.sockets + after.pipes + after.files + after.other);
+    EXPECT_EQ(processParser.CountFds(getpid()), after.total);
+    for (int fd : {pipes[0], pipes[1], sockets[0], sockets[1]}) close(fd);
+    EXPECT_GT(processParser.GetFdLimit(getpid()), after.total);
+    EXPECT_EQ(processParser.CountFds(-1), -1);
+    EXPECT_EQ(processParser.GetFdLimit(-1), -1);
+}
+
+// Test ReadCommand() and ReadUser()
+TEST_F(ProcessParserTest, ReadCommand_ReusesBuffer) {
+    std::string command(1000, 'x');
+    ASSERT_TRUE(processParser.ReadCommand(getpid(), command));
+    EXPECT_EQ(command, processParser.GetCommand(getpid()));
+    EXPECT_FALSE(processParser.ReadCommand(-1, command));
+    std::string_view user = processParser.ReadUser(getpid());
+    EXPECT_EQ(user, processParser.GetUser(getpid()));
+    EXPECT_EQ(processParser.ReadUser(getpid()).data(), user.data());
+    EXPECT_TRUE(processParser.ReadUser(-1).empty());
+}
+
+// Test both BatchReader backends over more files than slots
+TEST(BatchReaderTest, Read_DecodesFilesInBatches) {
+    for (BatchReader::Backend backend :
+         {BatchReader::Backend::kSync, BatchReader::Backend::kAuto}) {
+        BatchReader reader(backend, 2);
+        ProcessParser parser;
+        std::vector<int> errors(5, -1);
+        std::vector<int> pids(5, 0);
+        reader.Read(
+            errors.size(),
+            [](std::size_t i, char* path, std::size_t size) {
+                if (i == 3) {
+                    std::snprintf(path, size, "/proc/-1/stat");
+                } else {
+                    std::snprintf(path, size, "/proc/%d/stat", getpid());
+                }
+            },
+            [&](std::size_t i, std::string_view data, int error) {
+                errors[i] = error;
+                pid_stat_t stat;
+                if (error == 0 && parser.DecodeStat(data, getpid(), stat)) {
+                    pids[i] = stat.pid;
+                }
+            });
+        EXPECT_EQ(errors, (std::vector<int>{0, 0, 0, ENOENT, 0}));
+        EXPECT_EQ(pids[4], getpid());
+        EXPECT_GT(reader.Syscalls(), 0u);
+    }
+}
+
+// Test GetPressure() on a file in the /proc/pressure format
+TEST(PressureParserTest, GetPressure_ParsesSomeAndFull) {
+    std::string path = "/tmp/monitor_pressure_test_" + std::to_string(getpid());
+    {
+        std::ofstream file(path);
+        file << "some avg10=1.50 avg60=0.25 avg300=0.00 total=123456\n"
+             << "full avg10=0.75 avg60=0.10 avg300=0.01 total=654\n";
+    }
+    PressureParser parser;
+    pressure_t pressure;
+    ASSERT_TRUE(parser.GetPressure(path, pressure));
+    EXPECT_FLOAT_EQ(pressure.some.avg10, 1.5f);
+    EXPECT_FLOAT_EQ(pressure.some.avg60, 0.25f);
+    EXPECT_EQ(pressure.some.total_us, 123456u);
+    EXPECT_FLOAT_EQ(pressure.full.avg300, 0.01f);
+    EXPECT_EQ(pressure.full.total_us, 654u);
+    std::remove(path.c_str());
+    EXPECT_FALSE(parser.GetPressure(path, pressure));
+}
+
+// Test Decode() on a /proc/interrupts table with a CPU offline
+TEST(InterruptParserTest, Decode_ReadsMatrixAndSkipsSummaryLines) {
+    const std::string text =
+        "           CPU0       CPU2       \n"
+        " 24:         10          4294967295  IR-PCI-MSI 524288-edge      eth0-TxRx-0\n"
+        "LOC:        100        200   Local timer interrupts\n"
+        "ERR:          0\n"
+        "MIS:          0\n";
+    interrupt_table_t table{};
+    ASSERT_TRUE(InterruptParser::Decode(text, table));
+    EXPECT_TRUE(table.layout_changed);
+    EXPECT_EQ(table.cpus, (std::vector<int>{0, 2}));
+    EXPECT_EQ(table.names, (std::vector<std::string>{"24", "LOC"}));
+    EXPECT_EQ(table.descriptions[0], "IR-PCI-MSI 524288-edge      eth0-TxRx-0");
+    EXPECT_EQ(table.descriptions[1], "Local timer interrupts");
+    EXPECT_EQ(table.counts,
+              (std::vector<std::uint32_t>{10, 4294967295u, 100, 200}));
+
+    // Same sources and CPUs, only the counters moved
+    ASSERT_TRUE(InterruptParser::Decode(
+        "      CPU0 CPU2\n24: 11 3 IR-PCI-MSI 524288-edge      eth0-TxRx-0\n"
+        "LOC: 101 201 Local timer interrupts\n",
+        table));
+    EXPECT_FALSE(table.layout_changed);
+    EXPECT_EQ(table.counts, (std::vector<std::uint32_t>{11, 3, 101, 201}));
+    EXPECT_FALSE(InterruptParser::Decode("no header\n", table));
+}
+
+// Test NumaParser on a fake /sys/devices/system/node tree
+TEST(NumaParserTest, GetNode_ReadsMeminfoNumastatAndCpus) {
+    std::string root = "/tmp/monitor_numa_test_" + std::to_string(getpid());
+    std::filesystem::create_directories(root + "/node1");
+    std::filesystem::create_directories(root + "/node0");
+    std::filesystem::create_directories(root + "/power");
+    std::ofstream(root + "/node0/cpulist") << "0-1,4\n";
+    std::ofstream(root + "/node0/meminfo")
+        << "Node 0 MemTotal:       65843088 kB\n"
+        << "Node 0 MemFree:         1234567 kB\n"
+        << "Node 0 FilePages:          1000 kB\n";
+    std::ofstream(root + "/node0/numastat")
+        << "numa_hit 100\nnuma_miss 7\nnuma_foreign 3\nother_node 5\n";
+    NumaParser parser(root);
+    EXPECT_EQ(parser.GetNodes(), (std::vector<int>{0, 1}));
+    numa_node_stat_t stat;
+    ASSERT_TRUE(parser.GetNode(0, stat));
+    EXPECT_EQ(stat.cpus, (std::vector<int>{0, 1, 4}));
+    EXPECT_EQ(stat.total_kb, 65843088u);
+    EXPECT_EQ(stat.free_kb, 1234567u);
+    EXPECT_EQ(stat.file_kb, 1000u);
+    EXPECT_EQ(stat.numa_hit, 100u);
+    EXPECT_EQ(stat.numa_miss, 7u);
+    EXPECT_EQ(stat.numa_foreign, 3u);
+    EXPECT_EQ(stat.other_node, 5u);
+    EXPECT_FALSE(parser.GetNode(1, stat));
+    std::filesystem::remove_all(root);
+}
+
+// Test GetNumaMaps() finds the resident memory of our own process
+TEST(NumaParserTest, GetNumaMaps_ReadsOwnProcess) {
+    if (access("/proc/self/numa_maps", R_OK) != 0) {
+        GTEST_SKIP() << "kernel without NUMA support";
+    }
+    NumaParser parser;
+    std::vector<unsigned long long> node_kb;
+    ASSERT_TRUE(parser.GetNumaMaps(getpid(), node_kb));
+    ASSERT_FALSE(node_kb.empty());
+    unsigned long long total{0};
+    for (auto kb : node_kb) total += kb;
+    EXPECT_GT(total, 0u);
+    EXPECT_FALSE(parser.GetNumaMaps(-1, node_kb));
+}
+
+// Test GetPressure() against /proc/pressure/cpu
+TEST(PressureParserTest, GetPressure_ReadsSystemCpu) {
+    if (access("/proc/pressure/cpu", R_OK) != 0) {
+        GTEST_SKIP() << "kernel without PSI";
+    }
+    PressureParser parser;
+    pressure_t pressure;
+    ASSERT_TRUE(parser.GetPressure(PsiResource::kCpu, pressure));
+    EXPECT_GE(pressure.some.avg10, 0.0f);
+    EXPECT_LE(pressure.some.avg300, 100.0f);
+}
+
+// Test WaitForEvents() returns without events once woken
+TEST(PressureParserTest, WaitForEvents_ReturnsWhenWoken) {
+    PressureParser parser;
+    int wake_fd = eventfd(1, EFD_CLOEXEC);
+    ASSERT_GE(wake_fd, 0);
+    EXPECT_TRUE(parser.WaitForEvents(wake_fd).empty());
+    EXPECT_EQ(parser.EventCount(), 0u);
+    close(wake_fd);
+}
+
+// Fake cgroup v2 tree below /tmp, regular files stand in for the stats
+class CgroupParserTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        root = "/tmp/monitor_cgroup_test_" + std::to_string(getpid());
+        std::filesystem::create_directories(root + "/a");
+        Write("/cpu.stat", "usage_usec 900\nuser_usec 600\nsystem_usec 300\n");
+        Write("/a/cpu.stat", "usage_usec 400\nthrottled_usec 7\n");
+        Write("/a/memory.current", "8192\n");
+        Write("/a/memory.stat", "anon 4096\nfile 2048\nkernel 0\n");
+        Write("/a/io.stat", "8:0 rbytes=10 wbytes=20 rios=1 wios=2\n"
+                            "8:16 rbytes=5 wbytes=0 rios=1 wios=0\n");
+    }
+    void TearDown() override { std::filesystem::remove_all(root); }
+    void Write(const std::string& path, const std::string& text) {
+        std::ofstream(root + path) << text;
+    }
+    std::string root;
+};
+
+// Test GetStat() reads every stat file of a group
+TEST_F(CgroupParserTest, GetStat_ReadsCountersOfGroup) {
+    CgroupParser parser(root);
+    EXPECT_EQ(parser.GetCgroups(), (std::vector<std::string>{"/", "/a"}));
+    cgroup_stat_t stat;
+    ASSERT_TRUE(parser.GetStat("/a", stat));
+    EXPECT_EQ(stat.usage_usec, 400u);
+    EXPECT_EQ(stat.throttled_usec, 7u);
+    EXPECT_EQ(stat.memory_bytes, 8192u);
+    EXPECT_EQ(stat.anon_bytes, 4096u);
+    EXPECT_EQ(stat.file_bytes, 2048u);
+    EXPECT_EQ(stat.read_bytes, 15u);
+    EXPECT_EQ(stat.write_bytes, 20u);
+    ASSERT_TRUE(parser.GetStat("/", stat));
+    EXPECT_EQ(stat.usage_usec, 900u);
+    EXPECT_EQ(stat.memory_bytes, 0u);
+    // Descriptors stay open, updated content is read through them
+    Write("/a/cpu.stat", "usage_usec 500\n");
+    ASSERT_TRUE(parser.GetStat("/a", stat));
+    EXPECT_EQ(stat.usage_usec, 500u);
+    EXPECT_FALSE(parser.GetStat("/missing", stat));
+}
+
+// Test Refresh() follows created and removed groups
+TEST_F(CgroupParserTest, Refresh_FollowsCreatedAndRemovedGroups) {
+    CgroupParser parser(root);
+    EXPECT_FALSE(parser.Refresh());
+    std::filesystem::create_directories(root + "/b/c");
+    ASSERT_TRUE(parser.Refresh());
+    EXPECT_EQ(parser.GetCgroups(),
+              (std::vector<std::string>{"/", "/a", "/b", "/b/c"}));
+    std::filesystem::remove_all(root + "/a");
+    ASSERT_TRUE(parser.Refresh());
+    EXPECT_EQ(parser.GetCgroups(),
+              (std::vector<std::string>{"/", "/b", "/b/c"}));
+}
+
+// Test Collect() of every collector through the common interface
+TEST(MetricCollectorTest, Collect_FillsOwnFields) {
+    CpuParser cpu;
+    MemoryParser memory;
+    NetworkParser network;
+    ProcessParser process;
+    PressureParser pressure;
+    SystemParser system(cpu, memory, process, pressure);
+    metric_snapshot_t metrics{};
+    for (IMetricCollector* collector :
+         std::vector<IMetricCollector*>{&memory, &network, &system}) {
+        EXPECT_TRUE(collector->Collect(metrics));
+    }
+    EXPECT_GT(metrics.mem_total_kb, 0ULL);
+    EXPECT_LE(metrics.mem_available_kb, metrics.mem_total_kb);
+    EXPECT_GE(metrics.memory_utilization, 0.0f);
+    EXPECT_LE(metrics.memory_utilization, 1.0f);
+    EXPECT_GT(metrics.uptime_seconds, 0.0);
+    EXPECT_GE(metrics.load1, 0.0f);
+    EXPECT_GT(metrics.threads, 0);
+    EXPECT_DOUBLE_EQ(metrics.rx_rate, 0.0);  // no previous sample
+    EXPECT_TRUE(network.Collect(metrics));
+    EXPECT_GE(metrics.rx_rate, 0.0);
+}
@@ -0,0 +1,723 @@
+#include <gtest/gtest.h>
+#include "snapshot/cgroup_sampler.h"
+#include "snapshot/fd_sampler.h"
+#include "snapshot/interrupt_sampler.h"
+#include "snapshot/memory_sampler.h"
+#include "snapshot/numa_sampler.h"
+#include "snapshot/pressure_monitor.h"
+#include "snapshot/process_details.h"
+#include "snapshot/process_filter.h"
+#include "snapshot/process_tree.h"
+#include "snapshot/run_queue.h"
+#include "snapshot/sampling_scheduler.h"
+#include "snapshot/snapshot_publisher.h"
+#include "snapshot/string_arena.h"
+#include "snapshot/thread_sampler.h"
+#include "snapshot/top_n.h"
+#include "snapshot/work_pool.h"
+#include "system.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace snapshot;
+
+class SnapshotPublisherTest : public ::testing::Test {
+protected:
+    void Publish(long uptime) {
+        auto snapshot = std::make_unique<SystemSnapshot>();
+        snapshot->uptime = uptime;
+        publisher.Publish(std::move(snapshot));
+    }
+    SnapshotPublisher publisher;
+};
+
+// Before the first publish readers see an empty snapshot
+TEST_F(SnapshotPublisherTest, Acquire_BeforePublishReturnsEmpty) {
+    SnapshotPublisher::Reader reader(publisher);
+    auto snapshot = reader.Acquire();
+    EXPECT_EQ(snapshot->sequence, 0u);
+}
+
+// Readers always get the latest published snapshot
+TEST_F(SnapshotPublisherTest, Acquire_ReturnsLatest) {
+    SnapshotPublisher::Reader reader(publisher);
+    Publish(1);
+    Publish(2);
+    auto snapshot = reader.Acquire();
+    EXPECT_EQ(snapshot->uptime, 2);
+    EXPECT_EQ(snapshot->sequence, 2u);
+    EXPECT_EQ(publisher.Sequence(), 2u);
+}
+
+// A snapshot held by a reader is not reclaimed until it is released
+TEST_F(SnapshotPublisherTest, Publish_KeepsSnapshotsHeldByReaders) {
+    SnapshotPublisher::Reader reader(publisher);
+    Publish(1);
+    {
+        auto held = reader.Acquire();
+        Publish(2);
+        Publish(3);
+        EXPECT_EQ(held->uptime, 1);
+        EXPECT_GE(publisher.RetiredCount(), 1u);
+    }
+    Publish(4);
+    EXPECT_EQ(publisher.RetiredCount(), 0u);
+}
+
+// Readers running concurrently with the writer only see whole snapshots
+TEST_F(SnapshotPublisherTest, Acquire_ConcurrentWithPublish) {
+    std::atomic<bool> done{false};
+    std::thread consumer([&] {
+        SnapshotPublisher::Reader reader(publisher);
+        std::uint64_t last = 0;
+        while (!done.load()) {
+            auto snapshot = reader.Acquire();
+            EXPECT_GE(snapshot->sequence, last);
+            EXPECT_EQ(static_cast<std::uint64_t>(snapshot->uptime), snapshot->sequence);
+            last = snapshot->sequence;
+        }
+    });
+    for (long i = 1; i <= 10000; ++i) {
+        Publish(i);
+    }
+    done.store(true);
+    consumer.join();
+}
+
+class TopNSelectorTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        rows.resize(100);
+        for (int i = 0; i < 100; ++i) {
+            rows[i] = {};
+            rows[i].pid = i + 1;
+            rows[i].cpu_utilization = static_cast<float>((i * 37) % 100) / 100;
+            rows[i].rss_kb = 1000 - i;
+            rows[i].starttime = i;
+        }
+    }
+    std::vector<ProcessRow> rows;
+    TopNSelector selector;
+};
+
+// Small n goes through the bounded heap
+TEST_F(TopNSelectorTest, Select_SmallNReturnsBestFirst) {
+    const auto& order = selector.Select(rows, SortKey::kCpu, 3);
+    ASSERT_EQ(order.size(), 3u);
+    EXPECT_FLOAT_EQ(rows[order[0]].cpu_utilization, 0.99f);
+    EXPECT_FLOAT_EQ(rows[order[1]].cpu_utilization, 0.98f);
+    EXPECT_FLOAT_EQ(rows[order[2]].cpu_utilization, 0.97f);
+}
+
+// Large n goes through nth_element and must agree with a full sort
+TEST_F(TopNSelectorTest, Select_LargeNMatchesFullSort) {
+    std::vector<std::uint32_t> order = selector.Select(rows, SortKey::kRss, 60);
+    ASSERT_EQ(order.size(), 60u);
+    for (std::uint32_t i = 0; i < 60; ++i) {
+        EXPECT_EQ(order[i], i);
+    }
+}
+
+// Switching keys only re-ranks the rows already in the snapshot
+TEST_F(TopNSelectorTest, Select_StartTimeNewestFirst) {
+    const auto& order = selector.Select(rows, SortKey::kStartTime, 2);
+    ASSERT_EQ(order.size(), 2u);
+    EXPECT_EQ(rows[order[0]].pid, 100);
+    EXPECT_EQ(rows[order[1]].pid, 99);
+}
+
+// n larger than the table returns every row
+TEST_F(TopNSelectorTest, Select_NLargerThanTable) {
+    EXPECT_EQ(selector.Select(rows, SortKey::kEnergy, 500).size(), rows.size());
+    EXPECT_TRUE(selector.Select({}, SortKey::kCpu, 5).empty());
+}
+
+class SamplingSchedulerTest : public ::testing::Test {
+protected:
+    typedef SamplingScheduler::Clock Clock;
+    Clock::time_point epoch = Clock::time_point(std::chrono::hours(1));
+    // A budget of 100 cores keeps the test process itself from throttling
+    SamplingScheduler scheduler{std::chrono::milliseconds(100), 100.0, true, epoch};
+    int fast_runs = 0;
+    int slow_runs = 0;
+    double fast_score = 0.0;
+};
+
+// Test that shared periods fall into one wakeup
+TEST_F(SamplingSchedulerTest, RunDue_AlignsTasksOnOneGrid) {
+    SamplingScheduler fixed(std::chrono::milliseconds(100), 0.01, false, epoch);
+    fixed.AddTask("fast", 0, 1, 3, [this] { ++fast_runs; return 0.0; });
+    fixed.AddTask("slow", 0, 2, 3, [this] { ++slow_runs; return 0.0; });
+    EXPECT_EQ(fixed.RunDue(epoch), 2);
+    EXPECT_EQ(fixed.NextDeadline(), epoch + std::chrono::milliseconds(200));
+    EXPECT_EQ(fixed.RunDue(epoch + std::chrono::milliseconds(250)), 1);
+    EXPECT_EQ(fixed.NextDeadline(), epoch + std::chrono::milliseconds(400));
+    EXPECT_EQ(fixed.RunDue(epoch + std::chrono::milliseconds(400)), 2);
+    EXPECT_EQ(fast_runs, 3);
+    EXPECT_EQ(slow_runs, 2);
+}
+
+// Test that fast changes speed a task up and quiet runs back it off
+TEST_F(SamplingSchedulerTest, RunDue_AdaptsPeriodToChange) {
+    int id = scheduler.AddTask("cpu", 0, 2, 4, [this] { return fast_score; });
+    fast_score = 2.0;
+    scheduler.RunDue(epoch);
+    EXPECT_EQ(scheduler.Period(id), std::chrono::milliseconds(200));
+    scheduler.RunDue(scheduler.NextDeadline());
+    scheduler.RunDue(scheduler.NextDeadline());
+    EXPECT_EQ(scheduler.Period(id), std::chrono::milliseconds(100));
+
+    fast_score = 0.0;
+    for (int i = 0; i < 4; ++i) scheduler.RunDue(scheduler.NextDeadline());
+    EXPECT_EQ(scheduler.Period(id), std::chrono::milliseconds(200));
+    for (int i = 0; i < 20; ++i) scheduler.RunDue(scheduler.NextDeadline());
+    EXPECT_EQ(scheduler.Period(id), std::chrono::milliseconds(1600));
+}
+
+// Test that a pool runs due tasks concurrently, dependents after their task
+TEST_F(SamplingSchedulerTest, RunDue_RunsDependentsAfterTheirTask) {
+    WorkPool pool(2);
+    scheduler.SetPool(&pool);
+    std::atomic<int> scans{0};
+    std::atomic<int> seen{-1};
+    int scan = scheduler.AddTask("scan", 0, 1, 3, [&] { ++scans; return 0.0; });
+    scheduler.AddTask("reader", 0, 1, 3, [&] { seen = scans.load(); return 0.0; }, scan);
+    scheduler.AddTask("other", 0, 1, 3, [this] { ++slow_runs; return 0.0; });
+    EXPECT_EQ(scheduler.RunDue(epoch), 3);
+    EXPECT_EQ(seen, 1);
+    EXPECT_EQ(slow_runs, 1);
+}
+
+// Test ParallelFor visits every index once, also from inside a job
+TEST(WorkPoolTest, ParallelFor_CoversEveryIndex) {
+    for (std::size_t workers : {0, 3}) {
+        WorkPool pool(workers);
+        std::vector<std::atomic<int>> hits(1000);
+        WorkPool::Group group;
+        pool.Spawn(group, [&] {
+            pool.ParallelFor(hits.size(), 64, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i) ++hits[i];
+            });
+        });
+        pool.Wait(group);
+        EXPECT_TRUE(std::all_of(hits.begin(), hits.end(),
+                                [](const std::atomic<int>& hit) { return hit == 1; }));
+    }
+}
+
+// Test that Wait rethrows what a job threw, after the others finished
+TEST(WorkPoolTest, Wait_RethrowsJobException) {
+    WorkPool pool(2);
+    WorkPool::Group group;
+    std::atomic<int> finished{0};
+    pool.Spawn(group, [] { throw std::runtime_error("failed"); });
+    for (int i = 0; i < 8; ++i) pool.Spawn(group, [&finished] { ++finished; });
+    EXPECT_THROW(pool.Wait(group), std::runtime_error);
+    EXPECT_EQ(finished, 8);
+}
+
+// Test that only the busiest rows get a run-queue wait, from the second round
+TEST(RunQueueSamplerTest, SampleProcesses_MeasuresTopRowsOnly) {
+    RunQueueSampler sampler(1);
+    std::vector<ProcessRow> rows(2, ProcessRow{});
+    rows[0].pid = getpid();
+    rows[0].cpu_utilization = 0.9f;
+    rows[1].pid = getppid();
+    auto now = RunQueueSampler::Clock::now();
+    sampler.SampleProcesses(rows, now);
+    EXPECT_LT(rows[0].run_wait, 0.0f);
+    sampler.SampleProcesses(rows, now + std::chrono::seconds(1));
+    EXPECT_GE(rows[0].run_wait, 0.0f);
+    EXPECT_LT(rows[1].run_wait, 0.0f);
+}
+
+// Test that only the largest rows get smaps values, kept across scans
+TEST(MemorySamplerTest, Sample_ReadsLargestRowsOnly) {
+    MemorySampler sampler(1);
+    std::vector<ProcessRow> rows(2, ProcessRow{});
+    rows[0].pid = getppid();
+    rows[1].pid = getpid();
+    rows[1].rss_kb = 1 << 20;
+    for (ProcessRow& row : rows) {
+        row.pss_kb = row.uss_kb = row.swap_kb = -1;
+    }
+    sampler.Sample(rows);
+    EXPECT_LT(rows[0].pss_kb, 0);
+    ASSERT_GT(rows[1].pss_kb, 0);
+    // A later scan without a smaps read still has them
+    std::vector<ProcessRow> scan(rows);
+    scan[1].pss_kb = -1;
+    sampler.Apply(scan);
+    EXPECT_EQ(scan[1].pss_kb, rows[1].pss_kb);
+    scan[1].starttime += 1;
+    scan[1].pss_kb = -1;
+    sampler.Apply(scan);
+    EXPECT_LT(scan[1].pss_kb, 0);
+}
+
+// Test FdSampler counting every row and resolving the largest
+TEST(FdSamplerTest, Sample_ResolvesRowsWithMostDescriptors) {
+    FdSampler sampler(1);
+    std::vector<ProcessRow> rows(3, ProcessRow{});
+    rows[0].pid = -1;
+    rows[1].pid = getpid();
+    rows[2].pid = getppid();
+    for (ProcessRow& row : rows) {
+        row.fds = row.fd_sockets = row.fd_pipes = row.fd_files = -1;
+        row.fd_limit = -1;
+    }
+    sampler.Sample(rows);
+    EXPECT_LT(rows[0].fds, 0);
+    ASSERT_GT(rows[1].fds, 0);
+    ASSERT_GT(rows[2].fds, 0);
+    // Only the row with the most descriptors is resolved
+    ProcessRow& most = rows[1].fds >= rows[2].fds ? rows[1] : rows[2];
+    ProcessRow& fewer = &most == &rows[1] ? rows[2] : rows[1];
+    EXPECT_GE(most.fd_sockets + most.fd_pipes + most.fd_files, 0);
+    EXPECT_GT(most.fd_limit, 0);
+    EXPECT_LT(fewer.fd_sockets, 0);
+    EXPECT_LT(fewer.fd_limit, 0);
+    // A later scan without a read still has them
+    std::vector<ProcessRow> scan(rows);
+    scan[1].fds = scan[1].fd_limit = -1;
+    sampler.Apply(scan);
+    EXPECT_EQ(scan[1].fds, rows[1].fds);
+    EXPECT_EQ(scan[1].fd_limit, rows[1].fd_limit);
+    scan[1].starttime += 1;
+    scan[1].fds = -1;
+    sampler.Apply(scan);
+    EXPECT_LT(scan[1].fds, 0);
+}
+
+// Test StringArena sharing copies and reclaiming by generation
+TEST(StringArenaTest, Intern_SharesCopiesWithinGeneration) {
+    StringArena arena(64);
+    std::string text = "/usr/sbin/worker --queue=1";
+    std::string_view first = arena.Intern(text);
+    text[0] = 'x';  // the arena holds its own copy
+    std::string_view second = arena.Intern("/usr/sbin/worker --queue=1");
+    EXPECT_EQ(first, "/usr/sbin/worker --queue=1");
+    EXPECT_EQ(first.data(), second.data());
+    EXPECT_TRUE(arena.Intern("").empty());
+    std::string_view long_text = arena.Intern(std::string(200, 'a'));
+    EXPECT_EQ(long_text, std::string(200, 'a'));
+    EXPECT_EQ(arena.Intern("short"), "short");
+    EXPECT_EQ(arena.Strings(), 3u);
+
+    arena.NextGeneration();
+    EXPECT_EQ(arena.Strings(), 0u);
+    std::string_view kept = arena.Intern(first);
+    EXPECT_NE(kept.data(), first.data());
+    arena.DropGeneration();
+    EXPECT_EQ(kept, "/usr/sbin/worker --queue=1");
+    EXPECT_EQ(arena.Bytes(), kept.size());
+}
+
+// Test ProcessDetailCache interning equal command lines once
+TEST(ProcessDetailCacheTest, Get_InternsSharedStrings) {
+    ProcessDetailCache cache(1);
+    ProcessRow row{};
+    row.pid = getpid();
+    row.pss_kb = -1;
+    std::strcpy(row.comm, "monitor_tests");
+    const ProcessDetails& first = cache.Get(row, 1);
+    EXPECT_NE(first.command.find("monitor_tests"), std::string_view::npos);
+    EXPECT_FALSE(first.user.empty());
+    std::string_view const view = first.command;
+    std::string const command(view);
+    row.starttime = 1;  // another process of the same binary
+    EXPECT_EQ(cache.Get(row, 1).command.data(), view.data());
+    EXPECT_EQ(cache.Strings().Strings(), 2u);
+    // Over capacity the unused row goes, the other keeps its strings in
+    // the new generation
+    cache.Get(row, 3);
+    cache.Sweep(3);
+    EXPECT_EQ(cache.Size(), 1u);
+    EXPECT_EQ(cache.Get(row, 3).command, command);
+    EXPECT_NE(cache.Get(row, 3).command.data(), view.data());
+}
+
+// Test CgroupSampler rates and process counts on a fake tree
+TEST(CgroupSamplerTest, Sample_DerivesRatesAndCountsProcesses) {
+    std::string root = "/tmp/monitor_cgroup_sampler_" + std::to_string(getpid());
+    std::filesystem::create_directories(root + "/a");
+    std::ofstream(root + "/cpu.stat") << "usage_usec 0\n";
+    std::ofstream(root + "/a/cpu.stat") << "usage_usec 1000000\n";
+    std::ofstream(root + "/a/io.stat") << "8:0 rbytes=0 wbytes=100\n";
+    CgroupSampler sampler(16, root);
+    std::vector<CgroupRow> rows;
+    auto now = CgroupSampler::Clock::now();
+    EXPECT_EQ(sampler.Sample(rows, now), 0.0);
+    ASSERT_EQ(rows.size(), 2u);
+    std::ofstream(root + "/a/cpu.stat") << "usage_usec 1500000\n";
+    std::ofstream(root + "/a/io.stat") << "8:0 rbytes=4096 wbytes=100\n";
+    EXPECT_DOUBLE_EQ(sampler.Sample(rows, now + std::chrono::seconds(1)), 0.5);
+    EXPECT_EQ(rows[1].path, "/a");
+    EXPECT_FLOAT_EQ(rows[1].cpu_utilization, 0.5f);
+    EXPECT_DOUBLE_EQ(rows[1].read_rate, 4096.0);
+    EXPECT_DOUBLE_EQ(rows[1].write_rate, 0.0);
+
+    // Our real group is not in the fake tree, the root takes the count
+    std::vector<ProcessRow> processes(1, ProcessRow{});
+    processes[0].pid = getpid();
+    sampler.Assign(processes, rows);
+    EXPECT_EQ(processes[0].cgroup, 0);
+    EXPECT_EQ(rows[0].processes, 1);
+    EXPECT_EQ(rows[1].processes, 0);
+    std::filesystem::remove_all(root);
+}
+
+// Test InterruptSampler rates and per-CPU tops against /proc/interrupts
+TEST(InterruptSamplerTest, Sample_RanksSourcesPerCpu) {
+    if (access("/proc/interrupts", R_OK) != 0) {
+        GTEST_SKIP() << "no /proc/interrupts";
+    }
+    InterruptSampler sampler;
+    std::vector<CpuInterrupts> cpus;
+    std::vector<InterruptSource> sources;
+    auto now = InterruptSampler::Clock::now();
+    EXPECT_EQ(sampler.Sample(cpus, sources, now), 0.0);
+    EXPECT_TRUE(cpus.empty());
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    sampler.Sample(cpus, sources, now + std::chrono::seconds(1));
+    ASSERT_FALSE(cpus.empty());
+    for (std::size_t i = 1; i < sources.size(); ++i) {
+        EXPECT_GE(sources[i - 1].rate, sources[i].rate);
+    }
+    for (const CpuInterrupts& cpu : cpus) {
+        float tops{0.0f};
+        for (int slot = 0; slot < kTopInterrupts; ++slot) {
+            if (cpu.top[slot] < 0) {
+                EXPECT_EQ(cpu.top_rate[slot], 0.0f);
+                continue;
+            }
+            ASSERT_LT(cpu.top[slot], static_cast<int>(sources.size()));
+            EXPECT_GT(cpu.top_rate[slot], 0.0f);
+            EXPECT_LE(cpu.top_rate[slot], sources[cpu.top[slot]].rate);
+            if (slot > 0) {
+                EXPECT_LE(cpu.top_rate[slot], cpu.top_rate[slot - 1]);
+            }
+            tops += cpu.top_rate[slot];
+        }
+        EXPECT_LE(tops, cpu.hard_rate + cpu.soft_rate + 1.0f);
+    }
+}
+
+// Test NumaSampler rates and on-demand placement on a fake node tree
+TEST(NumaSamplerTest, Sample_DerivesRatesAndLocatesOnDemand) {
+    std::string root = "/tmp/monitor_numa_sampler_" + std::to_string(getpid());
+    std::filesystem::create_directories(root + "/node0");
+    std::ofstream(root + "/node0/cpulist") << "0\n";
+    std::ofstream(root + "/node0/meminfo") << "Node 0 MemTotal: 2048 kB\n"
+                                           << "Node 0 MemFree: 1024 kB\n";
+    std::ofstream(root + "/node0/numastat") << "numa_hit 100\nnuma_miss 0\n";
+    NumaSampler sampler(root);
+    std::vector<NumaNodeRow> nodes;
+    std::vector<NumaPlacement> placements;
+    auto now = NumaSampler::Clock::now();
+    sampler.Sample(nodes, placements, now);
+    ASSERT_EQ(nodes.size(), 1u);
+    EXPECT_EQ(nodes[0].cpus, 1);
+    EXPECT_EQ(nodes[0].free_kb, 1024);
+    EXPECT_TRUE(placements.empty());
+
+    std::ofstream(root + "/node0/numastat") << "numa_hit 300\nnuma_miss 50\n";
+    sampler.Locate(getpid());
+    sampler.Locate(-1);
+    sampler.Sample(nodes, placements, now + std::chrono::seconds(2));
+    EXPECT_FLOAT_EQ(nodes[0].hit_rate, 100.0f);
+    EXPECT_FLOAT_EQ(nodes[0].miss_rate, 25.0f);
+    EXPECT_GE(nodes[0].cpu_utilization, 0.0f);
+    EXPECT_LE(nodes[0].cpu_utilization, 1.0f);
+    // A pid without numa_maps leaves the watch list
+    EXPECT_FALSE(sampler.Located(-1));
+    if (access("/proc/self/numa_maps", R_OK) == 0) {
+        ASSERT_EQ(placements.size(), 1u);
+        EXPECT_EQ(placements[0].pid, getpid());
+    }
+    std::filesystem::remove_all(root);
+}
+
+class ProcessTreeTest : public ::testing::Test {
+protected:
+    void Add(int pid, int ppid, float cpu, long rss_kb) {
+        ProcessRow row{};
+        row.pid = pid;
+        row.ppid = ppid;
+        row.starttime = pid;
+        row.cpu_utilization = cpu;
+        row.rss_kb = rss_kb;
+        row.num_threads = 1;
+        rows.push_back(row);
+    }
+    const ProcessRow& Row(int pid) {
+        return *std::find_if(rows.begin(), rows.end(),
+                             [pid](const ProcessRow& row) { return row.pid == pid; });
+    }
+    ProcessTree tree;
+    std::vector<ProcessRow> rows;
+};
+
+// Subtrees sum their descendants, whatever order parents are scanned in
+TEST_F(ProcessTreeTest, Update_SumsSubtrees) {
+    Add(3, 2, 0.25f, 30);
+    Add(1, 0, 0.0f, 10);
+    Add(2, 1, 0.5f, 20);
+    Add(4, 1, 0.125f, 40);
+    tree.Update(rows);
+    EXPECT_FLOAT_EQ(Row(1).subtree.cpu_utilization, 0.875f);
+    EXPECT_EQ(Row(1).subtree.rss_kb, 100);
+    EXPECT_EQ(Row(1).subtree.processes, 4);
+    EXPECT_EQ(Row(2).subtree.rss_kb, 50);
+    EXPECT_EQ(Row(3).subtree.processes, 1);
+}
+
+// Changes, exits and reparenting only move the affected totals
+TEST_F(ProcessTreeTest, Update_FollowsChangesExitsAndMoves) {
+    Add(1, 0, 0.0f, 10);
+    Add(2, 1, 0.5f, 20);
+    Add(3, 2, 0.25f, 30);
+    Add(4, 1, 0.125f, 40);
+    tree.Update(rows);
+    rows[2].cpu_utilization = 1.0f;
+    tree.Update(rows);
+    EXPECT_FLOAT_EQ(Row(2).subtree.cpu_utilization, 1.5f);
+    EXPECT_FLOAT_EQ(Row(1).subtree.cpu_utilization, 1.625f);
+
+    // 2 exits, 3 is reparented below 4
+    rows.erase(rows.begin() + 1);
+    rows[1].ppid = 4;
+    tree.Update(rows);
+    EXPECT_EQ(tree.Size(), 3u);
+    EXPECT_EQ(Row(4).subtree.processes, 2);
+    EXPECT_EQ(Row(4).subtree.rss_kb, 70);
+    EXPECT_EQ(Row(1).subtree.rss_kb, 80);
+    subtree_t subtree;
+    EXPECT_FALSE(tree.Subtree(2, subtree));
+    ASSERT_TRUE(tree.Subtree(1, subtree));
+    EXPECT_FLOAT_EQ(subtree.cpu_utilization, 1.125f);
+}
+
+// Flatten lists depth first and hides collapsed subtrees
+TEST_F(ProcessTreeTest, Flatten_OrdersDepthFirst) {
+    Add(1, 0, 0.0f, 10);
+    Add(2, 1, 0.5f, 20);
+    Add(3, 2, 0.25f, 30);
+    Add(4, 1, 0.75f, 40);
+    tree.Update(rows);
+    std::vector<std::uint32_t> order;
+    std::vector<std::uint16_t> depths;
+    ProcessTree::Flatten(rows, {}, order, depths);
+    EXPECT_EQ(order, (std::vector<std::uint32_t>{0, 1, 2, 3}));
+    EXPECT_EQ(depths, (std::vector<std::uint16_t>{0, 1, 2, 1}));
+    rows[3].cpu_utilization = 0.9f;
+    tree.Update(rows);
+    ProcessTree::Flatten(rows, {2}, order, depths);
+    EXPECT_EQ(order, (std::vector<std::uint32_t>{0, 3, 1}));
+}
+
+// Test that only expanded or matching processes get thread rows
+TEST(ThreadSamplerTest, Sample_ReadsWatchedProcessesOnly) {
+    ThreadSampler sampler;
+    std::vector<ProcessRow> processes(1, ProcessRow{});
+    processes[0].pid = getpid();
+    std::strcpy(processes[0].comm, "monitor_tests");
+    std::vector<ThreadRow> threads;
+    auto now = ThreadSampler::Clock::now();
+    sampler.Sample(processes, threads, now);
+    EXPECT_TRUE(threads.empty());
+    sampler.SetFilter("tests");
+    sampler.Sample(processes, threads, now);
+    ASSERT_FALSE(threads.empty());
+    sampler.SetFilter("");
+    sampler.Expand(getpid());
+    EXPECT_TRUE(sampler.Expanded(getpid()));
+    sampler.Sample(processes, threads, now + std::chrono::seconds(1));
+    ASSERT_FALSE(threads.empty());
+    EXPECT_EQ(threads[0].pid, getpid());
+    EXPECT_GE(threads[0].cpu_utilization, 0.0f);
+    // Exited processes are forgotten
+    processes.clear();
+    sampler.Sample(processes, threads, now);
+    EXPECT_TRUE(threads.empty());
+    EXPECT_FALSE(sampler.Expanded(getpid()));
+}
+
+// Test that a read budget smaller than the thread count still covers all
+TEST(ThreadSamplerTest, Sample_SpreadsReadsOverRounds) {
+    std::atomic<bool> stop{false};
+    std::thread worker([&stop] { while (!stop) std::this_thread::yield(); });
+    ThreadSampler sampler(1);
+    std::vector<ProcessRow> processes(1, ProcessRow{});
+    processes[0].pid = getpid();
+    sampler.Expand(getpid());
+    std::vector<ThreadRow> threads;
+    auto now = ThreadSampler::Clock::now();
+    sampler.Sample(processes, threads, now);
+    EXPECT_EQ(threads.size(), 1u);
+    sampler.Sample(processes, threads, now);
+    EXPECT_EQ(threads.size(), 2u);
+    stop = true;
+    worker.join();
+}
+
+// Fixed values that remember which fields were asked for
+class FakeSubject : public FilterSubject {
+public:
+    bool Number(FilterField field, double& value) override {
+        reads.push_back(field);
+        value = field == FilterField::kCpu ? cpu : field == FilterField::kUser ? uid : 1;
+        return true;
+    }
+    bool Text(FilterField field, std::string& text) override {
+        reads.push_back(field);
+        text = field == FilterField::kCmd ? "postgres: worker 3" : "x";
+        return true;
+    }
+    double cpu{0.0};
+    double uid{0.0};
+    std::vector<FilterField> reads;
+};
+
+// Test that comparisons run cheapest first, and that a failed cpu test
+// still runs the lifetime tests so the process can be excluded for good
+TEST(ProcessFilterTest, Evaluate_ReadsCheapFieldsFirst) {
+    ProcessFilter filter("cmd~\"worker\" && user=root && cpu>5");
+    FakeSubject idle;
+    EXPECT_EQ(filter.Evaluate(idle), FilterResult::kMismatch);
+    EXPECT_EQ(idle.reads, (std::vector<FilterField>{FilterField::kCpu, FilterField::kUser,
+                                                    FilterField::kCmd}));
+    idle.reads.clear();
+    EXPECT_EQ(filter.Evaluate(idle, true), FilterResult::kMismatch);
+    EXPECT_EQ(idle.reads, std::vector<FilterField>{FilterField::kCpu});
+
+    FakeSubject idle_other_user;
+    idle_other_user.uid = 1000.0;
+    EXPECT_EQ(filter.Evaluate(idle_other_user), FilterResult::kExcluded);
+    EXPECT_EQ(idle_other_user.reads,
+              (std::vector<FilterField>{FilterField::kCpu, FilterField::kUser}));
+
+    FakeSubject other_user;
+    other_user.cpu = 10.0;
+    other_user.uid = 1000.0;
+    EXPECT_EQ(filter.Evaluate(other_user), FilterResult::kExcluded);
+    EXPECT_EQ(other_user.reads,
+              (std::vector<FilterField>{FilterField::kCpu, FilterField::kUser}));
+
+    FakeSubject busy;
+    busy.cpu = 10.0;
+    EXPECT_EQ(filter.Evaluate(busy), FilterResult::kMatch);
+    EXPECT_EQ(busy.reads.back(), FilterField::kCmd);
+    // A settled process is only tested on what changes
+    busy.reads.clear();
+    EXPECT_EQ(filter.Evaluate(busy, true), FilterResult::kMatch);
+    EXPECT_EQ(busy.reads, std::vector<FilterField>{FilterField::kCpu});
+}
+
+// Test that malformed expressions are rejected when compiled
+TEST(ProcessFilterTest, Constructor_RejectsMalformedExpressions) {
+    for (const char* expression :
+         {"", "cpu", "cpu>", "cpu>x", "size=1", "comm>3", "cpu~5", "user<5",
+          "cmd~\"open", "cpu>5 cmd=x", "cpu>5 &&"}) {
+        EXPECT_THROW(ProcessFilter filter(expression), std::invalid_argument)
+            << expression;
+    }
+    EXPECT_NO_THROW(ProcessFilter("pid>=1&&state!=Z && comm!~kworker"));
+}
+
+// Test that a filtered scan lists the matches only and stops reading the
+// processes it excluded
+TEST(SystemTest, Processes_ListsFilterMatchesOnly) {
+    System system;
+    system.SetFilter(std::make_shared<const ProcessFilter>(
+        "pid=" + std::to_string(getpid())));
+    for (int scan = 0; scan < 2; ++scan) {
+        std::vector<Process>& processes = system.Processes();
+        ASSERT_EQ(processes.size(), 1u);
+        EXPECT_EQ(processes[0].Pid(), getpid());
+    }
+    EXPECT_GE(system.TotalProcesses(), 1);
+    EXPECT_EQ(system.FilterExpression(), "pid=" + std::to_string(getpid()));
+    system.SetFilter(nullptr);
+    EXPECT_GE(system.Processes().size(), 1u);
+    EXPECT_TRUE(system.FilterExpression().empty());
+}
+
+// Test that once every process failed the user test, a scan only reads a
+// bounded slice of the excluded ones instead of one file per process
+TEST(SystemTest, Processes_ReadsLittleOnceExcluded) {
+    constexpr int kChildren = 64;
+    std::vector<pid_t> children;
+    for (int i = 0; i < kChildren; ++i) {
+        pid_t child = fork();
+        if (child == 0) {
+            for (;;) pause();
+        }
+        ASSERT_GT(child, 0);
+        children.push_back(child);
+    }
+    // Old enough to have settled, idle so they fail the cpu test first
+    std::this_thread::sleep_for(std::chrono::milliseconds(2200));
+    System system;
+    system.SetFilter(std::make_shared<const ProcessFilter>("cpu>50 && user=54321"));
+    EXPECT_TRUE(system.Processes().empty());
+    std::uint64_t const first = system.ScanReads();
+    EXPECT_GE(first, static_cast<std::uint64_t>(2 * kChildren));
+    constexpr int kScans = 4;
+    for (int scan = 0; scan < kScans; ++scan) {
+        EXPECT_TRUE(system.Processes().empty());
+    }
+    EXPECT_LT((system.ScanReads() - first) / kScans, static_cast<std::uint64_t>(kChildren));
+    for (pid_t child : children) {
+        kill(child, SIGKILL);
+        waitpid(child, nullptr, 0);
+    }
+}
+
+// Test that trigger events of a PressureMonitor are listed by the
+// SystemParser sharing its PressureParser
+TEST(PressureMonitorTest, Start_ReportsEventsThroughSystemParser) {
+    parser_factory::CpuParser cpu;
+    parser_factory::MemoryParser memory;
+    parser_factory::ProcessParser process;
+    parser_factory::PressureParser pressure;
+    parser_factory::SystemParser system(cpu, memory, process, pressure);
+    // 1 ms of stall within 2 s, easy to cause by oversubscribing the CPUs
+    if (!pressure.AddTrigger(parser_factory::PsiResource::kCpu, "some 1000 2000000")) {
+        GTEST_SKIP() << "PSI triggers unavailable";
+    }
+    std::atomic<std::size_t> fired{0};
+    PressureMonitor monitor(pressure, [&fired](std::size_t events) { fired += events; });
+    ASSERT_TRUE(monitor.Start());
+
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> spinners;
+    unsigned const count = 4 * std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < count; ++i) {
+        spinners.emplace_back([&stop] {
+            while (!stop) {
+            }
+        });
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (fired == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    stop = true;
+    for (std::thread& spinner : spinners) {
+        spinner.join();
+    }
+    monitor.Stop();
+    ASSERT_GT(fired.load(), 0u);
+    EXPECT_NE(system.GetPressureEvents().find(" cpu some "), std::string::npos);
+}
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include "telemetry/latency.h"
+#include <cstdint>
+#include <set>
+#include <string>
+#include <thread>
+
+using namespace telemetry;
+
+// Test that every value lands in a bucket within ~3% of it
+TEST(LatencyHistogramTest, BucketFor_BoundsRelativeError) {
+    for (std::uint64_t value : {0ull, 63ull, 64ull, 1000ull, 123456ull,
+                                999999999ull, (1ull << 40) - 1}) {
+        std::uint64_t high = LatencyHistogram::HighestValueIn(
+            LatencyHistogram::BucketFor(value));
+        EXPECT_GE(high, value);
+        EXPECT_LE(high - value, value / 32 + 1) << value;
+    }
+    EXPECT_EQ(LatencyHistogram::BucketFor(1ull << 50),
+              LatencyHistogram::kBucketCount - 1);
+}
+
+// Test percentiles, max and merge
+TEST(LatencyHistogramTest, Percentile_ReadsMergedDistribution) {
+    LatencyHistogram first;
+    LatencyHistogram second;
+    for (std::uint64_t i = 1; i <= 99; ++i) first.Record(i * 1000);
+    second.Record(5000000);
+    LatencyHistogram merged;
+    merged.Merge(first);
+    merged.Merge(second);
+    EXPECT_EQ(merged.Count(), 100u);
+    EXPECT_EQ(merged.Max(), 5000000u);
+    EXPECT_NEAR(static_cast<double>(merged.Percentile(50)), 50000.0, 50000.0 * 0.04);
+    EXPECT_NEAR(static_cast<double>(merged.Percentile(99)), 99000.0, 99000.0 * 0.04);
+    EXPECT_EQ(merged.Percentile(100), 5000000u);
+    merged.Reset();
+    EXPECT_EQ(merged.Percentile(50), 0u);
+}
+
+// Test that probes of several threads are merged and nesting counts once
+TEST(ScopedProbeTest, MergeProbe_CollectsEveryThread) {
+    LatencyHistogram before;
+    MergeProbe(Probe::kSystem, before);
+    auto work = [] {
+        ScopedProbe outer(Probe::kSystem);
+        ScopedProbe inner(Probe::kSystem);
+    };
+    std::thread a(work);
+    std::thread b(work);
+    a.join();
+    b.join();
+    LatencyHistogram after;
+    MergeProbe(Probe::kSystem, after);
+    EXPECT_EQ(after.Count() - before.Count(), 2u);
+    EXPECT_NE(Describe({Probe::kSystem}).find("system: p50 "), std::string::npos);
+}
+
+// Test that every probe has its own name
+TEST(ScopedProbeTest, ProbeName_NamesEveryProbe) {
+    std::set<std::string> names;
+    for (int i = 0; i < kProbeCount; ++i) {
+        std::string name = ProbeName(static_cast<Probe>(i));
+        EXPECT_NE(name, "unknown");
+        names.insert(name);
+    }
+    EXPECT_EQ(names.size(), static_cast<std::size_t>(kProbeCount));
+    EXPECT_STREQ(ProbeName(Probe::kNetwork), "network");
+    EXPECT_STREQ(ProbeName(Probe::kNuma), "numa");
+}